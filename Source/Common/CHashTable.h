@@ -214,6 +214,21 @@ public:
 		}
 	}
 
+	// Ensure the table can hold the given number of entries without resizing again. Useful
+	// before adding many keys at once, avoids repeated resizing as the table grows
+	void Reserve( const TUInt32 iNumEntries )
+	{
+		TUInt32 iNewSize = m_iSize;
+		while (iNumEntries > iNewSize * m_kfMaxLoadFactor)
+		{
+			iNewSize *= 2;
+		}
+		if (iNewSize != m_iSize)
+		{
+			Resize( iNewSize );
+		}
+	}
+
 
 	// Output a table illustrating the number of entries in each bucket - that is the number
 	// of keys that correspond to each hash value. Ideally there should always be 0 or 1 - no
@@ -1,12 +1,11 @@
 /*******************************************
-	
+
 	CTimer.cpp
 
 	Timer class implementation
 
 ********************************************/
 
-#include "Windows.h"
 #include "CTimer.h"
 
 //////////////////////////////
@@ -14,9 +13,6 @@
 
 CTimer::CTimer()
 {
-	// Try to initialise performance timer, will use low-resolution timer on failure
-	m_HighRes = (QueryPerformanceFrequency( &m_HighResFreq ) != 0);
-
 	// Reset and start the timer
 	Reset();
 	m_Running = true;
@@ -34,38 +30,19 @@ void CTimer::Start()
 		m_Running = true;
 
 		// Get restart time - add time passed since stop time to the start and lap times
-		// Select high or low-resolution timer
-		if (m_HighRes)
-		{
-			LARGE_INTEGER newHighResTime;
-			QueryPerformanceCounter( &newHighResTime );
-			m_HighResStart.QuadPart += (newHighResTime.QuadPart - m_HighResStop.QuadPart);
-			m_HighResLap.QuadPart += (newHighResTime.QuadPart - m_HighResStop.QuadPart);
-		}
-		else
-		{
-			DWORD newLowResTime;
-			newLowResTime = timeGetTime();
-			m_LowResStart += (newLowResTime - m_LowResStop);
-			m_LowResLap += (newLowResTime - m_LowResStop);
-		}
+		TTicks newTime = Now();
+		m_Start += (newTime - m_Stop);
+		m_Lap += (newTime - m_Stop);
 	}
 }
 
 // Stop the timer running
 void CTimer::Stop()
 {
-	m_Running = false;
-
-	// Get stop time
-	// Select high or low-resolution timer
-	if (m_HighRes)
+	if (m_Running)
 	{
-		QueryPerformanceCounter( &m_HighResStop );
-	}
-	else
-	{
-		m_LowResStop = timeGetTime();
+		m_Running = false;
+		m_Stop = Now();
 	}
 }
 
@@ -73,19 +50,9 @@ void CTimer::Stop()
 void CTimer::Reset()
 {
 	// Reset start, lap and stop times to current time
-	// Select high or low-resolution timer
-	if (m_HighRes)
-	{
-		QueryPerformanceCounter( &m_HighResStart );
-		m_HighResLap = m_HighResStart;
-		m_HighResStop = m_HighResStart;
-	}
-	else
-	{
-		m_LowResStart = timeGetTime();
-		m_LowResLap = m_LowResStart;
-		m_LowResStop = m_LowResStart;
-	}
+	m_Start = Now();
+	m_Lap = m_Start;
+	m_Stop = m_Start;
 }
 
 
@@ -93,90 +60,64 @@ void CTimer::Reset()
 // Timing
 
 // Get frequency of the timer being used (in counts per second)
-float CTimer::GetFrequency()
+double CTimer::GetFrequency() const
 {
-	// Select high or low-resolution timer
-	if (m_HighRes)
-	{
-		return static_cast<float>(m_HighResFreq.QuadPart);
-	}
-	else
-	{
-		return 1000.0f;
-	}
+	return static_cast<double>(TClock::period::den) / TClock::period::num;
 }
 
 // Get time passed (seconds) since since timer was started or last reset
-float CTimer::GetTime()
+double CTimer::GetTime() const
 {
-	float fTime;
-	if (m_HighRes)
-	{
-
-		LARGE_INTEGER newHighResTime;
-		if (m_Running)
-		{
-			QueryPerformanceCounter( &newHighResTime );
-		}
-		else
-		{
-			newHighResTime = m_HighResStop;
-		}
-		double dTime = static_cast<double>(newHighResTime.QuadPart - m_HighResStart.QuadPart) /
-			           static_cast<double>(m_HighResFreq.QuadPart);
-		fTime = static_cast<float>(dTime);
-	}
-	else
-	{
-		DWORD newLowResTime;
-		if (m_Running)
-		{
-			newLowResTime = timeGetTime();
-		}
-		else
-		{
-			newLowResTime = m_LowResStop;
-		}
-		fTime = static_cast<float>(newLowResTime - m_LowResStart) / 1000.0f;
-	}
-
-	return fTime;
+	return static_cast<double>(GetTicks()) / GetFrequency();
 }
 
 // Get time passed (seconds) since last call to this function. If this is the first call, then
 // the time since timer was started or the last reset is returned
-float CTimer::GetLapTime()
+double CTimer::GetLapTime()
 {
-	float fTime;
-	if (m_HighRes)
-	{
-		LARGE_INTEGER newHighResTime;
-		if (m_Running)
-		{
-			QueryPerformanceCounter( &newHighResTime );
-		}
-		else
-		{
-			newHighResTime = m_HighResStop;
-		}
-		double dTime = static_cast<double>(newHighResTime.QuadPart - m_HighResLap.QuadPart) /
-			           static_cast<double>(m_HighResFreq.QuadPart);
-		fTime = static_cast<float>(dTime);
-		m_HighResLap = newHighResTime;
-	}
-	else
+	return static_cast<double>(GetLapTicks()) / GetFrequency();
+}
+
+// Get ticks passed since since timer was started or last reset
+CTimer::TTicks CTimer::GetTicks() const
+{
+	TTicks newTime = m_Running ? Now() : m_Stop;
+	return newTime - m_Start;
+}
+
+// Get ticks passed since last call to this function or GetLapTime. Each lap starts exactly where
+// the last ended, so the laps always add up to the total time
+CTimer::TTicks CTimer::GetLapTicks()
+{
+	TTicks newTime = m_Running ? Now() : m_Stop;
+	TTicks lapTicks = newTime - m_Lap;
+	m_Lap = newTime;
+	return lapTicks;
+}
+
+
+//////////////////////////////
+// Clocks
+
+// Rate of the cycle counter, measured against the monotonic clock on first use
+double CTimer::CyclesPerSecond()
+{
+	// Calculated once, thread-safe as a function static
+	static const double cyclesPerSecond = []()
 	{
-		DWORD newLowResTime;
-		if (m_Running)
-		{
-			newLowResTime = timeGetTime();
-		}
-		else
+		const TClock::duration kCalibrationTime = std::chrono::milliseconds( 20 );
+
+		TClock::time_point startTime = TClock::now();
+		TTicks startCycles = Cycles();
+		TClock::time_point endTime;
+		do
 		{
-			newLowResTime = m_LowResStop;
-		}
-		fTime = static_cast<float>(newLowResTime - m_LowResLap) / 1000.0f;
-		m_LowResLap = newLowResTime;
-	}
-	return fTime;
+			endTime = TClock::now();
+		} while (endTime - startTime < kCalibrationTime);
+		TTicks endCycles = Cycles();
+
+		double seconds = std::chrono::duration<double>( endTime - startTime ).count();
+		return static_cast<double>(endCycles - startCycles) / seconds;
+	}();
+	return cyclesPerSecond;
 }
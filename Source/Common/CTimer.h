@@ -1,5 +1,5 @@
 /*******************************************
-	
+
 	CTimer.h
 
 	Timer class declarations
@@ -8,19 +8,32 @@
 
 #pragma once
 
+#include <cstdint>
+#include <chrono>
 
-#include "Windows.h"
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+	#include <x86intrin.h>
+#endif
 
+// Timer measuring real time with the monotonic clock (QueryPerformanceCounter on Windows,
+// clock_gettime(CLOCK_MONOTONIC) on Linux). Times are kept as 64-bit integer clock ticks and
+// only converted to seconds when read, so lap times do not drift however long the timer runs
 class CTimer
 {
 public:
+	// Clock used for all timers and its tick count type
+	typedef std::chrono::steady_clock TClock;
+	typedef std::int64_t TTicks;
+
 
 	//////////////////////////////
 	// Constructor
 
 	CTimer();
 
-	
+
 	//////////////////////////////
 	// Timer control
 
@@ -38,37 +51,54 @@ public:
 	// Timing
 
 	// Get frequency of the timer being used (in counts per second)
-	float GetFrequency();
+	double GetFrequency() const;
 
 	// Get time passed (seconds) since since timer was started or last reset
-	float GetTime();
+	double GetTime() const;
 
 	// Get time passed (seconds) since last call to this function. If this is the first call, then
 	// the time since timer was started or the last reset is returned
-	float GetLapTime();
-
-
-private:
-	// Is the timer running
-	bool m_Running;
+	double GetLapTime();
 
+	// As above, but in clock ticks
+	TTicks GetTicks() const;
+	TTicks GetLapTicks();
 
-	// Using high resolution timer and if so its frequency
-	bool          m_HighRes;
-	LARGE_INTEGER m_HighResFreq;
 
-	// Start time and last lap start time of high-resolution timer
-	LARGE_INTEGER m_HighResStart;
-	LARGE_INTEGER m_HighResLap;
+	//////////////////////////////
+	// Clocks
+
+	// Current time of the monotonic clock in ticks, see GetFrequency for ticks per second
+	static TTicks Now()
+	{
+		return static_cast<TTicks>(TClock::now().time_since_epoch().count());
+	}
+
+	// Current CPU cycle count - a single instruction on x86, for timing short sections of code
+	// such as profiler zones. Only differences between counts on the same run are meaningful,
+	// use CyclesPerSecond to convert them to time. Falls back to the monotonic clock on other
+	// processors
+	static TTicks Cycles()
+	{
+	#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+		return static_cast<TTicks>(__rdtsc());
+	#else
+		return Now();
+	#endif
+	}
+
+	// Rate of the cycle counter, measured against the monotonic clock on first use (takes ~20ms)
+	static double CyclesPerSecond();
 
-	// Time when high-resolution timer was stopped (if it has been)
-	LARGE_INTEGER m_HighResStop;
 
+private:
+	// Is the timer running
+	bool m_Running;
 
-	// Start time and last lap start time of low-resolution timer
-	DWORD m_LowResStart;
-	DWORD m_LowResLap;
+	// Start time and last lap start time
+	TTicks m_Start;
+	TTicks m_Lap;
 
-	// Time when low-resolution timer was stopped (if it has been)
-	DWORD m_LowResStop;
+	// Time when the timer was stopped (if it has been)
+	TTicks m_Stop;
 };
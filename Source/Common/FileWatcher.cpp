@@ -0,0 +1,100 @@
+/*******************************************
+	FileWatcher.cpp
+
+	Reports changes to a set of files in a
+	folder
+********************************************/
+
+#include <windows.h>
+#include "FileWatcher.h"
+
+namespace gen
+{
+
+// Constructor creates a watcher on no folder
+CFileWatcher::CFileWatcher()
+{
+	m_Notification = 0;
+}
+
+// Destructor stops watching
+CFileWatcher::~CFileWatcher()
+{
+	Stop();
+}
+
+
+// Start watching the given folder (including its sub-folders), returns false on failure
+bool CFileWatcher::Start( const string& folder )
+{
+	Stop();
+	HANDLE notification = FindFirstChangeNotification( folder.c_str(), TRUE,
+	                                                   FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME );
+	if (notification == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	m_Folder = folder;
+	m_Notification = notification;
+	return true;
+}
+
+// Stop watching and forget all files
+void CFileWatcher::Stop()
+{
+	if (m_Notification)
+	{
+		FindCloseChangeNotification( m_Notification );
+		m_Notification = 0;
+	}
+	m_Files.clear();
+}
+
+
+// Add a file to watch, does nothing if the file is already watched
+void CFileWatcher::AddFile( const string& fileName )
+{
+	if (m_Files.find( fileName ) == m_Files.end())
+	{
+		m_Files[fileName] = WriteTime( fileName );
+	}
+}
+
+// Get the watched files that have been written since they were added or last reported
+bool CFileWatcher::Poll( vector<string>* pChangedFiles )
+{
+	pChangedFiles->clear();
+	if (!m_Notification || WaitForSingleObject( m_Notification, 0 ) != WAIT_OBJECT_0)
+	{
+		return false;
+	}
+	FindNextChangeNotification( m_Notification );
+
+	// Something in the folder changed, see if it was one of ours. Editors often save in several
+	// steps, a file caught part way through will be reported again when the save completes
+	for (map<string, TUInt64>::iterator file = m_Files.begin(); file != m_Files.end(); ++file)
+	{
+		TUInt64 writeTime = WriteTime( file->first );
+		if (writeTime != file->second)
+		{
+			file->second = writeTime;
+			pChangedFiles->push_back( file->first );
+		}
+	}
+	return !pChangedFiles->empty();
+}
+
+
+// Get the last write time of a file in the folder, 0 if it does not exist
+TUInt64 CFileWatcher::WriteTime( const string& fileName )
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesEx( (m_Folder + fileName).c_str(), GetFileExInfoStandard, &data ))
+	{
+		return 0;
+	}
+	return (static_cast<TUInt64>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+}
+
+
+} // namespace gen
@@ -0,0 +1,75 @@
+/*******************************************
+	FileWatcher.h
+
+	Reports changes to a set of files in a
+	folder
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Watches files within a folder and reports those whose last write time has changed. Uses a
+// Windows change notification on the folder, so polling costs a single wait with no timeout
+// when nothing has changed - it can be called every frame. File names are given and returned
+// relative to the folder, e.g. watching "Media\\" for "Scene.xml"
+class CFileWatcher
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates a watcher on no folder
+	CFileWatcher();
+
+	// Destructor stops watching
+	~CFileWatcher();
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CFileWatcher( const CFileWatcher& );
+	CFileWatcher& operator=( const CFileWatcher& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Start watching the given folder (including its sub-folders), returns false on failure.
+	// The folder name should end with a separator
+	bool Start( const string& folder );
+
+	// Stop watching and forget all files
+	void Stop();
+
+	// Add a file to watch, does nothing if the file is already watched. Changes are reported
+	// from the time the file is added
+	void AddFile( const string& fileName );
+
+	// Get the watched files that have been written since they were added or last reported.
+	// Returns true if there were any
+	bool Poll( vector<string>* pChangedFiles );
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	// Get the last write time of a file in the folder, 0 if it does not exist
+	TUInt64 WriteTime( const string& fileName );
+
+
+	string                m_Folder;
+	void*                 m_Notification; // Windows change notification handle, 0 if not started
+	map<string, TUInt64>  m_Files;        // Last write time of each file when last checked
+};
+
+
+} // namespace gen
@@ -0,0 +1,94 @@
+/*******************************************
+	FrameArena.cpp
+
+	Linear allocator for data that only lives
+	until the end of the current frame
+********************************************/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "FrameArena.h"
+
+namespace gen
+{
+
+// Constructor allocates a block of the given size in bytes
+CFrameArena::CFrameArena( TUInt32 size /*= kDefaultSize*/ )
+{
+	m_pBlock = new TUInt8[size];
+	m_Size = size;
+	m_Used = 0;
+	m_OverflowBytes = 0;
+}
+
+// Destructor frees the block
+CFrameArena::~CFrameArena()
+{
+	Reset();
+	delete[] m_pBlock;
+}
+
+
+// Release everything allocated since the last reset
+void CFrameArena::Reset()
+{
+	if (!m_Overflow.empty())
+	{
+		for (TUInt32 overflow = 0; overflow < m_Overflow.size(); ++overflow)
+		{
+			delete[] m_Overflow[overflow];
+		}
+		m_Overflow.clear();
+
+		// Enlarge the block so a frame like this one fits, with some room to spare
+		size_t newSize = (m_Used + m_OverflowBytes) * 3 / 2;
+		delete[] m_pBlock;
+		m_pBlock = new TUInt8[newSize];
+		m_Size = newSize;
+		m_OverflowBytes = 0;
+	}
+	m_Used = 0;
+}
+
+
+// Allocate from the heap when the block is full
+void* CFrameArena::AllocateOverflow( size_t size, size_t alignment )
+{
+	TUInt8* pOverflow = new TUInt8[size + alignment];
+	m_Overflow.push_back( pOverflow );
+	m_OverflowBytes += size + alignment;
+
+	size_t address = reinterpret_cast<size_t>(pOverflow);
+	return pOverflow + (((address + alignment - 1) & ~(alignment - 1)) - address);
+}
+
+
+// Append text formatted as for printf to a frame string
+void AppendFormat( TFrameString* pText, const char* format, ... )
+{
+	// Most text fits in a small buffer on the stack, longer text is formatted a second time
+	// straight into the string once its length is known
+	char buffer[256];
+	va_list args;
+	va_start( args, format );
+	int length = vsnprintf( buffer, sizeof(buffer), format, args );
+	va_end( args );
+	if (length < 0)
+	{
+		return;
+	}
+	if (length < static_cast<int>(sizeof(buffer)))
+	{
+		pText->append( buffer, length );
+		return;
+	}
+
+	size_t start = pText->size();
+	pText->resize( start + length );
+	va_start( args, format );
+	vsnprintf( &(*pText)[start], length + 1, format, args );
+	va_end( args );
+}
+
+
+} // namespace gen
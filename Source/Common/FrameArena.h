@@ -0,0 +1,143 @@
+/*******************************************
+	FrameArena.h
+
+	Linear allocator for data that only lives
+	until the end of the current frame
+********************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Hands out memory for transient data (e.g. text formatted for this frame) by moving a pointer
+// through one preallocated block, so allocating is a few instructions and freeing is nothing.
+// Everything is released together by Reset at the end of each frame. If a frame needs more than
+// the block holds, the extra comes from the heap and the block is enlarged at the next Reset so
+// later frames fit. Use from the main thread only
+class CFrameArena
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor allocates a block of the given size in bytes
+	CFrameArena( TUInt32 size = kDefaultSize );
+
+	// Destructor frees the block, anything still using it must be gone
+	~CFrameArena();
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CFrameArena( const CFrameArena& );
+	CFrameArena& operator=( const CFrameArena& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+	// Default size of the block in bytes
+	static const TUInt32 kDefaultSize = 256 * 1024;
+
+	// Allocate memory with the given alignment (a power of 2), valid until the next Reset
+	void* Allocate( size_t size, size_t alignment )
+	{
+		size_t start = (m_Used + alignment - 1) & ~(alignment - 1);
+		if (start + size > m_Size)
+		{
+			return AllocateOverflow( size, alignment );
+		}
+		m_Used = start + size;
+		return m_pBlock + start;
+	}
+
+	// Release everything allocated since the last reset, call at the end of each frame once no
+	// transient data is in use
+	void Reset();
+
+	// Bytes allocated since the last reset, including any that did not fit in the block
+	size_t BytesUsed() const
+	{
+		return m_Used + m_OverflowBytes;
+	}
+
+	// Size of the block in bytes
+	size_t Capacity() const
+	{
+		return m_Size;
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+	// Allocate from the heap when the block is full
+	void* AllocateOverflow( size_t size, size_t alignment );
+
+	TUInt8* m_pBlock;
+	size_t  m_Size;
+	size_t  m_Used;
+
+	// Allocations that did not fit in the block this frame
+	vector<TUInt8*> m_Overflow;
+	size_t          m_OverflowBytes;
+};
+
+
+// STL allocator taking memory from a frame arena, so containers and strings used within a frame
+// make no heap allocations, e.g.
+//     TFrameString text( FrameArena );
+// Memory is only reclaimed when the arena is reset, so these should not be grown repeatedly
+template <typename T>
+class CFrameAllocator
+{
+public:
+	typedef T value_type;
+
+	CFrameAllocator( CFrameArena& arena ) : m_pArena( &arena ) {}
+
+	template <typename U>
+	CFrameAllocator( const CFrameAllocator<U>& other ) : m_pArena( other.m_pArena ) {}
+
+	T* allocate( size_t n )
+	{
+		return static_cast<T*>(m_pArena->Allocate( n * sizeof(T), alignof(T) ));
+	}
+
+	void deallocate( T*, size_t ) {}
+
+	// Arena memory comes from, public so other instantiations can copy it
+	CFrameArena* m_pArena;
+};
+
+template <typename T, typename U>
+bool operator==( const CFrameAllocator<T>& a, const CFrameAllocator<U>& b )
+{
+	return a.m_pArena == b.m_pArena;
+}
+
+template <typename T, typename U>
+bool operator!=( const CFrameAllocator<T>& a, const CFrameAllocator<U>& b )
+{
+	return a.m_pArena != b.m_pArena;
+}
+
+
+// String and vector using frame arena memory
+typedef basic_string<char, char_traits<char>, CFrameAllocator<char> > TFrameString;
+
+template <typename T>
+using TFrameVector = vector<T, CFrameAllocator<T> >;
+
+
+// Append text formatted as for printf to a frame string
+void AppendFormat( TFrameString* pText, const char* format, ... );
+
+
+} // namespace gen
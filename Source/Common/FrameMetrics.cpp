@@ -0,0 +1,299 @@
+/*******************************************
+	FrameMetrics.cpp
+
+	Histograms of frame, update and render
+	times with percentile statistics
+********************************************/
+
+#include <fstream>
+#include <iomanip>
+#include "FrameMetrics.h"
+
+namespace gen
+{
+
+// Times below this have a bucket each, above it each power of 2 has kSubBuckets buckets
+static const TUInt32 kLinearTimes = 64;
+static const TUInt32 kSubBuckets = 32;
+
+// Names of the metrics in the summary and output files
+static const char* const kMetricNames[NumFrameMetrics] = { "Frame", "Update", "Render" };
+
+// Percentiles reported
+static const TUInt32  kNumPercentiles = 3;
+static const TFloat32 kPercentiles[kNumPercentiles] = { 50.0f, 95.0f, 99.0f };
+
+
+// Convert microseconds to milliseconds
+static TFloat32 ToMilliseconds( TUInt32 microseconds )
+{
+	return microseconds * 0.001f;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Time histogram
+-----------------------------------------------------------------------------------------*/
+
+// Constructor creates an empty histogram
+CTimeHistogram::CTimeHistogram()
+{
+	Clear();
+}
+
+// Add a time in microseconds
+void CTimeHistogram::Record( TUInt32 microseconds )
+{
+	++m_Buckets[BucketIndex( microseconds )];
+	++m_Count;
+	m_Sum += microseconds;
+	if (microseconds > m_Max) m_Max = microseconds;
+}
+
+// Add all the times in another histogram to this one
+void CTimeHistogram::Add( const CTimeHistogram& histogram )
+{
+	for (TUInt32 bucket = 0; bucket < kNumBuckets; ++bucket)
+	{
+		m_Buckets[bucket] += histogram.m_Buckets[bucket];
+	}
+	m_Count += histogram.m_Count;
+	m_Sum += histogram.m_Sum;
+	if (histogram.m_Max > m_Max) m_Max = histogram.m_Max;
+}
+
+// Remove all times
+void CTimeHistogram::Clear()
+{
+	for (TUInt32 bucket = 0; bucket < kNumBuckets; ++bucket)
+	{
+		m_Buckets[bucket] = 0;
+	}
+	m_Count = 0;
+	m_Sum = 0;
+	m_Max = 0;
+}
+
+
+// Time in microseconds that the given percentage (0-100) of times are at or below
+TUInt32 CTimeHistogram::Percentile( TFloat32 percent ) const
+{
+	if (m_Count == 0)
+	{
+		return 0;
+	}
+
+	// Number of times that must be at or below the result. Uses integer thousandths of a percent
+	// so percentages like 99.9 that are not exact as floats do not round up a whole time
+	TUInt64 thousandths = static_cast<TUInt64>(percent * 1000.0f + 0.5f);
+	TUInt32 target = static_cast<TUInt32>((thousandths * m_Count + 99999) / 100000);
+	if (target < 1) target = 1;
+	if (target > m_Count) target = m_Count;
+
+	TUInt32 total = 0;
+	for (TUInt32 bucket = 0; bucket < kNumBuckets; ++bucket)
+	{
+		total += m_Buckets[bucket];
+		if (total >= target)
+		{
+			TUInt32 highest = BucketHighest( bucket );
+			return (highest < m_Max) ? highest : m_Max;
+		}
+	}
+	return m_Max;
+}
+
+
+// Get the bucket a time goes in
+TUInt32 CTimeHistogram::BucketIndex( TUInt32 microseconds )
+{
+	if (microseconds < kLinearTimes)
+	{
+		return microseconds;
+	}
+
+	// Shift the time down until it is one of kSubBuckets values, 32-63
+	TUInt32 shift = 0;
+	while ((microseconds >> shift) >= 2 * kSubBuckets)
+	{
+		++shift;
+	}
+	return shift * kSubBuckets + (microseconds >> shift);
+}
+
+// Get the highest time in microseconds a bucket holds
+TUInt32 CTimeHistogram::BucketHighest( TUInt32 bucket )
+{
+	if (bucket < kLinearTimes)
+	{
+		return bucket;
+	}
+
+	TUInt32 shift = bucket / kSubBuckets - 1;
+	TUInt64 subBucket = bucket % kSubBuckets + kSubBuckets;
+	TUInt64 highest = ((subBucket + 1) << shift) - 1;
+	return (highest > 0xFFFFFFFF) ? 0xFFFFFFFF : static_cast<TUInt32>(highest);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Frame metrics
+-----------------------------------------------------------------------------------------*/
+
+const TFloat32 CFrameMetrics::kSliceTime = 1.0f;
+
+// Constructor creates empty histograms
+CFrameMetrics::CFrameMetrics()
+{
+	m_CurrentSlice = 0;
+	m_SliceTime = 0.0f;
+}
+
+
+// Record the times of one frame, in seconds
+void CFrameMetrics::AddFrame( TFloat32 frameTime, TFloat32 updateTime, TFloat32 renderTime )
+{
+	// Start a new slice once the current one is full, dropping the oldest from the window
+	if (m_SliceTime >= kSliceTime)
+	{
+		m_CurrentSlice = (m_CurrentSlice + 1) % kWindowSlices;
+		m_SliceTime = 0.0f;
+		for (TUInt32 metric = 0; metric < NumFrameMetrics; ++metric)
+		{
+			m_Slices[metric][m_CurrentSlice].Clear();
+			m_Window[metric].Clear();
+			for (TUInt32 slice = 0; slice < kWindowSlices; ++slice)
+			{
+				m_Window[metric].Add( m_Slices[metric][slice] );
+			}
+		}
+	}
+	m_SliceTime += frameTime;
+
+	const TFloat32 times[NumFrameMetrics] = { frameTime, updateTime, renderTime };
+	for (TUInt32 metric = 0; metric < NumFrameMetrics; ++metric)
+	{
+		// Negative times cannot happen, times over an hour are held as an hour
+		TFloat32 microseconds = times[metric] * 1000000.0f;
+		TUInt32 time = (microseconds <= 0.0f) ? 0 :
+		               (microseconds >= 3.6e9f) ? 3600000000u : static_cast<TUInt32>(microseconds + 0.5f);
+
+		m_Slices[metric][m_CurrentSlice].Record( time );
+		m_Window[metric].Record( time );
+		m_Run[metric].Record( time );
+	}
+}
+
+// Remove all times
+void CFrameMetrics::Clear()
+{
+	for (TUInt32 metric = 0; metric < NumFrameMetrics; ++metric)
+	{
+		for (TUInt32 slice = 0; slice < kWindowSlices; ++slice)
+		{
+			m_Slices[metric][slice].Clear();
+		}
+		m_Window[metric].Clear();
+		m_Run[metric].Clear();
+	}
+	m_CurrentSlice = 0;
+	m_SliceTime = 0.0f;
+}
+
+
+// Append a text summary of the sliding window to a frame string, one line per metric with p50,
+// p95, p99 and max in ms
+void CFrameMetrics::WindowSummary( TFrameString* pText ) const
+{
+	for (TUInt32 metric = 0; metric < NumFrameMetrics; ++metric)
+	{
+		const CTimeHistogram& window = m_Window[metric];
+		AppendFormat( pText, "%s:", kMetricNames[metric] );
+		for (TUInt32 percentile = 0; percentile < kNumPercentiles; ++percentile)
+		{
+			AppendFormat( pText, " p%u %.1f", static_cast<TUInt32>(kPercentiles[percentile]),
+			              ToMilliseconds( window.Percentile( kPercentiles[percentile] ) ) );
+		}
+		AppendFormat( pText, " max %.1fms\n", ToMilliseconds( window.Max() ) );
+	}
+}
+
+
+// Write percentiles of the whole run and of the current window as CSV
+bool CFrameMetrics::WriteCSV( const string& fileName ) const
+{
+	ofstream file( fileName.c_str() );
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "metric,period,count,mean_ms";
+	for (TUInt32 percentile = 0; percentile < kNumPercentiles; ++percentile)
+	{
+		file << ",p" << static_cast<TUInt32>(kPercentiles[percentile]) << "_ms";
+	}
+	file << ",max_ms\n";
+
+	file << fixed << setprecision( 3 );
+	for (TUInt32 period = 0; period < 2; ++period)
+	{
+		for (TUInt32 metric = 0; metric < NumFrameMetrics; ++metric)
+		{
+			const CTimeHistogram& histogram = (period == 0) ? m_Run[metric] : m_Window[metric];
+			file << kMetricNames[metric] << "," << ((period == 0) ? "run" : "window") << ","
+			     << histogram.Count() << "," << histogram.Mean() * 0.001f;
+			for (TUInt32 percentile = 0; percentile < kNumPercentiles; ++percentile)
+			{
+				file << "," << ToMilliseconds( histogram.Percentile( kPercentiles[percentile] ) );
+			}
+			file << "," << ToMilliseconds( histogram.Max() ) << "\n";
+		}
+	}
+	return file.good();
+}
+
+// Write percentiles and the non-empty histogram buckets of the whole run as JSON
+bool CFrameMetrics::WriteJSON( const string& fileName ) const
+{
+	ofstream file( fileName.c_str() );
+	if (!file)
+	{
+		return false;
+	}
+
+	file << fixed << setprecision( 3 );
+	file << "{\n";
+	for (TUInt32 metric = 0; metric < NumFrameMetrics; ++metric)
+	{
+		const CTimeHistogram& histogram = m_Run[metric];
+		file << "\"" << kMetricNames[metric] << "\":{\"count\":" << histogram.Count()
+		     << ",\"mean_ms\":" << histogram.Mean() * 0.001f;
+		for (TUInt32 percentile = 0; percentile < kNumPercentiles; ++percentile)
+		{
+			file << ",\"p" << static_cast<TUInt32>(kPercentiles[percentile]) << "_ms\":"
+			     << ToMilliseconds( histogram.Percentile( kPercentiles[percentile] ) );
+		}
+		file << ",\"max_ms\":" << ToMilliseconds( histogram.Max() );
+
+		// Buckets as [highest time in ms, count] pairs
+		file << ",\"buckets\":[";
+		bool first = true;
+		for (TUInt32 bucket = 0; bucket < CTimeHistogram::kNumBuckets; ++bucket)
+		{
+			if (histogram.BucketCount( bucket ) > 0)
+			{
+				if (!first) file << ",";
+				first = false;
+				file << "[" << ToMilliseconds( CTimeHistogram::BucketHighest( bucket ) ) << ","
+				     << histogram.BucketCount( bucket ) << "]";
+			}
+		}
+		file << "]}" << ((metric + 1 < NumFrameMetrics) ? ",\n" : "\n");
+	}
+	file << "}\n";
+	return file.good();
+}
+
+
+} // namespace gen
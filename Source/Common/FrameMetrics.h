@@ -0,0 +1,177 @@
+/*******************************************
+	FrameMetrics.h
+
+	Histograms of frame, update and render
+	times with percentile statistics
+********************************************/
+
+#pragma once
+
+#include <string>
+using namespace std;
+
+#include "Defines.h"
+#include "FrameArena.h"
+
+namespace gen
+{
+
+// Histogram of times in microseconds, in the style of HdrHistogram: times below 64us each have
+// their own bucket, above that each power of 2 is split into 32 linear buckets. So any time from
+// 1us to over an hour is held to within 1/32 (~3%) in a fixed 3.5KB with no allocation, and
+// percentiles can be read at any time. Histograms can be added together to combine periods
+class CTimeHistogram
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty histogram
+	CTimeHistogram();
+
+	// No destructor needed
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+	// Number of buckets, enough for all 32-bit times
+	static const TUInt32 kNumBuckets = 896;
+
+	// Add a time in microseconds
+	void Record( TUInt32 microseconds );
+
+	// Add all the times in another histogram to this one
+	void Add( const CTimeHistogram& histogram );
+
+	// Remove all times
+	void Clear();
+
+
+	// Time in microseconds that the given percentage (0-100) of times are at or below. Returns the
+	// highest time in the bucket found, so errs towards a longer time, but never beyond the maximum
+	TUInt32 Percentile( TFloat32 percent ) const;
+
+	TUInt32 Count() const
+	{
+		return m_Count;
+	}
+
+	// Mean time in microseconds, exact (not from buckets)
+	TFloat32 Mean() const
+	{
+		return (m_Count > 0) ? static_cast<TFloat32>(m_Sum) / m_Count : 0.0f;
+	}
+
+	// Longest time in microseconds, exact
+	TUInt32 Max() const
+	{
+		return m_Max;
+	}
+
+	// Number of times in a bucket and the highest time in microseconds the bucket holds
+	TUInt32 BucketCount( TUInt32 bucket ) const
+	{
+		return m_Buckets[bucket];
+	}
+	static TUInt32 BucketHighest( TUInt32 bucket );
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	// Get the bucket a time goes in
+	static TUInt32 BucketIndex( TUInt32 microseconds );
+
+
+	TUInt32 m_Buckets[kNumBuckets];
+	TUInt32 m_Count;
+	TUInt64 m_Sum;
+	TUInt32 m_Max;
+};
+
+
+// Types of time recorded each frame
+enum EFrameMetric
+{
+	Metric_Frame,  // Whole frame, i.e. the time between updates
+	Metric_Update, // UpdateScene
+	Metric_Render, // RenderScene, including Present
+	NumFrameMetrics
+};
+
+
+// Records frame, update and render times into histograms over a sliding window of recent frames
+// (shown on screen) and over the whole run (written to file on exit). Percentiles show hitches
+// that an average hides, so builds can be compared on their slowest frames
+class CFrameMetrics
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates empty histograms
+	CFrameMetrics();
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CFrameMetrics( const CFrameMetrics& );
+	CFrameMetrics& operator=( const CFrameMetrics& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+	// The sliding window is made of this many slices of the given length (in seconds of frame
+	// time), the oldest slice is dropped as each new one starts
+	static const TUInt32 kWindowSlices = 10;
+	static const TFloat32 kSliceTime;
+
+
+	// Record the times of one frame, in seconds
+	void AddFrame( TFloat32 frameTime, TFloat32 updateTime, TFloat32 renderTime );
+
+	// Remove all times
+	void Clear();
+
+
+	// Times over the sliding window or over the whole run
+	const CTimeHistogram& Window( EFrameMetric metric ) const
+	{
+		return m_Window[metric];
+	}
+	const CTimeHistogram& Run( EFrameMetric metric ) const
+	{
+		return m_Run[metric];
+	}
+
+	// Append a text summary of the sliding window to a frame string, one line per metric with p50,
+	// p95, p99 and max in ms
+	void WindowSummary( TFrameString* pText ) const;
+
+	// Write percentiles of the whole run and of the current window as CSV, one row per metric and
+	// period. Returns false if the file cannot be written
+	bool WriteCSV( const string& fileName ) const;
+
+	// Write percentiles and the non-empty histogram buckets of the whole run as JSON. Returns false
+	// if the file cannot be written
+	bool WriteJSON( const string& fileName ) const;
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	// Slices of the sliding window for each metric (ring buffer), and their sum
+	CTimeHistogram m_Slices[NumFrameMetrics][kWindowSlices];
+	CTimeHistogram m_Window[NumFrameMetrics];
+	TUInt32        m_CurrentSlice;
+	TFloat32       m_SliceTime;  // Frame time recorded in the current slice so far
+
+	// Whole run
+	CTimeHistogram m_Run[NumFrameMetrics];
+};
+
+
+} // namespace gen
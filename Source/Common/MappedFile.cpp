@@ -0,0 +1,139 @@
+/*******************************************
+	MappedFile.cpp
+
+	Read-only file mapped into memory
+********************************************/
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+#include "MappedFile.h"
+
+namespace gen
+{
+
+// Constructor creates a closed file
+CMappedFile::CMappedFile()
+{
+	m_Data = 0;
+	m_Size = 0;
+#ifdef _WIN32
+	m_File = INVALID_HANDLE_VALUE;
+	m_Mapping = 0;
+#endif
+}
+
+// Destructor closes the file
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+
+#ifdef _WIN32
+
+// Map the given file into memory, returns false if it cannot be opened or is empty
+bool CMappedFile::Open( const string& fileName )
+{
+	Close();
+
+	m_File = CreateFile( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+	                     FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if (m_File == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx( m_File, &fileSize ) || fileSize.QuadPart == 0 || fileSize.QuadPart > 0x7fffffff)
+	{
+		Close();
+		return false;
+	}
+
+	m_Mapping = CreateFileMapping( m_File, NULL, PAGE_READONLY, 0, 0, NULL );
+	if (m_Mapping)
+	{
+		m_Data = static_cast<const TUInt8*>(MapViewOfFile( m_Mapping, FILE_MAP_READ, 0, 0, 0 ));
+	}
+	if (!m_Data)
+	{
+		Close();
+		return false;
+	}
+	m_Size = static_cast<TUInt32>(fileSize.QuadPart);
+	return true;
+}
+
+// Unmap the file
+void CMappedFile::Close()
+{
+	if (m_Data)
+	{
+		UnmapViewOfFile( m_Data );
+		m_Data = 0;
+	}
+	m_Size = 0;
+	if (m_Mapping)
+	{
+		CloseHandle( m_Mapping );
+		m_Mapping = 0;
+	}
+	if (m_File != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle( m_File );
+		m_File = INVALID_HANDLE_VALUE;
+	}
+}
+
+#else
+
+// Map the given file into memory, returns false if it cannot be opened or is empty. The mapping
+// stays valid after the file descriptor is closed, so no descriptor is kept
+bool CMappedFile::Open( const string& fileName )
+{
+	Close();
+
+	int file = open( fileName.c_str(), O_RDONLY );
+	if (file < 0)
+	{
+		return false;
+	}
+	struct stat fileStat;
+	if (fstat( file, &fileStat ) != 0 || fileStat.st_size == 0 || fileStat.st_size > 0x7fffffff)
+	{
+		close( file );
+		return false;
+	}
+
+	void* data = mmap( 0, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0 );
+	close( file );
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+	madvise( data, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL );
+	m_Data = static_cast<const TUInt8*>(data);
+	m_Size = static_cast<TUInt32>(fileStat.st_size);
+	return true;
+}
+
+// Unmap the file
+void CMappedFile::Close()
+{
+	if (m_Data)
+	{
+		munmap( const_cast<TUInt8*>(m_Data), m_Size );
+		m_Data = 0;
+	}
+	m_Size = 0;
+}
+
+#endif
+
+
+} // namespace gen
@@ -0,0 +1,79 @@
+/*******************************************
+	MappedFile.h
+
+	Read-only file mapped into memory
+********************************************/
+
+#pragma once
+
+#include <string>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Maps a whole file into memory for reading. The operating system pages the file in as it is
+// read, so nothing is copied into a buffer of our own. The data remains valid until the file is
+// closed. Files of 2GB or more are not supported. Uses file mapping objects on Windows and mmap
+// elsewhere
+class CMappedFile
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates a closed file
+	CMappedFile();
+
+	// Destructor closes the file
+	~CMappedFile();
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CMappedFile( const CMappedFile& );
+	CMappedFile& operator=( const CMappedFile& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Map the given file into memory, returns false if it cannot be opened or is empty
+	bool Open( const string& fileName );
+
+	// Unmap the file
+	void Close();
+
+	bool IsOpen() const
+	{
+		return m_Data != 0;
+	}
+
+	// Start of the file contents, 0 if not open
+	const TUInt8* Data() const
+	{
+		return m_Data;
+	}
+
+	// Size of the file in bytes
+	TUInt32 Size() const
+	{
+		return m_Size;
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	const TUInt8* m_Data;    // Start of mapped view, 0 if not open
+	TUInt32       m_Size;
+#ifdef _WIN32
+	void*         m_File;    // Windows handles
+	void*         m_Mapping;
+#endif
+};
+
+
+} // namespace gen
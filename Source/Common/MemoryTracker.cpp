@@ -0,0 +1,307 @@
+/*******************************************
+	MemoryTracker.cpp
+
+	Counts of memory allocated by each
+	subsystem, with optional budgets
+********************************************/
+
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+#include "Error.h"
+#include "MemoryTracker.h"
+
+namespace gen
+{
+
+// Counts for one tag. Static so they are zero before any constructor runs
+struct STagCounters
+{
+	atomic<TUInt64> liveBytes;
+	atomic<TUInt64> peakBytes;
+	atomic<TUInt64> framePeakBytes; // Peak since the last EndFrame
+	atomic<TUInt64> liveAllocations;
+	atomic<TUInt64> totalAllocations;
+	atomic<TUInt64> totalBytes;
+	atomic<TUInt64> frameAllocations; // Since the last EndFrame
+};
+static STagCounters Counters[NumMemoryTags];
+
+// Frame results and budgets, only used on the main thread
+static TUInt64 LastFrameAllocations[NumMemoryTags];
+static TUInt64 LastFramePeakBytes[NumMemoryTags];
+static TUInt64 Budgets[NumMemoryTags];
+static bool    BudgetAssertions = false;
+
+// Tag of the calling thread
+static thread_local EMemoryTag CurrentThreadTag = Mem_General;
+
+static const char* const kTagNames[NumMemoryTags] = { "General", "Entities", "Messages", "Meshes", "Textures", "XML" };
+
+
+// Header placed before each allocation. 16 bytes so the memory returned keeps the alignment of
+// malloc
+struct SAllocationHeader
+{
+	TUInt64 size;
+	TUInt32 tag;
+	TUInt32 padding;
+};
+
+
+// Raise a counter to the given value if it is lower
+static void UpdatePeak( atomic<TUInt64>& peak, TUInt64 value )
+{
+	TUInt64 current = peak.load( memory_order_relaxed );
+	while (value > current && !peak.compare_exchange_weak( current, value, memory_order_relaxed ))
+	{
+	}
+}
+
+// Allocate memory counted against the calling thread's tag, returns 0 on failure
+static void* TrackedAllocate( size_t size )
+{
+	SAllocationHeader* pHeader = static_cast<SAllocationHeader*>(malloc( sizeof(SAllocationHeader) + size ));
+	if (pHeader == 0)
+	{
+		return 0;
+	}
+	pHeader->size = size;
+	pHeader->tag = CurrentThreadTag;
+
+	STagCounters& counters = Counters[pHeader->tag];
+	TUInt64 liveBytes = counters.liveBytes.fetch_add( size, memory_order_relaxed ) + size;
+	UpdatePeak( counters.peakBytes, liveBytes );
+	UpdatePeak( counters.framePeakBytes, liveBytes );
+	counters.liveAllocations.fetch_add( 1, memory_order_relaxed );
+	counters.totalAllocations.fetch_add( 1, memory_order_relaxed );
+	counters.totalBytes.fetch_add( size, memory_order_relaxed );
+	counters.frameAllocations.fetch_add( 1, memory_order_relaxed );
+	return pHeader + 1;
+}
+
+// Free memory from TrackedAllocate, taking it off the tag it was allocated with
+static void TrackedFree( void* p )
+{
+	if (p == 0)
+	{
+		return;
+	}
+	SAllocationHeader* pHeader = static_cast<SAllocationHeader*>(p) - 1;
+	STagCounters& counters = Counters[pHeader->tag];
+	counters.liveBytes.fetch_sub( pHeader->size, memory_order_relaxed );
+	counters.liveAllocations.fetch_sub( 1, memory_order_relaxed );
+	free( pHeader );
+}
+
+
+/////////////////////////////////////
+// Tags
+
+// Tag that allocations on the calling thread are counted against
+EMemoryTag CMemoryTracker::CurrentTag()
+{
+	return CurrentThreadTag;
+}
+
+// Set the tag for the calling thread, returns the previous tag
+EMemoryTag CMemoryTracker::SetTag( EMemoryTag tag )
+{
+	EMemoryTag previousTag = CurrentThreadTag;
+	CurrentThreadTag = tag;
+	return previousTag;
+}
+
+// Name of a tag for display
+const char* CMemoryTracker::TagName( EMemoryTag tag )
+{
+	return kTagNames[tag];
+}
+
+
+/////////////////////////////////////
+// Counts
+
+// Get the current counts for a tag
+void CMemoryTracker::GetStats( EMemoryTag tag, SMemoryStats* pStats )
+{
+	const STagCounters& counters = Counters[tag];
+	pStats->liveBytes = counters.liveBytes.load( memory_order_relaxed );
+	pStats->peakBytes = counters.peakBytes.load( memory_order_relaxed );
+	pStats->liveAllocations = counters.liveAllocations.load( memory_order_relaxed );
+	pStats->totalAllocations = counters.totalAllocations.load( memory_order_relaxed );
+	pStats->totalBytes = counters.totalBytes.load( memory_order_relaxed );
+	pStats->frameAllocations = LastFrameAllocations[tag];
+	pStats->budget = Budgets[tag];
+}
+
+// Total allocations ever made with all tags
+TUInt64 CMemoryTracker::TotalAllocations()
+{
+	TUInt64 total = 0;
+	for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+	{
+		total += Counters[tag].totalAllocations.load( memory_order_relaxed );
+	}
+	return total;
+}
+
+// Total bytes ever allocated with all tags
+TUInt64 CMemoryTracker::TotalBytes()
+{
+	TUInt64 total = 0;
+	for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+	{
+		total += Counters[tag].totalBytes.load( memory_order_relaxed );
+	}
+	return total;
+}
+
+// Set the peak of every tag to its live bytes
+void CMemoryTracker::ResetPeaks()
+{
+	for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+	{
+		STagCounters& counters = Counters[tag];
+		counters.peakBytes.store( counters.liveBytes.load( memory_order_relaxed ), memory_order_relaxed );
+	}
+}
+
+
+/////////////////////////////////////
+// Budgets
+
+// Set the most bytes a tag should have live at once, 0 for no budget
+void CMemoryTracker::SetBudget( EMemoryTag tag, TUInt64 bytes )
+{
+	Budgets[tag] = bytes;
+}
+
+// Choose whether going over budget is a fatal error
+void CMemoryTracker::SetBudgetAssertions( bool enabled )
+{
+	BudgetAssertions = enabled;
+}
+
+// Returns true if the tag's peak in the last frame is over its budget
+bool CMemoryTracker::IsOverBudget( EMemoryTag tag )
+{
+	return Budgets[tag] > 0 && LastFramePeakBytes[tag] > Budgets[tag];
+}
+
+
+/////////////////////////////////////
+// Frames
+
+// Mark the end of a frame, updates the frame allocation counts and checks the budgets
+void CMemoryTracker::EndFrame()
+{
+	for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+	{
+		STagCounters& counters = Counters[tag];
+		LastFrameAllocations[tag] = counters.frameAllocations.exchange( 0, memory_order_relaxed );
+		LastFramePeakBytes[tag] = counters.framePeakBytes.exchange( counters.liveBytes.load( memory_order_relaxed ),
+		                                                            memory_order_relaxed );
+	}
+
+	if (BudgetAssertions)
+	{
+		for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+		{
+			if (IsOverBudget( static_cast<EMemoryTag>(tag) ))
+			{
+				string message = string( "Memory budget exceeded: " ) + kTagNames[tag];
+				GEN_ERROR( message.c_str() );
+			}
+		}
+	}
+}
+
+// Append a text summary to a frame string, one line per tag
+void CMemoryTracker::Summary( TFrameString* pText )
+{
+	const TFloat32 kMegabyte = 1024.0f * 1024.0f;
+
+	for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+	{
+		SMemoryStats stats;
+		GetStats( static_cast<EMemoryTag>(tag), &stats );
+		AppendFormat( pText, "%s: %.2fMB (peak %.2fMB", kTagNames[tag], stats.liveBytes / kMegabyte,
+		              stats.peakBytes / kMegabyte );
+		if (stats.budget > 0)
+		{
+			AppendFormat( pText, ", budget %.2fMB", stats.budget / kMegabyte );
+		}
+		AppendFormat( pText, ") %llu allocs/frame", static_cast<unsigned long long>(stats.frameAllocations) );
+		if (IsOverBudget( static_cast<EMemoryTag>(tag) ))
+		{
+			pText->append( " OVER BUDGET" );
+		}
+		pText->append( "\n" );
+	}
+}
+
+
+} // namespace gen
+
+
+/*-----------------------------------------------------------------------------------------
+	Global allocation functions
+-----------------------------------------------------------------------------------------*/
+
+// Replace the global operator new and delete so every allocation is counted
+
+void* operator new( size_t size )
+{
+	void* p = gen::TrackedAllocate( size );
+	if (p == 0)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[]( size_t size )
+{
+	return operator new( size );
+}
+
+void* operator new( size_t size, const std::nothrow_t& ) noexcept
+{
+	return gen::TrackedAllocate( size );
+}
+
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept
+{
+	return gen::TrackedAllocate( size );
+}
+
+void operator delete( void* p ) noexcept
+{
+	gen::TrackedFree( p );
+}
+
+void operator delete[]( void* p ) noexcept
+{
+	gen::TrackedFree( p );
+}
+
+void operator delete( void* p, size_t ) noexcept
+{
+	gen::TrackedFree( p );
+}
+
+void operator delete[]( void* p, size_t ) noexcept
+{
+	gen::TrackedFree( p );
+}
+
+void operator delete( void* p, const std::nothrow_t& ) noexcept
+{
+	gen::TrackedFree( p );
+}
+
+void operator delete[]( void* p, const std::nothrow_t& ) noexcept
+{
+	gen::TrackedFree( p );
+}
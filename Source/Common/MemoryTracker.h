@@ -0,0 +1,133 @@
+/*******************************************
+	MemoryTracker.h
+
+	Counts of memory allocated by each
+	subsystem, with optional budgets
+********************************************/
+
+#pragma once
+
+#include <string>
+using namespace std;
+
+#include "Defines.h"
+#include "FrameArena.h"
+
+namespace gen
+{
+
+// Subsystems that allocations are counted against
+enum EMemoryTag
+{
+	Mem_General,  // Anything not in a tagged scope
+	Mem_Entities, // Entities and templates, including what they allocate while updating
+	Mem_Messages, // Messages queued between entities
+	Mem_Meshes,   // Mesh import and geometry
+	Mem_Textures, // Texture loading and the texture cache
+	Mem_XML,      // Scene file parsing and compiling
+	NumMemoryTags
+};
+
+// Counts for one tag
+struct SMemoryStats
+{
+	TUInt64 liveBytes;        // Currently allocated
+	TUInt64 peakBytes;        // Most ever allocated at once
+	TUInt64 liveAllocations;
+	TUInt64 totalAllocations; // Ever made
+	TUInt64 totalBytes;
+	TUInt64 frameAllocations; // Made during the last complete frame
+	TUInt64 budget;           // Bytes, 0 for no budget
+};
+
+
+// Counts every allocation made through operator new against the memory tag of the calling thread,
+// set with CMemoryScope. The global operator new and delete are replaced to do this, each
+// allocation carries a small header holding its size and tag so it is taken off the right count
+// when freed. Jobs on a CThreadPool are counted against the tag of the thread that queued them.
+// Allocations not made with new (e.g. by D3D) are not seen.
+// All functions are static as allocations can happen before any object is constructed
+class CMemoryTracker
+{
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Tag that allocations on the calling thread are counted against
+	static EMemoryTag CurrentTag();
+
+	// Set the tag for the calling thread, returns the previous tag. Use CMemoryScope rather than
+	// calling this directly
+	static EMemoryTag SetTag( EMemoryTag tag );
+
+	// Name of a tag for display
+	static const char* TagName( EMemoryTag tag );
+
+
+	// Get the current counts for a tag
+	static void GetStats( EMemoryTag tag, SMemoryStats* pStats );
+
+	// Total allocations and bytes ever made with all tags
+	static TUInt64 TotalAllocations();
+	static TUInt64 TotalBytes();
+
+	// Set the peak of every tag to its live bytes, e.g. to measure the peak of one benchmark run
+	static void ResetPeaks();
+
+
+	// Set the most bytes a tag should have live at once, 0 for no budget. Budgets are checked in
+	// EndFrame against the peak, so a brief spike during a frame is still caught
+	static void SetBudget( EMemoryTag tag, TUInt64 bytes );
+
+	// In assertion mode EndFrame raises a fatal error when any tag has gone over its budget,
+	// otherwise tags over budget are only marked in the summary
+	static void SetBudgetAssertions( bool enabled );
+
+	// Returns true if the tag's peak is over its budget
+	static bool IsOverBudget( EMemoryTag tag );
+
+
+	// Mark the end of a frame, call once per frame on the main thread. Updates the frame
+	// allocation counts and checks the budgets
+	static void EndFrame();
+
+	// Append a text summary to a frame string, one line per tag with live and peak bytes,
+	// allocations in the last frame and the budget if any
+	static void Summary( TFrameString* pText );
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+	// Not created, all static (private and not defined)
+	CMemoryTracker();
+};
+
+
+// Counts allocations made on this thread against the given tag for the lifetime of this object,
+// e.g. a block of code:
+//     { CMemoryScope memory( Mem_Meshes ); ... }
+// Scopes nest, the previous tag is restored at the end
+class CMemoryScope
+{
+public:
+	CMemoryScope( EMemoryTag tag )
+	{
+		m_PreviousTag = CMemoryTracker::SetTag( tag );
+	}
+
+	~CMemoryScope()
+	{
+		CMemoryTracker::SetTag( m_PreviousTag );
+	}
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CMemoryScope( const CMemoryScope& );
+	CMemoryScope& operator=( const CMemoryScope& );
+
+	EMemoryTag m_PreviousTag;
+};
+
+
+} // namespace gen
@@ -0,0 +1,365 @@
+/*******************************************
+	Profiler.cpp
+
+	Per-frame CPU profiler timing named zones
+	of code on any thread
+********************************************/
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <string.h>
+#include "Profiler.h"
+
+namespace gen
+{
+
+// Zones recorded on one thread. Only the owning thread writes zones, other threads read those
+// below numZones
+struct CProfiler::SThread
+{
+	struct SZone
+	{
+		const char* name;
+		TUInt64     start;
+		TUInt64     end;
+		TUInt32     depth;
+	};
+
+	SZone*          zones;       // Ring buffer
+	TUInt64         zoneMask;    // Size of ring buffer - 1
+	atomic<TUInt64> numZones;    // Total zones ever recorded, not wrapped
+	TUInt64         numTotalled; // Zones already added to the frame totals
+	TUInt32         depth;       // Number of zones currently open
+	string          name;
+};
+
+// Thread used by the calling thread, and the profiler it belongs to
+static thread_local CProfiler::SThread* CurrentThreadData = 0;
+static thread_local const CProfiler*    CurrentThreadOwner = 0;
+
+
+// Write a string as a JSON string literal
+static void WriteJSONString( ofstream& file, const char* text )
+{
+	file << '"';
+	for (; *text != 0; ++text)
+	{
+		if (*text == '"' || *text == '\\') file << '\\';
+		file << *text;
+	}
+	file << '"';
+}
+
+
+// Constructor creates a profiler with no zones, times are measured from this point
+CProfiler::CProfiler( TUInt32 zonesPerThread /*= kDefaultZonesPerThread*/ )
+{
+	m_TicksPerSecond = CTimer::CyclesPerSecond();
+	m_ZonesPerThread = zonesPerThread;
+	m_StartTime = Now();
+	m_NumZoneNames = 0;
+	m_FrameStart = m_StartTime;
+	for (TUInt32 frame = 0; frame < kAverageFrames; ++frame)
+	{
+		m_FrameTicks[frame] = 0;
+	}
+	m_SumFrameTicks = 0;
+	m_FrameIndex = 0;
+	m_NumFrames = 0;
+	m_NumDroppedZones = 0;
+}
+
+// Destructor frees the thread buffers
+CProfiler::~CProfiler()
+{
+	for (TUInt32 thread = 0; thread < m_Threads.size(); ++thread)
+	{
+		delete[] m_Threads[thread]->zones;
+		delete m_Threads[thread];
+	}
+}
+
+
+/////////////////////////////////////
+// Recording zones
+
+// Name the calling thread in the trace
+void CProfiler::SetThreadName( const string& name )
+{
+	SThread* pThread = CurrentThread();
+	lock_guard<mutex> lock( m_ThreadsMutex );
+	pThread->name = name;
+}
+
+// Start a zone on the calling thread, returns the thread to pass to EndZone
+CProfiler::SThread* CProfiler::BeginZone()
+{
+	SThread* pThread = CurrentThread();
+	++pThread->depth;
+	return pThread;
+}
+
+// Record a zone on the given thread running from start to end
+void CProfiler::EndZone( SThread* pThread, const char* name, TUInt64 start, TUInt64 end )
+{
+	--pThread->depth;
+
+	TUInt64 index = pThread->numZones.load( memory_order_relaxed );
+	SThread::SZone& zone = pThread->zones[index & pThread->zoneMask];
+	zone.name = name;
+	zone.start = start;
+	zone.end = end;
+	zone.depth = pThread->depth;
+
+	// Publish the zone to readers on other threads
+	pThread->numZones.store( index + 1, memory_order_release );
+}
+
+
+// Get the thread for the calling thread, creating it on first use
+CProfiler::SThread* CProfiler::CurrentThread()
+{
+	if (CurrentThreadOwner == this)
+	{
+		return CurrentThreadData;
+	}
+
+	SThread* pThread = new SThread;
+	pThread->zones = new SThread::SZone[m_ZonesPerThread];
+	pThread->zoneMask = m_ZonesPerThread - 1;
+	pThread->numZones.store( 0 );
+	pThread->numTotalled = 0;
+	pThread->depth = 0;
+
+	lock_guard<mutex> lock( m_ThreadsMutex );
+	pThread->name = "Thread " + to_string( m_Threads.size() );
+	m_Threads.push_back( pThread );
+
+	CurrentThreadData = pThread;
+	CurrentThreadOwner = this;
+	return pThread;
+}
+
+
+/////////////////////////////////////
+// Frame totals
+
+// Mark the end of a frame, totals the zones recorded on all threads since the last call
+void CProfiler::EndFrame()
+{
+	TUInt64 frameEnd = Now();
+
+	// Remove the oldest frame from the averages, its slot is used for this frame
+	for (TUInt32 zone = 0; zone < m_NumZoneNames; ++zone)
+	{
+		SZoneStats& stats = m_ZoneStats[zone];
+		stats.sumTicks -= stats.frameTicks[m_FrameIndex];
+		stats.sumCalls -= stats.frameCalls[m_FrameIndex];
+		stats.frameTicks[m_FrameIndex] = 0;
+		stats.frameCalls[m_FrameIndex] = 0;
+	}
+	m_SumFrameTicks -= m_FrameTicks[m_FrameIndex];
+	m_FrameTicks[m_FrameIndex] = frameEnd - m_FrameStart;
+	m_SumFrameTicks += m_FrameTicks[m_FrameIndex];
+
+	// Total the new zones on each thread. If a thread recorded more zones than its buffer holds,
+	// the overwritten ones are missing from the totals
+	lock_guard<mutex> lock( m_ThreadsMutex );
+	for (TUInt32 thread = 0; thread < m_Threads.size(); ++thread)
+	{
+		SThread* pThread = m_Threads[thread];
+		TUInt64 numZones = pThread->numZones.load( memory_order_acquire );
+		TUInt64 first = max( pThread->numTotalled,
+		                     numZones > m_ZonesPerThread ? numZones - m_ZonesPerThread : 0 );
+		m_NumDroppedZones += first - pThread->numTotalled;
+		for (TUInt64 index = first; index < numZones; ++index)
+		{
+			const SThread::SZone& zone = pThread->zones[index & pThread->zoneMask];
+			SZoneStats* pStats = FindZoneStats( zone.name );
+			if (pStats != 0)
+			{
+				if (pStats->frameCalls[m_FrameIndex] == 0 || zone.start < pStats->firstStart)
+				{
+					pStats->firstStart = zone.start;
+				}
+				pStats->depth = zone.depth;
+				pStats->frameTicks[m_FrameIndex] += zone.end - zone.start;
+				++pStats->frameCalls[m_FrameIndex];
+			}
+		}
+		pThread->numTotalled = numZones;
+	}
+
+	for (TUInt32 zone = 0; zone < m_NumZoneNames; ++zone)
+	{
+		SZoneStats& stats = m_ZoneStats[zone];
+		stats.sumTicks += stats.frameTicks[m_FrameIndex];
+		stats.sumCalls += stats.frameCalls[m_FrameIndex];
+		stats.totalTicks += stats.frameTicks[m_FrameIndex];
+		stats.totalCalls += stats.frameCalls[m_FrameIndex];
+	}
+
+	m_FrameIndex = (m_FrameIndex + 1) % kAverageFrames;
+	if (m_NumFrames < kAverageFrames) ++m_NumFrames;
+	m_FrameStart = frameEnd;
+}
+
+// Average frame time in milliseconds over recent frames
+TFloat32 CProfiler::AverageFrameTime() const
+{
+	return (m_NumFrames > 0) ? TicksToMilliseconds( m_SumFrameTicks ) / m_NumFrames : 0.0f;
+}
+
+// Append a text breakdown of the average time spent in each zone over recent frames
+void CProfiler::Breakdown( TFrameString* pText ) const
+{
+	if (m_NumFrames == 0)
+	{
+		return;
+	}
+
+	// Zones in the order they started in, as last seen. Ties are kept in name order by comparing
+	// indices, as stable_sort would but without the temporary buffer it allocates
+	TUInt32 order[kMaxZoneNames];
+	for (TUInt32 zone = 0; zone < m_NumZoneNames; ++zone)
+	{
+		order[zone] = zone;
+	}
+	const SZoneStats* stats = m_ZoneStats;
+	sort( order, order + m_NumZoneNames, [stats]( TUInt32 a, TUInt32 b )
+	{
+		return stats[a].firstStart < stats[b].firstStart ||
+		       (stats[a].firstStart == stats[b].firstStart && a < b);
+	} );
+
+	for (TUInt32 entry = 0; entry < m_NumZoneNames; ++entry)
+	{
+		const SZoneStats& zone = m_ZoneStats[order[entry]];
+		if (zone.sumCalls == 0)
+		{
+			continue;
+		}
+
+		AppendFormat( pText, "%*s%s: %.2fms", static_cast<int>(zone.depth * 2), "", zone.name,
+		              TicksToMilliseconds( zone.sumTicks ) / m_NumFrames );
+		TFloat32 calls = static_cast<TFloat32>(zone.sumCalls) / m_NumFrames;
+		if (calls > 1.5f)
+		{
+			AppendFormat( pText, " (x%.0f)", calls );
+		}
+		pText->append( "\n" );
+	}
+}
+
+
+// Find or add the totals for a zone name, returns 0 if there are too many zone names
+CProfiler::SZoneStats* CProfiler::FindZoneStats( const char* name )
+{
+	// Zones with the same name in different source files may not share a pointer
+	for (TUInt32 zone = 0; zone < m_NumZoneNames; ++zone)
+	{
+		if (m_ZoneStats[zone].name == name || strcmp( m_ZoneStats[zone].name, name ) == 0)
+		{
+			return &m_ZoneStats[zone];
+		}
+	}
+
+	if (m_NumZoneNames == kMaxZoneNames)
+	{
+		return 0;
+	}
+
+	SZoneStats& stats = m_ZoneStats[m_NumZoneNames++];
+	stats.name = name;
+	stats.depth = 0;
+	stats.firstStart = 0;
+	for (TUInt32 frame = 0; frame < kAverageFrames; ++frame)
+	{
+		stats.frameTicks[frame] = 0;
+		stats.frameCalls[frame] = 0;
+	}
+	stats.sumTicks = 0;
+	stats.sumCalls = 0;
+	stats.totalTicks = 0;
+	stats.totalCalls = 0;
+	return &stats;
+}
+
+// Set the zone totals and dropped zone count to zero
+void CProfiler::ResetTotals()
+{
+	for (TUInt32 zone = 0; zone < m_NumZoneNames; ++zone)
+	{
+		m_ZoneStats[zone].totalTicks = 0;
+		m_ZoneStats[zone].totalCalls = 0;
+	}
+	m_NumDroppedZones = 0;
+}
+
+
+/////////////////////////////////////
+// Trace output
+
+// Write the zones currently held for all threads in Chrome trace format
+bool CProfiler::WriteChromeTrace( const string& fileName ) const
+{
+	ofstream file( fileName.c_str() );
+	if (!file)
+	{
+		return false;
+	}
+
+	lock_guard<mutex> lock( m_ThreadsMutex );
+	file << "{\"traceEvents\":[\n";
+	file << fixed << setprecision( 3 );
+	bool first = true;
+
+	// Thread names as metadata events
+	for (TUInt32 thread = 0; thread < m_Threads.size(); ++thread)
+	{
+		if (!first) file << ",\n";
+		first = false;
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":";
+		WriteJSONString( file, m_Threads[thread]->name.c_str() );
+		file << "}}";
+	}
+
+	// Complete events, oldest first on each thread
+	for (TUInt32 thread = 0; thread < m_Threads.size(); ++thread)
+	{
+		const SThread* pThread = m_Threads[thread];
+		TUInt64 numZones = pThread->numZones.load( memory_order_acquire );
+		TUInt64 index = (numZones > m_ZonesPerThread) ? numZones - m_ZonesPerThread : 0;
+		for (; index < numZones; ++index)
+		{
+			const SThread::SZone& zone = pThread->zones[index & pThread->zoneMask];
+			if (!first) file << ",\n";
+			first = false;
+			file << "{\"name\":";
+			WriteJSONString( file, zone.name );
+			file << ",\"cat\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+			     << ",\"ts\":" << TicksToTraceTime( zone.start )
+			     << ",\"dur\":" << TicksToTraceTime( zone.end ) - TicksToTraceTime( zone.start ) << "}";
+		}
+	}
+
+	file << "\n]}\n";
+	return file.good();
+}
+
+
+// Convert cycles to milliseconds
+TFloat32 CProfiler::TicksToMilliseconds( TUInt64 ticks ) const
+{
+	return static_cast<TFloat32>(static_cast<TFloat64>(ticks) * 1000.0 / m_TicksPerSecond);
+}
+
+// Convert cycles to microseconds since the profiler was created, as used in Chrome traces
+TFloat64 CProfiler::TicksToTraceTime( TUInt64 ticks ) const
+{
+	return static_cast<TFloat64>(ticks - m_StartTime) * 1000000.0 / m_TicksPerSecond;
+}
+
+
+} // namespace gen
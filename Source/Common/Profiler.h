@@ -0,0 +1,204 @@
+/*******************************************
+	Profiler.h
+
+	Per-frame CPU profiler timing named zones
+	of code on any thread
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+using namespace std;
+
+#include "Defines.h"
+#include "CTimer.h"
+#include "FrameArena.h"
+
+namespace gen
+{
+
+// Times named zones of code each frame, e.g. entity update or render submission. Zones are
+// recorded into a fixed size ring buffer for each thread, so timing a zone takes two cycle counter
+// reads and no locks or allocation. At the end of each frame the zones are totalled and averaged over
+// recent frames for an on-screen breakdown. The most recent zones on every thread can be written
+// as a Chrome trace JSON file (same format as CTraceLog) to look at individual frames offline.
+// Zone names must be string literals (or otherwise outlive the profiler) as only the pointer is
+// stored. There should only be one profiler in a program
+class CProfiler
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates a profiler with no zones, times are measured from this point. Each
+	// thread keeps the given number of zones, which must be a power of 2
+	CProfiler( TUInt32 zonesPerThread = kDefaultZonesPerThread );
+
+	// Destructor frees the thread buffers
+	~CProfiler();
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CProfiler( const CProfiler& );
+	CProfiler& operator=( const CProfiler& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+	// Zones recorded on one thread
+	struct SThread;
+
+	// Default number of zones kept for each thread, older zones are overwritten. Zones that are
+	// overwritten before the end of their frame are missing from the totals
+	static const TUInt32 kDefaultZonesPerThread = 1 << 15;
+
+	// Maximum number of differently named zones in the breakdown, later names are not shown
+	static const TUInt32 kMaxZoneNames = 64;
+
+	// Number of frames the breakdown is averaged over
+	static const TUInt32 kAverageFrames = 32;
+
+
+	// Current time in CPU cycles, used for zone start and end times
+	static TUInt64 Now()
+	{
+		return static_cast<TUInt64>(CTimer::Cycles());
+	}
+
+	// Name the calling thread in the trace
+	void SetThreadName( const string& name );
+
+	// Start a zone on the calling thread, returns the thread to pass to EndZone. Use CProfileZone
+	// rather than calling this directly
+	SThread* BeginZone();
+
+	// Record a zone on the given thread running from start to end (times from Now)
+	static void EndZone( SThread* pThread, const char* name, TUInt64 start, TUInt64 end );
+
+
+	// Mark the end of a frame, call once per frame on the main thread. Totals the zones recorded
+	// on all threads since the last call and updates the averages
+	void EndFrame();
+
+	// Average frame time in milliseconds over recent frames
+	TFloat32 AverageFrameTime() const;
+
+	// Append a text breakdown of the average time spent in each zone over recent frames to a frame
+	// string, one line per zone in the order they started in, indented by nesting
+	void Breakdown( TFrameString* pText ) const;
+
+	// Write the zones currently held for all threads in Chrome trace format, returns false if the
+	// file cannot be written
+	bool WriteChromeTrace( const string& fileName ) const;
+
+
+	// Totals for each zone name since creation or the last call to ResetTotals, e.g. for a
+	// benchmark run. Zones are listed in the order their names were first seen
+	TUInt32 NumZoneNames() const
+	{
+		return m_NumZoneNames;
+	}
+	const char* ZoneName( TUInt32 zone ) const
+	{
+		return m_ZoneStats[zone].name;
+	}
+	TFloat32 ZoneTotalTime( TUInt32 zone ) const // Milliseconds
+	{
+		return TicksToMilliseconds( m_ZoneStats[zone].totalTicks );
+	}
+	TUInt64 ZoneTotalCalls( TUInt32 zone ) const
+	{
+		return m_ZoneStats[zone].totalCalls;
+	}
+
+	// Number of zones overwritten before they were totalled, since creation or ResetTotals
+	TUInt64 NumDroppedZones() const
+	{
+		return m_NumDroppedZones;
+	}
+
+	// Set the zone totals and dropped zone count to zero
+	void ResetTotals();
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	// Totals for each zone name
+	struct SZoneStats
+	{
+		const char* name;
+		TUInt32     depth;                      // Nesting depth when last seen
+		TUInt64     firstStart;                 // Start of first zone with this name, last frame seen
+		TUInt64     frameTicks[kAverageFrames]; // Total time each recent frame (ring buffer)
+		TUInt32     frameCalls[kAverageFrames]; // Number of zones each recent frame (ring buffer)
+		TUInt64     sumTicks;                   // Sum of frameTicks
+		TUInt32     sumCalls;                   // Sum of frameCalls
+		TUInt64     totalTicks;                 // Since the last ResetTotals
+		TUInt64     totalCalls;
+	};
+
+	// Get the thread for the calling thread, creating it on first use
+	SThread* CurrentThread();
+
+	// Find or add the totals for a zone name, returns 0 if there are too many zone names
+	SZoneStats* FindZoneStats( const char* name );
+
+	// Convert cycles to milliseconds or to microseconds since the profiler was created
+	TFloat32 TicksToMilliseconds( TUInt64 ticks ) const;
+	TFloat64 TicksToTraceTime( TUInt64 ticks ) const;
+
+
+	TUInt64  m_StartTime;
+	TFloat64 m_TicksPerSecond;
+	TUInt32  m_ZonesPerThread;
+
+	// All threads that have recorded zones, only added to after creation
+	vector<SThread*> m_Threads;
+	mutable mutex    m_ThreadsMutex;
+
+	// Frame totals, only used on the main thread
+	SZoneStats m_ZoneStats[kMaxZoneNames];
+	TUInt32    m_NumZoneNames;
+	TUInt64    m_FrameStart;
+	TUInt64    m_FrameTicks[kAverageFrames]; // Recent frame times (ring buffer)
+	TUInt64    m_SumFrameTicks;
+	TUInt32    m_FrameIndex;                 // Position in the frame ring buffers
+	TUInt32    m_NumFrames;                  // Number of valid entries in the frame ring buffers
+	TUInt64    m_NumDroppedZones;
+};
+
+
+// Records a profiler zone covering the lifetime of this object, e.g. a block of code:
+//     { CProfileZone zone( Profiler, "Update entities" ); ... }
+class CProfileZone
+{
+public:
+	CProfileZone( CProfiler& profiler, const char* name )
+		: m_Name( name )
+	{
+		m_pThread = profiler.BeginZone();
+		m_Start = CProfiler::Now();
+	}
+
+	~CProfileZone()
+	{
+		CProfiler::EndZone( m_pThread, m_Name, m_Start, CProfiler::Now() );
+	}
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CProfileZone( const CProfileZone& );
+	CProfileZone& operator=( const CProfileZone& );
+
+	CProfiler::SThread* m_pThread;
+	const char*         m_Name;
+	TUInt64             m_Start;
+};
+
+
+} // namespace gen
@@ -0,0 +1,122 @@
+/*******************************************
+	Snapshot.cpp
+
+	Binary buffer that simulation state is
+	saved into and restored from
+********************************************/
+
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include "Snapshot.h"
+
+namespace gen
+{
+
+// Constructor creates an empty snapshot
+CSnapshot::CSnapshot()
+{
+	m_Size = 0;
+	m_ReadPosition = 0;
+	m_Failed = false;
+}
+
+
+/////////////////////////////////////
+// Writing
+
+// Remove all data, ready to write a new snapshot
+void CSnapshot::Clear()
+{
+	m_Size = 0;
+	m_ReadPosition = 0;
+	m_Failed = false;
+}
+
+// Write a string as its length then its characters
+void CSnapshot::WriteString( const string& text )
+{
+	Write( static_cast<TUInt32>(text.length()) );
+	WriteBytes( text.data(), static_cast<TUInt32>(text.length()) );
+}
+
+// Make room for at least the given number of bytes more, doubling the buffer so the cost of
+// growing is spread over many writes
+void CSnapshot::Grow( TUInt32 size )
+{
+	m_Data.resize( max( m_Size + size, m_Data.size() * 2 ) );
+}
+
+
+/////////////////////////////////////
+// Reading
+
+// Fail a read that runs past the end of the data, filling it with zeros
+bool CSnapshot::ReadFailed( void* data, TUInt32 size )
+{
+	m_Failed = true;
+	memset( data, 0, size );
+	return false;
+}
+
+bool CSnapshot::ReadString( string* pText )
+{
+	TUInt32 length = 0;
+	if (!Read( &length ) || length > m_Size - m_ReadPosition)
+	{
+		m_Failed = true;
+		pText->clear();
+		return false;
+	}
+	pText->assign( reinterpret_cast<const char*>(Data()) + m_ReadPosition, length );
+	m_ReadPosition += length;
+	return true;
+}
+
+
+/////////////////////////////////////
+// Files
+
+// Save the snapshot to a file with a header identifying it
+bool CSnapshot::Save( const string& fileName ) const
+{
+	ofstream file( fileName.c_str(), ios::binary | ios::trunc );
+	if (!file)
+	{
+		return false;
+	}
+
+	SHeader header = { kSnapshotMagic, kSnapshotVersion, Size() };
+	file.write( reinterpret_cast<const char*>(&header), sizeof(header) );
+	if (m_Size > 0)
+	{
+		file.write( reinterpret_cast<const char*>(&m_Data[0]), m_Size );
+	}
+	return file.good();
+}
+
+// Replace the snapshot with one saved to a file, returns false if the file cannot be read or is
+// not a snapshot of the current version. The snapshot is unchanged on failure
+bool CSnapshot::Load( const string& fileName )
+{
+	ifstream file( fileName.c_str(), ios::binary );
+	SHeader header;
+	if (!file || !file.read( reinterpret_cast<char*>(&header), sizeof(header) ) ||
+	    header.magic != kSnapshotMagic || header.version != kSnapshotVersion)
+	{
+		return false;
+	}
+
+	vector<TUInt8> data( header.size );
+	if (header.size > 0 && !file.read( reinterpret_cast<char*>(&data[0]), header.size ))
+	{
+		return false;
+	}
+	m_Data.swap( data );
+	m_Size = header.size;
+	BeginRead();
+	return true;
+}
+
+
+} // namespace gen
@@ -0,0 +1,205 @@
+/*******************************************
+	Snapshot.h
+
+	Binary buffer that simulation state is
+	saved into and restored from
+********************************************/
+
+#pragma once
+
+#include <string.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Identifies a snapshot file, and the version of the data written by the SaveState functions -
+// increase the version if any of them change so older snapshots are rejected
+const TUInt32 kSnapshotMagic = 0x504e5354; // "TSNP"
+const TUInt32 kSnapshotVersion = 2;
+
+// Holds simulation state as a flat run of bytes: values are appended as they are written and read
+// back in the same order, with no names or padding. Only plain data types (no pointers or members
+// needing construction) may be written with Write and WriteArray. Reading past the end of the data
+// returns zeros and marks the snapshot as failed, so a run of reads can be checked once at the end
+// with Failed rather than after each one
+class CSnapshot
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty snapshot
+	CSnapshot();
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CSnapshot( const CSnapshot& );
+	CSnapshot& operator=( const CSnapshot& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	/////////////////////////////////////
+	// Writing
+
+	// Remove all data, ready to write a new snapshot. Keeps the memory used so snapshots of
+	// the same size can be taken repeatedly without allocating
+	void Clear();
+
+	// Add data to the end of the snapshot. Inline so writes of fixed size types become simple moves
+	void WriteBytes( const void* data, TUInt32 size )
+	{
+		if (m_Size + size > m_Data.size())
+		{
+			Grow( size );
+		}
+		memcpy( m_Data.data() + m_Size, data, size );
+		m_Size += size;
+	}
+
+	template <class T>
+	void Write( const T& value )
+	{
+		WriteBytes( &value, sizeof(T) );
+	}
+
+	// Write a string as its length then its characters
+	void WriteString( const string& text );
+
+	// Write an array as its number of elements then the elements
+	template <class T>
+	void WriteArray( const vector<T>& values )
+	{
+		Write( static_cast<TUInt32>(values.size()) );
+		if (!values.empty())
+		{
+			WriteBytes( &values[0], static_cast<TUInt32>(values.size() * sizeof(T)) );
+		}
+	}
+
+
+	/////////////////////////////////////
+	// Reading
+
+	// Start reading from the beginning of the snapshot, clears any earlier failure
+	void BeginRead()
+	{
+		m_ReadPosition = 0;
+		m_Failed = false;
+	}
+
+	// Read data from the current position, returns false and fills with zeros if there is not
+	// enough data left
+	bool ReadBytes( void* data, TUInt32 size )
+	{
+		if (m_Failed || size > m_Size - m_ReadPosition)
+		{
+			return ReadFailed( data, size );
+		}
+		memcpy( data, m_Data.data() + m_ReadPosition, size );
+		m_ReadPosition += size;
+		return true;
+	}
+
+	template <class T>
+	bool Read( T* pValue )
+	{
+		return ReadBytes( pValue, sizeof(T) );
+	}
+
+	bool ReadString( string* pText );
+
+	template <class T>
+	bool ReadArray( vector<T>* pValues )
+	{
+		TUInt32 size = 0;
+		if (!Read( &size ) || size > (m_Size - m_ReadPosition) / sizeof(T))
+		{
+			m_Failed = true;
+			pValues->clear();
+			return false;
+		}
+		pValues->resize( size );
+		return size == 0 || ReadBytes( &(*pValues)[0], static_cast<TUInt32>(size * sizeof(T)) );
+	}
+
+	// Mark the snapshot as failed, e.g. if data read does not make sense
+	void Fail()
+	{
+		m_Failed = true;
+	}
+
+	// True if any read since BeginRead ran out of data or Fail was called
+	bool Failed() const
+	{
+		return m_Failed;
+	}
+
+	// True if every byte has been read without failure
+	bool ReadAll() const
+	{
+		return !m_Failed && m_ReadPosition == m_Size;
+	}
+
+
+	/////////////////////////////////////
+	// Files
+
+	// Save the snapshot to a file with a header identifying it, returns false on failure
+	bool Save( const string& fileName ) const;
+
+	// Replace the snapshot with one saved to a file, returns false if the file cannot be read or
+	// is not a snapshot of the current version
+	bool Load( const string& fileName );
+
+
+	/////////////////////////////////////
+	// Getters
+
+	// Size of the snapshot in bytes
+	TUInt32 Size() const
+	{
+		return static_cast<TUInt32>(m_Size);
+	}
+
+	const TUInt8* Data() const
+	{
+		return m_Data.empty() ? 0 : &m_Data[0];
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	// Written at the start of a snapshot file
+	struct SHeader
+	{
+		TUInt32 magic;
+		TUInt32 version;
+		TUInt32 size; // Bytes of data following the header
+	};
+
+	// Make room for at least the given number of bytes more
+	void Grow( TUInt32 size );
+
+	// Fail a read, filling its data with zeros. Returns false
+	bool ReadFailed( void* data, TUInt32 size );
+
+	// The buffer only grows, m_Size bytes of it are in use
+	vector<TUInt8> m_Data;
+	size_t         m_Size;
+	size_t         m_ReadPosition;
+	bool           m_Failed;
+};
+
+
+} // namespace gen
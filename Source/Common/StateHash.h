@@ -0,0 +1,115 @@
+/*******************************************
+	StateHash.h
+
+	Hash of simulation state built up one
+	value at a time
+********************************************/
+
+#pragma once
+
+#include <string.h>
+#include <string>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Hashes simulation state to check that two runs are identical, e.g. builds with different
+// optimisation settings. Values are added one at a time by type, never as raw structures,
+// so padding bytes (which may differ between runs) are not hashed. Floats are hashed by their bits,
+// so any difference in the result of a calculation is caught. Each value is one xor and multiply
+// (FNV-1a on 32-bit words), mixed at the end so every bit of the hash depends on every value
+class CStateHash
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor starts an empty hash
+	CStateHash()
+	{
+		m_Hash = kOffsetBasis;
+	}
+
+	// No destructor needed, copying is allowed
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	/////////////////////////////////////
+	// Adding values
+
+	void Add( TUInt32 value )
+	{
+		m_Hash = (m_Hash ^ value) * kPrime;
+	}
+
+	void Add( TInt32 value )
+	{
+		Add( static_cast<TUInt32>(value) );
+	}
+
+	void Add( TUInt64 value )
+	{
+		Add( static_cast<TUInt32>(value) );
+		Add( static_cast<TUInt32>(value >> 32) );
+	}
+
+	void Add( TFloat32 value )
+	{
+		TUInt32 bits;
+		memcpy( &bits, &value, sizeof(bits) );
+		Add( bits );
+	}
+
+	void Add( const TFloat32* values, TUInt32 count )
+	{
+		for (TUInt32 value = 0; value < count; ++value)
+		{
+			Add( values[value] );
+		}
+	}
+
+	// Text is hashed with its length so that neighbouring strings cannot run together
+	void Add( const string& text )
+	{
+		Add( static_cast<TUInt32>(text.size()) );
+		for (TUInt32 character = 0; character < text.size(); ++character)
+		{
+			Add( static_cast<TUInt32>(static_cast<unsigned char>(text[character])) );
+		}
+	}
+
+
+	/////////////////////////////////////
+	// Getters
+
+	// The hash of the values added so far
+	TUInt64 Value() const
+	{
+		// Final mix from MurmurHash3, the multiplies above only carry differences upwards
+		TUInt64 hash = m_Hash;
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	static const TUInt64 kOffsetBasis = 14695981039346656037ull;
+	static const TUInt64 kPrime = 1099511628211ull;
+
+	TUInt64 m_Hash;
+};
+
+
+} // namespace gen
@@ -0,0 +1,171 @@
+/*******************************************
+	ThreadPool.cpp
+
+	Pool of worker threads running queued
+	jobs
+********************************************/
+
+#include "ThreadPool.h"
+#include "TraceLog.h"
+
+namespace gen
+{
+
+// Worker threads are named in the start-up trace
+extern CTraceLog TraceLog;
+
+
+// Constructor starts the given number of worker threads
+CThreadPool::CThreadPool( TUInt32 numThreads, const string& threadName /*= "Worker"*/ )
+{
+	m_NumUnfinished = 0;
+	m_Stopping = false;
+	for (TUInt32 worker = 0; worker < numThreads; ++worker)
+	{
+		m_Threads.push_back( thread( &CThreadPool::WorkerThread, this, threadName + " " + to_string( worker + 1 ) ) );
+	}
+}
+
+// Destructor finishes any queued jobs then stops the worker threads
+CThreadPool::~CThreadPool()
+{
+	WaitForAll();
+	{
+		lock_guard<mutex> lock( m_Mutex );
+		m_Stopping = true;
+	}
+	m_JobAdded.notify_all();
+	for (TUInt32 worker = 0; worker < m_Threads.size(); ++worker)
+	{
+		m_Threads[worker].join();
+	}
+}
+
+
+// A reasonable number of worker threads for this machine
+TUInt32 CThreadPool::DefaultNumThreads()
+{
+	TUInt32 hardwareThreads = thread::hardware_concurrency();
+	return (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+}
+
+// Queue a job to be run by the pool
+void CThreadPool::AddJob( const function<void()>& job )
+{
+	{
+		SJob newJob = { job, CMemoryTracker::CurrentTag() };
+		lock_guard<mutex> lock( m_Mutex );
+		m_Jobs.push_back( newJob );
+		++m_NumUnfinished;
+	}
+	m_JobAdded.notify_one();
+}
+
+// Wait until all queued jobs have finished, running jobs on this thread while waiting
+void CThreadPool::WaitForAll()
+{
+	unique_lock<mutex> lock( m_Mutex );
+	while (m_NumUnfinished > 0)
+	{
+		if (!RunNextJob( lock ))
+		{
+			// Remaining jobs are running on workers - wait for one to finish (it may add more)
+			m_JobFinished.wait( lock );
+		}
+	}
+}
+
+
+// Run job( index ) for each index from 0 to count-1 on the pool and wait for just those to finish
+void CThreadPool::ParallelFor( TUInt32 count, const function<void( TUInt32 )>& job )
+{
+	// The jobs refer to these locals, they are all finished before this function returns
+	TUInt32 remaining = count;
+	exception_ptr error;
+	EMemoryTag memoryTag = CMemoryTracker::CurrentTag();
+
+	unique_lock<mutex> lock( m_Mutex );
+	for (TUInt32 index = 0; index < count; ++index)
+	{
+		SJob newJob;
+		newJob.memoryTag = memoryTag;
+		newJob.job = [this, &job, &remaining, &error, index]
+		{
+			exception_ptr jobError;
+			try
+			{
+				job( index );
+			}
+			catch (...)
+			{
+				jobError = current_exception();
+			}
+			lock_guard<mutex> lock( m_Mutex );
+			if (jobError && !error)
+			{
+				error = jobError;
+			}
+			--remaining; // Must be the last use of the locals above
+		};
+		m_Jobs.push_back( newJob );
+		++m_NumUnfinished;
+	}
+	m_JobAdded.notify_all();
+
+	while (remaining > 0)
+	{
+		if (!RunNextJob( lock ))
+		{
+			m_JobFinished.wait( lock );
+		}
+	}
+	lock.unlock();
+
+	if (error)
+	{
+		rethrow_exception( error );
+	}
+}
+
+
+// Worker thread function
+void CThreadPool::WorkerThread( const string& name )
+{
+	TraceLog.SetThreadName( name );
+
+	unique_lock<mutex> lock( m_Mutex );
+	while (true)
+	{
+		m_JobAdded.wait( lock, [this] { return m_Stopping || !m_Jobs.empty(); } );
+		if (m_Jobs.empty())
+		{
+			return; // Stopping
+		}
+		RunNextJob( lock );
+	}
+}
+
+// Run the next queued job if there is one, with the lock held on entry and exit
+bool CThreadPool::RunNextJob( unique_lock<mutex>& lock )
+{
+	if (m_Jobs.empty())
+	{
+		return false;
+	}
+	SJob job = m_Jobs.front();
+	m_Jobs.pop_front();
+
+	lock.unlock();
+	{
+		CMemoryScope memory( job.memoryTag );
+		job.job();
+	}
+	lock.lock();
+
+	--m_NumUnfinished;
+	m_JobFinished.notify_all();
+	return true;
+}
+
+
+} // namespace gen
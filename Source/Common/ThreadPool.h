@@ -0,0 +1,104 @@
+/*******************************************
+	ThreadPool.h
+
+	Pool of worker threads running queued
+	jobs
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+using namespace std;
+
+#include "Defines.h"
+#include "MemoryTracker.h"
+
+namespace gen
+{
+
+// A fixed set of worker threads taking jobs from a shared queue. Jobs may add further jobs.
+// The thread waiting for the jobs to finish also runs jobs while it waits, so a pool with no
+// worker threads simply runs every job on the waiting thread (useful to compare against
+// serial execution). Allocations made by a job are counted against the memory tag of the thread
+// that queued it (see CMemoryTracker)
+class CThreadPool
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor starts the given number of worker threads, each named from the given prefix
+	// (see CTraceLog::SetThreadName)
+	CThreadPool( TUInt32 numThreads, const string& threadName = "Worker" );
+
+	// Destructor finishes any queued jobs then stops the worker threads
+	~CThreadPool();
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CThreadPool( const CThreadPool& );
+	CThreadPool& operator=( const CThreadPool& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// A reasonable number of worker threads for this machine - one less than the number of
+	// hardware threads, leaving one for the thread that waits
+	static TUInt32 DefaultNumThreads();
+
+	// Queue a job to be run by the pool. Jobs must catch their own exceptions
+	void AddJob( const function<void()>& job );
+
+	// Wait until all queued jobs (including any they add) have finished, running jobs on this
+	// thread while waiting
+	void WaitForAll();
+
+	// Run job( index ) for each index from 0 to count-1 on the pool and wait for just those to
+	// finish, running jobs on this thread while waiting. Unlike WaitForAll this may be called
+	// from inside a job. The first exception thrown by any of the jobs is rethrown here
+	void ParallelFor( TUInt32 count, const function<void( TUInt32 )>& job );
+
+	TUInt32 NumThreads() const
+	{
+		return static_cast<TUInt32>(m_Threads.size());
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	// Worker thread function
+	void WorkerThread( const string& name );
+
+	// Run the next queued job if there is one, with the lock held on entry and exit
+	bool RunNextJob( unique_lock<mutex>& lock );
+
+
+	vector<thread>           m_Threads;
+	// A queued job and the memory tag to run it with
+	struct SJob
+	{
+		function<void()> job;
+		EMemoryTag       memoryTag;
+	};
+
+	deque<SJob>              m_Jobs;
+	TUInt32                  m_NumUnfinished; // Jobs queued or running
+	bool                     m_Stopping;
+
+	mutex                    m_Mutex;
+	condition_variable       m_JobAdded;    // Signalled when jobs are added or on stopping
+	condition_variable       m_JobFinished; // Signalled when a job finishes
+};
+
+
+} // namespace gen
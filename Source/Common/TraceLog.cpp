@@ -0,0 +1,119 @@
+/*******************************************
+	TraceLog.cpp
+
+	Timeline of timed events from any thread,
+	written in Chrome trace format
+********************************************/
+
+#include <fstream>
+#include "TraceLog.h"
+
+namespace gen
+{
+
+// Write a string as a JSON string literal
+static void WriteJSONString( ofstream& file, const string& text )
+{
+	file << '"';
+	for (TUInt32 c = 0; c < text.length(); ++c)
+	{
+		if (text[c] == '"' || text[c] == '\\') file << '\\';
+		file << text[c];
+	}
+	file << '"';
+}
+
+
+// Constructor creates an empty log, times are measured from this point
+CTraceLog::CTraceLog()
+{
+	m_StartTime = chrono::steady_clock::now();
+}
+
+
+// Name the calling thread in the trace
+void CTraceLog::SetThreadName( const string& name )
+{
+	lock_guard<mutex> lock( m_Mutex );
+	m_ThreadNames[ThreadIndex()] = name;
+}
+
+// Add an event on the calling thread running from start to end
+void CTraceLog::AddEvent( const string& name, const char* category, TUInt64 start, TUInt64 end )
+{
+	lock_guard<mutex> lock( m_Mutex );
+	SEvent event;
+	event.name = name;
+	event.category = category;
+	event.thread = ThreadIndex();
+	event.start = start;
+	event.end = end;
+	m_Events.push_back( event );
+}
+
+// Remove all events (thread names are kept)
+void CTraceLog::Clear()
+{
+	lock_guard<mutex> lock( m_Mutex );
+	m_Events.clear();
+}
+
+
+// Write the log in Chrome trace format, returns false if the file cannot be written
+bool CTraceLog::WriteChromeTrace( const string& fileName ) const
+{
+	ofstream file( fileName.c_str() );
+	if (!file)
+	{
+		return false;
+	}
+
+	lock_guard<mutex> lock( m_Mutex );
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+
+	// Thread names as metadata events
+	for (TUInt32 thread = 0; thread < m_ThreadNames.size(); ++thread)
+	{
+		if (!first) file << ",\n";
+		first = false;
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":";
+		WriteJSONString( file, m_ThreadNames[thread] );
+		file << "}}";
+	}
+
+	// Complete events
+	for (TUInt32 event = 0; event < m_Events.size(); ++event)
+	{
+		const SEvent& data = m_Events[event];
+		if (!first) file << ",\n";
+		first = false;
+		file << "{\"name\":";
+		WriteJSONString( file, data.name );
+		file << ",\"cat\":\"" << data.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << data.thread
+		     << ",\"ts\":" << data.start << ",\"dur\":" << (data.end - data.start) << "}";
+	}
+
+	file << "\n]}\n";
+	return file.good();
+}
+
+
+// Get the trace index of the calling thread, with the lock held
+TUInt32 CTraceLog::ThreadIndex()
+{
+	thread::id id = this_thread::get_id();
+	map<thread::id, TUInt32>::iterator found = m_ThreadIndices.find( id );
+	if (found != m_ThreadIndices.end())
+	{
+		return found->second;
+	}
+
+	TUInt32 index = static_cast<TUInt32>(m_ThreadNames.size());
+	m_ThreadIndices[id] = index;
+	m_ThreadNames.push_back( "Thread " + to_string( index ) );
+	return index;
+}
+
+
+} // namespace gen
@@ -0,0 +1,125 @@
+/*******************************************
+	TraceLog.h
+
+	Timeline of timed events from any thread,
+	written in Chrome trace format
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <chrono>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Collects timed events (name, category, thread, start and end) from any thread. The log can
+// be written as a Chrome trace JSON file, which can be viewed in chrome://tracing or Perfetto
+// to see how work overlaps across threads
+class CTraceLog
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty log, times are measured from this point
+	CTraceLog();
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CTraceLog( const CTraceLog& );
+	CTraceLog& operator=( const CTraceLog& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Current time in microseconds since the log was created
+	TUInt64 Now() const
+	{
+		return chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now() - m_StartTime ).count();
+	}
+
+	// Name the calling thread in the trace
+	void SetThreadName( const string& name );
+
+	// Add an event on the calling thread running from start to end (times from Now)
+	void AddEvent( const string& name, const char* category, TUInt64 start, TUInt64 end );
+
+	// Remove all events (thread names are kept)
+	void Clear();
+
+	// Write the log in Chrome trace format, returns false if the file cannot be written
+	bool WriteChromeTrace( const string& fileName ) const;
+
+	TUInt32 NumEvents() const
+	{
+		lock_guard<mutex> lock( m_Mutex );
+		return static_cast<TUInt32>(m_Events.size());
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	struct SEvent
+	{
+		string      name;
+		const char* category;
+		TUInt32     thread;
+		TUInt64     start;
+		TUInt64     end;
+	};
+
+	// Get the trace index of the calling thread, with the lock held
+	TUInt32 ThreadIndex();
+
+
+	chrono::steady_clock::time_point m_StartTime;
+
+	vector<SEvent>            m_Events;
+	map<thread::id, TUInt32>  m_ThreadIndices;
+	vector<string>            m_ThreadNames;   // By thread index
+	mutable mutex             m_Mutex;
+};
+
+
+// Adds an event to a trace log covering the lifetime of this object, e.g. a block of code:
+//     { CTraceScope trace( TraceLog, "Load textures", "Loading" ); ... }
+class CTraceScope
+{
+public:
+	CTraceScope( CTraceLog& log, const string& name, const char* category )
+		: m_Log( log ), m_Name( name ), m_Category( category )
+	{
+		m_Start = m_Log.Now();
+	}
+
+	~CTraceScope()
+	{
+		m_Log.AddEvent( m_Name, m_Category, m_Start, m_Log.Now() );
+	}
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CTraceScope( const CTraceScope& );
+	CTraceScope& operator=( const CTraceScope& );
+
+	CTraceLog&  m_Log;
+	string      m_Name;
+	const char* m_Category;
+	TUInt64     m_Start;
+};
+
+
+} // namespace gen
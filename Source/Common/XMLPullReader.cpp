@@ -0,0 +1,460 @@
+/*******************************************
+	XMLPullReader.cpp
+
+	Streaming XML reader returning one
+	element at a time
+********************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "XMLPullReader.h"
+
+namespace gen
+{
+
+// Is the character XML white space
+static bool IsSpace( char c )
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+// Constructor creates a reader using a buffer of the given size
+CXMLPullReader::CXMLPullReader( TUInt32 bufferSize /*= 64 * 1024*/ )
+	: m_Buffer( bufferSize )
+{
+	Close();
+}
+
+// Destructor closes any open file
+CXMLPullReader::~CXMLPullReader()
+{
+	Close();
+}
+
+
+// Open the given file, returns false if it cannot be opened
+bool CXMLPullReader::Open( const string& fileName )
+{
+	Close();
+	m_File.open( fileName.c_str(), ios::binary );
+	return m_File.is_open();
+}
+
+// Close the file
+void CXMLPullReader::Close()
+{
+	if (m_File.is_open())
+	{
+		m_File.close();
+	}
+	m_File.clear();
+	m_Pos = 0;
+	m_End = 0;
+	m_BytesRead = 0;
+	m_LineNumber = 1;
+	m_Name.clear();
+	m_NumAttributes = 0;
+	m_OpenElements.clear();
+	m_PendingEnd = false;
+	m_LastEvent = Event_EndOfFile;
+	m_ErrorText.clear();
+}
+
+
+// Read up to the start or end of the next element
+CXMLPullReader::EEvent CXMLPullReader::Next()
+{
+	if (m_LastEvent == Event_Error)
+	{
+		return Event_Error;
+	}
+
+	// End of an empty element (<a/>) follows its start
+	if (m_PendingEnd)
+	{
+		m_PendingEnd = false;
+		m_NumAttributes = 0;
+		m_OpenElements.pop_back();
+		return m_LastEvent = Event_EndElement;
+	}
+
+	while (true)
+	{
+		// Skip text content up to the next markup
+		if (!SkipToMarkup())
+		{
+			if (!m_OpenElements.empty())
+			{
+				return Error( "Unexpected end of file in element " + m_OpenElements.back() );
+			}
+			return m_LastEvent = Event_EndOfFile;
+		}
+
+		char c;
+		if (!ReadChar( &c ))
+		{
+			return Error( "Unexpected end of file" );
+		}
+
+		// Processing instruction or XML declaration
+		if (c == '?')
+		{
+			if (!ReadUntil( "?>", 0 )) return Error( "Unterminated processing instruction" );
+			continue;
+		}
+
+		// Comment, CDATA or DOCTYPE
+		if (c == '!')
+		{
+			char next[2];
+			if (!ReadChar( &next[0] )) return Error( "Unexpected end of file" );
+			if (next[0] == '-')
+			{
+				if (!ReadChar( &next[1] ) || next[1] != '-') return Error( "Malformed comment" );
+				if (!ReadUntil( "-->", 0 )) return Error( "Unterminated comment" );
+			}
+			else if (next[0] == '[')
+			{
+				if (!ReadUntil( "]]>", 0 )) return Error( "Unterminated CDATA section" );
+			}
+			else
+			{
+				if (!ReadUntil( ">", 0 )) return Error( "Unterminated declaration" );
+			}
+			continue;
+		}
+
+		// End tag, must match the open element
+		if (c == '/')
+		{
+			if (!ReadUntil( ">", &m_Name )) return Error( "Unterminated end tag" );
+			while (!m_Name.empty() && IsSpace( m_Name[m_Name.length() - 1] ))
+			{
+				m_Name.erase( m_Name.length() - 1 );
+			}
+			if (m_OpenElements.empty() || m_OpenElements.back() != m_Name)
+			{
+				return Error( "Unexpected end tag " + m_Name );
+			}
+			m_OpenElements.pop_back();
+			m_NumAttributes = 0;
+			return m_LastEvent = Event_EndElement;
+		}
+
+		// Start tag
+		m_Tag.assign( 1, c );
+		if (!ReadStartTag())
+		{
+			return Error( "Unterminated start tag" );
+		}
+		if (!ParseStartTag())
+		{
+			return Event_Error;
+		}
+		m_OpenElements.push_back( m_Name );
+		return m_LastEvent = Event_StartElement;
+	}
+}
+
+
+// Get an attribute of the element just started, returns 0 if the attribute is not present
+const char* CXMLPullReader::Attribute( const char* name ) const
+{
+	for (TUInt32 attribute = 0; attribute < m_NumAttributes; ++attribute)
+	{
+		if (m_Attributes[attribute].name == name)
+		{
+			return m_Attributes[attribute].value.c_str();
+		}
+	}
+	return 0;
+}
+
+// Get attributes converted to a number or bool, returns the default value if the attribute
+// is not present
+TFloat32 CXMLPullReader::FloatAttribute( const char* name, TFloat32 defaultValue /*= 0.0f*/ ) const
+{
+	const char* value = Attribute( name );
+	return value ? static_cast<TFloat32>(atof( value )) : defaultValue;
+}
+
+TInt32 CXMLPullReader::IntAttribute( const char* name, TInt32 defaultValue /*= 0*/ ) const
+{
+	const char* value = Attribute( name );
+	return value ? static_cast<TInt32>(strtol( value, 0, 10 )) : defaultValue;
+}
+
+TUInt32 CXMLPullReader::UnsignedAttribute( const char* name, TUInt32 defaultValue /*= 0*/ ) const
+{
+	const char* value = Attribute( name );
+	return value ? static_cast<TUInt32>(strtoul( value, 0, 10 )) : defaultValue;
+}
+
+bool CXMLPullReader::BoolAttribute( const char* name, bool defaultValue /*= false*/ ) const
+{
+	const char* value = Attribute( name );
+	if (!value)
+	{
+		return defaultValue;
+	}
+	return strcmp( value, "true" ) == 0 || strcmp( value, "1" ) == 0;
+}
+
+
+// Read the next chunk of the file into the buffer, returns false at the end of the file
+bool CXMLPullReader::FillBuffer()
+{
+	if (!m_File.is_open())
+	{
+		return false;
+	}
+	m_File.read( &m_Buffer[0], m_Buffer.size() );
+	m_Pos = 0;
+	m_End = static_cast<TUInt32>(m_File.gcount());
+	m_BytesRead += m_End;
+	return m_End > 0;
+}
+
+// Skip past the next '<', returns false if the end of the file is reached first
+bool CXMLPullReader::SkipToMarkup()
+{
+	while (m_Pos < m_End || FillBuffer())
+	{
+		const char* start = &m_Buffer[0] + m_Pos;
+		const char* end = &m_Buffer[0] + m_End;
+		const char* markup = static_cast<const char*>(memchr( start, '<', end - start ));
+		if (markup == 0)
+		{
+			markup = end;
+		}
+		m_LineNumber += static_cast<TUInt32>(count( start, markup, '\n' ));
+		m_Pos += static_cast<TUInt32>(markup - start);
+		if (markup != end)
+		{
+			++m_Pos;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Read up to and including the given terminator, optionally storing the text before it.
+// Returns false if the end of the file is reached first
+bool CXMLPullReader::ReadUntil( const char* terminator, string* pText )
+{
+	if (pText) pText->clear();
+
+	// Compare the last few characters read with the terminator. Terminators are short, so
+	// keep a small window rather than the whole text
+	TUInt32 length = static_cast<TUInt32>(strlen( terminator ));
+	char window[4] = { 0, 0, 0, 0 };
+	TUInt32 numRead = 0;
+	char c;
+	while (ReadChar( &c ))
+	{
+		memmove( window, window + 1, length - 1 );
+		window[length - 1] = c;
+		++numRead;
+		if (numRead >= length && memcmp( window, terminator, length ) == 0)
+		{
+			if (pText) pText->erase( pText->length() - (length - 1) );
+			return true;
+		}
+		if (pText) *pText += c;
+	}
+	return false;
+}
+
+// Read the rest of a start tag up to its closing '>', leaving quoted values intact. Tags are
+// copied a buffer span at a time, this is where most of the time goes for large files
+bool CXMLPullReader::ReadStartTag()
+{
+	char quote = 0;
+	while (m_Pos < m_End || FillBuffer())
+	{
+		const char* start = &m_Buffer[0] + m_Pos;
+		const char* end = &m_Buffer[0] + m_End;
+		const char* c = start;
+		for (; c != end; ++c)
+		{
+			if (*c == '\n')
+			{
+				++m_LineNumber;
+			}
+			else if (quote)
+			{
+				if (*c == quote) quote = 0;
+			}
+			else if (*c == '"' || *c == '\'')
+			{
+				quote = *c;
+			}
+			else if (*c == '>')
+			{
+				break;
+			}
+		}
+		m_Tag.append( start, c );
+		m_Pos += static_cast<TUInt32>(c - start);
+		if (c != end)
+		{
+			++m_Pos; // Skip '>'
+			return true;
+		}
+	}
+	return false;
+}
+
+// Split the start tag just read into name and attributes
+bool CXMLPullReader::ParseStartTag()
+{
+	const char* text = m_Tag.c_str();
+	const char* end = text + m_Tag.length();
+
+	// Empty element ends with '/'
+	while (end > text && IsSpace( end[-1] )) --end;
+	m_PendingEnd = (end > text && end[-1] == '/');
+	if (m_PendingEnd) --end;
+
+	// Element name
+	const char* nameStart = text;
+	while (text < end && !IsSpace( *text )) ++text;
+	if (text == nameStart)
+	{
+		Error( "Missing element name" );
+		return false;
+	}
+	m_Name.assign( nameStart, text );
+
+	// Attributes: name = "value" or name = 'value'
+	m_NumAttributes = 0;
+	while (true)
+	{
+		while (text < end && IsSpace( *text )) ++text;
+		if (text == end)
+		{
+			return true;
+		}
+
+		const char* attributeStart = text;
+		while (text < end && *text != '=' && !IsSpace( *text )) ++text;
+		const char* attributeEnd = text;
+		while (text < end && IsSpace( *text )) ++text;
+		if (text == end || *text != '=' || attributeEnd == attributeStart)
+		{
+			Error( "Malformed attribute in element " + m_Name );
+			return false;
+		}
+		++text;
+		while (text < end && IsSpace( *text )) ++text;
+		if (text == end || (*text != '"' && *text != '\''))
+		{
+			Error( "Unquoted attribute value in element " + m_Name );
+			return false;
+		}
+		char quote = *text++;
+		const char* valueStart = text;
+		while (text < end && *text != quote) ++text;
+		if (text == end)
+		{
+			Error( "Unterminated attribute value in element " + m_Name );
+			return false;
+		}
+
+		if (m_NumAttributes == m_Attributes.size())
+		{
+			m_Attributes.push_back( SAttribute() );
+		}
+		SAttribute& attribute = m_Attributes[m_NumAttributes++];
+		attribute.name.assign( attributeStart, attributeEnd );
+		attribute.value.assign( valueStart, text );
+		if (!DecodeValue( &attribute.value ))
+		{
+			Error( "Bad reference in attribute " + attribute.name );
+			return false;
+		}
+		++text;
+	}
+}
+
+// Replace entity and character references in an attribute value
+bool CXMLPullReader::DecodeValue( string* pValue )
+{
+	string::size_type ampersand = pValue->find( '&' );
+	if (ampersand == string::npos)
+	{
+		return true; // Usual case
+	}
+
+	string decoded( *pValue, 0, ampersand );
+	while (ampersand < pValue->length())
+	{
+		char c = (*pValue)[ampersand];
+		if (c != '&')
+		{
+			decoded += c;
+			++ampersand;
+			continue;
+		}
+
+		string::size_type semicolon = pValue->find( ';', ampersand );
+		if (semicolon == string::npos)
+		{
+			return false;
+		}
+		string reference = pValue->substr( ampersand + 1, semicolon - ampersand - 1 );
+		if      (reference == "lt")   decoded += '<';
+		else if (reference == "gt")   decoded += '>';
+		else if (reference == "amp")  decoded += '&';
+		else if (reference == "quot") decoded += '"';
+		else if (reference == "apos") decoded += '\'';
+		else if (reference.length() > 1 && reference[0] == '#')
+		{
+			// Character reference, written as UTF-8
+			TUInt32 code = (reference[1] == 'x') ? strtoul( reference.c_str() + 2, 0, 16 ) :
+			                                       strtoul( reference.c_str() + 1, 0, 10 );
+			if (code < 0x80)
+			{
+				decoded += static_cast<char>(code);
+			}
+			else if (code < 0x800)
+			{
+				decoded += static_cast<char>(0xc0 | (code >> 6));
+				decoded += static_cast<char>(0x80 | (code & 0x3f));
+			}
+			else if (code < 0x10000)
+			{
+				decoded += static_cast<char>(0xe0 | (code >> 12));
+				decoded += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+				decoded += static_cast<char>(0x80 | (code & 0x3f));
+			}
+			else
+			{
+				decoded += static_cast<char>(0xf0 | (code >> 18));
+				decoded += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+				decoded += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+				decoded += static_cast<char>(0x80 | (code & 0x3f));
+			}
+		}
+		else
+		{
+			return false;
+		}
+		ampersand = semicolon + 1;
+	}
+	pValue->swap( decoded );
+	return true;
+}
+
+
+// Set the error text and return the error event
+CXMLPullReader::EEvent CXMLPullReader::Error( const string& text )
+{
+	m_ErrorText = text;
+	return m_LastEvent = Event_Error;
+}
+
+
+} // namespace gen
@@ -0,0 +1,178 @@
+/*******************************************
+	XMLPullReader.h
+
+	Streaming XML reader returning one
+	element at a time
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Reads an XML file in fixed size chunks, returning the start and end of each element in turn
+// along with the attributes of start elements. Unlike a DOM parser (e.g. tinyxml2) nothing is
+// kept once the caller moves on, so memory use depends only on the buffer size and the largest
+// single tag, not on the size of the file. Text content, comments, processing instructions,
+// CDATA and DOCTYPE are skipped. Example:
+//     while ((event = reader.Next()) == CXMLPullReader::Event_StartElement || ...)
+//         if (event == Event_StartElement && reader.Name() == "Entity") ... reader.Attribute( "Name" )
+class CXMLPullReader
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates a reader using a buffer of the given size
+	CXMLPullReader( TUInt32 bufferSize = 64 * 1024 );
+
+	// Destructor closes any open file
+	~CXMLPullReader();
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CXMLPullReader( const CXMLPullReader& );
+	CXMLPullReader& operator=( const CXMLPullReader& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Events returned by Next
+	enum EEvent
+	{
+		Event_StartElement, // Name and attributes are available
+		Event_EndElement,   // Name is available. Also returned after an empty element (<a/>)
+		Event_EndOfFile,
+		Event_Error,        // ErrorText and LineNumber describe the problem
+	};
+
+	// Open the given file, returns false if it cannot be opened
+	bool Open( const string& fileName );
+
+	// Close the file
+	void Close();
+
+	// Read up to the start or end of the next element
+	EEvent Next();
+
+
+	/////////////////////////////////////
+	// Current element
+
+	// Name of the element just started or ended
+	const string& Name() const
+	{
+		return m_Name;
+	}
+
+	// Depth of the current element, the root element is at depth 1
+	TUInt32 Depth() const
+	{
+		return static_cast<TUInt32>(m_OpenElements.size()) + (m_LastEvent == Event_EndElement ? 1 : 0);
+	}
+
+	// Get an attribute of the element just started, returns 0 if the attribute is not present
+	const char* Attribute( const char* name ) const;
+
+	// Get an attribute converted to a number or bool, returns the default value if the
+	// attribute is not present
+	TFloat32 FloatAttribute( const char* name, TFloat32 defaultValue = 0.0f ) const;
+	TInt32 IntAttribute( const char* name, TInt32 defaultValue = 0 ) const;
+	TUInt32 UnsignedAttribute( const char* name, TUInt32 defaultValue = 0 ) const;
+	bool BoolAttribute( const char* name, bool defaultValue = false ) const;
+
+
+	/////////////////////////////////////
+	// Status
+
+	// Line of the file reached, for error messages
+	TUInt32 LineNumber() const
+	{
+		return m_LineNumber;
+	}
+
+	// Description of the last error
+	const string& ErrorText() const
+	{
+		return m_ErrorText;
+	}
+
+	// Total bytes read from the file so far
+	TUInt64 BytesRead() const
+	{
+		return m_BytesRead;
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	struct SAttribute
+	{
+		string name;
+		string value;
+	};
+
+	// Get the next character of the file, returns false at the end of the file
+	bool ReadChar( char* pChar )
+	{
+		if (m_Pos == m_End && !FillBuffer())
+		{
+			return false;
+		}
+		*pChar = m_Buffer[m_Pos++];
+		if (*pChar == '\n') ++m_LineNumber;
+		return true;
+	}
+
+	// Read the next chunk of the file into the buffer, returns false at the end of the file
+	bool FillBuffer();
+
+	// Skip past the next '<', returns false if the end of the file is reached first
+	bool SkipToMarkup();
+
+	// Read up to and including the given terminator, optionally storing the text before it.
+	// Returns false if the end of the file is reached first
+	bool ReadUntil( const char* terminator, string* pText );
+
+	// Read the rest of a start tag up to its closing '>', leaving quoted values intact
+	bool ReadStartTag();
+
+	// Split the start tag just read into name and attributes
+	bool ParseStartTag();
+
+	// Replace entity and character references in an attribute value
+	bool DecodeValue( string* pValue );
+
+	// Set the error text and return the error event
+	EEvent Error( const string& text );
+
+
+	ifstream          m_File;
+	vector<char>      m_Buffer;
+	TUInt32           m_Pos;
+	TUInt32           m_End;
+	TUInt64           m_BytesRead;
+	TUInt32           m_LineNumber;
+
+	string            m_Tag;             // Text of current start tag
+	string            m_Name;
+	vector<SAttribute> m_Attributes;     // Reused between elements, only the first few in use
+	TUInt32           m_NumAttributes;
+	vector<string>    m_OpenElements;    // Names of elements started but not yet ended
+	bool              m_PendingEnd;      // Empty element, end event still to return
+	EEvent            m_LastEvent;
+	string            m_ErrorText;
+};
+
+
+} // namespace gen
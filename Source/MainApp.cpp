@@ -11,6 +11,10 @@
 #include "Defines.h"
 #include "Input.h"
 #include "CTimer.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include "FrameArena.h"
+#include "FrameMetrics.h"
 #include "TankAssignment.h"
 
 namespace gen
@@ -30,8 +34,9 @@ ID3D10Texture2D*        DepthStencil = NULL;
 ID3D10DepthStencilView* DepthStencilView = NULL;
 ID3D10RenderTargetView* BackBufferRenderTarget = NULL;
 
-// D3DX font for OSD
-ID3DX10Font* OSDFont = NULL;
+// D3DX font for OSD, and the sprite all OSD text is batched into
+ID3DX10Font*   OSDFont = NULL;
+ID3DX10Sprite* OSDSprite = NULL;
 
 
 //--------------------------------------------------------------------------------------
@@ -59,6 +64,11 @@ TUInt32 MouseY;
 // Game timer
 CTimer Timer;
 
+// Frame profiler, frame time histograms and frame arena from TankAssignment.cpp
+extern CProfiler Profiler;
+extern CFrameMetrics FrameMetrics;
+extern CFrameArena FrameArena;
+
 
 
 //-----------------------------------------------------------------------------
@@ -128,6 +138,7 @@ bool D3DSetup( HWND hWnd )
 	// Create a font using D3DX helper functions
     if (FAILED(D3DX10CreateFont( g_pd3dDevice, 12, 0, FW_BOLD, 1, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
                                  DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Arial", &OSDFont ))) return false;
+	if (FAILED(D3DX10CreateSprite( g_pd3dDevice, 4096, &OSDSprite ))) return false;
 
 	return true;
 }
@@ -147,6 +158,7 @@ void D3DShutdown()
 {
 	// Release D3D interfaces
 	if (g_pd3dDevice)           g_pd3dDevice->ClearState();
+	if (OSDSprite)              OSDSprite->Release();
 	if (OSDFont)                OSDFont->Release();
 	if (DepthStencilView)       DepthStencilView->Release();
 	if (BackBufferRenderTarget) BackBufferRenderTarget->Release();
@@ -260,9 +272,20 @@ INT WINAPI WinMain( HINSTANCE hInst, HINSTANCE, LPSTR, INT )
                 else
 				{
 					// Render and update the scene - using variable timing
-					float updateTime = gen::Timer.GetLapTime();
+					float updateTime = static_cast<float>(gen::Timer.GetLapTime());
+					CTimer::TTicks renderStart = CTimer::Now();
                     gen::RenderScene( updateTime );
+					CTimer::TTicks updateStart = CTimer::Now();
 					gen::UpdateScene( updateTime );
+					CTimer::TTicks updateEnd = CTimer::Now();
+					gen::Profiler.EndFrame();
+					gen::CMemoryTracker::EndFrame();
+					gen::FrameArena.Reset();
+
+					// Record frame, render and update times
+					double frequency = gen::Timer.GetFrequency();
+					gen::FrameMetrics.AddFrame( updateTime, static_cast<float>((updateEnd - updateStart) / frequency),
+					                            static_cast<float>((updateStart - renderStart) / frequency) );
 
 					// Toggle fullscreen / windowed
 					if (gen::KeyHit( gen::Key_F1 ))
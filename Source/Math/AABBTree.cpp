@@ -0,0 +1,257 @@
+/*******************************************
+	AABBTree.cpp
+
+	Axis-aligned bounding box and a bounding
+	volume hierarchy built from such boxes
+********************************************/
+
+#include "Utility.h"
+#include "AABBTree.h"
+
+namespace gen
+{
+
+/*-----------------------------------------------------------------------------------------
+	Axis-Aligned Bounding Box
+-----------------------------------------------------------------------------------------*/
+
+// Return the world-space box enclosing a model-space box after transformation by a matrix
+SAABB TransformAABB( const SAABB& box, const CMatrix4x4& matrix )
+{
+	SAABB result;
+	result.SetEmpty();
+	for (TUInt32 corner = 0; corner < 8; ++corner)
+	{
+		CVector3 point( (corner & 1) ? box.maxBounds.x : box.minBounds.x,
+		                (corner & 2) ? box.maxBounds.y : box.minBounds.y,
+		                (corner & 4) ? box.maxBounds.z : box.minBounds.z );
+		result.Extend( matrix.TransformPoint( point ) );
+	}
+	return result;
+}
+
+// Slab test of a ray against a box. Returns true if the ray enters the box between parameter
+// 0 and maxT, with the entry parameter (0 if the origin is inside) returned through pNearT
+bool RayIntersectsAABB
+(
+	const SAABB&    box,
+	const CVector3& origin,
+	const CVector3& invDirection,
+	TFloat32        maxT,
+	TFloat32*       pNearT
+)
+{
+	TFloat32 t1 = (box.minBounds.x - origin.x) * invDirection.x;
+	TFloat32 t2 = (box.maxBounds.x - origin.x) * invDirection.x;
+	TFloat32 nearT = Min( t1, t2 );
+	TFloat32 farT = Max( t1, t2 );
+
+	t1 = (box.minBounds.y - origin.y) * invDirection.y;
+	t2 = (box.maxBounds.y - origin.y) * invDirection.y;
+	nearT = Max( nearT, Min( t1, t2 ) );
+	farT = Min( farT, Max( t1, t2 ) );
+
+	t1 = (box.minBounds.z - origin.z) * invDirection.z;
+	t2 = (box.maxBounds.z - origin.z) * invDirection.z;
+	nearT = Max( nearT, Min( t1, t2 ) );
+	farT = Min( farT, Max( t1, t2 ) );
+
+	nearT = Max( nearT, 0.0f );
+	if (nearT > farT || nearT > maxT)
+	{
+		return false;
+	}
+	*pNearT = nearT;
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	AABB Tree Class
+-----------------------------------------------------------------------------------------*/
+
+// Constructor creates an empty tree
+CAABBTree::CAABBTree()
+{
+	m_MaxLeafSize = 4;
+}
+
+
+// Build the tree from the given primitive boxes. Previous contents are discarded
+void CAABBTree::Build( const SAABB* boxes, TUInt32 numBoxes, TUInt32 maxLeafSize /*= 4*/ )
+{
+	Clear();
+	if (numBoxes == 0)
+	{
+		return;
+	}
+	m_MaxLeafSize = Max( maxLeafSize, 1u );
+
+	// Prepare build data - a tree has at most 2n-1 nodes
+	m_BuildPrims.resize( numBoxes );
+	for (TUInt32 prim = 0; prim < numBoxes; ++prim)
+	{
+		m_BuildPrims[prim].box = boxes[prim];
+		m_BuildPrims[prim].centre = boxes[prim].Centre();
+		m_BuildPrims[prim].index = prim;
+	}
+	m_Nodes.reserve( 2 * numBoxes - 1 );
+
+	BuildNode( 0, numBoxes, 0 );
+
+	// Store primitives in leaf order so leaves reference contiguous ranges
+	m_PrimIndices.resize( numBoxes );
+	m_PrimBoxes.resize( numBoxes );
+	for (TUInt32 prim = 0; prim < numBoxes; ++prim)
+	{
+		m_PrimIndices[prim] = m_BuildPrims[prim].index;
+		m_PrimBoxes[prim] = m_BuildPrims[prim].box;
+	}
+
+	// Release build memory
+	vector<SBuildPrim>().swap( m_BuildPrims );
+}
+
+// Empty the tree
+void CAABBTree::Clear()
+{
+	m_Nodes.clear();
+	m_PrimIndices.clear();
+	m_PrimBoxes.clear();
+}
+
+
+// Renumber the primitives so that each primitive index is its position in leaf order. Returns
+// the original index of each primitive so the caller can reorder its own data to match
+void CAABBTree::RenumberToLeafOrder( vector<TUInt32>* pOriginalIndices )
+{
+	*pOriginalIndices = m_PrimIndices;
+	for (TUInt32 prim = 0; prim < m_PrimIndices.size(); ++prim)
+	{
+		m_PrimIndices[prim] = prim;
+	}
+}
+
+
+// Recursively build the subtree for build primitives [first, first + count). Splits are
+// chosen with a binned surface area heuristic on the primitive centres
+void CAABBTree::BuildNode( TUInt32 first, TUInt32 count, TUInt32 depth )
+{
+	// Calculate bounds of the primitives and of their centres
+	SAABB bounds, centreBounds;
+	bounds.SetEmpty();
+	centreBounds.SetEmpty();
+	for (TUInt32 prim = first; prim < first + count; ++prim)
+	{
+		bounds.Extend( m_BuildPrims[prim].box );
+		centreBounds.Extend( m_BuildPrims[prim].centre );
+	}
+
+	TUInt32 nodeIndex = static_cast<TUInt32>(m_Nodes.size());
+	m_Nodes.push_back( SNode() );
+	m_Nodes[nodeIndex].minBounds = bounds.minBounds;
+	m_Nodes[nodeIndex].maxBounds = bounds.maxBounds;
+
+	// Make a leaf if small enough or the tree is getting too deep for the query stacks
+	if (count <= m_MaxLeafSize || depth >= kMaxStackDepth - 2)
+	{
+		m_Nodes[nodeIndex].offset = first;
+		m_Nodes[nodeIndex].count = count;
+		return;
+	}
+
+	// Find the best split over all three axes
+	TFloat32 bestCost = FLT_MAX;
+	TUInt32  bestAxis = 0;
+	TUInt32  bestBin = 0;
+	CVector3 extent = centreBounds.maxBounds - centreBounds.minBounds;
+	for (TUInt32 axis = 0; axis < 3; ++axis)
+	{
+		if (extent[axis] <= 0.0f) continue;
+		TFloat32 binScale = kNumBins / extent[axis];
+
+		// Gather primitives into bins
+		SAABB   binBounds[kNumBins];
+		TUInt32 binCounts[kNumBins];
+		for (TUInt32 bin = 0; bin < kNumBins; ++bin)
+		{
+			binBounds[bin].SetEmpty();
+			binCounts[bin] = 0;
+		}
+		for (TUInt32 prim = first; prim < first + count; ++prim)
+		{
+			TUInt32 bin = static_cast<TUInt32>((m_BuildPrims[prim].centre[axis] - centreBounds.minBounds[axis]) * binScale);
+			if (bin >= kNumBins) bin = kNumBins - 1;
+			binBounds[bin].Extend( m_BuildPrims[prim].box );
+			++binCounts[bin];
+		}
+
+		// Sweep from the right to get areas/counts for each possible right-hand side
+		TFloat32 rightAreas[kNumBins];
+		TUInt32  rightCounts[kNumBins];
+		SAABB    sweep;
+		sweep.SetEmpty();
+		TUInt32  sweepCount = 0;
+		for (TUInt32 bin = kNumBins - 1; bin > 0; --bin)
+		{
+			sweep.Extend( binBounds[bin] );
+			sweepCount += binCounts[bin];
+			rightAreas[bin] = sweep.SurfaceArea();
+			rightCounts[bin] = sweepCount;
+		}
+
+		// Sweep from the left evaluating the cost of splitting before each bin
+		sweep.SetEmpty();
+		sweepCount = 0;
+		for (TUInt32 bin = 1; bin < kNumBins; ++bin)
+		{
+			sweep.Extend( binBounds[bin - 1] );
+			sweepCount += binCounts[bin - 1];
+			if (sweepCount == 0 || rightCounts[bin] == 0) continue;
+
+			TFloat32 cost = sweep.SurfaceArea() * sweepCount + rightAreas[bin] * rightCounts[bin];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+			}
+		}
+	}
+
+	// Partition primitives around the chosen split, fall back to a median split if no useful
+	// split was found (e.g. all centres coincide)
+	TUInt32 mid = first;
+	if (bestCost < FLT_MAX)
+	{
+		TFloat32 binScale = kNumBins / extent[bestAxis];
+		TUInt32 right = first + count;
+		while (mid < right)
+		{
+			TUInt32 bin = static_cast<TUInt32>((m_BuildPrims[mid].centre[bestAxis] - centreBounds.minBounds[bestAxis]) * binScale);
+			if (bin >= kNumBins) bin = kNumBins - 1;
+			if (bin < bestBin)
+			{
+				++mid;
+			}
+			else
+			{
+				--right;
+				Swap( m_BuildPrims[mid], m_BuildPrims[right] );
+			}
+		}
+	}
+	if (mid == first || mid == first + count)
+	{
+		mid = first + count / 2;
+	}
+
+	// Left child directly follows this node, right child index recorded once built
+	BuildNode( first, mid - first, depth + 1 );
+	m_Nodes[nodeIndex].offset = static_cast<TUInt32>(m_Nodes.size());
+	m_Nodes[nodeIndex].count = 0;
+	BuildNode( mid, first + count - mid, depth + 1 );
+}
+
+
+} // namespace gen
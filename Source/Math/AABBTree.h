@@ -0,0 +1,493 @@
+/*******************************************
+	AABBTree.h
+
+	Axis-aligned bounding box and a bounding
+	volume hierarchy built from such boxes
+********************************************/
+
+#pragma once
+
+#include <float.h>
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "BaseMath.h"
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+
+namespace gen
+{
+
+/*-----------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------
+	Axis-Aligned Bounding Box
+-------------------------------------------------------------------------------------------
+-----------------------------------------------------------------------------------------*/
+
+// Simple axis-aligned box held as minimum and maximum corners
+struct SAABB
+{
+	CVector3 minBounds;
+	CVector3 maxBounds;
+
+	// Set the box to be empty (inverted) so that the first Extend call initialises it
+	void SetEmpty()
+	{
+		minBounds = CVector3(  FLT_MAX,  FLT_MAX,  FLT_MAX );
+		maxBounds = CVector3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+	}
+
+	// Grow the box to contain the given point
+	void Extend( const CVector3& point )
+	{
+		minBounds.x = Min( minBounds.x, point.x );
+		minBounds.y = Min( minBounds.y, point.y );
+		minBounds.z = Min( minBounds.z, point.z );
+		maxBounds.x = Max( maxBounds.x, point.x );
+		maxBounds.y = Max( maxBounds.y, point.y );
+		maxBounds.z = Max( maxBounds.z, point.z );
+	}
+
+	// Grow the box to contain another box
+	void Extend( const SAABB& box )
+	{
+		minBounds.x = Min( minBounds.x, box.minBounds.x );
+		minBounds.y = Min( minBounds.y, box.minBounds.y );
+		minBounds.z = Min( minBounds.z, box.minBounds.z );
+		maxBounds.x = Max( maxBounds.x, box.maxBounds.x );
+		maxBounds.y = Max( maxBounds.y, box.maxBounds.y );
+		maxBounds.z = Max( maxBounds.z, box.maxBounds.z );
+	}
+
+	// Grow the box by the given amount in every direction
+	void Inflate( TFloat32 amount )
+	{
+		minBounds -= CVector3( amount, amount, amount );
+		maxBounds += CVector3( amount, amount, amount );
+	}
+
+	CVector3 Centre() const
+	{
+		return (minBounds + maxBounds) * 0.5f;
+	}
+
+	// Surface area of the box, used by the surface area heuristic when building trees
+	TFloat32 SurfaceArea() const
+	{
+		CVector3 size = maxBounds - minBounds;
+		if (size.x < 0.0f || size.y < 0.0f || size.z < 0.0f)
+		{
+			return 0.0f;
+		}
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool Contains( const CVector3& point ) const
+	{
+		return point.x >= minBounds.x && point.x <= maxBounds.x &&
+		       point.y >= minBounds.y && point.y <= maxBounds.y &&
+		       point.z >= minBounds.z && point.z <= maxBounds.z;
+	}
+
+	bool Overlaps( const SAABB& box ) const
+	{
+		return minBounds.x <= box.maxBounds.x && maxBounds.x >= box.minBounds.x &&
+		       minBounds.y <= box.maxBounds.y && maxBounds.y >= box.minBounds.y &&
+		       minBounds.z <= box.maxBounds.z && maxBounds.z >= box.minBounds.z;
+	}
+
+	// Squared distance from a point to the nearest point in the box (zero if inside)
+	TFloat32 DistanceToSquared( const CVector3& point ) const
+	{
+		TFloat32 dx = Max( Max( minBounds.x - point.x, point.x - maxBounds.x ), 0.0f );
+		TFloat32 dy = Max( Max( minBounds.y - point.y, point.y - maxBounds.y ), 0.0f );
+		TFloat32 dz = Max( Max( minBounds.z - point.z, point.z - maxBounds.z ), 0.0f );
+		return dx * dx + dy * dy + dz * dz;
+	}
+};
+
+
+// Return the world-space box enclosing a model-space box after transformation by a matrix
+// (transforms the eight corners, so the result is conservative for rotated boxes)
+SAABB TransformAABB( const SAABB& box, const CMatrix4x4& matrix );
+
+// Slab test of a ray against a box. The ray is given as an origin and the reciprocal of its
+// direction so many boxes can be tested with one division. Returns true if the ray enters the
+// box between parameter 0 and maxT, with the entry parameter returned through pNearT
+bool RayIntersectsAABB
+(
+	const SAABB&    box,
+	const CVector3& origin,
+	const CVector3& invDirection,
+	TFloat32        maxT,
+	TFloat32*       pNearT
+);
+
+
+
+/*-----------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------
+	AABB Tree Class
+-------------------------------------------------------------------------------------------
+-----------------------------------------------------------------------------------------*/
+
+// A bounding volume hierarchy over a set of primitives, each represented by a box. The tree
+// does not know what the primitives are - queries report primitive indexes to a visitor which
+// performs any exact test (e.g. against a triangle or sphere). The tree is built top-down with
+// a binned surface area heuristic and flattened depth-first into a single array, so the left
+// child of a node is always the next node in the array
+//
+// Visitor types used by the template query functions (any class/lambda with the signature):
+//   Ray:     TFloat32 operator()( TUInt32 primitive, TFloat32 maxT ) - return the hit parameter
+//            if the primitive is hit closer than maxT, otherwise return maxT
+//   Overlap: bool operator()( TUInt32 primitive ) - return false to stop the query early
+//   Nearest: bool operator()( TUInt32 primitive ) - return true if primitive is acceptable
+class CAABBTree
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty tree
+	CAABBTree();
+
+	// No destructor needed
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	/////////////////////////////////////
+	// Creation
+
+	// Build the tree from the given primitive boxes. Previous contents are discarded. Leaves
+	// hold at most maxLeafSize primitives
+	void Build( const SAABB* boxes, TUInt32 numBoxes, TUInt32 maxLeafSize = 4 );
+
+	// Empty the tree
+	void Clear();
+
+	// Renumber the primitives so that each primitive index is its position in leaf order.
+	// Returns the original index of each primitive so the caller can reorder its own data to
+	// match - primitives that are close in the tree are then close in memory too
+	void RenumberToLeafOrder( vector<TUInt32>* pOriginalIndices );
+
+
+	/////////////////////////////////////
+	// Getters
+
+	bool IsEmpty() const
+	{
+		return m_Nodes.empty();
+	}
+
+	TUInt32 NumNodes() const
+	{
+		return static_cast<TUInt32>(m_Nodes.size());
+	}
+
+	TUInt32 NumPrimitives() const
+	{
+		return static_cast<TUInt32>(m_PrimIndices.size());
+	}
+
+	// Bounds of everything in the tree - not valid for an empty tree
+	SAABB Bounds() const
+	{
+		SAABB box;
+		box.minBounds = m_Nodes[0].minBounds;
+		box.maxBounds = m_Nodes[0].maxBounds;
+		return box;
+	}
+
+
+	/////////////////////////////////////
+	// Support functions
+
+	// Reciprocal of a ray direction component for the slab tests in RayIntersectsAABB, large
+	// values stand in for division by zero
+	static TFloat32 SafeReciprocal( TFloat32 value )
+	{
+		return (Abs( value ) > 1e-12f) ? 1.0f / value : (value >= 0.0f ? 1e12f : -1e12f);
+	}
+
+
+	/////////////////////////////////////
+	// Queries
+
+	// Find the nearest primitive hit by a ray (origin + t * direction, 0 <= t <= maxT). The
+	// visitor performs the exact test on each candidate. Children are visited front to back
+	// and subtrees beyond the current nearest hit are skipped. Returns true if anything was
+	// hit, with the hit parameter and primitive index returned through the pointers
+	template <class TRayVisitor>
+	bool RayQuery
+	(
+		const CVector3& origin,
+		const CVector3& direction,
+		TFloat32        maxT,
+		TRayVisitor&    visitor,
+		TFloat32*       pHitT = 0,
+		TUInt32*        pHitPrimitive = 0
+	) const
+	{
+		if (m_Nodes.empty()) return false;
+
+		// Reciprocal direction for slab tests, large values stand in for division by zero
+		CVector3 invDirection( SafeReciprocal( direction.x ), SafeReciprocal( direction.y ),
+		                       SafeReciprocal( direction.z ) );
+
+		bool     hit = false;
+		TFloat32 nearestT = maxT;
+		TUInt32  nearestPrimitive = 0;
+
+		TUInt32 stack[kMaxStackDepth];
+		TUInt32 stackSize = 0;
+		TFloat32 entryT;
+		if (!RayIntersectsAABB( NodeBox( 0 ), origin, invDirection, nearestT, &entryT )) return false;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			const SNode& node = m_Nodes[stack[--stackSize]];
+			if (!RayIntersectsAABB( NodeBox( node ), origin, invDirection, nearestT, &entryT )) continue;
+
+			if (node.count > 0)
+			{
+				// Leaf - pass each primitive to the visitor for an exact test
+				for (TUInt32 prim = node.offset; prim < node.offset + node.count; ++prim)
+				{
+					TFloat32 t = visitor( m_PrimIndices[prim], nearestT );
+					if (t < nearestT)
+					{
+						nearestT = t;
+						nearestPrimitive = m_PrimIndices[prim];
+						hit = true;
+					}
+				}
+			}
+			else
+			{
+				// Push the further child first so the nearer one is processed next
+				TUInt32 left = static_cast<TUInt32>(&node - &m_Nodes[0]) + 1;
+				TUInt32 right = node.offset;
+				TFloat32 leftT, rightT;
+				bool leftHit = RayIntersectsAABB( NodeBox( left ), origin, invDirection, nearestT, &leftT );
+				bool rightHit = RayIntersectsAABB( NodeBox( right ), origin, invDirection, nearestT, &rightT );
+				if (leftHit && rightHit)
+				{
+					if (leftT <= rightT)
+					{
+						stack[stackSize++] = right;
+						stack[stackSize++] = left;
+					}
+					else
+					{
+						stack[stackSize++] = left;
+						stack[stackSize++] = right;
+					}
+				}
+				else if (leftHit)
+				{
+					stack[stackSize++] = left;
+				}
+				else if (rightHit)
+				{
+					stack[stackSize++] = right;
+				}
+			}
+		}
+
+		if (hit)
+		{
+			if (pHitT) *pHitT = nearestT;
+			if (pHitPrimitive) *pHitPrimitive = nearestPrimitive;
+		}
+		return hit;
+	}
+
+	// Call the visitor for every primitive whose box overlaps the given box. Stops early if
+	// the visitor returns false. Returns false if the query was stopped early
+	template <class TOverlapVisitor>
+	bool OverlapQuery( const SAABB& box, TOverlapVisitor& visitor ) const
+	{
+		if (m_Nodes.empty()) return true;
+
+		TUInt32 stack[kMaxStackDepth];
+		TUInt32 stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			TUInt32 nodeIndex = stack[--stackSize];
+			const SNode& node = m_Nodes[nodeIndex];
+			if (!NodeBox( node ).Overlaps( box )) continue;
+
+			if (node.count > 0)
+			{
+				for (TUInt32 prim = node.offset; prim < node.offset + node.count; ++prim)
+				{
+					if (m_PrimBoxes[prim].Overlaps( box ) && !visitor( m_PrimIndices[prim] ))
+					{
+						return false;
+					}
+				}
+			}
+			else
+			{
+				stack[stackSize++] = node.offset;
+				stack[stackSize++] = nodeIndex + 1;
+			}
+		}
+		return true;
+	}
+
+	// Find up to k primitives nearest to a point (by distance to their boxes) within maxDistance,
+	// considering only primitives accepted by the filter. Results are written nearest first to
+	// the given arrays, returns the number found
+	template <class TNearestFilter>
+	TUInt32 NearestQuery
+	(
+		const CVector3&  point,
+		TFloat32         maxDistance,
+		TUInt32          k,
+		TNearestFilter&  filter,
+		TUInt32*         pResults,
+		TFloat32*        pDistancesSquared = 0
+	) const
+	{
+		if (m_Nodes.empty() || k == 0) return 0;
+		if (k > kMaxNearest) k = kMaxNearest;
+
+		// Best k so far kept in a small sorted array - k is expected to be small
+		TUInt32  bestPrims[kMaxNearest];
+		TFloat32 bestDists[kMaxNearest];
+		TUInt32  numBest = 0;
+		TFloat32 limit = maxDistance * maxDistance;
+
+		TUInt32 stack[kMaxStackDepth];
+		TUInt32 stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			TUInt32 nodeIndex = stack[--stackSize];
+			const SNode& node = m_Nodes[nodeIndex];
+			if (NodeBox( node ).DistanceToSquared( point ) > limit) continue;
+
+			if (node.count > 0)
+			{
+				for (TUInt32 prim = node.offset; prim < node.offset + node.count; ++prim)
+				{
+					TFloat32 distSq = m_PrimBoxes[prim].DistanceToSquared( point );
+					if (distSq > limit || !filter( m_PrimIndices[prim] )) continue;
+
+					// Insertion into sorted best list
+					TUInt32 insert = (numBest < k) ? numBest++ : k - 1;
+					while (insert > 0 && bestDists[insert - 1] > distSq)
+					{
+						bestDists[insert] = bestDists[insert - 1];
+						bestPrims[insert] = bestPrims[insert - 1];
+						--insert;
+					}
+					bestDists[insert] = distSq;
+					bestPrims[insert] = m_PrimIndices[prim];
+					if (numBest == k) limit = bestDists[k - 1];
+				}
+			}
+			else
+			{
+				// Visit nearer child first so the limit shrinks sooner
+				TUInt32 left = nodeIndex + 1;
+				TUInt32 right = node.offset;
+				if (NodeBox( left ).DistanceToSquared( point ) <= NodeBox( right ).DistanceToSquared( point ))
+				{
+					stack[stackSize++] = right;
+					stack[stackSize++] = left;
+				}
+				else
+				{
+					stack[stackSize++] = left;
+					stack[stackSize++] = right;
+				}
+			}
+		}
+
+		for (TUInt32 i = 0; i < numBest; ++i)
+		{
+			pResults[i] = bestPrims[i];
+			if (pDistancesSquared) pDistancesSquared[i] = bestDists[i];
+		}
+		return numBest;
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	/////////////////////////////////////
+	// Types
+
+	// A flattened tree node, 32 bytes. For a leaf, count > 0 and the primitives are
+	// m_PrimIndices[offset] to m_PrimIndices[offset + count - 1]. For an inner node count == 0,
+	// the left child immediately follows this node and offset is the index of the right child
+	struct SNode
+	{
+		CVector3 minBounds;
+		TUInt32  offset;
+		CVector3 maxBounds;
+		TUInt32  count;
+	};
+
+	// Primitive data used during the build
+	struct SBuildPrim
+	{
+		SAABB    box;
+		CVector3 centre;
+		TUInt32  index;
+	};
+
+	// Trees built here are never deeper than this (see BuildNode)
+	static const TUInt32 kMaxStackDepth = 64;
+
+	// Most results returned from a nearest query
+	static const TUInt32 kMaxNearest = 32;
+
+	// Number of bins per axis for the surface area heuristic
+	static const TUInt32 kNumBins = 12;
+
+
+	/////////////////////////////////////
+	// Support functions
+
+	// Recursively build the subtree for build primitives [first, first + count)
+	void BuildNode( TUInt32 first, TUInt32 count, TUInt32 depth );
+
+	SAABB NodeBox( const SNode& node ) const
+	{
+		SAABB box;
+		box.minBounds = node.minBounds;
+		box.maxBounds = node.maxBounds;
+		return box;
+	}
+	SAABB NodeBox( TUInt32 node ) const
+	{
+		return NodeBox( m_Nodes[node] );
+	}
+
+
+	/////////////////////////////////////
+	// Data
+
+	vector<SNode>    m_Nodes;       // Depth-first flattened nodes, root at index 0
+	vector<TUInt32>  m_PrimIndices; // Primitive indexes in leaf order
+	vector<SAABB>    m_PrimBoxes;   // Primitive boxes in leaf order (parallel to above)
+
+	// Temporary data only used while building
+	vector<SBuildPrim> m_BuildPrims;
+	TUInt32            m_MaxLeafSize;
+};
+
+
+} // namespace gen
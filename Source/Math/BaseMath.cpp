@@ -390,4 +390,41 @@ TFloat64 Round
 }
 
 
+/*-----------------------------------------------------------------------------------------
+	Random numbers
+-----------------------------------------------------------------------------------------*/
+
+// State of the random sequence, a xorshift generator. The state is never 0, which would
+// only ever give 0
+static const TUInt32 kDefaultRandomState = 2463534242u;
+static TUInt32 RandomState = kDefaultRandomState;
+
+// Restart the random sequence from the given seed
+void SeedRandom( const TUInt32 seed )
+{
+	// Spread the bits of the seed, small seeds would otherwise start with small numbers
+	SetRandomState( seed * 2654435761u + kDefaultRandomState );
+}
+
+// Get or set the state of the random sequence
+TUInt32 GetRandomState()
+{
+	return RandomState;
+}
+
+void SetRandomState( const TUInt32 state )
+{
+	RandomState = (state != 0) ? state : kDefaultRandomState;
+}
+
+// Return the next 32 random bits
+TUInt32 RandomBits()
+{
+	RandomState ^= RandomState << 13;
+	RandomState ^= RandomState >> 17;
+	RandomState ^= RandomState << 5;
+	return RandomState;
+}
+
+
 } // namespace gen
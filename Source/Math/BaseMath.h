@@ -470,31 +470,45 @@ template <class C>
 inline C Max( const C a, const C b ) { return (!(b < a) ? b : a); }
 
 
+/*-----------------------------------------------------------------------------------------
+	Random numbers
+-----------------------------------------------------------------------------------------*/
+// The Random functions use a small generator of their own rather than rand(), whose state
+// cannot be read. The state is a single 32-bit value that can be saved and restored (e.g. in
+// simulation snapshots) and gives the same sequence with every compiler. There is one state
+// for the program, so random numbers should only be taken on the main thread
+
+// Restart the random sequence from the given seed
+void SeedRandom( const TUInt32 seed );
+
+// Get or set the state of the random sequence, setting a state got earlier repeats the
+// numbers that followed it
+TUInt32 GetRandomState();
+void SetRandomState( const TUInt32 state );
+
+// Return the next 32 random bits
+TUInt32 RandomBits();
+
 // Return random integer from a to b (inclusive)
-// Can only return up to RAND_MAX different values, spread evenly across the given range
-// RAND_MAX is defined in stdlib.h and is compiler-specific (32767 on VS-2005, higher elsewhere)
 inline TInt32 Random( const TInt32 a, const TInt32 b )
 {
-	// Could just use a + rand() % (b-a), but using a more complex form to allow range
-	// to exceed RAND_MAX and still return values spread across the range
-	TInt32 t = (b - a + 1) * rand();
-	return t == 0 ? a : a + (t - 1) / RAND_MAX;
+	// Scale the random bits to the range rather than using %, which favours low values
+	TUInt64 range = static_cast<TUInt64>(static_cast<TInt64>(b) - a + 1);
+	return a + static_cast<TInt32>((range * RandomBits()) >> 32);
 }
 
 // Return random 32-bit float from a to b (inclusive)
-// Can only return up to RAND_MAX different values, spread evenly across the given range
-// RAND_MAX is defined in stdlib.h and is compiler-specific (32767 on VS-2005, higher elsewhere)
+// Returns up to 2^24 different values, spread evenly across the given range
 inline TFloat32 Random( const TFloat32 a, const TFloat32 b )
 {
-	return a + (b - a) * (static_cast<TFloat32>(rand()) / RAND_MAX);
+	return a + (b - a) * (static_cast<TFloat32>(RandomBits() >> 8) * (1.0f / 16777215.0f));
 }
 
 // Return random 64-bit float from a to b (inclusive)
-// Can only return up to RAND_MAX different values, spread evenly across the given range
-// RAND_MAX is defined in stdlib.h and is compiler-specific (32767 on VS-2005, higher elsewhere)
+// Returns up to 2^32 different values, spread evenly across the given range
 inline TFloat64 Random( const TFloat64 a, const TFloat64 b )
 {
-	return a + (b - a) * (static_cast<TFloat64>(rand()) / RAND_MAX);
+	return a + (b - a) * (static_cast<TFloat64>(RandomBits()) * (1.0 / 4294967295.0));
 }
 
 
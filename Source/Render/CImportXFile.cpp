@@ -13,14 +13,9 @@
 
 #include <algorithm>
 #include <numeric>
+#include <xmmintrin.h>
 using namespace std;
 
-#define INITGUID
-#include <windows.h>
-#include <dxfile.h>
-#include <rmxfguid.h>
-#include <rmxftmpl.h>
-
 #include "Error.h"
 #include "CImportXFile.h"
 
@@ -68,13 +63,14 @@ bool CImportXFile::IsXFile
 // Import a Microsoft X-File into a list of meshes and a frame hierarchy
 // Possible return values:
 //		kSuccess:			...
-//		kFileError:			Missing file or not an X-file
+//		kFileError:			Missing file or not a text or uncompressed binary X-file
 //		kInvalidData:		The file could not be parsed correctly, or contains invalid data
 //		kOutOfSystemMemory:	...
-//		kSystemFailure:		X-file API failure
+// Mesh processing is spread across the given thread pool if there is one
 EImportError CImportXFile::ImportFile
 (
-	const string& sFileName
+	const string& sFileName,
+	CThreadPool*  pPool /*= 0*/
 )
 {
 	GEN_GUARD;
@@ -90,29 +86,16 @@ EImportError CImportXFile::ImportFile
 		return kFileError;
 	}
 
-	// Create X-File object
-	ID3DXFile* pXFile;
-	EImportError eError = PrepareXFileObject( &pXFile );
-	if (eError != kSuccess)
+	// Map the file into memory and check its header
+	CXFileParser parser;
+	if (!parser.Open( sFileName ))
 	{
-		return eError;
-	}
-
-	// Get X-File enumerator
-	ID3DXFileEnumObject* pXFileEnumer;
-	eError = GetXFileEnumerator( sFileName, pXFile, &pXFileEnumer );
-	if (eError != kSuccess)
-	{
-		pXFile->Release();
-		return eError;
+		return kFileError;
 	}
 
 	// Parse X file to create frame hierachy and meshes
-	eError = ParseXFile( pXFileEnumer );
-
-	// Release X-File interfaces
-	pXFileEnumer->Release();
-	pXFile->Release();
+	EImportError eError = ParseXFile( parser );
+	parser.Close();
 
 	// Check for errors
 	if (eError != kSuccess)
@@ -123,7 +106,7 @@ EImportError CImportXFile::ImportFile
 	}
 
 	// Split into meshes containing only one material each
-	SplitMeshes();
+	SplitMeshes( pPool );
 
 	// Mark file as loaded
 	m_bImported = true;
@@ -182,13 +165,9 @@ EImportError CImportXFile::GetSubMesh
 	// Set sub-mesh owner node
 	pOutSubMesh->node = m_Meshes[iSubMesh].iParentFrame;
 
-	// Calculate tangents if required
+	// Calculate tangents if required (needs normals and texture coordinates)
 	TXFileVectors tangents;
-	pOutSubMesh->hasTangents = bTangents;
-	if (pOutSubMesh->hasTangents)
-	{
-		CalculateTangents( iSubMesh, &tangents );
-	}
+	pOutSubMesh->hasTangents = bTangents && CalculateTangents( iSubMesh, &tangents );
 
 	// Find what vertex data there is and calculate total vertex size
 	pOutSubMesh->hasSkinningData = (m_Meshes[iSubMesh].bones.size() > 0);
@@ -399,127 +378,6 @@ void CImportXFile::GetMaterial
 }
 
 
-/*-----------------------------------------------------------------------------------------
-	X-File API support
------------------------------------------------------------------------------------------*/
-
-// Prepare and return an X-file object
-// Possible return values:
-//		kSuccess:			...
-//		kOutOfSystemMemory:	...
-//		kSystemFailure:		Problem registering X-file templates or other API error
-EImportError CImportXFile::PrepareXFileObject
-(
-	ID3DXFile** ppXFile
-)
-{
-	GEN_GUARD;
-
-	HRESULT xFileError = D3DXFileCreate( ppXFile );
-	if (xFileError != S_OK)
-	{
-		*ppXFile = 0;
-		switch (xFileError)
-		{
-		case E_OUTOFMEMORY:
-			return kOutOfSystemMemory;
-
-		case E_POINTER:
-			GEN_ERROR( "Invalid parameter to D3DXFileCreate" );
-
-		default:
-			return kSystemFailure;
-		}
-	}
-
-    // Register templates for d3drm, skinning and patch extensions.
-    xFileError = (*ppXFile)->RegisterTemplates( (void*)D3DRM_XTEMPLATES, D3DRM_XTEMPLATE_BYTES );
-	if (xFileError != S_OK)
-	{
-        (*ppXFile)->Release();
-		*ppXFile = 0;
-		switch (xFileError)
-		{
-		case D3DXFERR_BADVALUE: 
-			GEN_ERROR( "Invalid parameter to RegisterTemplates" );
-
-		default:
-			return kSystemFailure;
-		}
-    }
-
-    xFileError = (*ppXFile)->RegisterTemplates( (void*)XSKINEXP_TEMPLATES, strlen(XSKINEXP_TEMPLATES) );
-	if (xFileError != S_OK)
-	{
-        (*ppXFile)->Release();
-		switch (xFileError)
-		{
-		case D3DXFERR_BADVALUE:
-			GEN_ERROR( "Invalid parameter to RegisterTemplates" );
-
-		default:
-			return kSystemFailure;
-		}
-    }
-
-    xFileError = (*ppXFile)->RegisterTemplates( (void*)XEXTENSIONS_TEMPLATES, strlen(XEXTENSIONS_TEMPLATES) );
-	if (xFileError != S_OK)
-	{
-        (*ppXFile)->Release();
-		*ppXFile = 0;
-		switch (xFileError)
-		{
-		case D3DXFERR_BADVALUE:
-			GEN_ERROR( "Invalid parameter to RegisterTemplates" );
-
-		default:
-			return kInvalidData;
-		}
-    }
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-
-// Prepare and return an X-file enumerator given a filename and an X-file object
-// Possible return values:
-//		kSuccess:			...
-//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
-//		kSystemFailure:		X-file API error
-EImportError CImportXFile::GetXFileEnumerator
-(
-	const string&         sFilename,
-	ID3DXFile*            pXFile,
-	ID3DXFileEnumObject** ppXFileEnumer
-)
-{
-	GEN_GUARD;
-
-	HRESULT xFileError =
-		pXFile->CreateEnumObject( (LPVOID)sFilename.c_str(), DXFILELOAD_FROMFILE, ppXFileEnumer );
-	if (xFileError != S_OK)
-	{
-		switch (xFileError)
-		{
-		case D3DXFERR_PARSEERROR:
-			return kInvalidData;
-
-		case D3DXFERR_BADVALUE:
-			GEN_ERROR( "Invalid parameter to CreateEnumObject" );
-
-		default:
-			return kSystemFailure;
-		}
-	}
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-
 /*-----------------------------------------------------------------------------------------
 	X-File parsing
 -----------------------------------------------------------------------------------------*/
@@ -531,7 +389,7 @@ EImportError CImportXFile::GetXFileEnumerator
 //		kInvalidData:		The file could not be parsed correctly, or contains invalid data
 EImportError CImportXFile::ParseXFile
 (
-	ID3DXFileEnumObject* pXFileEnumer
+	CXFileParser& parser
 )
 {
 	GEN_GUARD;
@@ -547,63 +405,54 @@ EImportError CImportXFile::ParseXFile
 	m_Frames[0].defaultMatrix = CMatrix4x4::kIdentity;
 	m_Frames[0].offsetMatrix = CMatrix4x4::kIdentity;
 
-	// Get number of child objects for the current object
-	TUInt32 iNumChildren;
-	EImportError eError = GetXFileNumChildren( pXFileEnumer, &iNumChildren );
-	if (eError != kSuccess)
+	// For each top level object
+	string sTemplateName, sName;
+	while (parser.NextObject( &sTemplateName, &sName ))
 	{
-		return kInvalidData;
-	}
+		EImportError eError = kSuccess;
 
-	// For each child object
-	for (TUInt32 iChild = 0; iChild < iNumChildren; ++iChild)
-	{
-		// Get child data and ID
-		ID3DXFileData* pChildData;
-		GUID childGUID;
-		eError = GetXFileChild( pXFileEnumer, iChild, &pChildData, &childGUID );
-		if (eError != kSuccess)
-		{
-			return kInvalidData;
-		}
-		
 		// Found child frame
-		if (childGUID == TID_D3DRMFrame)
+		if (sTemplateName == "Frame")
 		{
 			++m_Frames[0].iNumChildren;
-			eError = ParseXFileFrame( pChildData, 0 );
+			eError = ParseXFileFrame( parser, sName, 0 );
 		}
 
 		// Found child frame transformation matrix
-		else if (childGUID == TID_D3DRMFrameTransformMatrix)
+		else if (sTemplateName == "FrameTransformMatrix")
 		{
-			CMatrix4x4 transMat;
-			TUInt32 iSize = 16 * sizeof(TFloat32);
-			TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Frames[0].defaultMatrix.e00);
-			eError = CopyXFileData( pChildData, pDest, &iSize );
+			parser.ReadFloats( &m_Frames[0].defaultMatrix.e00, 16 );
+			parser.SkipObject();
 		}
 
 		// Found child mesh
-		else if (childGUID == TID_D3DRMMesh)
+		else if (sTemplateName == "Mesh")
 		{
-			eError = ParseXFileMesh( pChildData, 0 );
+			eError = ParseXFileMesh( parser, 0 );
 		}
 
-		// Release current child data before moving to the next or quiting on error
-		pChildData->Release();
+		// Found other data (header, materials to be referenced by meshes etc.)
+		else
+		{
+			parser.SkipObject();
+		}
 
 		// Return any errors found
 		if (eError != kSuccess)
 		{
 			return eError;
 		}
-	}		
+	}
+	if (parser.Failed())
+	{
+		return kInvalidData;
+	}
 
 	// Make a single global material list for all meshes
 	MakeGlobalMaterialList();
 	
 	// Validate bones and match them to their frames
-	eError = ProcessBones();
+	EImportError eError = ProcessBones();
 	if (eError != kSuccess)
 	{
 		return eError;
@@ -619,84 +468,76 @@ EImportError CImportXFile::ParseXFile
 // frames and meshes found will become children of this new frame. Child frames are recursively
 // parsed to create a frame hierarchy
 // Possible return values:
-//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
+//		kInvalidData:		The file could not be parsed correctly, contains invalid data or
+//		                    frames nested more than kMaxFrameDepth deep
 EImportError CImportXFile::ParseXFileFrame
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iParentFrame
+	CXFileParser& parser,
+	const string& sFrameName,
+	const TUInt32 iParentFrame
 )
 {
 	GEN_GUARD;
 
+	if (m_Frames[iParentFrame].iDepth >= kMaxFrameDepth)
+	{
+		return kInvalidData;
+	}
+
 	// Create new frame
 	TUInt32 iCurrFrame = static_cast<TUInt32>(m_Frames.size());
 	m_Frames.push_back( SXFileFrame() );
 
-	// Get name for frame
-	EImportError eError = GetXFileDataName( pXFileData, m_Frames[iCurrFrame].sName );
-	if (eError != kSuccess)
-	{
-		return eError;
-	}
-
-	// Initialise other frame values
+	// Initialise frame values
+	m_Frames[iCurrFrame].sName = sFrameName;
 	m_Frames[iCurrFrame].iDepth = m_Frames[iParentFrame].iDepth + 1;
 	m_Frames[iCurrFrame].iParentIndex = iParentFrame;
 	m_Frames[iCurrFrame].iNumChildren = 0;
 	m_Frames[iCurrFrame].defaultMatrix = CMatrix4x4::kIdentity;
 	m_Frames[iCurrFrame].offsetMatrix = CMatrix4x4::kIdentity;
 
-	// Get number of child objects for the current object
-	TUInt32 iNumChildren;
-	eError = GetXFileNumChildren( pXFileData, &iNumChildren );
-	if (eError != kSuccess)
-	{
-		return kInvalidData;
-	}
-
 	// For each child object
-	for (TUInt32 iChild = 0; iChild < iNumChildren; ++iChild)
+	string sTemplateName, sName;
+	while (parser.NextObject( &sTemplateName, &sName ))
 	{
-		// Get child data and ID
-		ID3DXFileData* pChildData;
-		GUID childGUID;
-		eError = GetXFileChild( pXFileData, iChild, &pChildData, &childGUID );
-		if (eError != kSuccess)
-		{
-			return kInvalidData;
-		}
-		
+		EImportError eError = kSuccess;
+
 		// Found child frame
-		if (childGUID == TID_D3DRMFrame)
+		if (sTemplateName == "Frame")
 		{
 			++m_Frames[iCurrFrame].iNumChildren;
-			eError = ParseXFileFrame( pChildData, iCurrFrame );
+			eError = ParseXFileFrame( parser, sName, iCurrFrame );
 		}
 
 		// Found child frame transformation matrix
-		else if (childGUID == TID_D3DRMFrameTransformMatrix)
+		else if (sTemplateName == "FrameTransformMatrix")
 		{
-			CMatrix4x4 transMat;
-			TUInt32 iSize = 16 * sizeof(TFloat32);
-			TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Frames[iCurrFrame].defaultMatrix.e00);
-			eError = CopyXFileData( pChildData, pDest, &iSize );
+			parser.ReadFloats( &m_Frames[iCurrFrame].defaultMatrix.e00, 16 );
+			parser.SkipObject();
 		}
 
 		// Found child mesh
-		else if (childGUID == TID_D3DRMMesh)
+		else if (sTemplateName == "Mesh")
 		{
-			eError = ParseXFileMesh( pChildData, iCurrFrame );
+			eError = ParseXFileMesh( parser, iCurrFrame );
 		}
 
-		// Release current child data before moving to the next or quiting on error
-		pChildData->Release();
+		// Found unknown frame data
+		else
+		{
+			parser.SkipObject();
+		}
 
 		// Return any errors found
 		if (eError != kSuccess)
 		{
 			return eError;
 		}
-	}		
+	}
+	if (parser.Failed())
+	{
+		return kInvalidData;
+	}
 
 	return kSuccess;
 
@@ -707,8 +548,8 @@ EImportError CImportXFile::ParseXFileFrame
 // Create a new mesh in the given frame and parse its data from the X-File
 EImportError CImportXFile::ParseXFileMesh
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iCurrFrame
+	CXFileParser& parser,
+	const TUInt32 iCurrFrame
 )
 {
 	GEN_GUARD;
@@ -724,7 +565,7 @@ EImportError CImportXFile::ParseXFileMesh
 	m_Meshes[iCurrMesh].iMaxBonesPerFace = 0;
 
 	// Read vertices and faces for the mesh
-	EImportError eError = ReadMeshData( pXFileData, iCurrMesh );
+	EImportError eError = ReadMeshData( parser, iCurrMesh );
 	if (eError != kSuccess)
 	{
 		return eError;
@@ -733,88 +574,73 @@ EImportError CImportXFile::ParseXFileMesh
 	// Counter for bones read from child data objects
 	TUInt32 iCurrBone = 0; 
 
-	// Get number of child objects for the current object
-	TUInt32 iNumChildren;
-	eError = GetXFileNumChildren( pXFileData, &iNumChildren );
-	if (eError != kSuccess)
-	{
-		return kInvalidData;
-	}
-
 	// For each child object
-	for (TUInt32 iChild = 0; iChild < iNumChildren; ++iChild)
+	string sTemplateName, sName;
+	while (parser.NextObject( &sTemplateName, &sName ))
 	{
-		// Get child data and ID
-		ID3DXFileData* pChildData;
-		GUID childGUID;
-		eError = GetXFileChild( pXFileData, iChild, &pChildData, &childGUID );
-		if (eError != kSuccess)
-		{
-			return kInvalidData;
-		}
-
 		// Found normal data
-		if (childGUID == TID_D3DRMMeshNormals)
+		if (sTemplateName == "MeshNormals")
 		{
-			eError = ReadNormalData( pChildData, iCurrMesh );
+			eError = ReadNormalData( parser, iCurrMesh );
 		}
 
 		// Found texture coordinate data
-		else if (childGUID == TID_D3DRMMeshTextureCoords)
+		else if (sTemplateName == "MeshTextureCoords")
 		{
-			eError = ReadTextureUVData( pChildData, iCurrMesh );
+			eError = ReadTextureUVData( parser, iCurrMesh );
 		}
 
 		// Found vertex colour data
-		else if (childGUID == TID_D3DRMMeshVertexColors)
+		else if (sTemplateName == "MeshVertexColors")
 		{
-			eError = ReadVertexColourData( pChildData, iCurrMesh );
+			eError = ReadVertexColourData( parser, iCurrMesh );
 		}
 
 		// Found material list
-		else if (childGUID == TID_D3DRMMeshMaterialList)
+		else if (sTemplateName == "MeshMaterialList")
 		{
-			eError = ReadMaterialData( pChildData, iCurrMesh );
+			eError = ReadMaterialData( parser, iCurrMesh );
 		}
 
 		// Found vertex duplication list
-		else if (childGUID == DXFILEOBJ_VertexDuplicationIndices)
+		else if (sTemplateName == "VertexDuplicationIndices")
 		{
-			eError = ReadDuplicationData( pChildData, iCurrMesh );
+			eError = ReadDuplicationData( parser, iCurrMesh );
 		}
 
 		// Found face adjacency data
-		else if (childGUID == DXFILEOBJ_FaceAdjacency)
+		else if (sTemplateName == "FaceAdjacency")
 		{
-			eError = ReadAdjacencyData( pChildData, iCurrMesh );
+			eError = ReadAdjacencyData( parser, iCurrMesh );
 		}
 
 		// Found skinning definition
-		else if (childGUID == DXFILEOBJ_XSkinMeshHeader)
+		else if (sTemplateName == "XSkinMeshHeader")
 		{
-			eError = ReadSkinDefnData( pChildData, iCurrMesh );
+			eError = ReadSkinDefnData( parser, iCurrMesh );
 		}
 
 		// Found skin weights
-		else if (childGUID == DXFILEOBJ_SkinWeights)
+		else if (sTemplateName == "SkinWeights")
 		{
-			eError = ReadSkinWeightsData( pChildData, iCurrMesh, iCurrBone );
+			eError = ReadSkinWeightsData( parser, iCurrMesh, iCurrBone );
 			++iCurrBone;
 		}
 
 		// Found unknown mesh data
 		else
 		{
-			eError = kSuccess; // Won't flag this as failure though
+			parser.SkipObject(); // Won't flag this as failure though
 		}
 
 		if (eError != kSuccess)
 		{
 			return eError;
 		}
-
-		// Release current child data before moving to the next
-		pChildData->Release();
+	}
+	if (parser.Failed())
+	{
+		return kInvalidData;
 	}
 
 	// Check if not enough bones
@@ -836,43 +662,43 @@ EImportError CImportXFile::ParseXFileMesh
 	X-File template parsing
 -----------------------------------------------------------------------------------------*/
 
-// Read vertex and face data from a mesh template
+// Read vertex and face data from a mesh template. Leaves the parser in the mesh, ready to read
+// its child objects
 EImportError CImportXFile::ReadMeshData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileParser& parser,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
 
-	// Lock mesh data pointer
-	TUInt32 iMeshDataSize = 0;
-	const TUInt8* pMeshDataStart;
-	EImportError eError = LockXFileData( pXFileData, &pMeshDataStart, &iMeshDataSize );
-	if (eError != kSuccess)
+	// Read vertices
+	TUInt32 iNumVertices;
+	if (!parser.ReadUInt( &iNumVertices ) || iNumVertices == 0 || !parser.CanRead( iNumVertices, 3 ))
 	{
 		return kInvalidData;
 	}
-	const TUInt8* pMeshData = pMeshDataStart;
-
-	// Get vertices
-	TUInt32 iNumVertices;
-	ReadXFileLockedUInt( pMeshData, &iNumVertices );
 	m_Meshes[iMesh].vertices.resize( iNumVertices );
-	for (TUInt32 iVertex = 0; iVertex < iNumVertices; ++iVertex)
+	if (!parser.ReadFloats( &m_Meshes[iMesh].vertices[0].x, 3 * iNumVertices ))
 	{
-		TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].vertices[iVertex]);
-		ReadXFileLockedData( pMeshData, pDest, sizeof(CVector3) );
+		return kInvalidData;
 	}
 
 	// Read faces - they can be general polygons - convert them all to triangles
 	TUInt32 iNumFaces;
-	ReadXFileLockedUInt( pMeshData, &iNumFaces );
+	if (!parser.ReadUInt( &iNumFaces ) || iNumFaces == 0 || !parser.CanRead( iNumFaces, 4 ))
+	{
+		return kInvalidData;
+	}
 	m_Meshes[iMesh].origFaceEdges.resize( iNumFaces ); // See below
+	m_Meshes[iMesh].faces.reserve( iNumFaces );
 	for (TUInt32 iFace = 0; iFace < iNumFaces; ++iFace)
 	{
 		TUInt32 iNumEdges;
-		ReadXFileLockedUInt( pMeshData, &iNumEdges );
+		if (!parser.ReadUInt( &iNumEdges ) || iNumEdges < 3)
+		{
+			return kInvalidData;
+		}
 
 		// Store original number of edges for normal face validation below
 		m_Meshes[iMesh].origFaceEdges[iFace] = iNumEdges;
@@ -880,26 +706,21 @@ EImportError CImportXFile::ReadMeshData
 		// Read first index of polygon, then use successive pairs of indices to form triangles
 		// with this first one
 		TUInt32 iFirstIndex, iIndexA, iIndexB;
-		ReadXFileLockedUInt( pMeshData, &iFirstIndex );
-		ReadXFileLockedUInt( pMeshData, &iIndexA );
+		parser.ReadUInt( &iFirstIndex );
+		parser.ReadUInt( &iIndexA );
 		for (TUInt32 iEdge = 2; iEdge < iNumEdges; ++iEdge)
 		{
-			ReadXFileLockedUInt( pMeshData, &iIndexB );
+			if (!parser.ReadUInt( &iIndexB ) || 
+			    iFirstIndex >= iNumVertices || iIndexA >= iNumVertices || iIndexB >= iNumVertices)
+			{
+				return kInvalidData;
+			}
 			SXFileFace face = { iFirstIndex, iIndexA, iIndexB };
 			m_Meshes[iMesh].faces.push_back( face );
 			iIndexA = iIndexB;
 		}
 	}
 
-	// Unlock mesh data
-	pXFileData->Unlock();
-
-	// Validate amount of data read
-	if (static_cast<TUInt32>(pMeshData - pMeshDataStart) != iMeshDataSize)
-	{
-		return kInvalidData;
-	}
-
 	return kSuccess;
 	GEN_ENDGUARD;
 }
@@ -908,8 +729,8 @@ EImportError CImportXFile::ReadMeshData
 // Read a normal data mesh template
 EImportError CImportXFile::ReadNormalData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileParser& parser,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
@@ -920,54 +741,48 @@ EImportError CImportXFile::ReadNormalData
 		return kInvalidData;
 	}
 
-	// Get normal data
-	const TUInt8* pNormalData;
-	EImportError eError = LockXFileData( pXFileData, &pNormalData );
-	if (eError != kSuccess)
+	// Read normals
+	TUInt32 iNumNormals;
+	if (!parser.ReadUInt( &iNumNormals ) || iNumNormals == 0 || !parser.CanRead( iNumNormals, 3 ))
 	{
 		return kInvalidData;
 	}
-
-	// Read normals
-	TUInt32 iNumNormals;
-	ReadXFileLockedUInt( pNormalData, &iNumNormals );
 	m_Meshes[iMesh].normals.resize( iNumNormals );
-	for (TUInt32 iNormal = 0; iNormal < iNumNormals; ++iNormal)
+	if (!parser.ReadFloats( &m_Meshes[iMesh].normals[0].x, 3 * iNumNormals ))
 	{
-		TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].normals[iNormal]);
-		ReadXFileLockedData( pNormalData, pDest, sizeof(CVector3) );
+		return kInvalidData;
 	}
 
 	// Verify that normal face list matches face list
 	TUInt32 iNumNormalFaces;
-	ReadXFileLockedUInt( pNormalData, &iNumNormalFaces );
-	if (iNumNormalFaces != m_Meshes[iMesh].origFaceEdges.size())
+	if (!parser.ReadUInt( &iNumNormalFaces ) || iNumNormalFaces != m_Meshes[iMesh].origFaceEdges.size())
 	{
-		pXFileData->Unlock();
 		return kInvalidData;
 	}
 
 	// Read normal faces - they can be general polygons - convert them all to triangles
+	m_Meshes[iMesh].normalFaces.reserve( m_Meshes[iMesh].faces.size() );
 	for (TUInt32 iFace = 0; iFace < iNumNormalFaces; ++iFace)
 	{
-		TUInt32 iNumEdges;
-		ReadXFileLockedUInt( pNormalData, &iNumEdges );
-
 		// Check number of edges against original face data
-		if (iNumEdges != m_Meshes[iMesh].origFaceEdges[iFace])
+		TUInt32 iNumEdges;
+		if (!parser.ReadUInt( &iNumEdges ) || iNumEdges != m_Meshes[iMesh].origFaceEdges[iFace])
 		{
-			pXFileData->Unlock();
 			return kInvalidData;
 		}
 
 		// Read first index of polygon, then use successive pairs of indices to form triangles
 		// with this first one
 		TUInt32 iFirstIndex, iIndexA, iIndexB;
-		ReadXFileLockedUInt( pNormalData, &iFirstIndex );
-		ReadXFileLockedUInt( pNormalData, &iIndexA );
+		parser.ReadUInt( &iFirstIndex );
+		parser.ReadUInt( &iIndexA );
 		for (TUInt32 iEdge = 2; iEdge < iNumEdges; ++iEdge)
 		{
-			ReadXFileLockedUInt( pNormalData, &iIndexB );
+			if (!parser.ReadUInt( &iIndexB ) ||
+			    iFirstIndex >= iNumNormals || iIndexA >= iNumNormals || iIndexB >= iNumNormals)
+			{
+				return kInvalidData;
+			}
 			SXFileFace face = { iFirstIndex, iIndexA, iIndexB };
 			m_Meshes[iMesh].normalFaces.push_back( face );
 			iIndexA = iIndexB;
@@ -975,7 +790,7 @@ EImportError CImportXFile::ReadNormalData
 	}
 
 	// Finished with normal data
-	pXFileData->Unlock();
+	parser.SkipObject();
 
 	return kSuccess;
 
@@ -985,8 +800,8 @@ EImportError CImportXFile::ReadNormalData
 // Read a texture coordinate mesh template
 EImportError CImportXFile::ReadTextureUVData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileParser& parser,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
@@ -997,31 +812,20 @@ EImportError CImportXFile::ReadTextureUVData
 		return kInvalidData;
 	}
 
-	// Get texture coordinate data
-	const TUInt8* pTexCoordData;
-	EImportError eError = LockXFileData( pXFileData, &pTexCoordData );
-	if (eError != kSuccess)
-	{
-		return kInvalidData;
-	}
-
 	// Read texture coordinates
 	TUInt32 iNumTextureCoords;
-	ReadXFileLockedUInt( pTexCoordData, &iNumTextureCoords );
-	if (iNumTextureCoords != m_Meshes[iMesh].vertices.size())
+	if (!parser.ReadUInt( &iNumTextureCoords ) || iNumTextureCoords != m_Meshes[iMesh].vertices.size())
 	{
-		pXFileData->Unlock();
 		return kInvalidData;
 	}
 	m_Meshes[iMesh].textureCoords.resize( iNumTextureCoords );
-	for (TUInt32 iUV = 0; iUV < iNumTextureCoords; ++iUV)
+	if (!parser.ReadFloats( &m_Meshes[iMesh].textureCoords[0].fU, 2 * iNumTextureCoords ))
 	{
-		TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].textureCoords[iUV]);
-		ReadXFileLockedData( pTexCoordData, pDest, sizeof(SXFileUV) );
+		return kInvalidData;
 	}
 
 	// Finished with texture coordinate data
-	pXFileData->Unlock();
+	parser.SkipObject();
 
 	return kSuccess;
 
@@ -1031,8 +835,8 @@ EImportError CImportXFile::ReadTextureUVData
 // Read a vertex colour mesh template, any vertices not assigned a colour will get white
 EImportError CImportXFile::ReadVertexColourData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileParser& parser,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
@@ -1043,32 +847,29 @@ EImportError CImportXFile::ReadVertexColourData
 		return kInvalidData;
 	}
 
-	// Get vertex colour data
-	const TUInt8* pVertexColourData;
-	EImportError eError = LockXFileData( pXFileData, &pVertexColourData );
-	if (eError != kSuccess)
+	// Read vertex colours
+	TUInt32 iNumVertexColours;
+	if (!parser.ReadUInt( &iNumVertexColours ) || !parser.CanRead( iNumVertexColours, 5 ))
 	{
 		return kInvalidData;
 	}
 
-	// Read vertex colours
-	TUInt32 iNumVertexColours;
-	ReadXFileLockedUInt( pVertexColourData, &iNumVertexColours );
-
 	// All colours default to white if not assigned
 	// TODO: Could split mesh into sections with and without vertex colours - not worth it?
 	SXFileRGBAColour defaultColour = { 1.0f, 1.0f, 1.0f, 1.0f };
-	m_Meshes[iMesh].vertexColours.resize( iNumVertexColours, defaultColour );
+	m_Meshes[iMesh].vertexColours.resize( m_Meshes[iMesh].vertices.size(), defaultColour );
 	for (TUInt32 iColour = 0; iColour < iNumVertexColours; ++iColour)
 	{
 		TUInt32 iVertexIndex;
-		ReadXFileLockedUInt( pVertexColourData, &iVertexIndex );
-		TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].vertexColours[iVertexIndex]);
-		ReadXFileLockedData( pVertexColourData, pDest, sizeof(SXFileRGBAColour) );
+		if (!parser.ReadUInt( &iVertexIndex ) || iVertexIndex >= m_Meshes[iMesh].vertices.size() ||
+		    !parser.ReadFloats( &m_Meshes[iMesh].vertexColours[iVertexIndex].fRed, 4 ))
+		{
+			return kInvalidData;
+		}
 	}
 
 	// Finished with vertex colour data
-	pXFileData->Unlock();
+	parser.SkipObject();
 
 	return kSuccess;
 
@@ -1078,8 +879,8 @@ EImportError CImportXFile::ReadVertexColourData
 // Read a vertex colour mesh template
 EImportError CImportXFile::ReadMaterialData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileParser& parser,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
@@ -1090,17 +891,12 @@ EImportError CImportXFile::ReadMaterialData
 		return kInvalidData;
 	}
 
-	// Get material data
-	const TUInt8* pMaterialData;
-	EImportError eError = LockXFileData( pXFileData, &pMaterialData );
-	if (eError != kSuccess)
+	// Read number of materials and initialise material list
+	TUInt32 iNumMaterials;
+	if (!parser.ReadUInt( &iNumMaterials ) || iNumMaterials == 0 || !parser.CanRead( iNumMaterials ))
 	{
 		return kInvalidData;
 	}
-
-	// Read number of materials and initialise material list
-	TUInt32 iNumMaterials;
-	ReadXFileLockedUInt( pMaterialData, &iNumMaterials );
 	for (TUInt32 iMaterial = 0; iMaterial < iNumMaterials; ++iMaterial)
 	{
 		SXFileMaterial material = 
@@ -1117,14 +913,20 @@ EImportError CImportXFile::ReadMaterialData
 	// Read face materials - matching the original face list before it was split into triangles.
 	// Will convert to match the new (triangle-only) face list
 	TUInt32 iNumFaceMaterials;
-	ReadXFileLockedUInt( pMaterialData, &iNumFaceMaterials );
+	if (!parser.ReadUInt( &iNumFaceMaterials ))
+	{
+		return kInvalidData;
+	}
 
 	// Handle undocumented case with only one face material - all faces use same material
 	if (iNumFaceMaterials == 1 && m_Meshes[iMesh].origFaceEdges.size() != 1)
 	{
 		// Read the single face material
 		TUInt32 iFaceMaterial;
-		ReadXFileLockedUInt( pMaterialData, &iFaceMaterial );
+		if (!parser.ReadUInt( &iFaceMaterial ) || iFaceMaterial >= iNumMaterials)
+		{
+			return kInvalidData;
+		}
 
 		// Create a full face material list from this value
 		m_Meshes[iMesh].faceMaterials.resize( m_Meshes[iMesh].faces.size(), iFaceMaterial );
@@ -1133,7 +935,6 @@ EImportError CImportXFile::ReadMaterialData
 	{
 		if (iNumFaceMaterials != m_Meshes[iMesh].origFaceEdges.size())
 		{
-			pXFileData->Unlock();
 			return kInvalidData;
 		}
 		m_Meshes[iMesh].faceMaterials.resize( m_Meshes[iMesh].faces.size() );
@@ -1141,7 +942,10 @@ EImportError CImportXFile::ReadMaterialData
 		for (TUInt32 iOrigFace = 0; iOrigFace < iNumFaceMaterials; ++iOrigFace)
 		{
 			TUInt32 iMaterial;
-			ReadXFileLockedUInt( pMaterialData, &iMaterial );
+			if (!parser.ReadUInt( &iMaterial ) || iMaterial >= iNumMaterials)
+			{
+				return kInvalidData;
+			}
 			m_Meshes[iMesh].faceMaterials[iFace] = iMaterial;
 			++iFace;
 			for (TUInt32 iEdge = 3; iEdge < m_Meshes[iMesh].origFaceEdges[iOrigFace]; ++iEdge)
@@ -1152,121 +956,62 @@ EImportError CImportXFile::ReadMaterialData
 		}
 	}
 
-	// Finished with material data
-	pXFileData->Unlock();
-
 
-	// Counter for materials read from optional data objects
+	// Counter for materials read from child objects (or references to earlier materials)
 	TUInt32 iMaterialsRead = 0;
 
-	// Get number of child objects for the current object
-	TUInt32 iNumMatListChildren;
-	eError = GetXFileNumChildren( pXFileData, &iNumMatListChildren );
-	if (eError != kSuccess)
-	{
-		return kInvalidData;
-	}
-
 	// For each child object
-	for (TUInt32 iMatListChild = 0; iMatListChild < iNumMatListChildren; ++iMatListChild)
+	string sTemplateName, sName;
+	while (parser.NextObject( &sTemplateName, &sName ))
 	{
-		// Get child data and ID
-		ID3DXFileData* pMatListChildData;
-		GUID matListChildGUID;
-		eError = GetXFileChild( pXFileData, iMatListChild, &pMatListChildData, &matListChildGUID );
-		if (eError != kSuccess)
-		{
-			return kInvalidData;
-		}
-
 		// Found material in material list
-		if (matListChildGUID == TID_D3DRMMaterial)
+		if (sTemplateName == "Material")
 		{
 			// Check if too many materials
 			if (iMaterialsRead >= m_Meshes[iMesh].materials.size())
 			{
-				pMatListChildData->Release();
 				return kInvalidData;
 			}
 
-			// Read material name
-			EImportError eError =
-				GetXFileDataName( pMatListChildData, m_Meshes[iMesh].materials[iMaterialsRead].sName );
-			if (eError != kSuccess)
+			// Read material colours and power
+			SXFileMaterial& material = m_Meshes[iMesh].materials[iMaterialsRead];
+			material.sName = sName;
+			parser.ReadFloats( &material.faceColour.fRed, 4 );
+			parser.ReadFloat( &material.fSpecularPower );
+			parser.ReadFloats( &material.specularColour.fRed, 3 );
+			parser.ReadFloats( &material.emmisiveColour.fRed, 3 );
+
+			// For each child object of the material
+			string sMatTemplateName, sMatName;
+			while (parser.NextObject( &sMatTemplateName, &sMatName ))
 			{
-				pMatListChildData->Release();
-				return kInvalidData;
-			}
-
-			// Get material data (11 floats in material template up to optional data)
-			// Fills in all of SXFileMaterial between name & texture name TODO a bit dodgy
-			TUInt32 iSize = 11 * sizeof(TFloat32);
-			TUInt8* pDest = 
-				reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].materials[iMaterialsRead].faceColour);
-			CopyXFileData( pMatListChildData, pDest, &iSize );
-
-
-			// Get number of child objects for the current object
-			TUInt32 iNumMatChildren;
-			eError = GetXFileNumChildren( pMatListChildData, &iNumMatChildren );
-			if (eError != kSuccess)
-			{
-				pMatListChildData->Release();
-				return kInvalidData;
-			}
-
-			// For each child object
-			for (TUInt32 iMatChild = 0; iMatChild < iNumMatChildren; ++iMatChild)
-			{
-				// Get child data and ID
-				ID3DXFileData* pMatChildData;
-				GUID matChildGUID;
-				eError = GetXFileChild( pMatListChildData, iMatChild,
-				                        &pMatChildData, &matChildGUID );
-				if (eError != kSuccess)
-				{
-					pMatListChildData->Release();
-					return kInvalidData;
-				}
-
 				// Found texture filename in material
-				if (matChildGUID == TID_D3DRMTextureFilename)
-				{
-					const TUInt8* pFileNameData;
-					EImportError eError = LockXFileData( pMatChildData, &pFileNameData );
-					if (eError != kSuccess)
-					{
-						pMatChildData->Release();
-						pMatListChildData->Release();
-						return kInvalidData;
-					}
-					m_Meshes[iMesh].materials[iMaterialsRead].sTextureName = 
-						reinterpret_cast<const char*>(pFileNameData);
-					pMatChildData->Unlock();
-				}
-
-				// Found unknown material data
-				else
+				if (sMatTemplateName == "TextureFilename")
 				{
-					// Ignore
+					parser.ReadString( &material.sTextureName );
 				}
 
-				// Release material child data before moving to the next
-				pMatChildData->Release();
+				// Ignore unknown material data
+				parser.SkipObject();
+			}
+			if (parser.Failed())
+			{
+				return kInvalidData;
 			}
 
-			// Increase nubmer of materials that have been found and read
+			// Increase number of materials that have been found and read
 			++iMaterialsRead;
 		}
 
 		// Found unknown material list data
 		else
 		{
-			// Ignore
+			parser.SkipObject();
 		}
-
-		// Release material list child data before moving to the next
-		pMatListChildData->Release();
+	}
+	if (parser.Failed())
+	{
+		return kInvalidData;
 	}
 
 	// Check if not enough materials
@@ -1283,8 +1028,8 @@ EImportError CImportXFile::ReadMaterialData
 // Read a vertex duplication mesh template
 EImportError CImportXFile::ReadDuplicationData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileParser& parser,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
@@ -1295,31 +1040,26 @@ EImportError CImportXFile::ReadDuplicationData
 		return kInvalidData;
 	}
 
-	// Get vertex duplication data
-	const TUInt8* pDuplicationData;
-	EImportError eError = LockXFileData( pXFileData, &pDuplicationData );
-	if (eError != kSuccess)
-	{
-		return kInvalidData;
-	}
-
 	// Read duplicaton indices, also fetch number of unique vertices
 	TUInt32 iNumDuplicationIndices;
-	ReadXFileLockedUInt( pDuplicationData, &iNumDuplicationIndices );
-	if (iNumDuplicationIndices != m_Meshes[iMesh].vertices.size())
+	if (!parser.ReadUInt( &iNumDuplicationIndices ) ||
+	    iNumDuplicationIndices != m_Meshes[iMesh].vertices.size() ||
+	    !parser.ReadUInt( &m_Meshes[iMesh].iNumUniqueVertices ))
 	{
-		pXFileData->Unlock();
 		return kInvalidData;
 	}
-	ReadXFileLockedUInt( pDuplicationData, &m_Meshes[iMesh].iNumUniqueVertices );
 	m_Meshes[iMesh].duplicateIndices.resize( iNumDuplicationIndices );
 	for (TUInt32 iIndex = 0; iIndex < iNumDuplicationIndices; ++iIndex)
 	{
-		ReadXFileLockedUInt( pDuplicationData, &m_Meshes[iMesh].duplicateIndices[iIndex] );
+		if (!parser.ReadUInt( &m_Meshes[iMesh].duplicateIndices[iIndex] ) ||
+		    m_Meshes[iMesh].duplicateIndices[iIndex] >= iNumDuplicationIndices)
+		{
+			return kInvalidData;
+		}
 	}
 
 	// Finished with vertex duplication data
-	pXFileData->Unlock();
+	parser.SkipObject();
 
 	return kSuccess;
 
@@ -1330,8 +1070,8 @@ EImportError CImportXFile::ReadDuplicationData
 // TODO: Unknown usage
 EImportError CImportXFile::ReadAdjacencyData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileParser& parser,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
@@ -1342,25 +1082,23 @@ EImportError CImportXFile::ReadAdjacencyData
 		return kInvalidData;
 	}
 
-	// Get face adjacency data
-	const TUInt8* pAdjacencyData;
-	EImportError eError = LockXFileData( pXFileData, &pAdjacencyData );
-	if (eError != kSuccess)
+	// Read face adjacency list
+	TUInt32 iNumAdjacencyIndices;
+	if (!parser.ReadUInt( &iNumAdjacencyIndices ) || !parser.CanRead( iNumAdjacencyIndices ))
 	{
 		return kInvalidData;
 	}
-
-	// Read face adjacency list
-	TUInt32 iNumAdjacencyIndices;
-	ReadXFileLockedUInt( pAdjacencyData, &iNumAdjacencyIndices );
 	m_Meshes[iMesh].adjacencyIndices.resize( iNumAdjacencyIndices );
 	for (TUInt32 iIndex = 0; iIndex < iNumAdjacencyIndices; ++iIndex)
 	{
-		ReadXFileLockedUInt( pAdjacencyData, &m_Meshes[iMesh].adjacencyIndices[iIndex] );
+		if (!parser.ReadUInt( &m_Meshes[iMesh].adjacencyIndices[iIndex] ))
+		{
+			return kInvalidData;
+		}
 	}
 
 	// Finished with face adjacency data
-	pXFileData->Unlock();
+	parser.SkipObject();
 
 	return kSuccess;
 
@@ -1370,8 +1108,8 @@ EImportError CImportXFile::ReadAdjacencyData
 // Read skinning header mesh template
 EImportError CImportXFile::ReadSkinDefnData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh
+	CXFileParser& parser,
+	const TUInt32 iMesh
 )
 {
 	GEN_GUARD;
@@ -1382,21 +1120,22 @@ EImportError CImportXFile::ReadSkinDefnData
 		return kInvalidData;
 	}
 
-	// Get skinning definition data
-	const TUInt8* pSkinDefnData;
-	EImportError eError = LockXFileData( pXFileData, &pSkinDefnData );
-	if (eError != kSuccess)
+	// Read maximum weights info
+	TUInt32 iMaxBonesPerVertex, iMaxBonesPerFace;
+	if (!parser.ReadUInt( &iMaxBonesPerVertex ) || !parser.ReadUInt( &iMaxBonesPerFace ))
 	{
 		return kInvalidData;
 	}
+	m_Meshes[iMesh].iMaxBonesPerVertex = static_cast<TUInt16>(iMaxBonesPerVertex);
+	m_Meshes[iMesh].iMaxBonesPerFace = static_cast<TUInt16>(iMaxBonesPerFace);
 
-	// Read maximum weights info
-	ReadXFileLockedUInt16( pSkinDefnData, &m_Meshes[iMesh].iMaxBonesPerVertex );
-	ReadXFileLockedUInt16( pSkinDefnData, &m_Meshes[iMesh].iMaxBonesPerFace );
-
-	// Get number of bones used and initialise bone structures
-	TUInt16 iNumBones;
-	ReadXFileLockedUInt16( pSkinDefnData, &iNumBones );
+	// Get number of bones used and initialise bone structures. Each bone has its own SkinWeights
+	// object, which limits the number
+	TUInt32 iNumBones;
+	if (!parser.ReadUInt( &iNumBones ) || iNumBones > 0xffff || !parser.CanRead( iNumBones ))
+	{
+		return kInvalidData;
+	}
 	for (TUInt32 iBone = 0; iBone < iNumBones; ++iBone)
 	{
 		SXFileBone bone;
@@ -1406,7 +1145,7 @@ EImportError CImportXFile::ReadSkinDefnData
 	}
 
 	// Finished with skinning definition data
-	pXFileData->Unlock();
+	parser.SkipObject();
 
 	return kSuccess;
 
@@ -1416,9 +1155,9 @@ EImportError CImportXFile::ReadSkinDefnData
 // Read a skinning weights mesh template
 EImportError CImportXFile::ReadSkinWeightsData
 (
-	ID3DXFileData* pXFileData,
-	const TUInt32  iMesh,
-	const TUInt32  iBone
+	CXFileParser& parser,
+	const TUInt32 iMesh,
+	const TUInt32 iBone
 )
 {
 	GEN_GUARD;
@@ -1428,64 +1167,37 @@ EImportError CImportXFile::ReadSkinWeightsData
 	{
 		return kInvalidData;
 	}
+	SXFileBone& bone = m_Meshes[iMesh].bones[iBone];
 
-	// Get skin weights data
-	const TUInt8* pSkinWeightData;
-	EImportError eError = LockXFileData( pXFileData, &pSkinWeightData );
-	if (eError != kSuccess)
+	// Read name of bone and number of weights
+	TUInt32 iNumWeights;
+	if (!parser.ReadString( &bone.sFrameName ) || !parser.ReadUInt( &iNumWeights ) ||
+	    !parser.CanRead( iNumWeights, 2 ))
 	{
 		return kInvalidData;
 	}
-
-	// Read name of bone
-	m_Meshes[iMesh].bones[iBone].sFrameName = reinterpret_cast<const char*>(pSkinWeightData);
-	pSkinWeightData += m_Meshes[iMesh].bones[iBone].sFrameName.length() + 1;
-
-	// Read number of weights
-	TUInt32 iNumWeights;
-	ReadXFileLockedUInt( pSkinWeightData, &iNumWeights );
-	m_Meshes[iMesh].bones[iBone].weights.resize( iNumWeights );
+	bone.weights.resize( iNumWeights );
 
 	// Read skinning indices, weights and offset matrix
 	for (TUInt32 iIndex = 0; iIndex < iNumWeights; ++iIndex)
 	{
-		ReadXFileLockedUInt( pSkinWeightData,
-		                     &m_Meshes[iMesh].bones[iBone].weights[iIndex].iVertexIndex );
+		if (!parser.ReadUInt( &bone.weights[iIndex].iVertexIndex ) ||
+		    bone.weights[iIndex].iVertexIndex >= m_Meshes[iMesh].vertices.size())
+		{
+			return kInvalidData;
+		}
 	}
 
 	for (TUInt32 iWeight = 0; iWeight < iNumWeights; ++iWeight)
 	{
-		TUInt8* pDest = 
-			reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].bones[iBone].weights[iWeight].fWeight);
-		ReadXFileLockedData( pSkinWeightData, pDest, sizeof(TFloat32) );
+		parser.ReadFloat( &bone.weights[iWeight].fWeight );
 	}
 
-	TUInt8* pDest = reinterpret_cast<TUInt8*>(&m_Meshes[iMesh].bones[iBone].offsetMatrix);
-	ReadXFileLockedData( pSkinWeightData, pDest, 16 * sizeof(TFloat32) );
+	parser.ReadFloats( &bone.offsetMatrix.e00, 16 );
 
 	// Finished with skin weight data
-	pXFileData->Unlock();
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-
-/*-----------------------------------------------------------------------------------------
-	X-File parsing
------------------------------------------------------------------------------------------*/
-
-EImportError CImportXFile::GetXFileNumChildren
-(
-	ID3DXFileEnumObject* pXFileEnumer, 
-	TUInt32*             iNumChildren
-)
-{
-	GEN_GUARD;
-
-	HRESULT xFileError = pXFileEnumer->GetChildren( reinterpret_cast<DWORD*>(iNumChildren) );
-	if (xFileError != S_OK)
+	parser.SkipObject();
+	if (parser.Failed())
 	{
 		return kInvalidData;
 	}
@@ -1495,217 +1207,6 @@ EImportError CImportXFile::GetXFileNumChildren
 	GEN_ENDGUARD;
 }
 
-EImportError CImportXFile::GetXFileNumChildren
-(
-	ID3DXFileData* pXFileData,
-	TUInt32*       iNumChildren
-)
-{
-	GEN_GUARD;
-
-	HRESULT xFileError = pXFileData->GetChildren( reinterpret_cast<DWORD*>(iNumChildren) );
-	if (xFileError != S_OK)
-	{
-		return kInvalidData;
-	}
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-
-EImportError CImportXFile::GetXFileChild
-(
-	ID3DXFileEnumObject* pXFileEnumer,
-	const TUInt32        iChild, 
-	ID3DXFileData**      ppChildData, 
-	GUID*                pChildGUID
-)
-{
-	GEN_GUARD;
-
-	HRESULT xFileError = pXFileEnumer->GetChild( iChild, ppChildData );
-	if (xFileError != S_OK)
-	{
-		GEN_ASSERT( xFileError != D3DXFERR_NOMOREOBJECTS, "Invalid child ID" );
-		return kInvalidData;
-	}
-
-	xFileError = (*ppChildData)->GetType( pChildGUID );
-	GEN_ASSERT( xFileError == S_OK, "Failure getting X-File GUID" );
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-EImportError CImportXFile::GetXFileChild
-(
-	ID3DXFileData*  pXFileData,
-	const TUInt32   iChild, 
-	ID3DXFileData** ppChildData, 
-	GUID*           pChildGUID
-)
-{
-	GEN_GUARD;
-
-	HRESULT xFileError = pXFileData->GetChild( iChild, ppChildData );
-	if (xFileError != S_OK)
-	{
-		GEN_ASSERT( xFileError != D3DXFERR_NOMOREOBJECTS, "Invalid child ID" );
-		return kInvalidData;
-	}
-
-	xFileError = (*ppChildData)->GetType( pChildGUID );
-	GEN_ASSERT( xFileError == S_OK, "Failure getting X-File GUID" );
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-
-EImportError CImportXFile::GetXFileDataName
-(
-	ID3DXFileData* pXFileData,
-	string&        sName
-)
-{
-	GEN_GUARD;
-
-	DWORD iDataSize;
-	HRESULT xFileError = pXFileData->GetName( NULL, &iDataSize );
-	if (!iDataSize)
-	{
-		sName = "";
-	}
-	else
-	{
-		char* szName = new char[iDataSize];
-		if (!szName)
-		{
-			return kOutOfSystemMemory;
-		}
-		xFileError = pXFileData->GetName( szName, &iDataSize );
-		GEN_ASSERT( xFileError == S_OK, "Failure getting X-File name" );
-		sName = szName;
-		delete[] szName;
-	}
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-
-EImportError CImportXFile::LockXFileData
-(
-	ID3DXFileData* pXFileData,
-    const TUInt8** ppLockData,
-    TUInt32*       pSize /*= 0*/
-)
-{
-	GEN_GUARD;
- 
-	DWORD iActualSize;
-	HRESULT xFileError = 
-		pXFileData->Lock( &iActualSize, reinterpret_cast<const void**>(ppLockData) );
-	GEN_ASSERT( xFileError == S_OK, "Unexpected failure in Lock" );
-	if (pSize)
-	{
-		if (*pSize != 0 && *pSize != iActualSize)
-		{
-			pXFileData->Unlock();
-			return kInvalidData;
-		}
-		*pSize = iActualSize;
-	}
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-void CImportXFile::UnlockXFileData
-(
-	ID3DXFileData* pXFileData
-)
-{
-	GEN_GUARD;
- 
-	pXFileData->Unlock();
-
-	GEN_ENDGUARD;
-}
-
-
-EImportError CImportXFile::CopyXFileData
-(
-	ID3DXFileData* pXFileData,
-    TUInt8*        pDest,
-    TUInt32*       pSize
-)
-{
-	GEN_GUARD;
- 
-	const TUInt8* pLockData;
-	EImportError eError = LockXFileData( pXFileData, &pLockData, pSize );
-	if (eError != kSuccess)
-	{
-		return eError;
-	}
-	memcpy( pDest, pLockData, *pSize );
-	UnlockXFileData( pXFileData );
-
-	return kSuccess;
-
-	GEN_ENDGUARD;
-}
-
-void CImportXFile::ReadXFileLockedData
-(
-	const TUInt8*& pMeshData,
-	TUInt8*        pDest,
-	const TUInt32  iSize
-)
-{
-	GEN_GUARD;
- 
-	memcpy( pDest, pMeshData, iSize );
-	pMeshData += iSize;
-
-	GEN_ENDGUARD;
-}
-
-void CImportXFile::ReadXFileLockedUInt
-(
-	const TUInt8*& pMeshData,
-	TUInt32*       piDest
-)
-{
-	GEN_GUARD;
- 
-	memcpy( piDest, pMeshData, 4 );
-	pMeshData += 4;
-
-	GEN_ENDGUARD;
-}
-
-void CImportXFile::ReadXFileLockedUInt16
-(
-	const TUInt8*& pMeshData,
-	TUInt16*       piDest
-)
-{
-	GEN_GUARD;
- 
-	memcpy( piDest, pMeshData, 2 );
-	pMeshData += 2;
-
-	GEN_ENDGUARD;
-}
-
 
 /*-----------------------------------------------------------------------------------------
 	X-file type support
@@ -1751,10 +1252,11 @@ void CImportXFile::MatchFaceLists
 
 	if (!mesh.normals.empty())
 	{
-		// Maximum vertices (and normals) possible is the total number of indices in the original
-		// face lists (if each index was different). Use std library accumulate from <numeric>
+		// Maximum vertices (and normals) possible is the original vertices plus a duplicate for
+		// every index in the original face lists. Use std library accumulate from <numeric>
 		TUInt32 iMaxVertices = accumulate( mesh.origFaceEdges.begin(), 
-		                                   mesh.origFaceEdges.end(), 0 );
+		                                   mesh.origFaceEdges.end(), 0 ) +
+		                       static_cast<TUInt32>(mesh.vertices.size());
 
 		// Create empty vertex and normal maps - use max vertex value as unused marker
 		TXFileInts vertexMap( iMaxVertices, iMaxVertices );
@@ -1840,11 +1342,12 @@ void CImportXFile::MatchFaceLists
 			}
 		}
 
-		// Build full updated normal list and replace original normals
+		// Build full updated normal list and replace original normals. Vertices not used by any
+		// face take the first normal
 		TXFileVectors newNormals( iNewNumVertices );
 		for (TUInt32 iNormal = 0; iNormal < iNewNumVertices; ++iNormal)
 		{
-			newNormals[iNormal] = mesh.normals[normalMap[iNormal]];
+			newNormals[iNormal] = mesh.normals[normalMap[iNormal] != iMaxVertices ? normalMap[iNormal] : 0];
 		}
 		mesh.normals.swap( newNormals );
 	}
@@ -1984,68 +1487,126 @@ EImportError CImportXFile::ProcessBones()
 	Mesh processing
 -----------------------------------------------------------------------------------------*/
 
-// Split each mesh into a set of meshes - each of which contains only a single material
-void CImportXFile::SplitMeshes()
+// Split each mesh into a set of meshes - each of which contains only a single material. The new
+// meshes are built in parallel on the given thread pool if there is one
+void CImportXFile::SplitMeshes
+(
+	CThreadPool* pPool
+)
 {
 	GEN_GUARD;
 
-	TUInt32 iNumOrigMeshes = static_cast<TUInt32>(m_Meshes.size());
-	for (TUInt32 iMesh = 0; iMesh < iNumOrigMeshes; ++iMesh)
+	// List every mesh / material pair, each will become a new mesh
+	vector< pair<TUInt32, TUInt32> > splits;
+	for (TUInt32 iMesh = 0; iMesh < m_Meshes.size(); ++iMesh)
 	{
-		TUInt32 iMaxVertices = static_cast<TUInt32>(m_Meshes[iMesh].vertices.size());
-
 		for (TUInt32 iMaterial = 0; iMaterial < m_Meshes[iMesh].materials.size(); ++iMaterial)
 		{
-			SXFileMesh newMesh;
-			newMesh.iParentFrame = m_Meshes[iMesh].iParentFrame;
-			newMesh.materials.push_back( m_Meshes[iMesh].materials[iMaterial] );
-			newMesh.materialMap.push_back( m_Meshes[iMesh].materialMap[iMaterial] );
+			splits.push_back( make_pair( iMesh, iMaterial ) );
+		}
+	}
+
+	// Build the new meshes independently, then replace the originals with them in the same order
+	// as a serial split would give
+	TXFileMeshes newMeshes( splits.size() );
+	auto split = [&]( TUInt32 iSplit )
+	{
+		SplitMesh( splits[iSplit].first, splits[iSplit].second, &newMeshes[iSplit] );
+	};
+	if (pPool)
+	{
+		pPool->ParallelFor( static_cast<TUInt32>(splits.size()), split );
+	}
+	else
+	{
+		for (TUInt32 iSplit = 0; iSplit < splits.size(); ++iSplit)
+		{
+			split( iSplit );
+		}
+	}
+
+	m_Meshes.clear();
+	for (TUInt32 iSplit = 0; iSplit < newMeshes.size(); ++iSplit)
+	{
+		if (newMeshes[iSplit].vertices.size() > 0)
+		{
+			m_Meshes.push_back( move( newMeshes[iSplit] ) );
+		}
+	}
 
-			TXFileInts vertexMap( iMaxVertices, iMaxVertices );
+	GEN_ENDGUARD;
+}
 
-			for (TUInt32 iFace = 0; iFace < m_Meshes[iMesh].faceMaterials.size(); ++iFace)
+// Create the new mesh holding the faces of the given mesh that use the given material
+void CImportXFile::SplitMesh
+(
+	const TUInt32 iMesh,
+	const TUInt32 iMaterial,
+	SXFileMesh*   pNewMesh
+) const
+{
+	GEN_GUARD;
+
+	const SXFileMesh& mesh = m_Meshes[iMesh];
+	SXFileMesh& newMesh = *pNewMesh;
+	TUInt32 iMaxVertices = static_cast<TUInt32>(mesh.vertices.size());
+
+	newMesh.iParentFrame = mesh.iParentFrame;
+	newMesh.materials.push_back( mesh.materials[iMaterial] );
+	newMesh.materialMap.push_back( mesh.materialMap[iMaterial] );
+
+	TXFileInts vertexMap( iMaxVertices, iMaxVertices );
+
+	for (TUInt32 iFace = 0; iFace < mesh.faceMaterials.size(); ++iFace)
+	{
+		if (mesh.faceMaterials[iFace] == iMaterial)
+		{
+			newMesh.faceMaterials.push_back( 0 );
+			SXFileFace newFace;
+			for (TUInt32 iIndex = 0; iIndex < 3; ++iIndex)
 			{
-				if (m_Meshes[iMesh].faceMaterials[iFace] == iMaterial)
+				TUInt32 iVert = mesh.faces[iFace].aiVertex[iIndex];
+				if (vertexMap[iVert] == iMaxVertices)
 				{
-					newMesh.faceMaterials.push_back( 0 );
-					SXFileFace newFace;
-					for (TUInt32 iIndex = 0; iIndex < 3; ++iIndex)
+					vertexMap[iVert] = static_cast<TUInt32>(newMesh.vertices.size());
+					newMesh.vertices.push_back( mesh.vertices[iVert] );
+					if (mesh.normals.size() > 0)
 					{
-						TUInt32 iVert = m_Meshes[iMesh].faces[iFace].aiVertex[iIndex];
-						if (vertexMap[iVert] == iMaxVertices)
-						{
-							vertexMap[iVert] = static_cast<TUInt32>(newMesh.vertices.size());
-							newMesh.vertices.push_back( m_Meshes[iMesh].vertices[iVert] );
-							if (m_Meshes[iMesh].normals.size() > 0)
-							{
-								newMesh.normals.push_back( m_Meshes[iMesh].normals[iVert] );
-							}
-							if (m_Meshes[iMesh].textureCoords.size() > 0)
-							{
-								newMesh.textureCoords.push_back( m_Meshes[iMesh].textureCoords[iVert] );
-							}
-							if (m_Meshes[iMesh].vertexColours.size() > 0)
-							{
-								newMesh.vertexColours.push_back( m_Meshes[iMesh].vertexColours[iVert] );
-							}
-						}
-						newFace.aiVertex[iIndex] = vertexMap[iVert];
+						newMesh.normals.push_back( mesh.normals[iVert] );
+					}
+					if (mesh.textureCoords.size() > 0)
+					{
+						newMesh.textureCoords.push_back( mesh.textureCoords[iVert] );
+					}
+					if (mesh.vertexColours.size() > 0)
+					{
+						newMesh.vertexColours.push_back( mesh.vertexColours[iVert] );
 					}
-					newMesh.faces.push_back( newFace );
 				}
+				newFace.aiVertex[iIndex] = vertexMap[iVert];
 			}
-			if (newMesh.vertices.size() > 0)
-			{
-				m_Meshes.push_back( newMesh );
-			}
+			newMesh.faces.push_back( newFace );
 		}
 	}
-	m_Meshes.erase( m_Meshes.begin(), m_Meshes.begin() + iNumOrigMeshes );
 
 	GEN_ENDGUARD;
 }
 
 
+// Load a value for each of four consecutive faces into an SSE register. The faces are given as
+// a pointer to the vertex index for the required corner of the first face (faces are 3 indices
+// apart). Values are taken from an array with the given number of floats per vertex
+static inline __m128 GatherFaces
+(
+	const TFloat32* pData,
+	const TUInt32   iStride,
+	const TUInt32*  piCornerIndices
+)
+{
+	return _mm_setr_ps( pData[piCornerIndices[0] * iStride], pData[piCornerIndices[3] * iStride],
+	                    pData[piCornerIndices[6] * iStride], pData[piCornerIndices[9] * iStride] );
+}
+
 // Create a list of tangent vectors for the given mesh. The tangent vector is the direction of
 // a vertex's texture U axis in model-space. Returns true on success
 bool CImportXFile::CalculateTangents
@@ -2063,8 +1624,62 @@ bool CImportXFile::CalculateTangents
 	pTangents->clear();
 	pTangents->resize( m_Meshes[iMesh].vertices.size(), CVector3::kOrigin );
 
-	// Step through faces
-	for (TUInt32 iFace = 0; iFace < m_Meshes[iMesh].faces.size(); ++iFace)
+	// Calculate the tangents of four faces at a time with SSE, one face in each lane. The
+	// operations are the same as the single face code below, and the tangents are added to
+	// the vertices in face order, so the results are identical
+	const SXFileMesh& mesh = m_Meshes[iMesh];
+	const TFloat32* pPositions = &mesh.vertices[0].x;
+	const TFloat32* pUVs = &mesh.textureCoords[0].fU;
+	const __m128 signBit = _mm_set1_ps( -0.0f );
+	const __m128 epsilon = _mm_set1_ps( kfEpsilon );
+	const __m128 one = _mm_set1_ps( 1.0f );
+	TUInt32 iFace = 0;
+	for (; iFace + 4 <= mesh.faces.size(); iFace += 4)
+	{
+		const SXFileFace* pFaces = &mesh.faces[iFace];
+
+		__m128 v1x = GatherFaces( pPositions,     3, &pFaces->aiVertex[0] );
+		__m128 v1y = GatherFaces( pPositions + 1, 3, &pFaces->aiVertex[0] );
+		__m128 v1z = GatherFaces( pPositions + 2, 3, &pFaces->aiVertex[0] );
+		__m128 edge1x = _mm_sub_ps( GatherFaces( pPositions,     3, &pFaces->aiVertex[1] ), v1x );
+		__m128 edge1y = _mm_sub_ps( GatherFaces( pPositions + 1, 3, &pFaces->aiVertex[1] ), v1y );
+		__m128 edge1z = _mm_sub_ps( GatherFaces( pPositions + 2, 3, &pFaces->aiVertex[1] ), v1z );
+		__m128 edge2x = _mm_sub_ps( GatherFaces( pPositions,     3, &pFaces->aiVertex[2] ), v1x );
+		__m128 edge2y = _mm_sub_ps( GatherFaces( pPositions + 1, 3, &pFaces->aiVertex[2] ), v1y );
+		__m128 edge2z = _mm_sub_ps( GatherFaces( pPositions + 2, 3, &pFaces->aiVertex[2] ), v1z );
+
+		__m128 u1 = GatherFaces( pUVs,     2, &pFaces->aiVertex[0] );
+		__m128 w1 = GatherFaces( pUVs + 1, 2, &pFaces->aiVertex[0] );
+		__m128 s1 = _mm_sub_ps( GatherFaces( pUVs,     2, &pFaces->aiVertex[1] ), u1 );
+		__m128 s2 = _mm_sub_ps( GatherFaces( pUVs,     2, &pFaces->aiVertex[2] ), u1 );
+		__m128 t1 = _mm_sub_ps( GatherFaces( pUVs + 1, 2, &pFaces->aiVertex[1] ), w1 );
+		__m128 t2 = _mm_sub_ps( GatherFaces( pUVs + 1, 2, &pFaces->aiVertex[2] ), w1 );
+
+		// Faces with a zero denominator get the X axis as tangent
+		__m128 denom = _mm_sub_ps( _mm_mul_ps( s1, t2 ), _mm_mul_ps( s2, t1 ) );
+		__m128 isZero = _mm_cmplt_ps( _mm_andnot_ps( signBit, denom ), epsilon );
+		__m128 tangentX = _mm_div_ps( _mm_sub_ps( _mm_mul_ps( edge1x, t2 ), _mm_mul_ps( edge2x, t1 ) ), denom );
+		__m128 tangentY = _mm_div_ps( _mm_sub_ps( _mm_mul_ps( edge1y, t2 ), _mm_mul_ps( edge2y, t1 ) ), denom );
+		__m128 tangentZ = _mm_div_ps( _mm_sub_ps( _mm_mul_ps( edge1z, t2 ), _mm_mul_ps( edge2z, t1 ) ), denom );
+		tangentX = _mm_or_ps( _mm_and_ps( isZero, one ), _mm_andnot_ps( isZero, tangentX ) );
+		tangentY = _mm_andnot_ps( isZero, tangentY );
+		tangentZ = _mm_andnot_ps( isZero, tangentZ );
+
+		TFloat32 afTangentX[4], afTangentY[4], afTangentZ[4];
+		_mm_storeu_ps( afTangentX, tangentX );
+		_mm_storeu_ps( afTangentY, tangentY );
+		_mm_storeu_ps( afTangentZ, tangentZ );
+		for (TUInt32 iLane = 0; iLane < 4; ++iLane)
+		{
+			CVector3 tangent( afTangentX[iLane], afTangentY[iLane], afTangentZ[iLane] );
+			(*pTangents)[pFaces[iLane].aiVertex[0]] += tangent;
+			(*pTangents)[pFaces[iLane].aiVertex[1]] += tangent;
+			(*pTangents)[pFaces[iLane].aiVertex[2]] += tangent;
+		}
+	}
+
+	// Remaining faces one at a time
+	for (; iFace < m_Meshes[iMesh].faces.size(); ++iFace)
 	{
 		int i1 = m_Meshes[iMesh].faces[iFace].aiVertex[0];
 		int i2 = m_Meshes[iMesh].faces[iFace].aiVertex[1];
@@ -16,12 +16,12 @@
 
 #include <vector>
 using namespace std;
-#include <d3d9.h>
-#include <d3dx9.h>
 
 #include "CVector3.h"
 #include "CMatrix4x4.h"
 #include "Mesh.h"
+#include "XFileParser.h"
+#include "ThreadPool.h"
 
 namespace gen
 {
@@ -74,13 +74,14 @@ public:
 	// Import a Microsoft X-File into a list of meshes and a frame hierarchy
 	// Possible return values:
 	//		kSuccess:			...
-	//		kFileError:			Missing file or not an X-file
+	//		kFileError:			Missing file or not a text or uncompressed binary X-file
 	//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
 	//		kOutOfSystemMemory:	...
-	//		kSystemFailure:		X-file API failure
+	// Mesh processing is spread across the given thread pool if there is one
 	EImportError ImportFile
 	(
-		const string& sXName
+		const string& sXName,
+		CThreadPool*  pPool = 0
 	);
 
 
@@ -327,35 +328,13 @@ private:
 	typedef vector<SXFileMesh> TXFileMeshes;
 
 
-	/////////////////////////////////////
-	// X-File API support
-
-	// Prepare and return an X-file object
-	// Possible return values:
-	//		kSuccess:			...
-	//		kOutOfSystemMemory:	...
-	//		kSystemFailure:		Problem registering X-file templates or other API error
-	EImportError PrepareXFileObject
-	(
-		ID3DXFile** ppXFile
-	);
-
-	// Prepare and return an X-file enumerator given a filename and an X-file object
-	// Possible return values:
-	//		kSuccess:			...
-	//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
-	//		kSystemFailure:		X-file API error
-	EImportError GetXFileEnumerator
-	(
-		const string&         sFilename,
-		ID3DXFile*            pXFile,
-		ID3DXFileEnumObject** ppXFileEnumer
-	);
-
-
 	/////////////////////////////////////
 	// X-File parsing
 
+	// Frames nested deeper than this are rejected as invalid data. Frames are parsed recursively,
+	// so without a limit a damaged or hostile file could overflow the stack
+	static const TUInt32 kMaxFrameDepth = 256;
+
 	// Create a single root frame and parse the X-File to add all the bottom level frames and
 	// meshes. Any frames and meshes found will be children of this root frame, child frames are
 	// recursively parsed to create a frame hierarchy
@@ -363,173 +342,100 @@ private:
 	//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
 	EImportError ParseXFile
 	(
-		ID3DXFileEnumObject* pXFileEnumer
+		CXFileParser& parser
 	);
 
 	// Create a new frame and parse the X-File to add all the contained frames and meshes. Any
 	// frames and meshes found will become children of this new frame. Child frames are recursively
 	// parsed to create a frame hierarchy
 	// Possible return values:
-	//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
+	//		kInvalidData:		The file could not be parsed correctly, contains invalid data or
+	//		                    frames nested more than kMaxFrameDepth deep
 	EImportError ParseXFileFrame
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iParentFrame
+		CXFileParser& parser,
+		const string& sFrameName,
+		const TUInt32 iParentFrame
 	);
 
 
 	// X-File parsing - collect mesh data
 	EImportError ParseXFileMesh
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iCurrFrame
+		CXFileParser& parser,
+		const TUInt32 iCurrFrame
 	);
 
 
 	/////////////////////////////////////
 	// X-File template parsing
 
+	// Each function reads the data of the parser's current object, which has the given template,
+	// and leaves the object (except ReadMeshData, which leaves the parser ready to read the mesh's
+	// child objects)
+
 	// Read vertex and face data from a mesh template
 	EImportError ReadMeshData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileParser& parser,
+		const TUInt32 iMesh
 	);
 
 	// Read a normal data mesh template
 	EImportError ReadNormalData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileParser& parser,
+		const TUInt32 iMesh
 	);
 
 	// Read a texture coordinate mesh template
 	EImportError ReadTextureUVData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileParser& parser,
+		const TUInt32 iMesh
 	);
 
 	// Read a vertex colour mesh template
 	EImportError ReadVertexColourData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileParser& parser,
+		const TUInt32 iMesh
 	);
 
 	// Read a vertex colour mesh template
 	EImportError ReadMaterialData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileParser& parser,
+		const TUInt32 iMesh
 	);
 
 	// Read a vertex duplication mesh template
 	EImportError ReadDuplicationData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileParser& parser,
+		const TUInt32 iMesh
 	);
 
 	// Read a adjacancy data mesh template
 	EImportError ReadAdjacencyData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileParser& parser,
+		const TUInt32 iMesh
 	);
 
 	// Read skinning header mesh template
 	EImportError ReadSkinDefnData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh
+		CXFileParser& parser,
+		const TUInt32 iMesh
 	);
 
 	// Read a skinning weights mesh template
 	EImportError ReadSkinWeightsData
 	(
-		ID3DXFileData* pXFileData,
-		const TUInt32  iMesh,
-		const TUInt32  iBone
-	);
-
-
-	/////////////////////////////////////
-	// X-File parsing support
-
-	EImportError GetXFileNumChildren
-	(
-		ID3DXFileEnumObject* pXFileEnumer, 
-		TUInt32*             iNumChildren
-	);
-
-	EImportError GetXFileNumChildren
-	(
-		ID3DXFileData* pXFileData,
-		TUInt32*       iNumChildren
-	);
-
-
-	EImportError GetXFileChild
-	(
-		ID3DXFileEnumObject* pXFileEnumer,
-		const TUInt32        iChild, 
-		ID3DXFileData**      ppChildData, 
-		GUID*                pChildGUID
-	);
-
-	EImportError GetXFileChild
-	(
-		ID3DXFileData*  pXFileData,
-		const TUInt32   iChild, 
-		ID3DXFileData** ppChildData, 
-		GUID*           pChildGUID
-	);
-
-
-	EImportError GetXFileDataName
-	(
-		ID3DXFileData* pXFileData,
-		string&        sName
-	);
-
-
-	EImportError LockXFileData
-	(
-		ID3DXFileData* pXFileData,
-		const TUInt8** ppLockData,
-		TUInt32*       pSize = 0
-	);
-
-	void UnlockXFileData
-	(
-		ID3DXFileData* pXFileData
-	);
-
-	EImportError CopyXFileData
-	(
-		ID3DXFileData* pXFileData,
-		TUInt8*        pDest,
-		TUInt32*       pSize
-	);
-
-	void ReadXFileLockedData
-	(
-		const   TUInt8*& pMeshData,
-		TUInt8*	         pDest,
-		const   TUInt32  iSize
-	);
-
-	void ReadXFileLockedUInt
-	(
-		const TUInt8*& pMeshData,
-		TUInt32*       piDest
-	);
-
-	void ReadXFileLockedUInt16
-	(
-		const TUInt8*& pMeshData,
-		TUInt16*       piDest
+		CXFileParser& parser,
+		const TUInt32 iMesh,
+		const TUInt32 iBone
 	);
 
 
@@ -562,8 +468,20 @@ private:
 	/////////////////////////////////////
 	// Mesh processing
 
-	// Split each mesh into a set of meshes - each of which contains only a single material
-	void SplitMeshes();
+	// Split each mesh into a set of meshes - each of which contains only a single material. The
+	// new meshes are built in parallel on the given thread pool if there is one
+	void SplitMeshes
+	(
+		CThreadPool* pPool
+	);
+
+	// Create the new mesh holding the faces of the given mesh that use the given material
+	void SplitMesh
+	(
+		const TUInt32 iMesh,
+		const TUInt32 iMaterial,
+		SXFileMesh*   pNewMesh
+	) const;
 
 	// Create a list of tangent vectors for the given mesh. The tangent vector is the direction of
 	// a vertex's texture U axis in model-space. Returns true on success
@@ -9,6 +9,10 @@
 #include "Mesh.h"
 #include "CImportXFile.h"
 #include "RenderMethod.h"
+#include "MeshOptimiser.h"
+#include "MeshSimplifier.h"
+#include "TextureCache.h"
+#include "MemoryTracker.h"
 
 namespace gen
 {
@@ -20,6 +24,37 @@ extern ID3D10Device* g_pd3dDevice;
 // Folder for all texture and mesh files
 extern const string MediaFolder;
 
+// Textures shared between all meshes
+extern CTextureCache TextureCache;
+
+
+// Each level of detail is simplified from the full mesh to half the faces of the level before,
+// moving the surface by no more than the given fraction of the mesh's bounding radius. A level
+// is used once the mesh covers less than the given fraction of the viewport height, so the
+// simplification error on screen is about the same (under 2 pixels at 720 lines) at each switch
+const TFloat32 kLODErrors[CMesh::kMaxLODs] = { 0.0f, 0.02f, 0.05f, 0.1f };
+const TFloat32 kLODScreenSizes[CMesh::kMaxLODs] = { 0.0f, 0.25f, 0.1f, 0.04f };
+
+// A level of detail is only kept if it has at most this fraction of the faces of the level before
+const TFloat32 kLODMinReduction = 0.9f;
+
+
+// Run a job for each sub-mesh, in parallel on the given thread pool if there is one
+static void ForEachSubMesh( TUInt32 numSubMeshes, CThreadPool* pPool, const function<void( TUInt32 )>& job )
+{
+	if (pPool)
+	{
+		pPool->ParallelFor( numSubMeshes, job );
+	}
+	else
+	{
+		for (TUInt32 subMesh = 0; subMesh < numSubMeshes; ++subMesh)
+		{
+			job( subMesh );
+		}
+	}
+}
+
 
 //-----------------------------------------------------------------------------
 // Constructor / destructor
@@ -37,6 +72,7 @@ CMesh::CMesh()
 	m_NumSubMeshes = 0;
 	m_SubMeshes = 0;
 	m_SubMeshesDX = 0;
+	m_NumLODs = 1;
 
 	m_NumMaterials = 0;
 	m_Materials = 0;
@@ -56,14 +92,17 @@ void CMesh::ReleaseResources()
 	{
 		for (TUInt32 texture = 0; texture < m_Materials[material].numTextures; ++texture)
 		{
-			if (m_Materials[material].textures[texture]) m_Materials[material].textures[texture]->Release();
+			if (m_Materials[material].textures[texture]) TextureCache.Release( m_Materials[material].textures[texture] );
 		}
 	}
 	delete[] m_Materials;
 	m_Materials = 0;
 	m_NumMaterials = 0;
 
-	for (TUInt32 subMesh = 0; subMesh < m_NumSubMeshes; ++subMesh)
+	m_ImportedMaterials.clear();
+
+	// DirectX sub-meshes only exist once device resources have been created
+	for (TUInt32 subMesh = 0; m_SubMeshesDX && subMesh < m_NumSubMeshes; ++subMesh)
 	{
 		if (m_SubMeshesDX[subMesh].indexBuffer)	 m_SubMeshesDX[subMesh].indexBuffer->Release();
 		if (m_SubMeshesDX[subMesh].vertexBuffer) m_SubMeshesDX[subMesh].vertexBuffer->Release();
@@ -75,10 +114,18 @@ void CMesh::ReleaseResources()
 	m_SubMeshes = 0;
 	m_NumSubMeshes = 0;
 
+	for (TUInt32 lod = 1; lod < kMaxLODs; ++lod)
+	{
+		m_LODFaces[lod - 1].clear();
+	}
+	m_NumLODs = 1;
+
 	delete[] m_Nodes;
 	m_Nodes = 0;
 	m_NumNodes = 0;
 
+	m_BVH.Clear();
+
 	m_HasGeometry = false;
 }
 
@@ -158,10 +205,11 @@ bool CMesh::GetTriangle( CVector3* pVertex1, CVector3* pVertex2, CVector3* pVert
 	pVertexData = m_SubMeshes[m_EnumTriMesh].vertices +
 	              face.aiVertex[2] * m_SubMeshes[m_EnumTriMesh].vertexSize;
 	pVertexCoord = reinterpret_cast<TFloat32*>(pVertexData);
-	pVertex2->x = *pVertexCoord++;
-	pVertex2->y = *pVertexCoord++;
-	pVertex2->z = *pVertexCoord;
+	pVertex3->x = *pVertexCoord++;
+	pVertex3->y = *pVertexCoord++;
+	pVertex3->z = *pVertexCoord;
 
+	++m_EnumTri;
 	return true;
 }
 
@@ -233,6 +281,16 @@ bool CMesh::GetVertex( CVector3* pVertex )
 // Create the model from an X-File, returns true on success
 bool CMesh::Load( const string& fileName )
 {
+	return Import( fileName ) && CreateDeviceResources();
+}
+
+// Import the mesh geometry and materials from an X-File without using the device, returns true
+// on success. Must be followed by CreateDeviceResources. The sub-meshes are processed in parallel
+// on the given thread pool if there is one
+bool CMesh::Import( const string& fileName, CThreadPool* pPool /*= 0*/ )
+{
+	CMemoryScope memory( Mem_Meshes );
+
 	// Create a X-File import helper class
 	CImportXFile importFile;
 
@@ -246,7 +304,7 @@ bool CMesh::Load( const string& fileName )
 	}
 
 	// Import the file, return on failure
-	EImportError error = importFile.ImportFile( fullFileName );
+	EImportError error = importFile.ImportFile( fullFileName, pPool );
 	if (error != kSuccess)
 	{
 		if (error == kFileError)
@@ -258,10 +316,8 @@ bool CMesh::Load( const string& fileName )
 	}
 
 	// Release any existing geometry
-	if (m_HasGeometry)
-	{
-		ReleaseResources();
-	}
+	ReleaseResources();
+	m_FileName = fileName;
 
 	// Get node data from import class
 	m_NumNodes = importFile.GetNumNodes();
@@ -275,55 +331,106 @@ bool CMesh::Load( const string& fileName )
 		importFile.GetNode( node, &m_Nodes[node] );
 	}
 
-	// Get material data from import class, also load textures
-	TUInt32 requiredMaterials = importFile.GetNumMaterials();
-	m_Materials = new SMeshMaterialDX[requiredMaterials];
-	if (!m_Materials)
+	// Get material data from import class, textures are loaded when device resources are created
+	m_ImportedMaterials.resize( importFile.GetNumMaterials() );
+	for (TUInt32 material = 0; material < m_ImportedMaterials.size(); ++material)
+	{
+		importFile.GetMaterial( material, &m_ImportedMaterials[material] );
+	}
+
+	// Get submesh data from import class, retain original data for easy access to vertices / faces
+	TUInt32 requiredSubMeshes = importFile.GetNumSubMeshes();
+	m_SubMeshes = new SSubMesh[requiredSubMeshes];
+	if (!m_SubMeshes)
 	{
 		ReleaseResources();
 		return false;
 	}
-	for (m_NumMaterials = 0; m_NumMaterials < requiredMaterials; ++m_NumMaterials)
+	auto getSubMesh = [&]( TUInt32 subMesh )
+	{
+		// Determine if the render method for this mesh needs tangents
+		ERenderMethod meshMethod = importFile.GetSubMeshRenderMethod( subMesh );
+		bool needTangents = RenderMethodUsesTangents( meshMethod );
+
+		importFile.GetSubMesh( subMesh, &m_SubMeshes[subMesh], needTangents );
+
+		// Reorder faces and vertices for the GPU vertex cache and to reduce overdraw
+		OptimiseSubMesh( &m_SubMeshes[subMesh] );
+	};
+	ForEachSubMesh( requiredSubMeshes, pPool, getSubMesh );
+	m_NumSubMeshes = requiredSubMeshes;
+
+	// Geometry pre-processing - just calculating bounding box in this example
+	if (!PreProcess())
 	{
-		SMeshMaterial importMaterial; 
-		importFile.GetMaterial( m_NumMaterials, &importMaterial );
-		if (!CreateMaterialDX( importMaterial, &m_Materials[m_NumMaterials] ))
+		ReleaseResources();
+		return false;
+	}
+
+	// Simplify the mesh for distant rendering
+	GenerateLODs( pPool );
+
+	// Build the triangle BVH used for collision and picking queries
+	m_BVH.Build( m_SubMeshes, m_NumSubMeshes, m_Nodes, m_NumNodes );
+
+	return true;
+}
+
+// Get the file names of the textures used by an imported mesh
+void CMesh::GetTextureFileNames( vector<string>* pFileNames ) const
+{
+	for (TUInt32 material = 0; material < m_ImportedMaterials.size(); ++material)
+	{
+		for (TUInt32 texture = 0; texture < m_ImportedMaterials[material].numTextures; ++texture)
 		{
-			ReleaseResources();
-			return false;
+			pFileNames->push_back( m_ImportedMaterials[material].textureFileNames[texture] );
 		}
 	}
+}
 
-	// Get submesh data from import class - convert to DirectX data for rendering
-	// but retain original data for easy access to vertices / faces
-	TUInt32 requiredSubMeshes = importFile.GetNumSubMeshes();
-	m_SubMeshes = new SSubMesh[requiredSubMeshes];
-	m_SubMeshesDX = new SSubMeshDX[requiredSubMeshes];
-	if (!m_SubMeshes || !m_SubMeshesDX)
+// Create the vertex/index buffers for an imported mesh and get its textures from the texture
+// cache, returns true on success
+bool CMesh::CreateDeviceResources()
+{
+	if (m_NumSubMeshes == 0)
+	{
+		return false; // Not imported
+	}
+
+	// Convert materials to DirectX form, also load textures
+	TUInt32 requiredMaterials = static_cast<TUInt32>(m_ImportedMaterials.size());
+	m_Materials = new SMeshMaterialDX[requiredMaterials];
+	if (!m_Materials)
 	{
 		ReleaseResources();
 		return false;
 	}
-	for (m_NumSubMeshes = 0; m_NumSubMeshes < requiredSubMeshes; ++m_NumSubMeshes)
+	for (m_NumMaterials = 0; m_NumMaterials < requiredMaterials; ++m_NumMaterials)
 	{
-		// Determine if the render method for this mesh needs tangents
-		ERenderMethod meshMethod = importFile.GetSubMeshRenderMethod( m_NumSubMeshes );
-		bool needTangents = RenderMethodUsesTangents( meshMethod );
-
-		importFile.GetSubMesh( m_NumSubMeshes, &m_SubMeshes[m_NumSubMeshes], needTangents );
-		if (!CreateSubMeshDX( m_SubMeshes[m_NumSubMeshes], &m_SubMeshesDX[m_NumSubMeshes] ))
+		if (!CreateMaterialDX( m_ImportedMaterials[m_NumMaterials], &m_Materials[m_NumMaterials] ))
 		{
+			++m_NumMaterials; // Release textures of the partly created material too
 			ReleaseResources();
 			return false;
 		}
 	}
 
-	// Geometry pre-processing - just calculating bounding box in this example
-	if (!PreProcess())
+	// Convert sub-meshes to DirectX data for rendering
+	m_SubMeshesDX = new SSubMeshDX[m_NumSubMeshes];
+	if (!m_SubMeshesDX)
 	{
 		ReleaseResources();
 		return false;
 	}
+	memset( m_SubMeshesDX, 0, m_NumSubMeshes * sizeof(SSubMeshDX) ); // So partial creation can be released
+	for (TUInt32 subMesh = 0; subMesh < m_NumSubMeshes; ++subMesh)
+	{
+		if (!CreateSubMeshDX( subMesh, &m_SubMeshesDX[subMesh] ))
+		{
+			ReleaseResources();
+			return false;
+		}
+	}
 
 	m_HasGeometry = true;
 	return true;
@@ -332,17 +439,32 @@ bool CMesh::Load( const string& fileName )
 // Creates a DirectX specific sub-mesh from an imported sub-mesh (mesh materials must already have been prepared as we need to know render method to setup vertex data)
 bool CMesh::CreateSubMeshDX
 (
-	const SSubMesh& subMesh,
-	SSubMeshDX*     subMeshDX
+	TUInt32     subMeshIndex,
+	SSubMeshDX* subMeshDX
 )
 {
+	const SSubMesh& subMesh = m_SubMeshes[subMeshIndex];
+
 	// Copy node and material
 	subMeshDX->node = subMesh.node;
 	subMeshDX->material = subMesh.material;
 
-	// Buffer sizes
+	// Buffer sizes. The faces of each level of detail go in the index buffer one after another,
+	// starting with the full sub-mesh. Using triangle lists, so always 3 indexes per face
 	subMeshDX->numVertices = subMesh.numVertices;
-	subMeshDX->numIndices = subMesh.numFaces * 3; // Using triangle lists, so always 3 indexes per face
+	vector<TUInt32> indices;
+	for (TUInt32 lod = 0; lod < m_NumLODs; ++lod)
+	{
+		const SMeshFace* faces = (lod == 0) ? subMesh.faces : m_LODFaces[lod - 1][subMeshIndex].data();
+		TUInt32 numFaces = (lod == 0) ? subMesh.numFaces : static_cast<TUInt32>(m_LODFaces[lod - 1][subMeshIndex].size());
+		subMeshDX->lodFirstIndex[lod] = static_cast<TUInt32>(indices.size());
+		subMeshDX->lodNumIndices[lod] = numFaces * 3;
+		for (TUInt32 face = 0; face < numFaces; ++face)
+		{
+			indices.insert( indices.end(), faces[face].aiVertex, faces[face].aiVertex + 3 );
+		}
+	}
+	subMeshDX->numIndices = static_cast<TUInt32>(indices.size());
 
 	// Create vertex element list & layout.
 	unsigned int numElts = 0;
@@ -454,13 +576,26 @@ bool CMesh::CreateSubMeshDX
 	}
 
 
-	// Create the index buffer - assuming 2-byte (WORD) index data
+	// Create the index buffer. Faces hold 32-bit indices, use 2-byte (WORD) indices instead
+	// where the sub-mesh has few enough vertices, halving the index data
+	vector<WORD> shortIndices;
 	bufferDesc.BindFlags = D3D10_BIND_INDEX_BUFFER;
 	bufferDesc.Usage = D3D10_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = subMeshDX->numIndices * sizeof(WORD);
 	bufferDesc.CPUAccessFlags = 0;
 	bufferDesc.MiscFlags = 0;
-	initData.pSysMem = subMesh.faces;   
+	if (subMesh.numVertices <= 0x10000)
+	{
+		shortIndices.assign( indices.begin(), indices.end() );
+		subMeshDX->indexFormat = DXGI_FORMAT_R16_UINT;
+		bufferDesc.ByteWidth = subMeshDX->numIndices * sizeof(WORD);
+		initData.pSysMem = &shortIndices[0];
+	}
+	else
+	{
+		subMeshDX->indexFormat = DXGI_FORMAT_R32_UINT;
+		bufferDesc.ByteWidth = subMeshDX->numIndices * sizeof(TUInt32);
+		initData.pSysMem = &indices[0];
+	}
 	if (FAILED( g_pd3dDevice->CreateBuffer( &bufferDesc, &initData, &subMeshDX->indexBuffer )))
 	{
 		return false;
@@ -469,7 +604,8 @@ bool CMesh::CreateSubMeshDX
 	return true;
 }
 
-// Creates a DirectX specific material from an imported material
+// Creates a DirectX specific material from an imported material. Textures are shared with other
+// materials through the texture cache
 bool CMesh::CreateMaterialDX
 (
 	const SMeshMaterial& material,
@@ -477,6 +613,7 @@ bool CMesh::CreateMaterialDX
 )
 {
 	// Load shaders for render method
+	materialDX->numTextures = 0; // So a partly created material can be released
 	materialDX->renderMethod = material.renderMethod;
 	if (!PrepareMethod( materialDX->renderMethod ))
 	{
@@ -491,16 +628,16 @@ bool CMesh::CreateMaterialDX
 	materialDX->specularPower = material.specularPower;
 
 	// Load material textures
-	materialDX->numTextures = material.numTextures;
 	for (TUInt32 texture = 0; texture < material.numTextures; ++texture)
 	{
-		string fullFileName = MediaFolder + material.textureFileNames[texture];
-		if (FAILED( D3DX10CreateShaderResourceViewFromFile( g_pd3dDevice, fullFileName.c_str(), NULL, NULL, &materialDX->textures[texture], NULL ) ))
+		materialDX->textures[texture] = TextureCache.Acquire( material.textureFileNames[texture] );
+		if (!materialDX->textures[texture])
 		{
-			string errorMsg = "Error loading texture " + fullFileName;
+			string errorMsg = "Error loading texture " + MediaFolder + material.textureFileNames[texture];
 			SystemMessageBox( errorMsg.c_str(), "Mesh Error" );
 			return false;
 		}
+		++materialDX->numTextures;
 	}
 	return true;
 }
@@ -589,15 +726,83 @@ bool CMesh::PreProcess()
 	return true;
 }
 
+// Generate the simplified levels of detail after loading. The sub-meshes are simplified in
+// parallel on the given thread pool if there is one. Levels that barely reduce the face count
+// (e.g. meshes of separate quads, which cannot be simplified by edge collapse) are dropped
+void CMesh::GenerateLODs( CThreadPool* pPool )
+{
+	for (TUInt32 lod = 1; lod < kMaxLODs; ++lod)
+	{
+		m_LODFaces[lod - 1].resize( m_NumSubMeshes );
+	}
+	auto simplifySubMesh = [&]( TUInt32 subMesh )
+	{
+		SSubMesh lodSubMesh = m_SubMeshes[subMesh];
+		for (TUInt32 lod = 1; lod < kMaxLODs; ++lod)
+		{
+			TMeshFaces& faces = m_LODFaces[lod - 1][subMesh];
+			SimplifySubMesh( m_SubMeshes[subMesh], m_SubMeshes[subMesh].numFaces >> lod,
+			                 m_BoundingRadius * kLODErrors[lod], &faces );
+
+			// Simplified faces keep the vertex order of the full sub-mesh, reorder them for the cache
+			if (!faces.empty())
+			{
+				lodSubMesh.numFaces = static_cast<TUInt32>(faces.size());
+				lodSubMesh.faces = &faces[0];
+				OptimiseFaceOrder( &lodSubMesh );
+			}
+		}
+	};
+	ForEachSubMesh( m_NumSubMeshes, pPool, simplifySubMesh );
+
+	TUInt32 lastNumFaces = GetNumTriangles();
+	for (m_NumLODs = 1; m_NumLODs < kMaxLODs; ++m_NumLODs)
+	{
+		TUInt32 numFaces = 0;
+		for (TUInt32 subMesh = 0; subMesh < m_NumSubMeshes; ++subMesh)
+		{
+			numFaces += static_cast<TUInt32>(m_LODFaces[m_NumLODs - 1][subMesh].size());
+		}
+		if (numFaces > lastNumFaces * kLODMinReduction)
+		{
+			break;
+		}
+		lastNumFaces = numFaces;
+	}
+	for (TUInt32 lod = m_NumLODs; lod < kMaxLODs; ++lod)
+	{
+		m_LODFaces[lod - 1].clear();
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Level of detail
+//-----------------------------------------------------------------------------
+
+// Get the level of detail to render the mesh at given its screen size - the fraction of the
+// viewport height covered by its bounding sphere
+TUInt32 CMesh::SelectLOD( TFloat32 screenSize ) const
+{
+	TUInt32 lod = 0;
+	while (lod + 1 < m_NumLODs && screenSize < kLODScreenSizes[lod + 1])
+	{
+		++lod;
+	}
+	return lod;
+}
+
 
 //-----------------------------------------------------------------------------
 // Rendering
 //-----------------------------------------------------------------------------
 
 // Render the model using the given matrix list as a hierarchy (must be one matrix per node)
-void CMesh::Render(	CMatrix4x4* matrices )
+// at the given level of detail
+void CMesh::Render(	CMatrix4x4* matrices, TUInt32 lod /*= 0*/ )
 {
 	if (!m_HasGeometry) return;
+	if (lod >= m_NumLODs) lod = m_NumLODs - 1;
 
 	for (TUInt32 subMesh = 0; subMesh < m_NumSubMeshes; ++subMesh)
 	{
@@ -613,7 +818,7 @@ void CMesh::Render(	CMatrix4x4* matrices )
 		UINT offset = 0;
 		g_pd3dDevice->IASetVertexBuffers( 0, 1, &subMeshDX.vertexBuffer, &subMeshDX.vertexSize, &offset );
 		g_pd3dDevice->IASetInputLayout(subMeshDX.vertexLayout );
-		g_pd3dDevice->IASetIndexBuffer(subMeshDX.indexBuffer, DXGI_FORMAT_R16_UINT, 0 );
+		g_pd3dDevice->IASetIndexBuffer(subMeshDX.indexBuffer, subMeshDX.indexFormat, 0 );
 		g_pd3dDevice->IASetPrimitiveTopology( D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
 
 		// Render the sub-mesh. Geometry buffers and shader variables, just select the technique for this method and draw.
@@ -622,9 +827,9 @@ void CMesh::Render(	CMatrix4x4* matrices )
 		for( UINT p = 0; p < techDesc.Passes; ++p )
 		{
 			technique->GetPassByIndex( p )->Apply( 0 );
-			g_pd3dDevice->DrawIndexed( subMeshDX.numIndices, 0, 0 );
+			g_pd3dDevice->DrawIndexed( subMeshDX.lodNumIndices[lod], subMeshDX.lodFirstIndex[lod], 0 );
 		}
-		g_pd3dDevice->DrawIndexed( subMeshDX.numIndices, 0, 0 );
+		g_pd3dDevice->DrawIndexed( subMeshDX.lodNumIndices[lod], subMeshDX.lodFirstIndex[lod], 0 );
 	}
 }
 
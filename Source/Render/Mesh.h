@@ -7,6 +7,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 using namespace std;
 
 #include <d3d10.h>
@@ -15,10 +16,14 @@ using namespace std;
 #include "CVector3.h"
 #include "CMatrix4x4.h"
 #include "MeshData.h"
+#include "MeshBVH.h"
 #include "Camera.h"
 
 namespace gen
 {
+
+class CThreadPool;
+
 	
 // Mesh class
 class CMesh
@@ -90,6 +95,21 @@ public:
 	bool GetVertex( CVector3* pVertex );
 
 
+	// Get the triangle BVH for the mesh, built on load. Use for ray and sphere tests against
+	// the triangles rather than the enumeration above
+	const CMeshBVH& BVH() const
+	{
+		return m_BVH;
+	}
+
+
+	// File name the mesh was imported from, as passed to Import
+	const string& FileName() const
+	{
+		return m_FileName;
+	}
+
+
 	/////////////////////////////////////
 	// Hierarchy access
 
@@ -107,15 +127,46 @@ public:
 	/////////////////////////////////////
 	// Creation
 
-	// Load the mesh from an X-File
+	// Load the mesh from an X-File - same as Import followed by CreateDeviceResources
 	bool Load( const string& fileName );
 
+	// Import the mesh geometry and materials from an X-File without using the device, so may be
+	// called from any thread. Must be followed by CreateDeviceResources on the main thread. The
+	// sub-meshes are processed in parallel on the given thread pool if there is one
+	bool Import( const string& fileName, CThreadPool* pPool = 0 );
+
+	// Get the file names of the textures used by an imported mesh
+	void GetTextureFileNames( vector<string>* pFileNames ) const;
+
+	// Create the vertex/index buffers for an imported mesh and get its textures from the
+	// texture cache
+	bool CreateDeviceResources();
+
+
+	/////////////////////////////////////
+	// Level of detail
+
+	// Maximum number of levels of detail for a mesh, level 0 is the full mesh. Lower levels are
+	// generated on import by simplifying the mesh, each has about half the faces of the last
+	static const TUInt32 kMaxLODs = 4;
+
+	// Number of levels of detail generated for the mesh, 1 if it could not be simplified enough
+	TUInt32 GetNumLODs() const
+	{
+		return m_NumLODs;
+	}
+
+	// Get the level of detail to render the mesh at given its screen size - the fraction of the
+	// viewport height covered by its bounding sphere (see CCamera::ScreenSize)
+	TUInt32 SelectLOD( TFloat32 screenSize ) const;
+
 
 	/////////////////////////////////////
 	// Rendering
 
 	// Render the model using the given matrix list as a hierarchy (must be one matrix per node)
-	void Render( CMatrix4x4* matrices );
+	// at the given level of detail
+	void Render( CMatrix4x4* matrices, TUInt32 lod = 0 );
 
 
 /*-----------------------------------------------------------------------------------------
@@ -147,6 +198,11 @@ private:
 		// Index data for the sub-mesh stored in a index buffer and the number of indices in the buffer
 		ID3D10Buffer*            indexBuffer;
 		TUInt32                  numIndices;
+		DXGI_FORMAT              indexFormat;  // 16-bit indices unless the sub-mesh has too many vertices
+
+		// The faces of each level of detail are stored one after another in the index buffer
+		TUInt32                  lodFirstIndex[kMaxLODs];
+		TUInt32                  lodNumIndices[kMaxLODs];
 	};
 
 
@@ -180,19 +236,25 @@ private:
 	// Creates a DirectX specific sub-mesh from an imported sub-mesh (mesh materials must already have been prepared as we need to know render method to setup vertex data)
 	bool CreateSubMeshDX
 	(
-		const SSubMesh& subMesh,
-		SSubMeshDX*     subMeshDX
+		TUInt32     subMeshIndex,
+		SSubMeshDX* subMeshDX
 	);
 
 
 	// Pre-processing after loading
 	bool PreProcess();
 
+	// Generate the simplified levels of detail after loading
+	void GenerateLODs( CThreadPool* pPool );
+
 
 	/*---------------------------------------------------------------------------------------------
 		Data
 	---------------------------------------------------------------------------------------------*/
 
+	// File name the mesh was imported from
+	string           m_FileName;
+
 	// Does this mesh have any geometry to render
 	bool             m_HasGeometry;
 
@@ -205,7 +267,13 @@ private:
 	SSubMesh*        m_SubMeshes;    // Original sub-mesh data (dynamically allocated array)
 	SSubMeshDX*      m_SubMeshesDX;  // DirectX sub-mesh data (vertex / index buffers)
 
-	// Materials used in mesh
+	// Levels of detail, the faces of level 1 up are stored for each sub-mesh and index the
+	// vertices of the full sub-mesh
+	TUInt32            m_NumLODs;
+	vector<TMeshFaces> m_LODFaces[kMaxLODs - 1];
+
+	// Materials used in mesh - as imported, then in DirectX form once device resources are created
+	vector<SMeshMaterial> m_ImportedMaterials;
 	TUInt32          m_NumMaterials;
 	SMeshMaterialDX* m_Materials;    // Dynamically allocated array
 
@@ -216,6 +284,9 @@ private:
 	// Bounding sphere radius (from (0,0,0) in model space)
 	TFloat32         m_BoundingRadius;
 
+	// Triangle BVH for ray / sphere queries
+	CMeshBVH         m_BVH;
+
 	// Data to support vertex / triangle enumeration
 	TUInt32          m_EnumTriMesh;  // Current mesh being enumerated for triangles
 	TUInt32          m_EnumTri;      // Current triangle (within above mesh) being enumerated
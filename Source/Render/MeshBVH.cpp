@@ -0,0 +1,469 @@
+/*******************************************
+	MeshBVH.cpp
+
+	Triangle bounding volume hierarchy for
+	ray and sphere queries against a mesh
+********************************************/
+
+#include "MeshBVH.h"
+
+namespace gen
+{
+
+/////////////////////////////////////
+// Creation
+
+// Build the BVH from imported sub-mesh data and the node hierarchy it is attached to
+void CMeshBVH::Build
+(
+	const SSubMesh*  subMeshes,
+	TUInt32          numSubMeshes,
+	const SMeshNode* nodes,
+	TUInt32          numNodes
+)
+{
+	Clear();
+
+	// Matrix of each node in mesh space, built down the depth-first node list. The root is left
+	// as identity because entities replace its matrix with their own
+	vector<CMatrix4x4> meshMatrices( numNodes, CMatrix4x4::kIdentity );
+	for (TUInt32 node = 1; node < numNodes; ++node)
+	{
+		meshMatrices[node] = nodes[node].positionMatrix * meshMatrices[nodes[node].parent];
+	}
+
+	// Gather triangles in mesh order, reading sub-mesh data directly rather than through the
+	// stateful enumeration in CMesh
+	TUInt32 numTriangles = 0;
+	for (TUInt32 subMesh = 0; subMesh < numSubMeshes; ++subMesh)
+	{
+		numTriangles += subMeshes[subMesh].numFaces;
+	}
+	if (numTriangles == 0)
+	{
+		return;
+	}
+
+	vector<STriangle> triangles( numTriangles );
+	vector<SAABB> boxes( numTriangles );
+	TUInt32 triangle = 0;
+	for (TUInt32 subMesh = 0; subMesh < numSubMeshes; ++subMesh)
+	{
+		const SSubMesh& data = subMeshes[subMesh];
+		const CMatrix4x4& matrix = meshMatrices[data.node < numNodes ? data.node : 0];
+		for (TUInt32 face = 0; face < data.numFaces; ++face)
+		{
+			// Assuming first three floats of each vertex are the coordinate (see CMesh::PreProcess)
+			CVector3 corners[3];
+			boxes[triangle].SetEmpty();
+			for (TUInt32 corner = 0; corner < 3; ++corner)
+			{
+				const TFloat32* pCoord = reinterpret_cast<const TFloat32*>(data.vertices +
+				                         data.faces[face].aiVertex[corner] * data.vertexSize);
+				corners[corner] = matrix.TransformPoint( CVector3( pCoord[0], pCoord[1], pCoord[2] ) );
+				boxes[triangle].Extend( corners[corner] );
+			}
+			triangles[triangle].vertex = corners[0];
+			triangles[triangle].edge1 = corners[1] - corners[0];
+			triangles[triangle].edge2 = corners[2] - corners[0];
+			++triangle;
+		}
+	}
+
+	m_Tree.Build( &boxes[0], numTriangles );
+
+	// Reorder the triangles to match the tree leaves
+	m_Tree.RenumberToLeafOrder( &m_MeshOrder );
+	m_Triangles.resize( numTriangles );
+	m_LeafOrder.resize( numTriangles );
+	for (triangle = 0; triangle < numTriangles; ++triangle)
+	{
+		m_Triangles[triangle] = triangles[m_MeshOrder[triangle]];
+		m_LeafOrder[m_MeshOrder[triangle]] = triangle;
+	}
+}
+
+// Empty the BVH
+void CMeshBVH::Clear()
+{
+	m_Triangles.clear();
+	m_MeshOrder.clear();
+	m_LeafOrder.clear();
+	m_Tree.Clear();
+}
+
+
+/////////////////////////////////////
+// Getters
+
+// Get the mesh-space corners of a triangle, indexed in mesh order
+void CMeshBVH::GetTriangle( TUInt32 triangle, CVector3* pVertex1, CVector3* pVertex2, CVector3* pVertex3 ) const
+{
+	const STriangle& data = m_Triangles[m_LeafOrder[triangle]];
+	*pVertex1 = data.vertex;
+	*pVertex2 = data.vertex + data.edge1;
+	*pVertex3 = data.vertex + data.edge2;
+}
+
+
+/////////////////////////////////////
+// Queries
+
+// Find the nearest triangle hit by a ray (origin + t * direction, 0 <= t <= maxT)
+bool CMeshBVH::RayIntersect
+(
+	const CVector3& origin,
+	const CVector3& direction,
+	TFloat32        maxT,
+	TFloat32*       pHitT /*= 0*/,
+	TUInt32*        pHitTriangle /*= 0*/
+) const
+{
+	const vector<STriangle>& triangles = m_Triangles;
+	auto visitor = [&]( TUInt32 triangle, TFloat32 nearestT ) -> TFloat32
+	{
+		TFloat32 t;
+		return RayTriangle( triangles[triangle], origin, direction, nearestT, &t ) ? t : nearestT;
+	};
+
+	TUInt32 hitTriangle;
+	if (!m_Tree.RayQuery( origin, direction, maxT, visitor, pHitT, &hitTriangle ))
+	{
+		return false;
+	}
+	if (pHitTriangle) *pHitTriangle = m_MeshOrder[hitTriangle];
+	return true;
+}
+
+// Returns true if the sphere touches any triangle, with the index of the first found
+bool CMeshBVH::SphereIntersect( const CVector3& centre, TFloat32 radius, TUInt32* pHitTriangle /*= 0*/ ) const
+{
+	SAABB queryBox;
+	queryBox.minBounds = centre;
+	queryBox.maxBounds = centre;
+	queryBox.Inflate( radius );
+
+	const vector<STriangle>& triangles = m_Triangles;
+	TFloat32 radiusSquared = radius * radius;
+	TUInt32 hitTriangle = 0;
+	bool hit = false;
+	auto visitor = [&]( TUInt32 triangle ) -> bool
+	{
+		CVector3 offset = ClosestPointOnTriangle( triangles[triangle], centre ) - centre;
+		if (offset.Dot( offset ) <= radiusSquared)
+		{
+			hitTriangle = triangle;
+			hit = true;
+			return false; // Stop the query
+		}
+		return true;
+	};
+	m_Tree.OverlapQuery( queryBox, visitor );
+
+	if (hit && pHitTriangle) *pHitTriangle = m_MeshOrder[hitTriangle];
+	return hit;
+}
+
+// Find the first triangle touched by a sphere moving from origin to origin + maxT * direction
+bool CMeshBVH::SweptSphereIntersect
+(
+	const CVector3& origin,
+	const CVector3& direction,
+	TFloat32        radius,
+	TFloat32        maxT,
+	TFloat32*       pHitT /*= 0*/,
+	TUInt32*        pHitTriangle /*= 0*/
+) const
+{
+	// Candidates are the triangles whose boxes overlap the box around the whole sweep. Shells
+	// move a short way each update so this box is small
+	SAABB queryBox;
+	queryBox.SetEmpty();
+	queryBox.Extend( origin );
+	queryBox.Extend( origin + direction * maxT );
+	queryBox.Inflate( radius );
+
+	const vector<STriangle>& triangles = m_Triangles;
+	TFloat32 radiusSquared = radius * radius;
+	TFloat32 nearestT = maxT;
+	TUInt32 hitTriangle = 0;
+	bool hit = false;
+	auto visitor = [&]( TUInt32 triangle ) -> bool
+	{
+		// Touching at the start is the earliest possible contact, so the query can stop
+		CVector3 offset = ClosestPointOnTriangle( triangles[triangle], origin ) - origin;
+		if (offset.Dot( offset ) <= radiusSquared)
+		{
+			nearestT = 0.0f;
+			hitTriangle = triangle;
+			hit = true;
+			return false;
+		}
+
+		TFloat32 t;
+		if (SweptSphereTriangle( triangles[triangle], origin, direction, radius, nearestT, &t ))
+		{
+			nearestT = t;
+			hitTriangle = triangle;
+			hit = true;
+		}
+		return true;
+	};
+	m_Tree.OverlapQuery( queryBox, visitor );
+
+	if (hit)
+	{
+		if (pHitT) *pHitT = nearestT;
+		if (pHitTriangle) *pHitTriangle = m_MeshOrder[hitTriangle];
+	}
+	return hit;
+}
+
+
+/////////////////////////////////////
+// Support functions
+
+// Ray against a single triangle (Moller-Trumbore), returns true with the parameter if hit
+// between 0 and maxT
+bool CMeshBVH::RayTriangle
+(
+	const STriangle& triangle,
+	const CVector3&  origin,
+	const CVector3&  direction,
+	TFloat32         maxT,
+	TFloat32*        pT
+)
+{
+	CVector3 p = direction.Cross( triangle.edge2 );
+	TFloat32 det = triangle.edge1.Dot( p );
+	if (Abs( det ) < 1e-12f)
+	{
+		return false; // Ray parallel to triangle
+	}
+	TFloat32 invDet = 1.0f / det;
+
+	CVector3 s = origin - triangle.vertex;
+	TFloat32 u = s.Dot( p ) * invDet;
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+
+	CVector3 q = s.Cross( triangle.edge1 );
+	TFloat32 v = direction.Dot( q ) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+	{
+		return false;
+	}
+
+	TFloat32 t = triangle.edge2.Dot( q ) * invDet;
+	if (t < 0.0f || t > maxT)
+	{
+		return false;
+	}
+	*pT = t;
+	return true;
+}
+
+// Sphere moving along a ray against a single triangle, returns true with the parameter of first
+// contact if between 0 and maxT. The sphere first touches either the face, where the plane is
+// radius away from its centre, or else an edge or corner - found as the ray against a capsule of
+// the radius around each edge
+bool CMeshBVH::SweptSphereTriangle
+(
+	const STriangle& triangle,
+	const CVector3&  origin,
+	const CVector3&  direction,
+	TFloat32         radius,
+	TFloat32         maxT,
+	TFloat32*        pT
+)
+{
+	bool hit = false;
+
+	// Face, only when moving towards the plane from the side the sphere starts on
+	CVector3 normal = triangle.edge1.Cross( triangle.edge2 );
+	TFloat32 normalLength = normal.Length();
+	if (normalLength > 1e-12f)
+	{
+		normal *= 1.0f / normalLength;
+		TFloat32 distance = normal.Dot( origin - triangle.vertex );
+		TFloat32 speed = normal.Dot( direction );
+		if (distance < 0.0f)
+		{
+			normal = -normal;
+			distance = -distance;
+			speed = -speed;
+		}
+		if (speed < 0.0f)
+		{
+			TFloat32 t = (radius - distance) / speed;
+			if (t >= 0.0f && t <= maxT)
+			{
+				// Contact point in barycentric coordinates, inside if both and their sum are in [0,1]
+				CVector3 contact = origin + direction * t - normal * radius - triangle.vertex;
+				TFloat32 d11 = triangle.edge1.Dot( triangle.edge1 );
+				TFloat32 d12 = triangle.edge1.Dot( triangle.edge2 );
+				TFloat32 d22 = triangle.edge2.Dot( triangle.edge2 );
+				TFloat32 c1 = contact.Dot( triangle.edge1 );
+				TFloat32 c2 = contact.Dot( triangle.edge2 );
+				TFloat32 invDenom = 1.0f / (d11 * d22 - d12 * d12);
+				TFloat32 u = (d22 * c1 - d12 * c2) * invDenom;
+				TFloat32 v = (d11 * c2 - d12 * c1) * invDenom;
+				if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f)
+				{
+					// Nothing can touch earlier than the face
+					*pT = t;
+					return true;
+				}
+			}
+		}
+	}
+
+	// Edges and corners
+	CVector3 corners[3] = { triangle.vertex, triangle.vertex + triangle.edge1, triangle.vertex + triangle.edge2 };
+	for (TUInt32 corner = 0; corner < 3; ++corner)
+	{
+		const CVector3& start = corners[corner];
+		CVector3 edge = corners[(corner + 1) % 3] - start;
+		TFloat32 t;
+		if (RayCylinder( origin, direction, start, edge, radius, maxT, &t ) ||
+		    RaySphere( origin, direction, start, radius, maxT, &t ))
+		{
+			maxT = t;
+			hit = true;
+		}
+	}
+
+	if (hit) *pT = maxT;
+	return hit;
+}
+
+// Ray against a sphere, returns true with the parameter if the ray enters between 0 and maxT
+bool CMeshBVH::RaySphere
+(
+	const CVector3& origin,
+	const CVector3& direction,
+	const CVector3& centre,
+	TFloat32        radius,
+	TFloat32        maxT,
+	TFloat32*       pT
+)
+{
+	// Solve |origin + t * direction - centre| = radius for the smaller root
+	CVector3 offset = origin - centre;
+	TFloat32 a = direction.Dot( direction );
+	TFloat32 b = offset.Dot( direction );
+	TFloat32 c = offset.Dot( offset ) - radius * radius;
+	TFloat32 discriminant = b * b - a * c;
+	if (a < 1e-12f || discriminant < 0.0f)
+	{
+		return false;
+	}
+	TFloat32 t = (-b - Sqrt( discriminant )) / a;
+	if (t < 0.0f || t > maxT)
+	{
+		return false;
+	}
+	*pT = t;
+	return true;
+}
+
+// Ray against an infinite cylinder around the axis from axisStart to axisStart + axis, returns
+// true with the parameter if the ray enters the cylinder within the length of the axis and
+// between 0 and maxT
+bool CMeshBVH::RayCylinder
+(
+	const CVector3& origin,
+	const CVector3& direction,
+	const CVector3& axisStart,
+	const CVector3& axis,
+	TFloat32        radius,
+	TFloat32        maxT,
+	TFloat32*       pT
+)
+{
+	// Solve for the ray's distance from the axis being the radius, working with the parts of the
+	// ray perpendicular to the axis (Ericson, Real-Time Collision Detection 5.3.7)
+	CVector3 offset = origin - axisStart;
+	TFloat32 axisDotAxis = axis.Dot( axis );
+	TFloat32 axisDotOffset = axis.Dot( offset );
+	TFloat32 axisDotDirection = axis.Dot( direction );
+	TFloat32 a = axisDotAxis * direction.Dot( direction ) - axisDotDirection * axisDotDirection;
+	TFloat32 b = axisDotAxis * offset.Dot( direction ) - axisDotDirection * axisDotOffset;
+	TFloat32 c = axisDotAxis * (offset.Dot( offset ) - radius * radius) - axisDotOffset * axisDotOffset;
+	TFloat32 discriminant = b * b - a * c;
+	if (a < 1e-12f || discriminant < 0.0f)
+	{
+		return false; // Parallel to the axis (the corner spheres are hit first) or missing
+	}
+	TFloat32 t = (-b - Sqrt( discriminant )) / a;
+	if (t < 0.0f || t > maxT)
+	{
+		return false;
+	}
+
+	// Entry point must lie alongside the axis, otherwise a corner sphere is hit instead
+	TFloat32 along = axisDotOffset + t * axisDotDirection;
+	if (along < 0.0f || along > axisDotAxis)
+	{
+		return false;
+	}
+	*pT = t;
+	return true;
+}
+
+// Return the point on a triangle closest to the given point, by finding which feature (corner,
+// edge or face) of the triangle the point lies nearest
+CVector3 CMeshBVH::ClosestPointOnTriangle( const STriangle& triangle, const CVector3& point )
+{
+	const CVector3& a = triangle.vertex;
+	const CVector3& ab = triangle.edge1;
+	const CVector3& ac = triangle.edge2;
+
+	// Corner a
+	CVector3 ap = point - a;
+	TFloat32 d1 = ab.Dot( ap );
+	TFloat32 d2 = ac.Dot( ap );
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+	// Corner b
+	CVector3 bp = ap - ab;
+	TFloat32 d3 = ab.Dot( bp );
+	TFloat32 d4 = ac.Dot( bp );
+	if (d3 >= 0.0f && d4 <= d3) return a + ab;
+
+	// Edge ab
+	TFloat32 vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		return a + ab * (d1 / (d1 - d3));
+	}
+
+	// Corner c
+	CVector3 cp = ap - ac;
+	TFloat32 d5 = ab.Dot( cp );
+	TFloat32 d6 = ac.Dot( cp );
+	if (d6 >= 0.0f && d5 <= d6) return a + ac;
+
+	// Edge ac
+	TFloat32 vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		return a + ac * (d2 / (d2 - d6));
+	}
+
+	// Edge bc
+	TFloat32 va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		return a + ab + (ac - ab) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	// Inside the face
+	TFloat32 denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+
+} // namespace gen
@@ -0,0 +1,195 @@
+/*******************************************
+	MeshBVH.h
+
+	Triangle bounding volume hierarchy for
+	ray and sphere queries against a mesh
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "CVector3.h"
+#include "AABBTree.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+// A triangle BVH over the geometry of a mesh, built once when the mesh is loaded. Triangles
+// are held in mesh space with every node in its default pose (the root node is the identity,
+// as the entity matrix replaces it), so animated parts such as turrets are tested where the
+// mesh file places them. Queries are const and hold no state, so may be run from any thread
+class CMeshBVH
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty BVH
+	CMeshBVH() {}
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CMeshBVH( const CMeshBVH& );
+	CMeshBVH& operator=( const CMeshBVH& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	/////////////////////////////////////
+	// Creation
+
+	// Build the BVH from imported sub-mesh data and the node hierarchy it is attached to
+	void Build
+	(
+		const SSubMesh*  subMeshes,
+		TUInt32          numSubMeshes,
+		const SMeshNode* nodes,
+		TUInt32          numNodes
+	);
+
+	// Empty the BVH
+	void Clear();
+
+
+	/////////////////////////////////////
+	// Getters
+
+	bool IsEmpty() const
+	{
+		return m_Triangles.empty();
+	}
+
+	TUInt32 NumTriangles() const
+	{
+		return static_cast<TUInt32>(m_Triangles.size());
+	}
+
+	TUInt32 NumNodes() const
+	{
+		return m_Tree.NumNodes();
+	}
+
+	// Get the mesh-space corners of a triangle, indexed in mesh order (sub-mesh by sub-mesh,
+	// the same order as CMesh::GetTriangle)
+	void GetTriangle( TUInt32 triangle, CVector3* pVertex1, CVector3* pVertex2, CVector3* pVertex3 ) const;
+
+
+	/////////////////////////////////////
+	// Queries - all in mesh space
+
+	// Find the nearest triangle hit by a ray (origin + t * direction, 0 <= t <= maxT). Returns
+	// true if a triangle was hit, with the hit parameter and triangle index (mesh order)
+	bool RayIntersect
+	(
+		const CVector3& origin,
+		const CVector3& direction,
+		TFloat32        maxT,
+		TFloat32*       pHitT = 0,
+		TUInt32*        pHitTriangle = 0
+	) const;
+
+	// Returns true if the sphere touches any triangle, with the index of the first found
+	bool SphereIntersect( const CVector3& centre, TFloat32 radius, TUInt32* pHitTriangle = 0 ) const;
+
+	// Find the first triangle touched by a sphere moving from origin to origin + maxT * direction.
+	// Returns true if a triangle was touched, with the parameter of first contact (0 if touching
+	// at the start) and triangle index (mesh order)
+	bool SweptSphereIntersect
+	(
+		const CVector3& origin,
+		const CVector3& direction,
+		TFloat32        radius,
+		TFloat32        maxT,
+		TFloat32*       pHitT = 0,
+		TUInt32*        pHitTriangle = 0
+	) const;
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	/////////////////////////////////////
+	// Types
+
+	// A triangle stored in the form used by the ray test - one corner and two edges
+	struct STriangle
+	{
+		CVector3 vertex;
+		CVector3 edge1;
+		CVector3 edge2;
+	};
+
+
+	/////////////////////////////////////
+	// Support functions
+
+	// Ray against a single triangle (Moller-Trumbore), returns true with the parameter if hit
+	// between 0 and maxT. Both sides of the triangle are hit
+	static bool RayTriangle
+	(
+		const STriangle& triangle,
+		const CVector3&  origin,
+		const CVector3&  direction,
+		TFloat32         maxT,
+		TFloat32*        pT
+	);
+
+	// Sphere moving along a ray against a single triangle, returns true with the parameter of
+	// first contact if between 0 and maxT. The sphere must not touch the triangle at the start
+	static bool SweptSphereTriangle
+	(
+		const STriangle& triangle,
+		const CVector3&  origin,
+		const CVector3&  direction,
+		TFloat32         radius,
+		TFloat32         maxT,
+		TFloat32*        pT
+	);
+
+	// Ray against a sphere and against an infinite cylinder limited to the length of its axis,
+	// used for the corners and edges of a triangle by the swept sphere test. Both return true
+	// with the parameter if the ray enters between 0 and maxT
+	static bool RaySphere
+	(
+		const CVector3& origin,
+		const CVector3& direction,
+		const CVector3& centre,
+		TFloat32        radius,
+		TFloat32        maxT,
+		TFloat32*       pT
+	);
+	static bool RayCylinder
+	(
+		const CVector3& origin,
+		const CVector3& direction,
+		const CVector3& axisStart,
+		const CVector3& axis,
+		TFloat32        radius,
+		TFloat32        maxT,
+		TFloat32*       pT
+	);
+
+	// Return the point on a triangle closest to the given point
+	static CVector3 ClosestPointOnTriangle( const STriangle& triangle, const CVector3& point );
+
+
+	/////////////////////////////////////
+	// Data
+
+	// Triangles stored in the leaf order of the tree so each leaf's triangles are contiguous
+	vector<STriangle> m_Triangles;
+	vector<TUInt32>   m_MeshOrder;  // Mesh-order index of each triangle above
+	vector<TUInt32>   m_LeafOrder;  // Index above of each triangle in mesh order (the inverse)
+	CAABBTree         m_Tree;
+};
+
+
+} // namespace gen
@@ -36,10 +36,11 @@ struct SMeshNode
 };
 
 
-// A single face in a mesh - all faces are triangles
+// A single face in a mesh - all faces are triangles. Indices are 32-bit so large meshes can be
+// imported, sub-meshes with few enough vertices are rendered with 16-bit indices
 struct SMeshFace
 {
-	TUInt16 aiVertex[3];
+	TUInt32 aiVertex[3];
 };
 typedef vector<SMeshFace> TMeshFaces;
 
@@ -0,0 +1,423 @@
+/*******************************************
+	MeshOptimiser.cpp
+
+	Reorders the faces and vertices of a
+	sub-mesh for faster rendering
+********************************************/
+
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include "MeshOptimiser.h"
+#include "CVector3.h"
+
+namespace gen
+{
+
+// Vertex scoring parameters from Forsyth's article. The scoring cache is larger than the
+// hardware one, so vertices a little further back are still worth reusing
+const TUInt32  kScoreCacheSize = 32;
+const TFloat32 kCacheDecayPower = 1.5f;
+const TFloat32 kLastFaceScore = 0.75f;     // Vertices of the last face added are scored lower
+const TFloat32 kValenceBoostScale = 2.0f;  // Boost vertices with few faces left to finish them off
+const TFloat32 kValenceBoostPower = 0.5f;
+const TUInt32  kMaxScoredValence = 32;     // Higher valences score the same as this
+
+const TUInt32 kNotInCache = 0xffffffff;
+const TUInt32 kNoFace = 0xffffffff;
+const TUInt32 kNoVertex = 0xffffffff;
+
+
+// Get the coordinate of a sub-mesh vertex - assumed to be its first three floats (see
+// CMesh::PreProcess)
+static CVector3 VertexCoord( const SSubMesh& subMesh, TUInt32 vertex )
+{
+	const TFloat32* pCoord = reinterpret_cast<const TFloat32*>(subMesh.vertices + vertex * subMesh.vertexSize);
+	return CVector3( pCoord[0], pCoord[1], pCoord[2] );
+}
+
+
+// Average cache miss ratio (ACMR) of a sub-mesh: the number of vertices transformed per
+// triangle drawn, simulating a FIFO post-transform cache of the given size
+TFloat32 AverageCacheMissRatio( const SSubMesh& subMesh, TUInt32 cacheSize /*= kVertexCacheSize*/ )
+{
+	if (subMesh.numFaces == 0)
+	{
+		return 0.0f;
+	}
+
+	// Each vertex records when it last entered the cache, it has been pushed out of the FIFO
+	// once cacheSize more vertices have entered after it
+	vector<TUInt32> entryTime( subMesh.numVertices, 0 );
+	TUInt32 time = cacheSize + 1;
+	TUInt32 misses = 0;
+	for (TUInt32 face = 0; face < subMesh.numFaces; ++face)
+	{
+		for (TUInt32 corner = 0; corner < 3; ++corner)
+		{
+			TUInt32 vertex = subMesh.faces[face].aiVertex[corner];
+			if (time - entryTime[vertex] > cacheSize)
+			{
+				entryTime[vertex] = time++;
+				++misses;
+			}
+		}
+	}
+	return static_cast<TFloat32>(misses) / subMesh.numFaces;
+}
+
+
+// Reorder the faces of a sub-mesh so vertices are reused while still in the post-transform
+// cache. Each vertex is scored by its position in a modelled LRU cache and by how many of its
+// faces are left to draw. Faces are added greedily, the next being the highest scoring face
+// that uses a cached vertex - so only faces around the cache need rescoring after each one
+void OptimiseFaceOrder( SSubMesh* pSubMesh )
+{
+	TUInt32 numVertices = pSubMesh->numVertices;
+	TUInt32 numFaces = pSubMesh->numFaces;
+	if (numFaces < 2)
+	{
+		return;
+	}
+
+	// Score of each position in the modelled cache and of each number of remaining faces
+	TFloat32 cacheScores[kScoreCacheSize];
+	for (TUInt32 position = 0; position < kScoreCacheSize; ++position)
+	{
+		if (position < 3)
+		{
+			cacheScores[position] = kLastFaceScore;
+		}
+		else
+		{
+			TFloat32 decay = 1.0f - static_cast<TFloat32>(position - 3) / (kScoreCacheSize - 3);
+			cacheScores[position] = powf( decay, kCacheDecayPower );
+		}
+	}
+	TFloat32 valenceScores[kMaxScoredValence + 1];
+	valenceScores[0] = 0.0f;
+	for (TUInt32 valence = 1; valence <= kMaxScoredValence; ++valence)
+	{
+		valenceScores[valence] = kValenceBoostScale * powf( static_cast<TFloat32>(valence), -kValenceBoostPower );
+	}
+
+	// List the faces using each vertex. The faces of a vertex start at firstFace[vertex] in
+	// vertexFaces, the first activeFaces[vertex] of them have not been added yet
+	vector<TUInt32> activeFaces( numVertices, 0 );
+	for (TUInt32 face = 0; face < numFaces; ++face)
+	{
+		for (TUInt32 corner = 0; corner < 3; ++corner)
+		{
+			++activeFaces[pSubMesh->faces[face].aiVertex[corner]];
+		}
+	}
+	vector<TUInt32> firstFace( numVertices );
+	TUInt32 listSize = 0;
+	for (TUInt32 vertex = 0; vertex < numVertices; ++vertex)
+	{
+		firstFace[vertex] = listSize;
+		listSize += activeFaces[vertex];
+		activeFaces[vertex] = 0;
+	}
+	vector<TUInt32> vertexFaces( listSize );
+	for (TUInt32 face = 0; face < numFaces; ++face)
+	{
+		for (TUInt32 corner = 0; corner < 3; ++corner)
+		{
+			TUInt32 vertex = pSubMesh->faces[face].aiVertex[corner];
+			vertexFaces[firstFace[vertex] + activeFaces[vertex]++] = face;
+		}
+	}
+
+	vector<TUInt32> cachePositions( numVertices, kNotInCache );
+	vector<TFloat32> vertexScores( numVertices );
+	auto scoreVertex = [&]( TUInt32 vertex )
+	{
+		TFloat32 score = valenceScores[min( activeFaces[vertex], kMaxScoredValence )];
+		if (cachePositions[vertex] != kNotInCache)
+		{
+			score += cacheScores[cachePositions[vertex]];
+		}
+		vertexScores[vertex] = score;
+	};
+	auto faceScore = [&]( TUInt32 face )
+	{
+		const SMeshFace& meshFace = pSubMesh->faces[face];
+		return vertexScores[meshFace.aiVertex[0]] + vertexScores[meshFace.aiVertex[1]] +
+		       vertexScores[meshFace.aiVertex[2]];
+	};
+
+	// Start with the best face given valences only
+	for (TUInt32 vertex = 0; vertex < numVertices; ++vertex)
+	{
+		scoreVertex( vertex );
+	}
+	TUInt32 bestFace = 0;
+	TFloat32 bestScore = faceScore( 0 );
+	for (TUInt32 face = 1; face < numFaces; ++face)
+	{
+		TFloat32 score = faceScore( face );
+		if (score > bestScore)
+		{
+			bestFace = face;
+			bestScore = score;
+		}
+	}
+
+	vector<SMeshFace> newFaces;
+	newFaces.reserve( numFaces );
+	vector<bool> faceAdded( numFaces, false );
+	TUInt32 nextUnadded = 0;
+	vector<TUInt32> cache, newCache;
+	cache.reserve( kScoreCacheSize + 3 );
+	newCache.reserve( kScoreCacheSize + 3 );
+	while (newFaces.size() < numFaces)
+	{
+		// If no face uses a cached vertex, restart from the next face in the original order
+		if (bestFace == kNoFace)
+		{
+			while (faceAdded[nextUnadded])
+			{
+				++nextUnadded;
+			}
+			bestFace = nextUnadded;
+		}
+		const SMeshFace& face = pSubMesh->faces[bestFace];
+		faceAdded[bestFace] = true;
+		newFaces.push_back( face );
+
+		// Remove the face from the active faces of its vertices, which move to the front of the
+		// cache followed by the rest of the old cache
+		newCache.clear();
+		for (TUInt32 corner = 0; corner < 3; ++corner)
+		{
+			TUInt32 vertex = face.aiVertex[corner];
+			TUInt32* pFaces = &vertexFaces[firstFace[vertex]];
+			TUInt32 last = --activeFaces[vertex];
+			TUInt32 active = 0;
+			while (pFaces[active] != bestFace)
+			{
+				++active;
+			}
+			swap( pFaces[active], pFaces[last] );
+
+			if (find( newCache.begin(), newCache.end(), vertex ) == newCache.end())
+			{
+				newCache.push_back( vertex );
+			}
+		}
+		TUInt32 numFaceVertices = static_cast<TUInt32>(newCache.size());
+		for (TUInt32 entry = 0; entry < cache.size(); ++entry)
+		{
+			if (find( newCache.begin(), newCache.begin() + numFaceVertices, cache[entry] ) == newCache.begin() + numFaceVertices)
+			{
+				newCache.push_back( cache[entry] );
+			}
+		}
+
+		// Rescore the vertices that were or are now in the cache (up to three fall out of it)
+		for (TUInt32 entry = 0; entry < newCache.size(); ++entry)
+		{
+			TUInt32 vertex = newCache[entry];
+			cachePositions[vertex] = entry < kScoreCacheSize ? entry : kNotInCache;
+			scoreVertex( vertex );
+		}
+
+		// The next face is the best scoring face of these vertices
+		bestFace = kNoFace;
+		bestScore = -1.0f;
+		for (TUInt32 entry = 0; entry < newCache.size(); ++entry)
+		{
+			TUInt32 vertex = newCache[entry];
+			const TUInt32* pFaces = &vertexFaces[firstFace[vertex]];
+			for (TUInt32 active = 0; active < activeFaces[vertex]; ++active)
+			{
+				TFloat32 score = faceScore( pFaces[active] );
+				if (score > bestScore)
+				{
+					bestFace = pFaces[active];
+					bestScore = score;
+				}
+			}
+		}
+
+		if (newCache.size() > kScoreCacheSize)
+		{
+			newCache.resize( kScoreCacheSize );
+		}
+		cache.swap( newCache );
+	}
+
+	copy( newFaces.begin(), newFaces.end(), pSubMesh->faces );
+}
+
+
+// Reorder clusters of faces so outward facing parts of the mesh are drawn first. Following Sander
+// et al. "Fast triangle reordering for vertex locality and reduced overdraw": the cache ordered
+// faces are split into clusters wherever a face shares no vertices with the cache, then clusters
+// are sorted by how far they face away from the mesh centre. Those facing outwards are the most
+// likely to be in front, and drawing them first lets depth testing reject what lies behind
+void OptimiseOverdraw( SSubMesh* pSubMesh, TFloat32 maxCacheMissGrowth /*= 1.05f*/ )
+{
+	TUInt32 numFaces = pSubMesh->numFaces;
+	if (numFaces < 2)
+	{
+		return;
+	}
+
+	// Split into clusters, each starting with a face whose three vertices all miss the cache.
+	// Uses the same FIFO model as AverageCacheMissRatio
+	vector<TUInt32> clusterStarts;
+	vector<TUInt32> entryTime( pSubMesh->numVertices, 0 );
+	TUInt32 time = kVertexCacheSize + 1;
+	for (TUInt32 face = 0; face < numFaces; ++face)
+	{
+		TUInt32 misses = 0;
+		for (TUInt32 corner = 0; corner < 3; ++corner)
+		{
+			TUInt32 vertex = pSubMesh->faces[face].aiVertex[corner];
+			if (time - entryTime[vertex] > kVertexCacheSize)
+			{
+				entryTime[vertex] = time++;
+				++misses;
+			}
+		}
+		if (misses == 3)
+		{
+			clusterStarts.push_back( face );
+		}
+	}
+	TUInt32 numClusters = static_cast<TUInt32>(clusterStarts.size());
+	if (numClusters < 2)
+	{
+		return;
+	}
+	clusterStarts.push_back( numFaces );
+
+	// Area weighted centre and average normal of each cluster, and centre of the whole mesh
+	struct SCluster
+	{
+		TUInt32  start, end;
+		CVector3 centre;
+		CVector3 normal;
+		TFloat32 sortKey;
+	};
+	vector<SCluster> clusters( numClusters );
+	CVector3 meshCentre( 0.0f, 0.0f, 0.0f );
+	TFloat32 meshArea = 0.0f;
+	for (TUInt32 cluster = 0; cluster < numClusters; ++cluster)
+	{
+		SCluster& c = clusters[cluster];
+		c.start = clusterStarts[cluster];
+		c.end = clusterStarts[cluster + 1];
+		c.centre = CVector3( 0.0f, 0.0f, 0.0f );
+		c.normal = CVector3( 0.0f, 0.0f, 0.0f );
+		TFloat32 area = 0.0f;
+		for (TUInt32 face = c.start; face < c.end; ++face)
+		{
+			CVector3 v0 = VertexCoord( *pSubMesh, pSubMesh->faces[face].aiVertex[0] );
+			CVector3 v1 = VertexCoord( *pSubMesh, pSubMesh->faces[face].aiVertex[1] );
+			CVector3 v2 = VertexCoord( *pSubMesh, pSubMesh->faces[face].aiVertex[2] );
+			CVector3 normal = Cross( v1 - v0, v2 - v0 ); // Length is twice the face area
+			TFloat32 faceArea = normal.Length();
+			c.centre += (v0 + v1 + v2) * faceArea;
+			c.normal += normal;
+			area += faceArea;
+		}
+		meshCentre += c.centre;
+		meshArea += area;
+		if (area > 0.0f)
+		{
+			c.centre /= area;
+		}
+		if (!c.normal.IsZero())
+		{
+			c.normal.Normalise();
+		}
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCentre /= meshArea;
+	}
+
+	// Outward facing clusters first, keeping cache order between equal clusters
+	for (TUInt32 cluster = 0; cluster < numClusters; ++cluster)
+	{
+		clusters[cluster].sortKey = Dot( clusters[cluster].centre - meshCentre, clusters[cluster].normal );
+	}
+	stable_sort( clusters.begin(), clusters.end(),
+	             []( const SCluster& a, const SCluster& b ) { return a.sortKey > b.sortKey; } );
+
+	vector<SMeshFace> newFaces;
+	newFaces.reserve( numFaces );
+	for (TUInt32 cluster = 0; cluster < numClusters; ++cluster)
+	{
+		newFaces.insert( newFaces.end(), pSubMesh->faces + clusters[cluster].start,
+		                                 pSubMesh->faces + clusters[cluster].end );
+	}
+
+	// Keep the new order unless it costs too much vertex reuse at the cluster joins
+	SSubMesh newSubMesh = *pSubMesh;
+	newSubMesh.faces = &newFaces[0];
+	if (AverageCacheMissRatio( newSubMesh ) <= AverageCacheMissRatio( *pSubMesh ) * maxCacheMissGrowth)
+	{
+		copy( newFaces.begin(), newFaces.end(), pSubMesh->faces );
+	}
+}
+
+
+// Reorder the vertices of a sub-mesh into the order faces first use them. Vertices no face
+// uses are kept, after all the others
+void OptimiseVertexOrder( SSubMesh* pSubMesh )
+{
+	TUInt32 numVertices = pSubMesh->numVertices;
+	TUInt32 vertexSize = pSubMesh->vertexSize;
+	if (numVertices < 2)
+	{
+		return;
+	}
+
+	// New index of each vertex
+	vector<TUInt32> remap( numVertices, kNoVertex );
+	TUInt32 nextVertex = 0;
+	for (TUInt32 face = 0; face < pSubMesh->numFaces; ++face)
+	{
+		for (TUInt32 corner = 0; corner < 3; ++corner)
+		{
+			TUInt32& vertex = pSubMesh->faces[face].aiVertex[corner];
+			if (remap[vertex] == kNoVertex)
+			{
+				remap[vertex] = nextVertex++;
+			}
+			vertex = remap[vertex];
+		}
+	}
+	for (TUInt32 vertex = 0; vertex < numVertices; ++vertex)
+	{
+		if (remap[vertex] == kNoVertex)
+		{
+			remap[vertex] = nextVertex++;
+		}
+	}
+
+	vector<TUInt8> oldVertices( pSubMesh->vertices, pSubMesh->vertices + numVertices * vertexSize );
+	for (TUInt32 vertex = 0; vertex < numVertices; ++vertex)
+	{
+		memcpy( pSubMesh->vertices + remap[vertex] * vertexSize, &oldVertices[vertex * vertexSize], vertexSize );
+	}
+}
+
+
+// Run all the optimisations on a sub-mesh
+void OptimiseSubMesh( SSubMesh* pSubMesh )
+{
+	OptimiseFaceOrder( pSubMesh );
+	OptimiseOverdraw( pSubMesh );
+	OptimiseVertexOrder( pSubMesh );
+}
+
+
+} // namespace gen
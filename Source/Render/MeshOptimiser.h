@@ -0,0 +1,46 @@
+/*******************************************
+	MeshOptimiser.h
+
+	Reorders the faces and vertices of a
+	sub-mesh for faster rendering
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+// Size of the post-transform vertex cache assumed when measuring a mesh. GPUs of the D3D10 era
+// behave roughly as a FIFO of this many vertices
+const TUInt32 kVertexCacheSize = 16;
+
+
+// Average cache miss ratio (ACMR) of a sub-mesh: the number of vertices transformed per
+// triangle drawn, simulating a FIFO post-transform cache of the given size. Ranges from 3.0 (no
+// vertex reuse) down towards 0.5 for large regular grids
+TFloat32 AverageCacheMissRatio( const SSubMesh& subMesh, TUInt32 cacheSize = kVertexCacheSize );
+
+
+// Reorder the faces of a sub-mesh so vertices are reused while still in the post-transform
+// cache. Uses Tom Forsyth's linear-speed algorithm, which does not depend on the exact cache
+// size or replacement policy of the hardware
+void OptimiseFaceOrder( SSubMesh* pSubMesh );
+
+// Reorder clusters of faces so outward facing parts of the mesh are drawn first, reducing
+// overdraw from the mesh on itself. Must follow OptimiseFaceOrder - faces are only moved as
+// clusters that start with an empty cache, so vertex reuse is mostly kept. The new order is
+// discarded if the ACMR grows by more than the given factor
+void OptimiseOverdraw( SSubMesh* pSubMesh, TFloat32 maxCacheMissGrowth = 1.05f );
+
+// Reorder the vertices of a sub-mesh into the order faces first use them, so vertex fetches
+// move forward through memory. Faces are updated to match. Call after reordering faces
+void OptimiseVertexOrder( SSubMesh* pSubMesh );
+
+// Run all the above on a sub-mesh
+void OptimiseSubMesh( SSubMesh* pSubMesh );
+
+
+} // namespace gen
@@ -0,0 +1,351 @@
+/*******************************************
+	MeshSimplifier.cpp
+
+	Reduces the number of faces in a sub-mesh
+	for lower levels of detail
+********************************************/
+
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include "MeshSimplifier.h"
+#include "CVector3.h"
+
+namespace gen
+{
+
+// Weight of the planes added along open borders of the mesh, which hold its outline in place
+const double kBorderWeight = 10.0;
+
+// A collapse is rejected if it turns any remaining face by more than about 80 degrees (cosine)
+const TFloat32 kMinFaceTurnCos = 0.2f;
+
+const TUInt32 kNoVertex = 0xffffffff;
+
+
+// Error quadric - a symmetric 4x4 matrix giving the sum of squared distances from a point to a
+// set of planes. Adding quadrics combines their plane sets
+struct SQuadric
+{
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+};
+
+// Add a plane through the given point with the given unit normal to a quadric
+static void AddPlane( SQuadric* pQuadric, const CVector3& normal, const CVector3& point, double weight )
+{
+	double a = normal.x, b = normal.y, c = normal.z;
+	double d = -(a * point.x + b * point.y + c * point.z);
+	pQuadric->a2 += weight * a * a;  pQuadric->ab += weight * a * b;  pQuadric->ac += weight * a * c;
+	pQuadric->ad += weight * a * d;  pQuadric->b2 += weight * b * b;  pQuadric->bc += weight * b * c;
+	pQuadric->bd += weight * b * d;  pQuadric->c2 += weight * c * c;  pQuadric->cd += weight * c * d;
+	pQuadric->d2 += weight * d * d;
+}
+
+// Add one quadric to another
+static void AddQuadric( SQuadric* pQuadric, const SQuadric& quadric )
+{
+	pQuadric->a2 += quadric.a2;  pQuadric->ab += quadric.ab;  pQuadric->ac += quadric.ac;
+	pQuadric->ad += quadric.ad;  pQuadric->b2 += quadric.b2;  pQuadric->bc += quadric.bc;
+	pQuadric->bd += quadric.bd;  pQuadric->c2 += quadric.c2;  pQuadric->cd += quadric.cd;
+	pQuadric->d2 += quadric.d2;
+}
+
+// Sum of squared distances from a point to the planes of two quadrics
+static double QuadricError( const SQuadric& q1, const SQuadric& q2, const CVector3& point )
+{
+	double x = point.x, y = point.y, z = point.z;
+	double error = (q1.a2 + q2.a2) * x * x + (q1.b2 + q2.b2) * y * y + (q1.c2 + q2.c2) * z * z +
+	               2.0 * ((q1.ab + q2.ab) * x * y + (q1.ac + q2.ac) * x * z + (q1.bc + q2.bc) * y * z +
+	                      (q1.ad + q2.ad) * x + (q1.bd + q2.bd) * y + (q1.cd + q2.cd) * z) +
+	               q1.d2 + q2.d2;
+	return error > 0.0 ? error : 0.0; // Rounding can take it just below zero
+}
+
+// Get the coordinate of a sub-mesh vertex - assumed to be its first three floats (see
+// CMesh::PreProcess)
+static CVector3 VertexCoord( const SSubMesh& subMesh, TUInt32 vertex )
+{
+	const TFloat32* pCoord = reinterpret_cast<const TFloat32*>(subMesh.vertices + vertex * subMesh.vertexSize);
+	return CVector3( pCoord[0], pCoord[1], pCoord[2] );
+}
+
+
+// Simplify a sub-mesh by quadric error edge collapse. Works in passes: each pass finds the cost
+// of collapsing along every edge, then makes the cheapest collapses in order, each vertex taking
+// part in at most one. Faces are rebuilt between passes
+void SimplifySubMesh( const SSubMesh& subMesh, TUInt32 targetFaces, TFloat32 maxError,
+                      TMeshFaces* pFaces )
+{
+	TUInt32 numVertices = subMesh.numVertices;
+	pFaces->assign( subMesh.faces, subMesh.faces + subMesh.numFaces );
+	if (pFaces->size() <= targetFaces)
+	{
+		return;
+	}
+
+	// Vertices at the same position (split for different normals or UVs) form a group, named by
+	// its first vertex in position order. Collapses move whole groups
+	vector<CVector3> positions( numVertices );
+	vector<TUInt32> order( numVertices );
+	for (TUInt32 vertex = 0; vertex < numVertices; ++vertex)
+	{
+		positions[vertex] = VertexCoord( subMesh, vertex );
+		order[vertex] = vertex;
+	}
+	sort( order.begin(), order.end(), [&]( TUInt32 a, TUInt32 b )
+	{
+		const CVector3& pa = positions[a];
+		const CVector3& pb = positions[b];
+		return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+	});
+	vector<TUInt32> groups( numVertices );
+	for (TUInt32 i = 0; i < numVertices; ++i)
+	{
+		const CVector3& position = positions[order[i]];
+		const CVector3& previous = positions[order[i > 0 ? i - 1 : 0]];
+		bool samePosition = i > 0 && position.x == previous.x && position.y == previous.y && position.z == previous.z;
+		groups[order[i]] = samePosition ? groups[order[i - 1]] : order[i];
+	}
+
+	// Quadric of each group from the planes of its faces. Edges used by only one face are on an
+	// open border, add a plane at right angles to the face through them to hold the border in
+	// place. Edges are found by sorting (group, group) keys
+	SQuadric zeroQuadric = {};
+	vector<SQuadric> quadrics( numVertices, zeroQuadric );
+	vector<CVector3> faceNormals( pFaces->size() );
+	vector< pair<TUInt64, TUInt32> > edges;
+	edges.reserve( pFaces->size() * 3 );
+	for (TUInt32 face = 0; face < pFaces->size(); ++face)
+	{
+		const SMeshFace& meshFace = (*pFaces)[face];
+		const CVector3& p0 = positions[meshFace.aiVertex[0]];
+		CVector3 normal = Cross( positions[meshFace.aiVertex[1]] - p0, positions[meshFace.aiVertex[2]] - p0 );
+		if (!normal.IsZero())
+		{
+			normal.Normalise();
+		}
+		faceNormals[face] = normal;
+		for (TUInt32 corner = 0; corner < 3; ++corner)
+		{
+			AddPlane( &quadrics[groups[meshFace.aiVertex[corner]]], normal, p0, 1.0 );
+
+			TUInt32 group1 = groups[meshFace.aiVertex[corner]];
+			TUInt32 group2 = groups[meshFace.aiVertex[(corner + 1) % 3]];
+			TUInt64 key = group1 < group2 ? (static_cast<TUInt64>(group1) << 32) | group2
+			                              : (static_cast<TUInt64>(group2) << 32) | group1;
+			edges.push_back( make_pair( key, face * 3 + corner ) );
+		}
+	}
+	sort( edges.begin(), edges.end() );
+	for (TUInt32 edge = 0; edge < edges.size(); ++edge)
+	{
+		bool shared = (edge > 0 && edges[edge - 1].first == edges[edge].first) ||
+		              (edge + 1 < edges.size() && edges[edge + 1].first == edges[edge].first);
+		if (!shared)
+		{
+			TUInt32 face = edges[edge].second / 3;
+			TUInt32 corner = edges[edge].second % 3;
+			TUInt32 vertex1 = (*pFaces)[face].aiVertex[corner];
+			TUInt32 vertex2 = (*pFaces)[face].aiVertex[(corner + 1) % 3];
+			CVector3 borderNormal = Cross( positions[vertex2] - positions[vertex1], faceNormals[face] );
+			if (!borderNormal.IsZero())
+			{
+				borderNormal.Normalise();
+				AddPlane( &quadrics[groups[vertex1]], borderNormal, positions[vertex1], kBorderWeight );
+				AddPlane( &quadrics[groups[vertex2]], borderNormal, positions[vertex1], kBorderWeight );
+			}
+		}
+	}
+
+	struct SCollapse
+	{
+		TUInt32 from, to; // Groups
+		double  error;
+	};
+	vector<SCollapse> collapses;
+	vector<TUInt32> firstGroupFace( numVertices + 1 ), groupFaces;
+	vector<TUInt32> remap( numVertices );
+	vector<bool> locked( numVertices );
+	vector< pair<TUInt32, TUInt32> > moves; // Vertex of the collapsing group and where it moves to
+	double maxQuadricError = static_cast<double>(maxError) * maxError;
+	TUInt32 numFaces = static_cast<TUInt32>(pFaces->size());
+	while (numFaces > targetFaces)
+	{
+		// Error of collapsing each group onto each of its neighbours
+		collapses.clear();
+		for (TUInt32 face = 0; face < numFaces; ++face)
+		{
+			for (TUInt32 corner = 0; corner < 3; ++corner)
+			{
+				TUInt32 group1 = groups[(*pFaces)[face].aiVertex[corner]];
+				TUInt32 group2 = groups[(*pFaces)[face].aiVertex[(corner + 1) % 3]];
+				double error1 = QuadricError( quadrics[group1], quadrics[group2], positions[group2] );
+				if (error1 <= maxQuadricError)
+				{
+					SCollapse collapse = { group1, group2, error1 };
+					collapses.push_back( collapse );
+				}
+				double error2 = QuadricError( quadrics[group1], quadrics[group2], positions[group1] );
+				if (error2 <= maxQuadricError)
+				{
+					SCollapse collapse = { group2, group1, error2 };
+					collapses.push_back( collapse );
+				}
+			}
+		}
+		if (collapses.empty())
+		{
+			break;
+		}
+		sort( collapses.begin(), collapses.end(),
+		      []( const SCollapse& a, const SCollapse& b ) { return a.error < b.error; } );
+
+		// List the faces around each group
+		fill( firstGroupFace.begin(), firstGroupFace.end(), 0 );
+		for (TUInt32 face = 0; face < numFaces; ++face)
+		{
+			for (TUInt32 corner = 0; corner < 3; ++corner)
+			{
+				++firstGroupFace[groups[(*pFaces)[face].aiVertex[corner]] + 1];
+			}
+		}
+		for (TUInt32 group = 0; group < numVertices; ++group)
+		{
+			firstGroupFace[group + 1] += firstGroupFace[group];
+		}
+		groupFaces.resize( numFaces * 3 );
+		for (TUInt32 face = 0; face < numFaces; ++face)
+		{
+			for (TUInt32 corner = 0; corner < 3; ++corner)
+			{
+				groupFaces[firstGroupFace[groups[(*pFaces)[face].aiVertex[corner]]]++] = face;
+			}
+		}
+		for (TUInt32 group = numVertices; group > 0; --group)
+		{
+			firstGroupFace[group] = firstGroupFace[group - 1];
+		}
+		firstGroupFace[0] = 0;
+
+		for (TUInt32 vertex = 0; vertex < numVertices; ++vertex)
+		{
+			remap[vertex] = vertex;
+		}
+		fill( locked.begin(), locked.end(), false );
+		TUInt32 numCollapses = 0;
+		for (TUInt32 collapse = 0; collapse < collapses.size() && numFaces > targetFaces; ++collapse)
+		{
+			TUInt32 from = collapses[collapse].from;
+			TUInt32 to = collapses[collapse].to;
+			if (locked[from] || locked[to])
+			{
+				continue;
+			}
+
+			// Check the faces around the group, using the current positions of their vertices
+			// (neighbours may already have moved in this pass). Every vertex in the group must
+			// share an edge with a vertex in the target group to move onto, and the faces that
+			// remain must not flip over
+			moves.clear();
+			bool valid = true;
+			TUInt32 removedFaces = 0;
+			for (TUInt32 groupFace = firstGroupFace[from]; valid && groupFace < firstGroupFace[from + 1]; ++groupFace)
+			{
+				const SMeshFace& meshFace = (*pFaces)[groupFaces[groupFace]];
+				TUInt32 vertices[3] = { remap[meshFace.aiVertex[0]], remap[meshFace.aiVertex[1]], remap[meshFace.aiVertex[2]] };
+				TUInt32 faceGroups[3] = { groups[vertices[0]], groups[vertices[1]], groups[vertices[2]] };
+				if (faceGroups[0] == faceGroups[1] || faceGroups[1] == faceGroups[2] || faceGroups[2] == faceGroups[0])
+				{
+					continue; // Already collapsed in this pass
+				}
+				TUInt32 fromCorner = faceGroups[0] == from ? 0 : (faceGroups[1] == from ? 1 : 2);
+				TUInt32 vertex = vertices[fromCorner];
+				TUInt32 toCorner = faceGroups[0] == to ? 0 : (faceGroups[1] == to ? 1 : (faceGroups[2] == to ? 2 : 3));
+				if (toCorner < 3)
+				{
+					// Face is on the collapsing edge and will be removed
+					moves.push_back( make_pair( vertex, vertices[toCorner] ) );
+					++removedFaces;
+				}
+				else
+				{
+					const CVector3& p0 = positions[vertices[0]];
+					const CVector3& p1 = positions[vertices[1]];
+					const CVector3& p2 = positions[vertices[2]];
+					CVector3 oldNormal = Cross( p1 - p0, p2 - p0 );
+					CVector3 moved[3] = { p0, p1, p2 };
+					moved[fromCorner] = positions[to];
+					CVector3 newNormal = Cross( moved[1] - moved[0], moved[2] - moved[0] );
+					if (Dot( oldNormal, newNormal ) < kMinFaceTurnCos * oldNormal.Length() * newNormal.Length())
+					{
+						valid = false;
+					}
+					moves.push_back( make_pair( vertex, kNoVertex ) );
+				}
+			}
+			if (!valid || removedFaces == 0)
+			{
+				continue;
+			}
+
+			// Pick the target of each vertex in the group, every vertex must have one
+			for (TUInt32 move = 0; valid && move < moves.size(); ++move)
+			{
+				if (moves[move].second == kNoVertex)
+				{
+					valid = false;
+					for (TUInt32 target = 0; target < moves.size(); ++target)
+					{
+						if (moves[target].first == moves[move].first && moves[target].second != kNoVertex)
+						{
+							moves[move].second = moves[target].second;
+							valid = true;
+							break;
+						}
+					}
+				}
+			}
+			if (!valid)
+			{
+				continue;
+			}
+
+			for (TUInt32 move = 0; move < moves.size(); ++move)
+			{
+				remap[moves[move].first] = moves[move].second;
+			}
+			AddQuadric( &quadrics[to], quadrics[from] );
+			locked[from] = locked[to] = true;
+			numFaces -= removedFaces;
+			++numCollapses;
+		}
+		if (numCollapses == 0)
+		{
+			break;
+		}
+
+		// Rebuild the faces with the moved vertices, dropping those that have collapsed
+		TUInt32 newFace = 0;
+		for (TUInt32 face = 0; face < pFaces->size(); ++face)
+		{
+			SMeshFace meshFace = (*pFaces)[face];
+			for (TUInt32 corner = 0; corner < 3; ++corner)
+			{
+				meshFace.aiVertex[corner] = remap[meshFace.aiVertex[corner]];
+			}
+			TUInt32 group0 = groups[meshFace.aiVertex[0]];
+			TUInt32 group1 = groups[meshFace.aiVertex[1]];
+			TUInt32 group2 = groups[meshFace.aiVertex[2]];
+			if (group0 != group1 && group1 != group2 && group2 != group0)
+			{
+				(*pFaces)[newFace++] = meshFace;
+			}
+		}
+		pFaces->resize( newFace );
+		numFaces = newFace;
+	}
+}
+
+
+} // namespace gen
@@ -0,0 +1,27 @@
+/*******************************************
+	MeshSimplifier.h
+
+	Reduces the number of faces in a sub-mesh
+	for lower levels of detail
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+// Simplify a sub-mesh by quadric error edge collapse (Garland & Heckbert, "Surface
+// Simplification Using Quadric Error Metrics"). Vertices are only collapsed onto other existing
+// vertices, so the new faces index the sub-mesh's own vertices and can share its vertex buffer.
+// Vertices split at normal or UV seams are moved together, along the seam, so no cracks open up.
+// Stops when there are no more than targetFaces faces, or when every remaining collapse would
+// move the surface by more than maxError (in mesh units). The sub-mesh itself is not changed,
+// the simplified faces are returned in pFaces
+void SimplifySubMesh( const SSubMesh& subMesh, TUInt32 targetFaces, TFloat32 maxError,
+                      TMeshFaces* pFaces );
+
+
+} // namespace gen
@@ -0,0 +1,152 @@
+/*******************************************
+	TextBatcher.cpp
+
+	Collects on-screen text for a frame and
+	draws it all in one sprite batch
+********************************************/
+
+#include <string.h>
+#include "TextBatcher.h"
+
+namespace gen
+{
+
+// Constructor sets the number of characters and strings to reserve in the arena each frame
+CTextBatcher::CTextBatcher( CFrameArena& arena, TUInt32 maxCharacters /*= kDefaultMaxCharacters*/,
+                            TUInt32 maxTexts /*= kDefaultMaxTexts*/ )
+	: m_Characters( arena ), m_Texts( CFrameAllocator<SText>( arena ) )
+{
+	m_pArena = &arena;
+	m_MaxCharacters = maxCharacters;
+	m_MaxTexts = maxTexts;
+	m_TextStart = 0;
+}
+
+
+/////////////////////////////////////
+// Formatting text
+
+// Start formatting a new piece of text
+void CTextBatcher::BeginText()
+{
+	ReserveFrame();
+	m_TextStart = static_cast<TUInt32>(m_Characters.size());
+}
+
+// Add to the text being formatted
+void CTextBatcher::Append( const char* text, TUInt32 length )
+{
+	m_Characters.append( text, length );
+}
+
+void CTextBatcher::Append( const char* text )
+{
+	Append( text, static_cast<TUInt32>(strlen( text )) );
+}
+
+void CTextBatcher::AppendInt( TInt32 value )
+{
+	AppendFormat( &m_Characters, "%d", value );
+}
+
+void CTextBatcher::AppendFloat( TFloat32 value, TUInt32 decimals )
+{
+	AppendFormat( &m_Characters, "%.*f", static_cast<int>(decimals), value );
+}
+
+// Finish the text being formatted and place it at the given pixel position
+void CTextBatcher::EndText( int x, int y, const SColourRGBA& colour, bool centre /*= false*/,
+                            bool shadow /*= false*/ )
+{
+	AddTextEntry( m_TextStart, x, y, colour, centre, shadow );
+}
+
+
+// Add text that is already formatted
+void CTextBatcher::AddText( const char* text, TUInt32 length, int x, int y, const SColourRGBA& colour,
+                            bool centre /*= false*/, bool shadow /*= false*/ )
+{
+	ReserveFrame();
+	TUInt32 start = static_cast<TUInt32>(m_Characters.size());
+	Append( text, length );
+	AddTextEntry( start, x, y, colour, centre, shadow );
+}
+
+// Take this frame's buffers from the arena if the frame has no text yet. Done when text is first
+// added rather than after drawing, as the arena is reset in between
+void CTextBatcher::ReserveFrame()
+{
+	if (m_Texts.capacity() == 0)
+	{
+		m_Characters.reserve( m_MaxCharacters );
+		m_Texts.reserve( m_MaxTexts );
+	}
+}
+
+// Place the characters from start to the end of the buffer as a string
+void CTextBatcher::AddTextEntry( TUInt32 start, int x, int y, const SColourRGBA& colour, bool centre, bool shadow )
+{
+	SText text;
+	text.start = start;
+	text.length = static_cast<TUInt32>(m_Characters.size()) - start;
+	text.centre = centre;
+	if (shadow)
+	{
+		// Shadow first so it is drawn underneath
+		text.x = x + kShadowOffset;
+		text.y = y + kShadowOffset;
+		text.colour = SColourRGBA( 0.0f, 0.0f, 0.0f, 1.0f );
+		m_Texts.push_back( text );
+	}
+	text.x = x;
+	text.y = y;
+	text.colour = colour;
+	text.colour.a = 1.0f;
+	m_Texts.push_back( text );
+	m_TextStart = static_cast<TUInt32>(m_Characters.size());
+}
+
+
+/////////////////////////////////////
+// Drawing
+
+// Draw all the text added since the last call in one sprite batch, then clear it
+void CTextBatcher::Draw( ID3DX10Font* pFont, ID3DX10Sprite* pSprite )
+{
+	if (!m_Texts.empty())
+	{
+		// Drawn in the order added (no sorting) so shadows stay underneath their text
+		pSprite->Begin( D3DX10_SPRITE_SAVE_STATE );
+		for (TUInt32 entry = 0; entry < m_Texts.size(); ++entry)
+		{
+			const SText& text = m_Texts[entry];
+			if (text.length == 0)
+			{
+				continue;
+			}
+			RECT rect;
+			UINT format = DT_NOCLIP;
+			if (!text.centre)
+			{
+				SetRect( &rect, text.x, text.y, 0, 0 );
+			}
+			else
+			{
+				SetRect( &rect, text.x - 100, text.y, text.x + 100, 0 );
+				format |= DT_CENTER;
+			}
+			pFont->DrawText( pSprite, &m_Characters[text.start], static_cast<int>(text.length), &rect, format,
+			                 ToD3DXCOLOR( text.colour ) );
+		}
+		pSprite->End();
+	}
+
+	// The buffers' memory is released when the arena is reset, so the next frame starts with new
+	// empty ones that have taken nothing from it
+	TFrameString( *m_pArena ).swap( m_Characters );
+	TFrameVector<SText>( CFrameAllocator<SText>( *m_pArena ) ).swap( m_Texts );
+	m_TextStart = 0;
+}
+
+
+} // namespace gen
@@ -0,0 +1,143 @@
+/*******************************************
+	TextBatcher.h
+
+	Collects on-screen text for a frame and
+	draws it all in one sprite batch
+********************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <d3dx10.h>
+#include "Defines.h"
+#include "Colour.h"
+#include "FrameArena.h"
+
+namespace gen
+{
+
+// Collects the text drawn each frame and draws it with a single sprite batch, rather than each
+// string being a separate D3DX draw. Text is formatted straight into a buffer with the Append
+// functions (no iostreams or temporary strings), e.g.
+//     TextBatcher.BeginText();
+//     TextBatcher.Append( "FPS: " );
+//     TextBatcher.AppendFloat( fps, 1 );
+//     TextBatcher.EndText( 0, 0, SColourRGBA( 1.0f, 1.0f, 0.0f ), false, true );
+// Text already formatted elsewhere (e.g. cached labels) can be added directly with AddText.
+// The buffers are taken from a frame arena when the first text of a frame is added, so adding
+// text makes no heap allocations. All text must be added and drawn before the arena is reset
+class CTextBatcher
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor sets the number of characters and strings to reserve in the arena each frame
+	CTextBatcher( CFrameArena& arena, TUInt32 maxCharacters = kDefaultMaxCharacters,
+	              TUInt32 maxTexts = kDefaultMaxTexts );
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CTextBatcher( const CTextBatcher& );
+	CTextBatcher& operator=( const CTextBatcher& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+	// Default space reserved each frame, enough for a thousand tank labels
+	static const TUInt32 kDefaultMaxCharacters = 64 * 1024;
+	static const TUInt32 kDefaultMaxTexts = 1024;
+
+	// Offset of the shadow drawn under text, in pixels
+	static const int kShadowOffset = 2;
+
+
+	/////////////////////////////////////
+	// Formatting text
+
+	// Start formatting a new piece of text
+	void BeginText();
+
+	// Add to the text being formatted
+	void Append( const char* text, TUInt32 length );
+	void Append( const char* text );
+	void Append( const string& text )
+	{
+		Append( text.c_str(), static_cast<TUInt32>(text.length()) );
+	}
+	void AppendInt( TInt32 value );
+	void AppendFloat( TFloat32 value, TUInt32 decimals );
+
+	// The text being formatted, for functions that append to a frame string themselves (e.g.
+	// CProfiler::Breakdown). Only valid between BeginText and EndText
+	TFrameString* Text()
+	{
+		return &m_Characters;
+	}
+
+	// Finish the text being formatted and place it at the given pixel position, horizontally
+	// centred on it if required. A shadow draws the text a second time in black underneath
+	void EndText( int x, int y, const SColourRGBA& colour, bool centre = false, bool shadow = false );
+
+
+	// Add text that is already formatted, the text is copied so need not outlive the call
+	void AddText( const char* text, TUInt32 length, int x, int y, const SColourRGBA& colour, bool centre = false,
+	              bool shadow = false );
+
+
+	/////////////////////////////////////
+	// Drawing
+
+	// Draw all the text added since the last call in one sprite batch, then clear it. Call each
+	// frame before the arena is reset
+	void Draw( ID3DX10Font* pFont, ID3DX10Sprite* pSprite );
+
+	// Number of characters and strings waiting to be drawn
+	TUInt32 NumCharacters() const
+	{
+		return static_cast<TUInt32>(m_Characters.size());
+	}
+	TUInt32 NumTexts() const
+	{
+		return static_cast<TUInt32>(m_Texts.size());
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	// A string to draw, the text itself is in m_Characters. Shadows share the text of the string
+	// they are under
+	struct SText
+	{
+		TUInt32     start;
+		TUInt32     length;
+		int         x;
+		int         y;
+		SColourRGBA colour;
+		bool        centre;
+	};
+
+	// Take this frame's buffers from the arena if the frame has no text yet
+	void ReserveFrame();
+
+	// Place the characters from start to the end of the buffer as a string
+	void AddTextEntry( TUInt32 start, int x, int y, const SColourRGBA& colour, bool centre, bool shadow );
+
+	CFrameArena* m_pArena;
+	TUInt32      m_MaxCharacters;
+	TUInt32      m_MaxTexts;
+
+	TFrameString        m_Characters;
+	TFrameVector<SText> m_Texts;
+	TUInt32             m_TextStart; // Start of the text being formatted
+};
+
+
+} // namespace gen
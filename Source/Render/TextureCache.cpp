@@ -0,0 +1,260 @@
+/*******************************************
+	TextureCache.cpp
+
+	Shared textures loaded once per file
+********************************************/
+
+#include <vector>
+#include <d3dx10.h>
+#include "TextureCache.h"
+#include "MemoryTracker.h"
+
+namespace gen
+{
+
+// Get reference to global variables from another source file
+extern ID3D10Device* g_pd3dDevice;
+
+// Folder for all texture and mesh files
+extern const string MediaFolder;
+
+
+// Constructor creates an empty cache
+CTextureCache::CTextureCache()
+{
+	m_MemoryBytes = 0;
+	m_NumReferences = 0;
+	m_NumLoads = 0;
+	m_NumHits = 0;
+}
+
+// Destructor releases any textures still held
+CTextureCache::~CTextureCache()
+{
+	for (map<ID3D10ShaderResourceView*, SEntry>::iterator entry = m_Textures.begin(); entry != m_Textures.end(); ++entry)
+	{
+		entry->first->Release();
+	}
+}
+
+
+// Canonical form of a texture file name (relative to the media folder) used as the key. Full
+// path in lower case with backslashes, without "." or ".." parts
+string CTextureCache::CanonicalPath( const string& fileName )
+{
+	string fullFileName = MediaFolder + fileName;
+
+	vector<string> parts;
+	string part;
+	for (TUInt32 c = 0; c <= fullFileName.length(); ++c)
+	{
+		char ch = (c < fullFileName.length()) ? fullFileName[c] : '\\';
+		if (ch == '\\' || ch == '/')
+		{
+			if (part == "..")
+			{
+				if (!parts.empty() && parts.back() != "..")
+				{
+					parts.pop_back();
+				}
+				else
+				{
+					parts.push_back( part );
+				}
+			}
+			else if (!part.empty() && part != ".")
+			{
+				parts.push_back( part );
+			}
+			part.clear();
+		}
+		else
+		{
+			part += static_cast<char>(tolower( static_cast<unsigned char>(ch) ));
+		}
+	}
+
+	string path;
+	for (TUInt32 p = 0; p < parts.size(); ++p)
+	{
+		if (p > 0) path += '\\';
+		path += parts[p];
+	}
+	return path;
+}
+
+
+// Get a reference to the texture in the given file (relative to the media folder), loading it
+// if it is not already held. Returns 0 if the file cannot be loaded. Release when finished
+ID3D10ShaderResourceView* CTextureCache::Acquire( const string& fileName )
+{
+	CMemoryScope memory( Mem_Textures );
+	string path = CanonicalPath( fileName );
+
+	lock_guard<mutex> lock( m_Mutex );
+	map<string, ID3D10ShaderResourceView*>::iterator found = m_Paths.find( path );
+	if (found != m_Paths.end())
+	{
+		++m_Textures[found->second].references;
+		++m_NumReferences;
+		++m_NumHits;
+		return found->second;
+	}
+
+	ID3D10ShaderResourceView* texture;
+	if (FAILED( D3DX10CreateShaderResourceViewFromFile( g_pd3dDevice, path.c_str(), NULL, NULL, &texture, NULL ) ))
+	{
+		return 0;
+	}
+	AddEntry( path, texture );
+	return texture;
+}
+
+// Add a texture created elsewhere for the given file, taking over the caller's reference to
+// it. If the file is already held the given texture is released and the cached one used
+// instead. Returns the texture now held for the file, release when finished
+ID3D10ShaderResourceView* CTextureCache::Insert( const string& fileName, ID3D10ShaderResourceView* texture )
+{
+	CMemoryScope memory( Mem_Textures );
+	string path = CanonicalPath( fileName );
+
+	lock_guard<mutex> lock( m_Mutex );
+	map<string, ID3D10ShaderResourceView*>::iterator found = m_Paths.find( path );
+	if (found != m_Paths.end())
+	{
+		texture->Release();
+		++m_Textures[found->second].references;
+		++m_NumReferences;
+		++m_NumHits;
+		return found->second;
+	}
+
+	AddEntry( path, texture );
+	return texture;
+}
+
+// Release a reference returned by Acquire or Insert, the texture is freed with the last one
+void CTextureCache::Release( ID3D10ShaderResourceView* texture )
+{
+	lock_guard<mutex> lock( m_Mutex );
+	map<ID3D10ShaderResourceView*, SEntry>::iterator entry = m_Textures.find( texture );
+	if (entry == m_Textures.end())
+	{
+		return; // Not from this cache
+	}
+
+	--m_NumReferences;
+	if (--entry->second.references == 0)
+	{
+		m_MemoryBytes -= entry->second.memoryBytes;
+		m_Paths.erase( entry->second.path );
+		m_Textures.erase( entry );
+		texture->Release();
+	}
+}
+
+// Is the texture for the given file currently held
+bool CTextureCache::Contains( const string& fileName ) const
+{
+	string path = CanonicalPath( fileName );
+
+	lock_guard<mutex> lock( m_Mutex );
+	return m_Paths.find( path ) != m_Paths.end();
+}
+
+// Get statistics for the textures held
+STextureCacheStats CTextureCache::GetStats() const
+{
+	lock_guard<mutex> lock( m_Mutex );
+	STextureCacheStats stats;
+	stats.numTextures = static_cast<TUInt32>(m_Textures.size());
+	stats.numReferences = m_NumReferences;
+	stats.memoryBytes = m_MemoryBytes;
+	stats.numLoads = m_NumLoads;
+	stats.numHits = m_NumHits;
+	return stats;
+}
+
+
+// Estimate the video memory used by a texture - only 2D textures (including cube maps) are
+// counted, drivers may pad or compress differently
+TUInt64 CTextureCache::TextureMemory( ID3D10ShaderResourceView* texture )
+{
+	ID3D10Resource* resource;
+	texture->GetResource( &resource );
+	D3D10_RESOURCE_DIMENSION type;
+	resource->GetType( &type );
+	if (type != D3D10_RESOURCE_DIMENSION_TEXTURE2D)
+	{
+		resource->Release();
+		return 0;
+	}
+	D3D10_TEXTURE2D_DESC desc;
+	static_cast<ID3D10Texture2D*>(resource)->GetDesc( &desc );
+	resource->Release();
+
+	// Block compressed formats use a fixed number of bytes per 4x4 block, others a number of
+	// bytes per texel (common formats only, others assumed to be 32-bit)
+	TUInt32 blockBytes = 0;
+	TUInt32 texelBytes = 4;
+	switch (desc.Format)
+	{
+		case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+			blockBytes = 8;
+			break;
+		case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+			blockBytes = 16;
+			break;
+		case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_A8_UNORM:
+			texelBytes = 1;
+			break;
+		case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_B5G6R5_UNORM: case DXGI_FORMAT_B5G5R5A1_UNORM:
+		case DXGI_FORMAT_R16_FLOAT:
+			texelBytes = 2;
+			break;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R32G32_FLOAT:
+			texelBytes = 8;
+			break;
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			texelBytes = 16;
+			break;
+	}
+
+	TUInt64 bytes = 0;
+	TUInt32 width = desc.Width;
+	TUInt32 height = desc.Height;
+	for (TUInt32 mip = 0; mip < desc.MipLevels; ++mip)
+	{
+		if (blockBytes > 0)
+		{
+			bytes += static_cast<TUInt64>((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+		}
+		else
+		{
+			bytes += static_cast<TUInt64>(width) * height * texelBytes;
+		}
+		if (width > 1) width /= 2;
+		if (height > 1) height /= 2;
+	}
+	return bytes * desc.ArraySize;
+}
+
+// Add a new texture with one reference, with the lock held
+void CTextureCache::AddEntry( const string& path, ID3D10ShaderResourceView* texture )
+{
+	SEntry& entry = m_Textures[texture];
+	entry.path = path;
+	entry.references = 1;
+	entry.memoryBytes = TextureMemory( texture );
+	m_Paths[path] = texture;
+
+	m_MemoryBytes += entry.memoryBytes;
+	++m_NumReferences;
+	++m_NumLoads;
+}
+
+
+} // namespace gen
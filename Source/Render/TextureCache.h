@@ -0,0 +1,109 @@
+/*******************************************
+	TextureCache.h
+
+	Shared textures loaded once per file
+********************************************/
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <mutex>
+using namespace std;
+
+#include <d3d10.h>
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Texture cache statistics
+struct STextureCacheStats
+{
+	TUInt32 numTextures;   // Distinct textures currently held
+	TUInt32 numReferences; // Total references to those textures
+	TUInt64 memoryBytes;   // Estimated video memory used by the textures, including mip-maps
+	TUInt32 numLoads;      // Textures loaded (or inserted) since the cache was created
+	TUInt32 numHits;       // Requests satisfied from the cache since it was created
+};
+
+
+// Holds one shader resource view per texture file, shared by every material that uses it. Files
+// are keyed by canonical path so different spellings of the same file (case, slashes, "..")
+// share one texture. Textures are reference counted and released when no longer used.
+// Safe to call from any thread, although textures can only be loaded on the main thread
+class CTextureCache
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty cache
+	CTextureCache();
+
+	// Destructor releases any textures still held
+	~CTextureCache();
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CTextureCache( const CTextureCache& );
+	CTextureCache& operator=( const CTextureCache& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Canonical form of a texture file name (relative to the media folder) used as the key
+	static string CanonicalPath( const string& fileName );
+
+	// Get a reference to the texture in the given file (relative to the media folder), loading it
+	// if it is not already held. Returns 0 if the file cannot be loaded. Release when finished
+	ID3D10ShaderResourceView* Acquire( const string& fileName );
+
+	// Add a texture created elsewhere for the given file, taking over the caller's reference to
+	// it. If the file is already held the given texture is released and the cached one used
+	// instead. Returns the texture now held for the file, release when finished
+	ID3D10ShaderResourceView* Insert( const string& fileName, ID3D10ShaderResourceView* texture );
+
+	// Release a reference returned by Acquire or Insert, the texture is freed with the last one
+	void Release( ID3D10ShaderResourceView* texture );
+
+	// Is the texture for the given file currently held
+	bool Contains( const string& fileName ) const;
+
+	// Get statistics for the textures held
+	STextureCacheStats GetStats() const;
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	struct SEntry
+	{
+		string                    path;       // Canonical path
+		TUInt32                   references;
+		TUInt64                   memoryBytes;
+	};
+
+	// Estimate the video memory used by a texture
+	static TUInt64 TextureMemory( ID3D10ShaderResourceView* texture );
+
+	// Add a new texture with one reference, with the lock held
+	void AddEntry( const string& path, ID3D10ShaderResourceView* texture );
+
+
+	map<string, ID3D10ShaderResourceView*> m_Paths;    // Canonical path to texture
+	map<ID3D10ShaderResourceView*, SEntry> m_Textures; // Texture to details
+
+	TUInt64       m_MemoryBytes;
+	TUInt32       m_NumReferences;
+	TUInt32       m_NumLoads;
+	TUInt32       m_NumHits;
+
+	mutable mutex m_Mutex;
+};
+
+
+} // namespace gen
@@ -0,0 +1,768 @@
+/*******************************************
+	XFileParser.cpp
+
+	Reads the objects and data in a text or
+	binary DirectX .X file
+********************************************/
+
+#include <string.h>
+#include <math.h>
+#include "XFileParser.h"
+
+namespace gen
+{
+
+// Binary format token identifiers
+enum
+{
+	kBinName = 1, kBinString = 2, kBinInteger = 3, kBinGuid = 5, kBinIntegerList = 6, kBinFloatList = 7,
+	kBinOpenBrace = 10, kBinCloseBrace = 11, kBinComma = 19, kBinSemicolon = 20, kBinTemplate = 31,
+	kBinFirstOther = 12, kBinLastOther = 18, kBinFirstType = 40, kBinLastType = 53,
+};
+
+// Size of the file header, e.g. "xof 0303txt 0032"
+const TUInt32 kHeaderSize = 16;
+
+
+// Read a little-endian WORD / DWORD from unaligned memory
+static TUInt32 ReadWord( const TUInt8* data )
+{
+	return data[0] | (data[1] << 8);
+}
+static TUInt32 ReadDWord( const TUInt8* data )
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<TUInt32>(data[3]) << 24);
+}
+
+// Text format character types
+static bool IsSpace( TUInt8 c )
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+static bool IsDigit( TUInt8 c )
+{
+	return c >= '0' && c <= '9';
+}
+static bool IsDelimiter( TUInt8 c )
+{
+	return IsSpace( c ) || c == '{' || c == '}' || c == ';' || c == ',' || c == '<' || c == '>' ||
+	       c == '"' || c == '[' || c == ']' || c == '(' || c == ')';
+}
+
+// Parse a decimal number (e.g. -1.25e-3) from text, advancing the pointer. Faster than strtod,
+// which is locale dependent and not needed for the precision of a float. Returns false if there
+// is no number
+static bool ParseNumber( const TUInt8*& text, const TUInt8* end, double* pValue )
+{
+	static const double kPowers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const TUInt8* p = text;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+
+	// Keep up to 19 significant digits in an integer, scale by the exponent at the end
+	TUInt64 mantissa = 0;
+	TInt32 exponent = 0;
+	TUInt32 numDigits = 0;
+	bool anyDigits = false;
+	for (; p < end && IsDigit( *p ); ++p, anyDigits = true)
+	{
+		if (numDigits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) ++numDigits; }
+		else ++exponent;
+	}
+	if (p < end && *p == '.')
+	{
+		for (++p; p < end && IsDigit( *p ); ++p, anyDigits = true)
+		{
+			if (numDigits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) ++numDigits; --exponent; }
+		}
+	}
+	if (!anyDigits)
+	{
+		return false;
+	}
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const TUInt8* exponentStart = p++;
+		bool negativeExponent = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negativeExponent = (*p == '-');
+			++p;
+		}
+		if (p < end && IsDigit( *p ))
+		{
+			TInt32 value = 0;
+			for (; p < end && IsDigit( *p ); ++p)
+			{
+				if (value < 10000) value = value * 10 + (*p - '0');
+			}
+			exponent += negativeExponent ? -value : value;
+		}
+		else
+		{
+			p = exponentStart; // Not an exponent after all
+		}
+	}
+
+	double value = static_cast<double>(mantissa);
+	if (exponent != 0 && mantissa != 0)
+	{
+		TInt32 absExponent = exponent < 0 ? -exponent : exponent;
+		double scale = (absExponent <= 22) ? kPowers[absExponent] : pow( 10.0, absExponent );
+		value = (exponent < 0) ? value / scale : value * scale;
+	}
+	*pValue = negative ? -value : value;
+	text = p;
+	return true;
+}
+
+
+// Constructor creates a parser with no file
+CXFileParser::CXFileParser()
+{
+	Close();
+}
+
+
+// Map the given file and read its header
+bool CXFileParser::Open( const string& fileName )
+{
+	Close();
+	if (!m_File.Open( fileName ))
+	{
+		return false;
+	}
+	if (!Open( m_File.Data(), m_File.Size() ))
+	{
+		m_File.Close();
+		return false;
+	}
+	return true;
+}
+
+// Parse an X-file already in memory, which must remain valid while it is parsed
+bool CXFileParser::Open( const TUInt8* data, TUInt32 size )
+{
+	m_Levels.clear();
+	m_NamedObjects.clear();
+	m_Failed = false;
+	m_ListRemaining = 0;
+	m_Data = data;
+	m_Size = size;
+	m_Pos = kHeaderSize;
+
+	// Header: "xof ", version, format ("txt ", "bin ", or compressed "tzip" / "bzip"), float size
+	if (size < kHeaderSize || memcmp( data, "xof ", 4 ) != 0)
+	{
+		return false;
+	}
+	if (memcmp( data + 8, "txt ", 4 ) == 0)
+	{
+		m_Binary = false;
+	}
+	else if (memcmp( data + 8, "bin ", 4 ) == 0)
+	{
+		m_Binary = true;
+	}
+	else
+	{
+		return false; // Compressed files not supported
+	}
+	if (memcmp( data + 12, "0032", 4 ) == 0)
+	{
+		m_DoubleFloats = false;
+	}
+	else if (memcmp( data + 12, "0064", 4 ) == 0)
+	{
+		m_DoubleFloats = true;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+// Close the file
+void CXFileParser::Close()
+{
+	m_File.Close();
+	m_Data = 0;
+	m_Size = 0;
+	m_Pos = 0;
+	m_Binary = false;
+	m_DoubleFloats = false;
+	m_Failed = false;
+	m_Levels.clear();
+	m_ListData = 0;
+	m_ListRemaining = 0;
+	m_ListIsFloat = false;
+	m_NamedObjects.clear();
+}
+
+
+/////////////////////////////////////
+// Objects
+
+// Move to the next child object of the current object, skipping any unread data
+bool CXFileParser::NextObject( string* pTemplateName, string* pName )
+{
+	m_ListRemaining = 0;
+	while (!m_Failed)
+	{
+		TUInt32 tokenPos = m_Pos;
+		SToken token;
+		switch (ReadToken( &token ))
+		{
+		case Token_EndOfFile:
+			if (!m_Levels.empty())
+			{
+				return Fail(); // Unclosed object
+			}
+			return false;
+
+		case Token_CloseBrace:
+			if (m_Levels.empty())
+			{
+				return Fail();
+			}
+			LeaveObject();
+			return false;
+
+		case Token_Name:
+			return ReadObjectHeader( token, tokenPos, kNoReturn, pTemplateName, pName );
+
+		case Token_OpenBrace:
+		{
+			// Reference to a named object: { name } or { name <guid> }
+			SToken nameToken;
+			if (ReadToken( &nameToken ) != Token_Name)
+			{
+				return Fail();
+			}
+			EToken type = ReadToken( &token );
+			if (type == Token_Guid)
+			{
+				type = ReadToken( &token );
+			}
+			map<string, TUInt32>::iterator object =
+				m_NamedObjects.find( string( nameToken.text, nameToken.length ) );
+			if (type != Token_CloseBrace || object == m_NamedObjects.end())
+			{
+				return Fail();
+			}
+
+			// Parse the referenced object where it is, then come back here
+			TUInt32 returnPos = m_Pos;
+			m_Pos = object->second;
+			SToken templateToken;
+			if (ReadToken( &templateToken ) != Token_Name)
+			{
+				return Fail();
+			}
+			return ReadObjectHeader( templateToken, object->second, returnPos, pTemplateName, pName );
+		}
+
+		case Token_Template:
+			if (!m_Levels.empty() || !SkipTemplate())
+			{
+				return Fail();
+			}
+			break;
+
+		case Token_Error:
+		case Token_Other:
+			return Fail();
+
+		default:
+			break; // Unread data
+		}
+	}
+	return false;
+}
+
+// Skip the rest of the current object including its children
+void CXFileParser::SkipObject()
+{
+	m_ListRemaining = 0;
+	TUInt32 depth = 1;
+	while (!m_Failed)
+	{
+		SToken token;
+		switch (ReadToken( &token ))
+		{
+		case Token_OpenBrace:
+			++depth;
+			break;
+
+		case Token_CloseBrace:
+			if (--depth == 0)
+			{
+				LeaveObject();
+				return;
+			}
+			break;
+
+		case Token_EndOfFile:
+		case Token_Error:
+		case Token_Other:
+		case Token_Template:
+			Fail();
+			return;
+
+		default:
+			break;
+		}
+	}
+}
+
+
+// Read the rest of an object header after its template name, up to and including the opening
+// brace. Enters the object
+bool CXFileParser::ReadObjectHeader( const SToken& templateToken, TUInt32 headerPos, TUInt32 returnPos,
+                                     string* pTemplateName, string* pName )
+{
+	pTemplateName->assign( templateToken.text, templateToken.length );
+	pName->clear();
+
+	SToken token;
+	EToken type = ReadToken( &token );
+	if (type == Token_Name)
+	{
+		pName->assign( token.text, token.length );
+		type = ReadToken( &token );
+	}
+	if (type != Token_OpenBrace)
+	{
+		return Fail();
+	}
+
+	// Optional class id follows the brace
+	TUInt32 bodyPos = m_Pos;
+	if (ReadToken( &token ) != Token_Guid)
+	{
+		m_Pos = bodyPos;
+	}
+
+	if (!pName->empty() && returnPos == kNoReturn)
+	{
+		m_NamedObjects[*pName] = headerPos;
+	}
+	SLevel level = { returnPos };
+	m_Levels.push_back( level );
+	return true;
+}
+
+// Leave the current object after its closing brace has been read
+void CXFileParser::LeaveObject()
+{
+	if (m_Levels.back().returnPos != kNoReturn)
+	{
+		m_Pos = m_Levels.back().returnPos;
+	}
+	m_Levels.pop_back();
+	m_ListRemaining = 0;
+}
+
+// Skip a template definition after the template keyword
+bool CXFileParser::SkipTemplate()
+{
+	SToken token;
+	if (ReadToken( &token ) != Token_Name || ReadToken( &token ) != Token_OpenBrace)
+	{
+		return false;
+	}
+	EToken type;
+	while ((type = ReadToken( &token )) != Token_CloseBrace)
+	{
+		if (type == Token_EndOfFile || type == Token_Error || type == Token_OpenBrace)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/////////////////////////////////////
+// Data members of current object
+
+// Read the next value as an unsigned integer
+bool CXFileParser::ReadUInt( TUInt32* pValue )
+{
+	if (m_Failed)
+	{
+		return false;
+	}
+	if (m_Binary)
+	{
+		if (!NextBinaryValue() || m_ListIsFloat)
+		{
+			return Fail();
+		}
+		*pValue = ReadDWord( m_ListData );
+		m_ListData += 4;
+		--m_ListRemaining;
+		return true;
+	}
+
+	if (!SkipToTextValue() || !IsDigit( m_Data[m_Pos] ))
+	{
+		return Fail();
+	}
+	TUInt64 value = 0;
+	const TUInt8* p = m_Data + m_Pos;
+	const TUInt8* end = m_Data + m_Size;
+	for (; p < end && IsDigit( *p ); ++p)
+	{
+		value = value * 10 + (*p - '0');
+		if (value > 0xffffffff)
+		{
+			return Fail();
+		}
+	}
+	m_Pos = static_cast<TUInt32>(p - m_Data);
+	*pValue = static_cast<TUInt32>(value);
+	return true;
+}
+
+// Read the next value as a float
+bool CXFileParser::ReadFloat( TFloat32* pValue )
+{
+	if (m_Failed)
+	{
+		return false;
+	}
+	if (m_Binary)
+	{
+		if (!NextBinaryValue())
+		{
+			return Fail();
+		}
+		if (!m_ListIsFloat)
+		{
+			*pValue = static_cast<TFloat32>(ReadDWord( m_ListData ));
+			m_ListData += 4;
+		}
+		else if (m_DoubleFloats)
+		{
+			double value;
+			memcpy( &value, m_ListData, sizeof(value) );
+			*pValue = static_cast<TFloat32>(value);
+			m_ListData += 8;
+		}
+		else
+		{
+			memcpy( pValue, m_ListData, sizeof(TFloat32) );
+			m_ListData += 4;
+		}
+		--m_ListRemaining;
+		return true;
+	}
+
+	if (!SkipToTextValue())
+	{
+		return Fail();
+	}
+	const TUInt8* p = m_Data + m_Pos;
+	double value;
+	if (!ParseNumber( p, m_Data + m_Size, &value ))
+	{
+		return Fail();
+	}
+	m_Pos = static_cast<TUInt32>(p - m_Data);
+	*pValue = static_cast<TFloat32>(value);
+	return true;
+}
+
+// Read a number of float values
+bool CXFileParser::ReadFloats( TFloat32* pValues, TUInt32 count )
+{
+	// Copy straight from the file where a binary list holds all the values
+	if (m_Binary && !m_Failed && count > 0 && !m_DoubleFloats && NextBinaryValue() && m_ListIsFloat &&
+	    m_ListRemaining >= count)
+	{
+		memcpy( pValues, m_ListData, count * sizeof(TFloat32) );
+		m_ListData += count * sizeof(TFloat32);
+		m_ListRemaining -= count;
+		return true;
+	}
+
+	for (TUInt32 value = 0; value < count; ++value)
+	{
+		if (!ReadFloat( &pValues[value] ))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Read the next value as a string
+bool CXFileParser::ReadString( string* pValue )
+{
+	if (m_Failed)
+	{
+		return false;
+	}
+	if (m_Binary)
+	{
+		if (m_ListRemaining > 0)
+		{
+			return Fail();
+		}
+		SToken token;
+		EToken type;
+		while ((type = ReadToken( &token )) == Token_Separator) {}
+		if (type != Token_String)
+		{
+			return Fail();
+		}
+		pValue->assign( token.text, token.length );
+		return true;
+	}
+
+	if (!SkipToTextValue() || m_Data[m_Pos] != '"')
+	{
+		return Fail();
+	}
+	const TUInt8* start = m_Data + m_Pos + 1;
+	const TUInt8* end = static_cast<const TUInt8*>(memchr( start, '"', m_Size - m_Pos - 1 ));
+	if (!end)
+	{
+		return Fail();
+	}
+	pValue->assign( reinterpret_cast<const char*>(start), end - start );
+	m_Pos = static_cast<TUInt32>(end + 1 - m_Data);
+	return true;
+}
+
+
+/////////////////////////////////////
+// Tokens
+
+// Read the next token, advancing past it
+CXFileParser::EToken CXFileParser::ReadToken( SToken* pToken )
+{
+	pToken->text = 0;
+	pToken->length = 0;
+	pToken->value = 0;
+	pToken->type = m_Binary ? ReadBinaryToken( pToken ) : ReadTextToken( pToken );
+	return pToken->type;
+}
+
+// Read the next token from a text file
+CXFileParser::EToken CXFileParser::ReadTextToken( SToken* pToken )
+{
+	// Skip white space and comments (// or #)
+	while (m_Pos < m_Size)
+	{
+		TUInt8 c = m_Data[m_Pos];
+		if (IsSpace( c ))
+		{
+			++m_Pos;
+		}
+		else if (c == '#' || (c == '/' && m_Pos + 1 < m_Size && m_Data[m_Pos + 1] == '/'))
+		{
+			const void* lineEnd = memchr( m_Data + m_Pos, '\n', m_Size - m_Pos );
+			m_Pos = lineEnd ? static_cast<TUInt32>(static_cast<const TUInt8*>(lineEnd) - m_Data) : m_Size;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if (m_Pos >= m_Size)
+	{
+		return Token_EndOfFile;
+	}
+
+	const char* text = reinterpret_cast<const char*>(m_Data + m_Pos);
+	TUInt8 c = m_Data[m_Pos++];
+	switch (c)
+	{
+	case '{': return Token_OpenBrace;
+	case '}': return Token_CloseBrace;
+	case ';':
+	case ',': return Token_Separator;
+	case '[': case ']': case '(': case ')': return Token_Other;
+
+	case '<':
+	case '"':
+	{
+		// Class id <...> or string "..."
+		TUInt8 terminator = (c == '<') ? '>' : '"';
+		const void* end = memchr( m_Data + m_Pos, terminator, m_Size - m_Pos );
+		if (!end)
+		{
+			return Token_Error;
+		}
+		pToken->text = text + 1;
+		pToken->length = static_cast<TUInt32>(static_cast<const TUInt8*>(end) - (m_Data + m_Pos));
+		m_Pos += pToken->length + 1;
+		return (c == '<') ? Token_Guid : Token_String;
+	}
+
+	default:
+	{
+		// Name or number
+		TUInt32 start = m_Pos - 1;
+		while (m_Pos < m_Size && !IsDelimiter( m_Data[m_Pos] ))
+		{
+			++m_Pos;
+		}
+		pToken->text = text;
+		pToken->length = m_Pos - start;
+		if (IsDigit( c ) || c == '-' || c == '+' || c == '.')
+		{
+			return Token_Number;
+		}
+		if (pToken->length == 8 && memcmp( text, "template", 8 ) == 0)
+		{
+			return Token_Template;
+		}
+		return Token_Name;
+	}
+	}
+}
+
+// Read the next token from a binary file
+CXFileParser::EToken CXFileParser::ReadBinaryToken( SToken* pToken )
+{
+	if (m_Pos >= m_Size)
+	{
+		return Token_EndOfFile;
+	}
+	if (m_Size - m_Pos < 2)
+	{
+		return Token_Error;
+	}
+	TUInt32 id = ReadWord( m_Data + m_Pos );
+	m_Pos += 2;
+	TUInt32 remaining = m_Size - m_Pos;
+
+	switch (id)
+	{
+	case kBinName:
+	case kBinString:
+	case kBinIntegerList:
+	case kBinFloatList:
+	{
+		// Count followed by characters or values
+		if (remaining < 4)
+		{
+			return Token_Error;
+		}
+		TUInt32 count = ReadDWord( m_Data + m_Pos );
+		TUInt32 elementSize = (id == kBinIntegerList) ? 4 : (id == kBinFloatList) ? (m_DoubleFloats ? 8 : 4) : 1;
+		if (count > (remaining - 4) / elementSize)
+		{
+			return Token_Error;
+		}
+		pToken->text = reinterpret_cast<const char*>(m_Data + m_Pos + 4);
+		pToken->length = count * elementSize;
+		pToken->value = count;
+		m_Pos += 4 + pToken->length;
+		return (id == kBinName) ? Token_Name : (id == kBinString) ? Token_String :
+		       (id == kBinIntegerList) ? Token_IntegerList : Token_FloatList;
+	}
+
+	case kBinInteger:
+		if (remaining < 4)
+		{
+			return Token_Error;
+		}
+		pToken->text = reinterpret_cast<const char*>(m_Data + m_Pos);
+		pToken->length = 4;
+		pToken->value = ReadDWord( m_Data + m_Pos );
+		m_Pos += 4;
+		return Token_Integer;
+
+	case kBinGuid:
+		if (remaining < 16)
+		{
+			return Token_Error;
+		}
+		m_Pos += 16;
+		return Token_Guid;
+
+	case kBinOpenBrace:  return Token_OpenBrace;
+	case kBinCloseBrace: return Token_CloseBrace;
+	case kBinComma:
+	case kBinSemicolon:  return Token_Separator;
+	case kBinTemplate:   return Token_Template;
+
+	default:
+		if ((id >= kBinFirstOther && id <= kBinLastOther) || (id >= kBinFirstType && id <= kBinLastType))
+		{
+			return Token_Other;
+		}
+		return Token_Error;
+	}
+}
+
+
+/////////////////////////////////////
+// Support functions
+
+// Move to the start of the next value in a text file, skipping white space, comments and
+// separators. Returns false at the end of the file
+bool CXFileParser::SkipToTextValue()
+{
+	while (m_Pos < m_Size)
+	{
+		TUInt8 c = m_Data[m_Pos];
+		if (IsSpace( c ) || c == ',' || c == ';')
+		{
+			++m_Pos;
+		}
+		else if (c == '#' || (c == '/' && m_Pos + 1 < m_Size && m_Data[m_Pos + 1] == '/'))
+		{
+			const void* lineEnd = memchr( m_Data + m_Pos, '\n', m_Size - m_Pos );
+			m_Pos = lineEnd ? static_cast<TUInt32>(static_cast<const TUInt8*>(lineEnd) - m_Data) : m_Size;
+		}
+		else
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Move to the next binary value, starting a new integer or float list if necessary
+bool CXFileParser::NextBinaryValue()
+{
+	if (m_ListRemaining > 0)
+	{
+		return true;
+	}
+
+	SToken token;
+	EToken type;
+	while ((type = ReadToken( &token )) == Token_Separator) {}
+	if ((type != Token_IntegerList && type != Token_FloatList && type != Token_Integer) ||
+	    (type != Token_Integer && token.value == 0))
+	{
+		return false;
+	}
+	m_ListData = reinterpret_cast<const TUInt8*>(token.text);
+	m_ListRemaining = (type == Token_Integer) ? 1 : token.value;
+	m_ListIsFloat = (type == Token_FloatList);
+	return true;
+}
+
+// Mark the file as malformed, returns false
+bool CXFileParser::Fail()
+{
+	m_Failed = true;
+	m_ListRemaining = 0;
+	return false;
+}
+
+
+} // namespace gen
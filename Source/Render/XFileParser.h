@@ -0,0 +1,204 @@
+/*******************************************
+	XFileParser.h
+
+	Reads the objects and data in a text or
+	binary DirectX .X file
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+using namespace std;
+
+#include "Defines.h"
+#include "MappedFile.h"
+
+namespace gen
+{
+
+// Reads an X-file in place from a memory-mapped file, without the D3DX file API. Works as a
+// cursor over the file: NextObject steps into the next child object of the current object (or
+// the next top-level object), the Read functions read the data members of the current object in
+// order. Text and uncompressed binary files are supported, with 32 or 64-bit floats.
+// Templates are not needed - the caller knows the layout of the objects it reads - and template
+// definitions in the file are skipped. References to named objects (e.g. { Material1 }) are
+// followed, the referenced object is returned from NextObject as if it appeared in place. Only
+// references back to objects earlier in the file are supported, which is how exporters write
+// them. Example:
+//     while (parser.NextObject( &templateName, &name ))
+//         if (templateName == "Mesh") { parser.ReadUInt( &numVertices ); ... }
+//         else parser.SkipObject();
+class CXFileParser
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates a parser with no file
+	CXFileParser();
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CXFileParser( const CXFileParser& );
+	CXFileParser& operator=( const CXFileParser& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Map the given file and read its header. Returns false if the file cannot be opened or is
+	// not a text or uncompressed binary X-file
+	bool Open( const string& fileName );
+
+	// Parse an X-file already in memory, which must remain valid while it is parsed. Returns
+	// false if it is not a text or uncompressed binary X-file
+	bool Open( const TUInt8* data, TUInt32 size );
+
+	// Close the file
+	void Close();
+
+	// Is the file in binary format
+	bool IsBinary() const
+	{
+		return m_Binary;
+	}
+
+	// Has any read failed (the file was malformed), all reads fail once one has
+	bool Failed() const
+	{
+		return m_Failed;
+	}
+
+
+	/////////////////////////////////////
+	// Objects
+
+	// Move to the next child object of the current object, skipping any unread data. Returns the
+	// template name (e.g. "Mesh") and object name (empty if none) of the child, which becomes the
+	// current object. Returns false if the current object ends first, its parent then becomes
+	// the current object again. At the top level returns false at the end of the file
+	bool NextObject( string* pTemplateName, string* pName );
+
+	// Skip the rest of the current object including its children, its parent becomes the
+	// current object again
+	void SkipObject();
+
+
+	/////////////////////////////////////
+	// Data members of current object
+
+	// Read the next value, returns false if there is no value of the right type
+	bool ReadUInt( TUInt32* pValue );
+	bool ReadFloat( TFloat32* pValue );
+	bool ReadString( string* pValue );
+
+	// Read a number of float values
+	bool ReadFloats( TFloat32* pValues, TUInt32 count );
+
+	// Could the rest of the file hold the given number of items, each of several values. Each
+	// value takes at least one byte in either format, so counts read from the file can be checked
+	// before allocating space for them
+	bool CanRead( TUInt32 count, TUInt32 valuesPerItem = 1 ) const
+	{
+		return static_cast<TUInt64>(count) * valuesPerItem <= static_cast<TUInt64>(m_Size - m_Pos) + m_ListRemaining;
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	/////////////////////////////////////
+	// Types
+
+	enum EToken
+	{
+		Token_EndOfFile,
+		Token_Error,
+		Token_Name,
+		Token_String,
+		Token_Number,      // Text format number
+		Token_Integer,     // Binary format values...
+		Token_IntegerList,
+		Token_FloatList,
+		Token_Guid,
+		Token_OpenBrace,
+		Token_CloseBrace,
+		Token_Separator,   // ',' or ';'
+		Token_Template,
+		Token_Other,       // Other template definition syntax
+	};
+
+	// Token read from the file, text points into the file. Binary integers hold their value,
+	// binary lists their number of elements
+	struct SToken
+	{
+		EToken        type;
+		const char*   text;
+		TUInt32       length;
+		TUInt32       value;
+	};
+
+	// Object entered by NextObject
+	struct SLevel
+	{
+		TUInt32 returnPos; // Position after the reference if the object was referenced, else kNoReturn
+	};
+	static const TUInt32 kNoReturn = 0xffffffff;
+
+
+	/////////////////////////////////////
+	// Support functions
+
+	// Read the next token, advancing past it
+	EToken ReadToken( SToken* pToken );
+	EToken ReadTextToken( SToken* pToken );
+	EToken ReadBinaryToken( SToken* pToken );
+
+	// Read the rest of an object header after its template name, up to and including the
+	// opening brace. Enters the object
+	bool ReadObjectHeader( const SToken& templateToken, TUInt32 headerPos, TUInt32 returnPos,
+	                       string* pTemplateName, string* pName );
+
+	// Leave the current object after its closing brace has been read
+	void LeaveObject();
+
+	// Skip a template definition after the template keyword
+	bool SkipTemplate();
+
+	// Move to the start of the next value in a text file, skipping white space, comments and
+	// separators. Returns false at the end of the file
+	bool SkipToTextValue();
+
+	// Move to the next binary value, starting a new integer or float list if necessary
+	bool NextBinaryValue();
+
+	// Mark the file as malformed, returns false
+	bool Fail();
+
+
+	/////////////////////////////////////
+	// Data
+
+	CMappedFile      m_File;
+	const TUInt8*    m_Data;
+	TUInt32          m_Size;
+	TUInt32          m_Pos;
+	bool             m_Binary;
+	bool             m_DoubleFloats;    // 64-bit floats in binary float lists
+	bool             m_Failed;
+
+	vector<SLevel>   m_Levels;          // Objects entered, innermost last
+
+	// Current binary integer or float list, values are read from it until it is used up
+	const TUInt8*    m_ListData;
+	TUInt32          m_ListRemaining;
+	bool             m_ListIsFloat;
+
+	map<string, TUInt32> m_NamedObjects; // Position of each named object seen so far, for references
+};
+
+
+} // namespace gen
@@ -8,11 +8,13 @@
 #include "TankEntity.h"
 #include "EntityManager.h"
 #include "Messenger.h"
+#include "PickupIndex.h"
 
 namespace gen
 {
 	extern CEntityManager EntityManager;
 	extern CMessenger Messenger;
+	extern CPickupIndex Pickups;
 
 	/*-----------------------------------------------------------------------------------------
 		Ammo Entity Class
@@ -49,6 +51,9 @@ namespace gen
 				Position().y = 0.5f;
 				m_State = EAmmoState::TimeOut;
 
+				// On the ground, so tanks can now find it
+				Pickups.AddPickup(Pickup_Ammo, GetUID(), Position());
+
 			} // End of if-else statment
 		}
 		else if (m_State == EAmmoState::TimeOut)
@@ -80,6 +85,7 @@ namespace gen
 						m.from = GetUID();
 						Messenger.SendMessage(SystemUID, m);
 
+						Pickups.RemovePickup(Pickup_Ammo, GetUID());
 						return false;
 
 					} // End of if statment
@@ -98,6 +104,7 @@ namespace gen
 				m.from = GetUID();
 				Messenger.SendMessage(SystemUID, m);
 
+				Pickups.RemovePickup(Pickup_Ammo, GetUID());
 				return false;
 
 			} // End of if-else statment
@@ -108,4 +115,33 @@ namespace gen
 
 	} // End of Update function
 
+	// Write the ammo pack's state to a snapshot
+	void CAmmoEntity::SaveState(CSnapshot* pSnapshot)
+	{
+		CEntity::SaveState(pSnapshot);
+		pSnapshot->Write(static_cast<TUInt32>(m_State));
+		pSnapshot->Write(m_LifeTime);
+		pSnapshot->Write(m_Amount);
+	}
+
+	// Read the ammo pack's state from a snapshot
+	void CAmmoEntity::LoadState(CSnapshot* pSnapshot)
+	{
+		CEntity::LoadState(pSnapshot);
+		TUInt32 state;
+		pSnapshot->Read(&state);
+		pSnapshot->Read(&m_LifeTime);
+		pSnapshot->Read(&m_Amount);
+		m_State = (state == static_cast<TUInt32>(EAmmoState::Dropping)) ? EAmmoState::Dropping : EAmmoState::TimeOut;
+	}
+
+	// Add the ammo pack's state to a hash
+	void CAmmoEntity::HashState(CStateHash* pHash)
+	{
+		CEntity::HashState(pHash);
+		pHash->Add(static_cast<TUInt32>(m_State));
+		pHash->Add(m_LifeTime);
+		pHash->Add(m_Amount);
+	}
+
 } // namespace gen
\ No newline at end of file
@@ -64,6 +64,21 @@ namespace gen
 		// Virtual function
 		virtual bool Update( TFloat32 updateTime );
 
+		virtual EEntityKind GetKind()
+		{
+			return Entity_AmmoPack;
+		}
+
+		/////////////////////////////////////
+		// Snapshots
+
+		// Write the ammo pack's state to a snapshot, or read it back
+		virtual void SaveState( CSnapshot* pSnapshot );
+		virtual void LoadState( CSnapshot* pSnapshot );
+
+		// Add the ammo pack's state to a hash
+		virtual void HashState( CStateHash* pHash );
+
 		// Returns true if the Ammo pack is not in Dropping state
 		const bool OnGround()
 		{
@@ -0,0 +1,151 @@
+/*******************************************
+	Battle.cpp
+
+	The rules of the game's battle, run once
+	per update of the simulation
+********************************************/
+
+#include <string>
+using namespace std;
+
+#include "Battle.h"
+#include "BaseMath.h"
+#include "EntityManager.h"
+#include "Messenger.h"
+#include "RaycastService.h"
+#include "TankGrid.h"
+#include "SimulationState.h"
+
+namespace gen
+{
+
+// Simulation globals, defined by the program running the battle
+extern CEntityManager EntityManager;
+extern CMessenger Messenger;
+extern CRaycastService Raycasts;
+extern CTankGrid TankGrid;
+
+const TFloat32 CBattle::kHealthPackInterval = 10.0f;
+const TFloat32 CBattle::kAmmoPackInterval = 15.0f;
+
+
+// Constructor sets up the pack timers for the start of a battle
+CBattle::CBattle()
+{
+	m_HealthPackTimer = kHealthPackInterval;
+	m_NumHealthPacks = 0;
+	m_HealthPackSerial = 0;
+
+	m_AmmoPackTimer = kAmmoPackInterval;
+	m_NumAmmoPacks = 0;
+	m_AmmoPackSerial = 0;
+}
+
+
+// Run one update of the battle
+void CBattle::Update( TFloat32 updateTime )
+{
+	/////////////////////////////
+	// Health and ammo pack deployment
+
+	SMessage msg;
+	while (Messenger.FetchMessage( SystemUID, &msg ))
+	{
+		// A pack has been collected or expired
+		if (msg.type == Msg_NewHealthPack && m_NumHealthPacks > 0)
+		{
+			--m_NumHealthPacks;
+		}
+		if (msg.type == Msg_NewAmmoPack && m_NumAmmoPacks > 0)
+		{
+			--m_NumAmmoPacks;
+		}
+	}
+
+	if (m_NumHealthPacks < kMaxHealthPacks)
+	{
+		if (m_HealthPackTimer > 0.0f)
+		{
+			m_HealthPackTimer -= updateTime;
+		}
+		else
+		{
+			++m_NumHealthPacks;
+			m_HealthPackTimer = kHealthPackInterval;
+			EntityManager.CreateHealthPack( "HealthPack", "Health Pack " + to_string( ++m_HealthPackSerial ),
+			                                { Random( -50.0f, 0.0f ), 25.0f, Random( -40.0f, 10.0f ) } );
+		}
+	}
+
+	if (m_NumAmmoPacks < kMaxAmmoPacks)
+	{
+		if (m_AmmoPackTimer > 0.0f)
+		{
+			m_AmmoPackTimer -= updateTime;
+		}
+		else
+		{
+			++m_NumAmmoPacks;
+			m_AmmoPackTimer = kAmmoPackInterval;
+			EntityManager.CreateAmmoPack( "AmmoPack", "Ammo Pack " + to_string( ++m_AmmoPackSerial ),
+			                              { Random( 0.0f, 50.0f ), 25.0f, Random( -40.0f, 10.0f ) } );
+		}
+	}
+
+	/////////////////////////////
+	// Entities
+
+	// Shells find the tanks they hit through a grid of the tanks' positions at the start
+	TankGrid.Build( &EntityManager );
+	EntityManager.UpdateAllEntities( updateTime );
+
+	// Resolve the rays queued by the entities, results are read on the next update
+	Raycasts.ResolveBatch();
+}
+
+
+/////////////////////////////////////
+// Snapshots
+
+// Write the simulation and the pack timers to a snapshot
+void CBattle::SaveState( CSnapshot* pSnapshot )
+{
+	SaveSimulation( pSnapshot );
+	pSnapshot->Write( m_HealthPackTimer );
+	pSnapshot->Write( m_NumHealthPacks );
+	pSnapshot->Write( m_HealthPackSerial );
+	pSnapshot->Write( m_AmmoPackTimer );
+	pSnapshot->Write( m_NumAmmoPacks );
+	pSnapshot->Write( m_AmmoPackSerial );
+}
+
+// Restore the state written by SaveState
+bool CBattle::LoadState( CSnapshot* pSnapshot )
+{
+	if (!RestoreSimulation( pSnapshot ))
+	{
+		return false;
+	}
+	pSnapshot->Read( &m_HealthPackTimer );
+	pSnapshot->Read( &m_NumHealthPacks );
+	pSnapshot->Read( &m_HealthPackSerial );
+	pSnapshot->Read( &m_AmmoPackTimer );
+	pSnapshot->Read( &m_NumAmmoPacks );
+	pSnapshot->Read( &m_AmmoPackSerial );
+	return !pSnapshot->Failed();
+}
+
+// Add the simulation and the pack timers to a hash
+void CBattle::HashState( CStateHash* pHash )
+{
+	HashSimulation( pHash );
+	pHash->Add( m_HealthPackTimer );
+	pHash->Add( m_NumHealthPacks );
+	pHash->Add( m_HealthPackSerial );
+	pHash->Add( m_AmmoPackTimer );
+	pHash->Add( m_NumAmmoPacks );
+	pHash->Add( m_AmmoPackSerial );
+}
+
+
+} // namespace gen
@@ -0,0 +1,79 @@
+/*******************************************
+	Battle.h
+
+	The rules of the game's battle, run once
+	per update of the simulation
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+#include "Snapshot.h"
+#include "StateHash.h"
+
+namespace gen
+{
+
+// The battle played by the game: each update health and ammo packs are dropped at intervals while
+// there are fewer than the maximum on the ground, then the entities are updated and their line of
+// sight rays resolved. Kept apart from the game's input and rendering so the same battle can be
+// run headless, e.g. to replay a recording
+class CBattle
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor sets up the pack timers for the start of a battle
+	CBattle();
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CBattle( const CBattle& );
+	CBattle& operator=( const CBattle& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Run one update of the battle
+	void Update( TFloat32 updateTime );
+
+
+	/////////////////////////////////////
+	// Snapshots
+
+	// Write the simulation and the pack timers to a snapshot
+	void SaveState( CSnapshot* pSnapshot );
+
+	// Restore the state written by SaveState, returns false if the snapshot does not match the
+	// loaded scene or is damaged (see RestoreSimulation)
+	bool LoadState( CSnapshot* pSnapshot );
+
+	// Add the simulation and the pack timers to a hash (see HashSimulation)
+	void HashState( CStateHash* pHash );
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	// A new pack is dropped this many seconds after the last while there are fewer than the maximum
+	static const TUInt32 kMaxHealthPacks = 4;
+	static const TUInt32 kMaxAmmoPacks = 4;
+	static const TFloat32 kHealthPackInterval;
+	static const TFloat32 kAmmoPackInterval;
+
+	TFloat32 m_HealthPackTimer;
+	TUInt32  m_NumHealthPacks;
+	TUInt32  m_HealthPackSerial; // Used to give each pack a unique name
+
+	TFloat32 m_AmmoPackTimer;
+	TUInt32  m_NumAmmoPacks;
+	TUInt32  m_AmmoPackSerial;
+};
+
+
+} // namespace gen
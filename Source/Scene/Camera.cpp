@@ -173,6 +173,28 @@ CVector3 CCamera::WorldPtFromPixel(CVector2 pixelPt, TUInt32 ViewportWidth, TUIn
 }
 
 
+//-----------------------------------------------------------------------------
+// Level of detail
+//-----------------------------------------------------------------------------
+
+// Get the fraction of the viewport height covered by a sphere when viewed from this camera,
+// e.g. 0.5 if its diameter fills half the height. Uses the distance to the sphere rather than
+// its depth in the view, so the size does not change as the camera turns. Returns 1 or more if
+// the camera is inside the sphere
+TFloat32 CCamera::ScreenSize( const CVector3& centre, TFloat32 radius )
+{
+	TFloat32 distance = m_Matrix.Position().DistanceTo( centre );
+	if (distance <= radius)
+	{
+		return 1.0f;
+	}
+
+	// Half height of the view at the sphere's distance, FOV is horizontal (see CalculateMatrices)
+	TFloat32 viewHalfHeight = distance * Tan( m_FOV * 0.5f ) / m_Aspect;
+	return radius / viewHalfHeight;
+}
+
+
 
 
 
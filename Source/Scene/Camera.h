@@ -121,6 +121,14 @@ public:
 	CVector3 WorldPtFromPixel(CVector2 pixelPt, TUInt32 ViewportWidth, TUInt32 ViewportHeight);
 
 
+	///////////////////////////
+	// Level of detail
+
+	// Get the fraction of the viewport height covered by a sphere with the given centre and
+	// radius when viewed from this camera. Returns 1 or more if the camera is inside the sphere
+	TFloat32 ScreenSize( const CVector3& centre, TFloat32 radius );
+
+
 	///////////////////////////
 	// Frustrum planes
 
@@ -0,0 +1,187 @@
+/*******************************************
+	CollisionWorld.cpp
+
+	Static scenery collision for shells and
+	line-of-sight tests
+********************************************/
+
+#include "CollisionWorld.h"
+#include "EntityManager.h"
+#include "Error.h"
+
+namespace gen
+{
+
+
+/////////////////////////////////////
+// Creation
+
+// Add a static entity to the world, uses the entity's current matrix and its mesh bounds
+void CCollisionWorld::AddStaticEntity( CEntity* entity )
+{
+	SStaticObject object;
+	SetObject( &object, entity );
+	m_Objects.push_back( object );
+}
+
+// Build the tree from the added entities. Swept sphere queries up to the given radius will be
+// supported - the tree boxes are grown by this amount so that nodes enclose inflated objects
+void CCollisionWorld::Build( TFloat32 maxSweepRadius )
+{
+	m_MaxSweepRadius = maxSweepRadius;
+
+	vector<SAABB> boxes( m_Objects.size() );
+	for (TUInt32 object = 0; object < m_Objects.size(); ++object)
+	{
+		boxes[object] = m_Objects[object].bounds;
+		boxes[object].Inflate( m_MaxSweepRadius );
+	}
+
+	// Scenery objects are cheap to test exactly so use small leaves
+	m_Tree.Build( boxes.empty() ? 0 : &boxes[0], static_cast<TUInt32>(boxes.size()), 2 );
+}
+
+// Update every object from its entity's current mesh after template meshes have been replaced,
+// removing objects whose entity no longer exists, then rebuild the tree
+void CCollisionWorld::RefreshEntities( CEntityManager* entityManager )
+{
+	TUInt32 numKept = 0;
+	for (TUInt32 object = 0; object < m_Objects.size(); ++object)
+	{
+		CEntity* entity = entityManager->GetEntity( m_Objects[object].UID );
+		if (entity)
+		{
+			SetObject( &m_Objects[numKept++], entity );
+		}
+	}
+	m_Objects.resize( numKept );
+	Build( m_MaxSweepRadius );
+}
+
+// Remove everything from the world
+void CCollisionWorld::Clear()
+{
+	m_Objects.clear();
+	m_Tree.Clear();
+}
+
+
+/////////////////////////////////////
+// Support functions
+
+// Set an object's box and mesh data from an entity's current matrix and mesh
+void CCollisionWorld::SetObject( SStaticObject* object, CEntity* entity )
+{
+	CMesh* mesh = entity->Template()->Mesh();
+
+	SAABB meshBounds;
+	meshBounds.minBounds = mesh->MinBounds();
+	meshBounds.maxBounds = mesh->MaxBounds();
+
+	object->bounds = TransformAABB( meshBounds, entity->Matrix() );
+	object->UID = entity->GetUID();
+	object->BVH = &mesh->BVH();
+	object->invMatrix = entity->Matrix();
+	object->invMatrix.InvertAffine();
+	CVector3 scale = entity->Matrix().GetScale();
+	object->invScale = 1.0f / Min( scale.x, Min( scale.y, scale.z ) );
+}
+
+
+/////////////////////////////////////
+// Queries
+
+// Test a moving sphere (the segment from start to end, swept by radius) against the scenery
+bool CCollisionWorld::SegmentIntersect
+(
+	const CVector3& start,
+	const CVector3& end,
+	TFloat32        radius /*= 0.0f*/,
+	TFloat32*       pHitFraction /*= 0*/,
+	TEntityUID*     pHitUID /*= 0*/
+) const
+{
+	if (m_Tree.IsEmpty())
+	{
+		return false;
+	}
+
+	// The tree works in ray parameters, using the segment as the direction gives t in [0,1].
+	// A swept sphere is tested as a segment against boxes inflated by the radius, then as a
+	// sphere moving along the segment against the triangles. Parameters are unchanged by the
+	// transform into model space, where the radius is scaled to cover the largest distance it
+	// could be in a non-uniformly scaled object. Tree nodes only enclose objects inflated by the
+	// radius passed to Build, a larger sphere could pass through unseen
+	GEN_ASSERT( radius <= m_MaxSweepRadius, "Sweep radius larger than the collision world supports" );
+	CVector3 direction = end - start;
+	CVector3 invDirection( CAABBTree::SafeReciprocal( direction.x ), CAABBTree::SafeReciprocal( direction.y ),
+	                       CAABBTree::SafeReciprocal( direction.z ) );
+
+	const vector<SStaticObject>& objects = m_Objects;
+	auto visitor = [&]( TUInt32 object, TFloat32 maxT ) -> TFloat32
+	{
+		const SStaticObject& data = objects[object];
+		SAABB box = data.bounds;
+		box.Inflate( radius );
+		TFloat32 boxT;
+		if (!RayIntersectsAABB( box, start, invDirection, maxT, &boxT ))
+		{
+			return maxT;
+		}
+		if (data.BVH->IsEmpty())
+		{
+			return boxT;
+		}
+
+		CVector3 modelStart = data.invMatrix.TransformPoint( start );
+		CVector3 modelDirection = data.invMatrix.TransformVector( direction );
+		TFloat32 t;
+		bool hit = (radius > 0.0f) ?
+		           data.BVH->SweptSphereIntersect( modelStart, modelDirection, radius * data.invScale, maxT, &t ) :
+		           data.BVH->RayIntersect( modelStart, modelDirection, maxT, &t );
+		return hit ? t : maxT;
+	};
+
+	TFloat32 hitT;
+	TUInt32  hitObject;
+	if (!m_Tree.RayQuery( start, direction, 1.0f, visitor, &hitT, &hitObject ))
+	{
+		return false;
+	}
+
+	if (pHitFraction) *pHitFraction = hitT;
+	if (pHitUID) *pHitUID = m_Objects[hitObject].UID;
+	return true;
+}
+
+// Returns true if the given sphere overlaps any scenery, with the first UID found
+bool CCollisionWorld::SphereIntersect( const CVector3& centre, TFloat32 radius, TEntityUID* pHitUID /*= 0*/ ) const
+{
+	SAABB queryBox;
+	queryBox.minBounds = centre;
+	queryBox.maxBounds = centre;
+	queryBox.Inflate( radius );
+
+	const vector<SStaticObject>& objects = m_Objects;
+	TFloat32 radiusSquared = radius * radius;
+	bool hit = false;
+	auto visitor = [&]( TUInt32 object ) -> bool
+	{
+		const SStaticObject& data = objects[object];
+		if (data.bounds.DistanceToSquared( centre ) <= radiusSquared &&
+		    (data.BVH->IsEmpty() ||
+		     data.BVH->SphereIntersect( data.invMatrix.TransformPoint( centre ), radius * data.invScale )))
+		{
+			if (pHitUID) *pHitUID = data.UID;
+			hit = true;
+			return false; // Stop the query
+		}
+		return true;
+	};
+	m_Tree.OverlapQuery( queryBox, visitor );
+
+	return hit;
+}
+
+
+} // namespace gen
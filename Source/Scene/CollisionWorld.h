@@ -0,0 +1,155 @@
+/*******************************************
+	CollisionWorld.h
+
+	Static scenery collision for shells and
+	line-of-sight tests
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "CVector3.h"
+#include "AABBTree.h"
+#include "Entity.h"
+
+namespace gen
+{
+
+class CEntityManager;
+
+// The collision world holds the static scenery (buildings, trees etc.) that moving entities
+// can hit. Each scenery entity is represented by the world-space box around its mesh, and the
+// boxes are organised in an AABB tree built once after the scene has been set up. Scenery
+// never moves, so the tree is only rebuilt during play when a hot reload replaces meshes. Objects whose boxes are hit are then
+// tested against the triangles of their mesh using the mesh BVH
+class CCollisionWorld
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty world
+	CCollisionWorld()
+	{
+		m_MaxSweepRadius = 0.0f;
+	}
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CCollisionWorld( const CCollisionWorld& );
+	CCollisionWorld& operator=( const CCollisionWorld& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	/////////////////////////////////////
+	// Creation
+
+	// Add a static entity to the world, uses the entity's current matrix and its mesh bounds.
+	// Call Build after all entities have been added
+	void AddStaticEntity( CEntity* entity );
+
+	// Build the tree from the added entities. Swept sphere queries will support radii up to the
+	// given maximum, e.g. the largest shell. May be called again to change the maximum
+	void Build( TFloat32 maxSweepRadius );
+
+	// Update every object from its entity's current mesh, after template meshes have been
+	// replaced (by a hot reload), so no object still refers to a replaced mesh. Objects whose
+	// entity no longer exists are removed. Rebuilds the tree for the same sweep radius
+	void RefreshEntities( CEntityManager* entityManager );
+
+	// Remove everything from the world
+	void Clear();
+
+
+	/////////////////////////////////////
+	// Queries
+
+	// Test a moving sphere (the segment from start to end, swept by radius - radius 0 for a
+	// simple segment) against the scenery. The radius must be no larger than that passed to
+	// Build, a fatal error otherwise. Returns true if anything is hit, along with the fraction of the way along the segment
+	// of the first hit and the UID of the entity hit
+	bool SegmentIntersect
+	(
+		const CVector3& start,
+		const CVector3& end,
+		TFloat32        radius = 0.0f,
+		TFloat32*       pHitFraction = 0,
+		TEntityUID*     pHitUID = 0
+	) const;
+
+	// Returns true if there is no scenery between the two points
+	bool LineOfSight( const CVector3& from, const CVector3& to ) const
+	{
+		return !SegmentIntersect( from, to );
+	}
+
+	// Returns true if the given sphere overlaps any scenery, with the first UID found
+	bool SphereIntersect( const CVector3& centre, TFloat32 radius, TEntityUID* pHitUID = 0 ) const;
+
+
+	/////////////////////////////////////
+	// Getters
+
+	TUInt32 NumObjects() const
+	{
+		return static_cast<TUInt32>(m_Objects.size());
+	}
+
+	// Largest radius supported by swept sphere queries, as passed to Build
+	TFloat32 MaxSweepRadius() const
+	{
+		return m_MaxSweepRadius;
+	}
+
+	// Bounds of all the scenery - not valid for an empty world
+	SAABB Bounds() const
+	{
+		SAABB bounds = m_Tree.Bounds();
+		bounds.Inflate( -m_MaxSweepRadius ); // Tree boxes are inflated, see Build
+		return bounds;
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	/////////////////////////////////////
+	// Types
+
+	// A single static object - the world-space box and the entity it came from, along with
+	// what is needed to test against its mesh triangles in model space
+	struct SStaticObject
+	{
+		SAABB           bounds;
+		TEntityUID      UID;
+		const CMeshBVH* BVH;
+		CMatrix4x4      invMatrix; // World to model space
+		TFloat32        invScale;  // Converts world distances to (at least) model distances
+	};
+
+
+	/////////////////////////////////////
+	// Support functions
+
+	// Set an object's box and mesh data from an entity's current matrix and mesh
+	static void SetObject( SStaticObject* object, CEntity* entity );
+
+
+	/////////////////////////////////////
+	// Data
+
+	vector<SStaticObject> m_Objects;
+	CAABBTree             m_Tree;
+	TFloat32              m_MaxSweepRadius; // Tree boxes are inflated by this amount
+};
+
+
+} // namespace gen
@@ -47,8 +47,8 @@ CEntity::CEntity
 }
 
 
-// Render the model
-void CEntity::Render()
+// Render the model, at a level of detail suited to its size on screen from the given camera
+void CEntity::Render( CCamera* camera )
 {
 	// Get pointer to mesh to simplify code
 	CMesh* Mesh = m_Template->Mesh();
@@ -63,8 +63,67 @@ void CEntity::Render()
 	// Incorporate any bone<->mesh offsets (only relevant for skinning)
 	// Don't need this step for this exercise
 
+	// Choose the level of detail from the screen size of the mesh's bounding sphere, scaled by the
+	// largest scale in the entity's matrix
+	CVector3 scale = m_Matrices[0].GetScale();
+	TFloat32 radius = Mesh->BoundingRadius() * Max( scale.x, Max( scale.y, scale.z ) );
+	TUInt32 lod = Mesh->SelectLOD( camera->ScreenSize( m_Matrices[0].Position(), radius ) );
+
 	// Render with absolute matrices
-	Mesh->Render( m_Matrices );
+	Mesh->Render( m_Matrices, lod );
+}
+
+
+/////////////////////////////////////
+// Snapshots
+
+// Write the node matrices to a snapshot. They are all affine, so only the first three columns are
+// written - 48 bytes rather than 64 per node
+void CEntity::SaveState( CSnapshot* pSnapshot )
+{
+	TUInt32 numNodes = m_Template->Mesh()->GetNumNodes();
+	pSnapshot->Write( numNodes );
+	for (TUInt32 node = 0; node < numNodes; ++node)
+	{
+		const CMatrix4x4& m = m_RelMatrices[node];
+		TFloat32 columns[12] = { m.e00, m.e01, m.e02, m.e10, m.e11, m.e12, m.e20, m.e21, m.e22, m.e30, m.e31, m.e32 };
+		pSnapshot->Write( columns );
+	}
+}
+
+// Read the node matrices from a snapshot, fails it if the mesh has a different number of nodes
+void CEntity::LoadState( CSnapshot* pSnapshot )
+{
+	TUInt32 numNodes = 0;
+	pSnapshot->Read( &numNodes );
+	if (numNodes != m_Template->Mesh()->GetNumNodes())
+	{
+		pSnapshot->Fail();
+		return;
+	}
+	for (TUInt32 node = 0; node < numNodes; ++node)
+	{
+		TFloat32 c[12];
+		pSnapshot->Read( &c );
+		m_RelMatrices[node] = CMatrix4x4( c[0], c[1],  c[2],  0.0f,
+		                                  c[3], c[4],  c[5],  0.0f,
+		                                  c[6], c[7],  c[8],  0.0f,
+		                                  c[9], c[10], c[11], 1.0f );
+	}
+}
+
+// Add the node matrices to a hash, the fourth column is always (0,0,0,1) so is skipped
+void CEntity::HashState( CStateHash* pHash )
+{
+	TUInt32 numNodes = m_Template->Mesh()->GetNumNodes();
+	for (TUInt32 node = 0; node < numNodes; ++node)
+	{
+		const CMatrix4x4& m = m_RelMatrices[node];
+		pHash->Add( m.e00 ); pHash->Add( m.e01 ); pHash->Add( m.e02 );
+		pHash->Add( m.e10 ); pHash->Add( m.e11 ); pHash->Add( m.e12 );
+		pHash->Add( m.e20 ); pHash->Add( m.e21 ); pHash->Add( m.e22 );
+		pHash->Add( m.e30 ); pHash->Add( m.e31 ); pHash->Add( m.e32 );
+	}
 }
 
 
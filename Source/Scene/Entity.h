@@ -14,6 +14,8 @@ using namespace std;
 #include "CMatrix4x4.h"
 #include "Camera.h"
 #include "Mesh.h"
+#include "Snapshot.h"
+#include "StateHash.h"
 
 namespace gen
 {
@@ -25,6 +27,16 @@ namespace gen
 typedef TUInt32 TEntityUID;
 const TEntityUID SystemUID = 0xffffffff;
 
+// The classes of entity, so snapshots can recreate each entity as the right class
+enum EEntityKind
+{
+	Entity_Scenery, // Base class entities, which never change once created
+	Entity_Tank,
+	Entity_Shell,
+	Entity_HealthPack,
+	Entity_AmmoPack
+};
+
 
 /*-----------------------------------------------------------------------------------------
 -------------------------------------------------------------------------------------------
@@ -57,6 +69,15 @@ public:
 		}
 	}
 
+	// Alternative constructor for a mesh that has already been loaded (e.g. by the scene
+	// loader). The template takes ownership of the mesh
+	CEntityTemplate( const string& type, const string& name, CMesh* mesh )
+	{
+		m_Type = type;
+		m_Name = name;
+		m_Mesh = mesh;
+	}
+
 	// Destructor - base class destructors should always be virtual
 	virtual ~CEntityTemplate()
 	{
@@ -92,6 +113,21 @@ public:
 	}
 
 
+	/////////////////////////////////////
+	//	Setters
+
+	// Replace the mesh (e.g. when the mesh file has been edited), the template takes ownership
+	// of the new mesh. The old mesh is returned rather than deleted as other systems may still
+	// refer to it (e.g. the collision world). Entities of this template keep their matrices, so
+	// the new mesh must have the same number of nodes
+	CMesh* ReplaceMesh( CMesh* mesh )
+	{
+		CMesh* oldMesh = m_Mesh;
+		m_Mesh = mesh;
+		return oldMesh;
+	}
+
+
 /////////////////////////////////////
 //	Private interface
 private:
@@ -167,6 +203,12 @@ public:
 		return m_Name;
 	}
 
+	// The class of this entity, derived classes return their own
+	virtual EEntityKind GetKind()
+	{
+		return Entity_Scenery;
+	}
+
 
 	/////////////////////////////////////
 	// Matrix access
@@ -190,8 +232,22 @@ public:
 	// Virtual function, base version does nothing
 	virtual bool Update( TFloat32 updateTime ) { return true; }
 	
-	// Render the entity
-	void Render();
+	// Render the entity, at a level of detail suited to its size on screen from the given camera
+	void Render( CCamera* camera );
+
+
+	/////////////////////////////////////
+	// Snapshots
+
+	// Write the state that changes as the entity updates to a snapshot, or read it back into an
+	// entity of the same template. The template, UID and name are saved by the entity manager.
+	// Base versions save the node matrices, derived classes must call them before their own data
+	virtual void SaveState( CSnapshot* pSnapshot );
+	virtual void LoadState( CSnapshot* pSnapshot );
+
+	// Add the state that affects the simulation to a hash, to check that runs match. Base version
+	// hashes the node matrices (positions and orientations), derived classes must call it first
+	virtual void HashState( CStateHash* pHash );
 
 
 /////////////////////////////////////
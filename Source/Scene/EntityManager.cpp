@@ -6,10 +6,15 @@
 ********************************************/
 
 #include "EntityManager.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
 
 namespace gen
 {
 
+// Frame profiler
+extern CProfiler Profiler;
+
 /////////////////////////////////////
 // Constructors/Destructors
 
@@ -22,6 +27,7 @@ CEntityManager::CEntityManager()
 
 	// Set first entity UID that will be used
 	m_NextUID = 0;
+	m_EntitiesHash = 0;
 
 	m_IsEnumerating = false;
 }
@@ -41,6 +47,8 @@ CEntityManager::~CEntityManager()
 // template pointer
 CEntityTemplate* CEntityManager::CreateTemplate( const string& type, const string& name, const string& mesh )
 {
+	CMemoryScope memory( Mem_Entities );
+
 	// Create new entity template
 	CEntityTemplate* newTemplate = new CEntityTemplate( type, name, mesh );
 
@@ -57,6 +65,8 @@ CTankTemplate* CEntityManager::CreateTankTemplate(const string& type, const stri
 	float acceleration, float turnSpeed,
 	float turretTurnSpeed, int maxHP, int shellDamage)
 {
+	CMemoryScope memory( Mem_Entities );
+
 	// Create new tank template
 	CTankTemplate* newTemplate = new CTankTemplate(type, name, mesh, maxSpeed, acceleration,
 		turnSpeed, turretTurnSpeed, maxHP, shellDamage);
@@ -67,6 +77,32 @@ CTankTemplate* CEntityManager::CreateTankTemplate(const string& type, const stri
 	return newTemplate;
 }
 
+// Create a base entity template from a mesh that has already been loaded, the template takes
+// ownership of the mesh
+CEntityTemplate* CEntityManager::CreateTemplate( const string& type, const string& name, CMesh* mesh )
+{
+	CMemoryScope memory( Mem_Entities );
+
+	CEntityTemplate* newTemplate = new CEntityTemplate( type, name, mesh );
+	m_Templates[name] = newTemplate;
+	return newTemplate;
+}
+
+// Create a tank template from a mesh that has already been loaded, the template takes ownership
+// of the mesh
+CTankTemplate* CEntityManager::CreateTankTemplate(const string& type, const string& name,
+	CMesh* mesh, float maxSpeed,
+	float acceleration, float turnSpeed,
+	float turretTurnSpeed, int maxHP, int shellDamage)
+{
+	CMemoryScope memory( Mem_Entities );
+
+	CTankTemplate* newTemplate = new CTankTemplate(type, name, mesh, maxSpeed, acceleration,
+		turnSpeed, turretTurnSpeed, maxHP, shellDamage);
+	m_Templates[name] = newTemplate;
+	return newTemplate;
+}
+
 // Destroy the given template (name) - returns true if the template existed and was destroyed
 bool CEntityManager::DestroyTemplate( const string& name )
 {
@@ -99,6 +135,21 @@ void CEntityManager::DestroyAllTemplates()
 	}
 }
 
+// Return the largest bounding radius of the meshes of templates with the given type, 0 if there
+// are none
+TFloat32 CEntityManager::MaxBoundingRadius( const string& type )
+{
+	TFloat32 maxRadius = 0.0f;
+	for (TTemplateIter entityTemplate = m_Templates.begin(); entityTemplate != m_Templates.end(); ++entityTemplate)
+	{
+		if (entityTemplate->second->GetType() == type)
+		{
+			maxRadius = Max( maxRadius, entityTemplate->second->Mesh()->BoundingRadius() );
+		}
+	}
+	return maxRadius;
+}
+
 
 /////////////////////////////////////
 // Entity creation / destruction
@@ -115,7 +166,21 @@ TEntityUID CEntityManager::CreateEntity
 )
 {
 	// Get template associated with the template name
-	CEntityTemplate* entityTemplate = GetTemplate( templateName );
+	return CreateEntity( GetTemplate( templateName ), name, position, rotation, scale );
+}
+
+// Version of the above taking the template itself, avoids looking up the template name when
+// creating many entities
+TEntityUID CEntityManager::CreateEntity
+(
+	CEntityTemplate* entityTemplate,
+	const string&    name,
+	const CVector3&  position,
+	const CVector3&  rotation,
+	const CVector3&  scale
+)
+{
+	CMemoryScope memory( Mem_Entities );
 
 	// Create new entity with next UID
 	CEntity* newEntity = new CEntity( entityTemplate, m_NextUID, name, position, rotation, scale );
@@ -123,6 +188,7 @@ TEntityUID CEntityManager::CreateEntity
 	// Get vector index for new entity and add it to vector
 	TUInt32 entityIndex = static_cast<TUInt32>(m_Entities.size());
 	m_Entities.push_back( newEntity );
+	EntityChanged( entityIndex );
 
 	// Add mapping from UID to entity index into hash map
 	m_EntityUIDMap->SetKeyValue( m_NextUID, entityIndex );
@@ -134,6 +200,16 @@ TEntityUID CEntityManager::CreateEntity
 }
 
 
+// Reserve space for the given number of additional entities, before creating many at once
+void CEntityManager::ReserveEntities( TUInt32 numEntities )
+{
+	TUInt32 totalEntities = static_cast<TUInt32>(m_Entities.size()) + numEntities;
+	m_Entities.reserve( totalEntities );
+	m_EntityHashes.reserve( totalEntities );
+	m_EntityUIDMap->Reserve( totalEntities );
+}
+
+
 // Create a tank, requires a tank template name and team number, may supply entity name and
 // position. Returns the UID of the new entity
 TEntityUID CEntityManager::CreateTank
@@ -147,6 +223,8 @@ TEntityUID CEntityManager::CreateTank
 	const CVector3& scale /*= CVector3( 1.0f, 1.0f, 1.0f )*/
 	)
 {
+	CMemoryScope memory( Mem_Entities );
+
 	// Get tank template associated with the template name
 	// This will cause an error if the template is not a tank type
 	CTankTemplate* tankTemplate = static_cast<CTankTemplate*>(GetTemplate(templateName));
@@ -157,6 +235,7 @@ TEntityUID CEntityManager::CreateTank
 	// Get vector index for new entity and add it to vector
 	TUInt32 entityIndex = static_cast<int>(m_Entities.size());
 	m_Entities.push_back(newEntity);
+	EntityChanged(entityIndex);
 
 	// Add mapping from UID to entity index into hash map
 	m_EntityUIDMap->SetKeyValue(m_NextUID, entityIndex);
@@ -180,6 +259,8 @@ TEntityUID CEntityManager::CreateShell
 	const CVector3& scale /*= CVector3( 1.0f, 1.0f, 1.0f )*/
 )
 {
+	CMemoryScope memory( Mem_Entities );
+
 	// Get template associated with the template name
 	CEntityTemplate* entityTemplate = GetTemplate(templateName);
 
@@ -191,6 +272,7 @@ TEntityUID CEntityManager::CreateShell
 	// Get vector index for new entity and add it to vector
 	TUInt32 entityIndex = static_cast<int>(m_Entities.size());
 	m_Entities.push_back(newEntity);
+	EntityChanged(entityIndex);
 
 	// Add mapping from UID to entity index into hash map
 	m_EntityUIDMap->SetKeyValue(m_NextUID, entityIndex);
@@ -214,6 +296,8 @@ TEntityUID CEntityManager::CreateHealthPack
 	const TUInt32    amount
 )
 {
+	CMemoryScope memory( Mem_Entities );
+
 	// Get template associated with the template name
 	CEntityTemplate* entityTemplate = GetTemplate(templateName);
 
@@ -225,6 +309,7 @@ TEntityUID CEntityManager::CreateHealthPack
 	// Get vector index for new entity and add it to vector
 	TUInt32 entityIndex = static_cast<int>(m_Entities.size());
 	m_Entities.push_back(newEntity);
+	EntityChanged(entityIndex);
 
 	// Add mapping from UID to entity index into hash map
 	m_EntityUIDMap->SetKeyValue(m_NextUID, entityIndex);
@@ -246,6 +331,8 @@ TEntityUID CEntityManager::CreateAmmoPack
 	const TUInt32    amount
 )
 {
+	CMemoryScope memory( Mem_Entities );
+
 	// Get template associated with the template name
 	CEntityTemplate* entityTemplate = GetTemplate(templateName);
 
@@ -257,6 +344,7 @@ TEntityUID CEntityManager::CreateAmmoPack
 	// Get vector index for new entity and add it to vector
 	TUInt32 entityIndex = static_cast<int>(m_Entities.size());
 	m_Entities.push_back(newEntity);
+	EntityChanged(entityIndex);
 
 	// Add mapping from UID to entity index into hash map
 	m_EntityUIDMap->SetKeyValue(m_NextUID, entityIndex);
@@ -281,13 +369,20 @@ bool CEntityManager::DestroyEntity( TEntityUID UID )
 	// Delete the given entity and remove from UID map
 	delete m_Entities[entityIndex];
 	m_EntityUIDMap->RemoveKey( UID );
+	m_EntitiesHash -= m_EntityHashes[entityIndex].inTotal;
+	m_EntityHashes[entityIndex].inTotal = 0;
 
 	// If not removing last entity...
 	if (entityIndex != m_Entities.size() - 1)
 	{
-		// ...put the last entity into the empty entity slot and update UID map
+		// ...put the last entity into the empty entity slot and update UID map. Its hash depends
+		// on its index so must be taken again
 		m_Entities[entityIndex] = m_Entities.back();
 		m_EntityUIDMap->SetKeyValue( m_Entities.back()->GetUID(), entityIndex );
+		SEntityHash& lastHash = m_EntityHashes[m_Entities.size() - 1];
+		m_EntitiesHash -= lastHash.inTotal;
+		lastHash.inTotal = 0;
+		EntityChanged( entityIndex );
 	}
 	m_Entities.pop_back(); // Remove last entity
 
@@ -305,6 +400,9 @@ void CEntityManager::DestroyAllEntities()
 		delete m_Entities.back();
 		m_Entities.pop_back();
 	}
+	m_EntityHashes.clear();
+	m_ChangedEntities.clear();
+	m_EntitiesHash = 0;
 
 	m_IsEnumerating = false; // Cancel any entity enumeration (entity list has changed)
 }
@@ -316,33 +414,329 @@ void CEntityManager::DestroyAllEntities()
 // Call all entity update functions. Pass the time since last update
 void CEntityManager::UpdateAllEntities( float updateTime )
 {
-	TUInt32 entity = 0;
-	while (entity < m_Entities.size())
+	CProfileZone zone( Profiler, "Update entities" );
+	CMemoryScope memory( Mem_Entities );
+
+	// One pass per kind so each kind is a single zone, rather than a zone per entity. Scenery
+	// does nothing on update so is skipped
+	static const EEntityKind kKinds[] = { Entity_Tank, Entity_Shell, Entity_HealthPack, Entity_AmmoPack };
+	static const char* const kZoneNames[] = { "Tank update", "Shell update", "Health pack update", "Ammo pack update" };
+	for (TUInt32 kind = 0; kind < sizeof(kKinds) / sizeof(kKinds[0]); ++kind)
 	{
-		// Update entity, if it returns false, then destroy it
-		if (!m_Entities[entity]->Update( updateTime ))
-		{
-			DestroyEntity(m_Entities[entity]->GetUID());
-		}
-		else
+		CProfileZone kindZone( Profiler, kZoneNames[kind] );
+
+		TUInt32 entity = 0;
+		while (entity < m_Entities.size())
 		{
-			++entity;
+			// Update entity, if it returns false, then destroy it. Destroying moves the last
+			// entity into this slot, so the slot is looked at again
+			if (m_Entities[entity]->GetKind() != kKinds[kind])
+			{
+				++entity;
+			}
+			else if (!m_Entities[entity]->Update( updateTime ))
+			{
+				DestroyEntity(m_Entities[entity]->GetUID());
+			}
+			else
+			{
+				EntityChanged( entity );
+				++entity;
+			}
 		}
 	}
 }
 
-// Render all entities
-void CEntityManager::RenderAllEntities()
+// Render all entities, levels of detail are chosen for the given camera
+void CEntityManager::RenderAllEntities( CCamera* camera )
 {
+	CProfileZone zone( Profiler, "Render entities" );
+
 	TEntityIter entity = m_Entities.begin();
 	while (entity != m_Entities.end())
 	{
-		(*entity)->Render();
+		(*entity)->Render( camera );
 		++entity;
 	}
 }
 
 
+/////////////////////////////////////
+// Snapshots
+
+// Write all entities to a snapshot in update order. Templates are written once by name, entities
+// refer to them by index
+void CEntityManager::SaveState( CSnapshot* pSnapshot )
+{
+	CProfileZone zone( Profiler, "Save entities" );
+
+	map<CEntityTemplate*, TUInt32> templateIndices;
+	pSnapshot->Write( static_cast<TUInt32>(m_Templates.size()) );
+	for (TTemplateIter entityTemplate = m_Templates.begin(); entityTemplate != m_Templates.end(); ++entityTemplate)
+	{
+		TUInt32 index = static_cast<TUInt32>(templateIndices.size());
+		templateIndices[entityTemplate->second] = index;
+		pSnapshot->WriteString( entityTemplate->first );
+	}
+
+	pSnapshot->Write( m_NextUID );
+	pSnapshot->Write( static_cast<TUInt32>(m_Entities.size()) );
+	CEntityTemplate* lastTemplate = 0;
+	TUInt32 lastTemplateIndex = 0;
+	for (TUInt32 entity = 0; entity < m_Entities.size(); ++entity)
+	{
+		CEntity* pEntity = m_Entities[entity];
+		EEntityKind kind = pEntity->GetKind();
+		pSnapshot->Write( static_cast<TUInt8>(kind) );
+		pSnapshot->Write( pEntity->GetUID() );
+		if (kind != Entity_Scenery)
+		{
+			// Entities of the same template are often together, e.g. shells fired in one update
+			if (pEntity->Template() != lastTemplate)
+			{
+				lastTemplate = pEntity->Template();
+				lastTemplateIndex = templateIndices[lastTemplate];
+			}
+			pSnapshot->Write( lastTemplateIndex );
+			pSnapshot->WriteString( pEntity->GetName() );
+			pEntity->SaveState( pSnapshot );
+		}
+	}
+}
+
+// Add all entities to a hash in update order, each hashed on its own first. Only the entities that
+// have changed since the last call are hashed again
+void CEntityManager::HashState( CStateHash* pHash, vector<TUInt64>* pEntityHashes /*= 0*/ )
+{
+	CProfileZone zone( Profiler, "Hash entities" );
+
+	for (TUInt32 changed = 0; changed < m_ChangedEntities.size(); ++changed)
+	{
+		// Entities may have been destroyed since, leaving the index past the end of the list
+		TUInt32 entity = m_ChangedEntities[changed];
+		if (entity >= m_Entities.size())
+		{
+			m_EntityHashes[entity].changed = false;
+			continue;
+		}
+
+		CEntity* pEntity = m_Entities[entity];
+		EEntityKind kind = pEntity->GetKind();
+		CStateHash entityHash;
+		entityHash.Add( pEntity->GetUID() );
+		entityHash.Add( static_cast<TUInt32>(kind) );
+		if (kind != Entity_Scenery)
+		{
+			pEntity->HashState( &entityHash );
+		}
+
+		// Replace this index's share of the total
+		SEntityHash& kept = m_EntityHashes[entity];
+		kept.hash = entityHash.Value();
+		CStateHash indexHash;
+		indexHash.Add( entity );
+		indexHash.Add( kept.hash );
+		m_EntitiesHash -= kept.inTotal;
+		kept.inTotal = indexHash.Value();
+		m_EntitiesHash += kept.inTotal;
+		kept.changed = false;
+	}
+	m_ChangedEntities.clear();
+
+	pHash->Add( m_NextUID );
+	pHash->Add( static_cast<TUInt32>(m_Entities.size()) );
+	pHash->Add( m_EntitiesHash );
+	if (pEntityHashes != 0)
+	{
+		pEntityHashes->resize( m_Entities.size() );
+		for (TUInt32 entity = 0; entity < m_Entities.size(); ++entity)
+		{
+			(*pEntityHashes)[entity] = m_EntityHashes[entity].hash;
+		}
+	}
+}
+
+// Replace the entities with those in a snapshot. The new list is built completely before
+// anything is changed, so a snapshot that does not match the scene leaves it as it was
+bool CEntityManager::LoadState( CSnapshot* pSnapshot )
+{
+	CProfileZone zone( Profiler, "Load entities" );
+	CMemoryScope memory( Mem_Entities );
+
+	// Templates by name, all must exist in the current scene
+	TUInt32 numTemplates = 0;
+	pSnapshot->Read( &numTemplates );
+	vector<CEntityTemplate*> templates;
+	for (TUInt32 entityTemplate = 0; entityTemplate < numTemplates && !pSnapshot->Failed(); ++entityTemplate)
+	{
+		string name;
+		pSnapshot->ReadString( &name );
+		templates.push_back( GetTemplate( name ) );
+		if (templates.back() == 0)
+		{
+			pSnapshot->Fail();
+		}
+	}
+
+	TEntityUID nextUID = 0;
+	TUInt32 numEntities = 0;
+	pSnapshot->Read( &nextUID );
+	pSnapshot->Read( &numEntities );
+	if (pSnapshot->Failed())
+	{
+		return false;
+	}
+
+	// Build the new entity list, reusing scenery and creating everything else
+	TEntities entities;
+	entities.reserve( numEntities );
+	vector<bool> reused( m_Entities.size(), false );
+	string name;
+	for (TUInt32 entity = 0; entity < numEntities; ++entity)
+	{
+		TUInt8 kind = 0;
+		TEntityUID UID = 0;
+		pSnapshot->Read( &kind );
+		pSnapshot->Read( &UID );
+		if (pSnapshot->Failed())
+		{
+			break;
+		}
+
+		if (kind == Entity_Scenery)
+		{
+			TUInt32 index;
+			if (!m_EntityUIDMap->LookUpKey( UID, &index ) || reused[index] ||
+			    m_Entities[index]->GetKind() != Entity_Scenery)
+			{
+				pSnapshot->Fail();
+				break;
+			}
+			reused[index] = true;
+			entities.push_back( m_Entities[index] );
+		}
+		else
+		{
+			TUInt32 templateIndex = 0;
+			pSnapshot->Read( &templateIndex );
+			pSnapshot->ReadString( &name );
+			CEntity* newEntity = 0;
+			if (!pSnapshot->Failed() && templateIndex < templates.size())
+			{
+				newEntity = CreateSnapshotEntity( static_cast<EEntityKind>(kind), templates[templateIndex], UID, name );
+			}
+			if (newEntity == 0)
+			{
+				pSnapshot->Fail();
+				break;
+			}
+			entities.push_back( newEntity );
+			newEntity->LoadState( pSnapshot );
+		}
+		if (pSnapshot->Failed())
+		{
+			break;
+		}
+	}
+
+	// On failure delete the entities created above, the existing ones are untouched
+	if (pSnapshot->Failed())
+	{
+		for (TUInt32 entity = 0; entity < entities.size(); ++entity)
+		{
+			if (entities[entity]->GetKind() != Entity_Scenery)
+			{
+				delete entities[entity];
+			}
+		}
+		return false;
+	}
+
+	// Delete the entities that were not reused, then use the new list
+	for (TUInt32 entity = 0; entity < m_Entities.size(); ++entity)
+	{
+		if (!reused[entity])
+		{
+			delete m_Entities[entity];
+		}
+	}
+	m_Entities.swap( entities );
+	m_EntityUIDMap->RemoveAllKeys();
+	m_EntityUIDMap->Reserve( static_cast<TUInt32>(m_Entities.size()) );
+	for (TUInt32 entity = 0; entity < m_Entities.size(); ++entity)
+	{
+		m_EntityUIDMap->SetKeyValue( m_Entities[entity]->GetUID(), entity );
+	}
+	m_NextUID = nextUID;
+
+	// Every entity is new or may have moved, so all are hashed again
+	m_EntityHashes.clear();
+	m_ChangedEntities.clear();
+	m_EntitiesHash = 0;
+	for (TUInt32 entity = 0; entity < m_Entities.size(); ++entity)
+	{
+		EntityChanged( entity );
+	}
+
+	m_IsEnumerating = false; // Cancel any entity enumeration (entity list has changed)
+	return true;
+}
+
+
+/////////////////////////////////////
+// Support functions
+
+// Mark the entity at the given index to be hashed again, adding a kept hash for a new index
+void CEntityManager::EntityChanged( TUInt32 index )
+{
+	if (index >= m_EntityHashes.size())
+	{
+		SEntityHash entityHash = { 0, 0, false };
+		m_EntityHashes.resize( index + 1, entityHash );
+	}
+	if (!m_EntityHashes[index].changed)
+	{
+		m_EntityHashes[index].changed = true;
+		m_ChangedEntities.push_back( index );
+	}
+}
+
+// Create an entity of the given class for a snapshot being restored. Returns 0 if the template is
+// not suitable (tanks need a tank template) or the class is unknown
+CEntity* CEntityManager::CreateSnapshotEntity( EEntityKind kind, CEntityTemplate* entityTemplate, TEntityUID UID,
+                                               const string& name )
+{
+	switch (kind)
+	{
+		case Entity_Tank:
+		{
+			CTankTemplate* tankTemplate = dynamic_cast<CTankTemplate*>(entityTemplate);
+			if (tankTemplate == 0)
+			{
+				return 0;
+			}
+			return new CTankEntity( tankTemplate, UID, 0, vector<CVector3>(), name );
+		}
+		case Entity_Shell:
+		{
+			return new CShellEntity( entityTemplate, UID, name );
+		}
+		case Entity_HealthPack:
+		{
+			return new CHealthEntity( entityTemplate, UID, name );
+		}
+		case Entity_AmmoPack:
+		{
+			return new CAmmoEntity( entityTemplate, UID, name );
+		}
+		default:
+		{
+			return 0;
+		}
+	}
+}
+
+
 } // namespace gen
 
 
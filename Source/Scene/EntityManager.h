@@ -60,6 +60,13 @@ public:
 	                                                   float acceleration, float turnSpeed,
 	                                                   float turretTurnSpeed, int maxHP, int shellDamage );
 
+	// Versions of the above for meshes that have already been loaded (e.g. by the scene
+	// loader). The template takes ownership of the mesh
+	CEntityTemplate* CreateTemplate( const string& type, const string& name, CMesh* mesh );
+	CTankTemplate* CreateTankTemplate( const string& type, const string& name, CMesh* mesh,
+	                                   float maxSpeed, float acceleration, float turnSpeed,
+	                                   float turretTurnSpeed, int maxHP, int shellDamage );
+
 
 	// Destroy the given template (name) - returns true if the template existed and was destroyed
 	bool DestroyTemplate( const string& name );
@@ -82,6 +89,20 @@ public:
 		const CVector3&  scale = CVector3( 1.0f, 1.0f, 1.0f )
 	);
 
+	// Version of the above taking the template itself, avoids looking up the template name when
+	// creating many entities
+	TEntityUID CreateEntity
+	(
+		CEntityTemplate* entityTemplate,
+		const string&    name,
+		const CVector3&  position,
+		const CVector3&  rotation,
+		const CVector3&  scale
+	);
+
+	// Reserve space for the given number of additional entities, before creating many at once
+	void ReserveEntities( TUInt32 numEntities );
+
 	// Create a tank, requires a tank template name and team number, may supply entity name and
 	// position. Returns the UID of the new entity
 	TEntityUID CreateTank
@@ -154,6 +175,10 @@ public:
 		return (*entityTemplate).second;
 	}
 
+	// Return the largest bounding radius of the meshes of templates with the given type, 0 if
+	// there are none
+	TFloat32 MaxBoundingRadius( const string& type );
+
 
 	// Return the number of entities
 	TUInt32 NumEntities() 
@@ -250,11 +275,37 @@ public:
 	// Update / Rendering
 
 	// Call all entity update functions - not the ideal method, OK for this example
-	// Pass the time since last update
+	// Pass the time since last update. Entities are updated a kind at a time (tanks, shells,
+	// then pickups), each kind timed as one profiler zone. An entity created during the update
+	// is updated in the same pass if its kind has not been updated yet
 	void UpdateAllEntities( float updateTime );
 
 	// Render all entities - not the ideal method, OK for this example
-	void RenderAllEntities();
+	// Levels of detail are chosen for the given camera
+	void RenderAllEntities( CCamera* camera );
+
+
+	/////////////////////////////////////
+	// Snapshots
+
+	// Write all entities to a snapshot, in update order. Scenery never changes once created, so
+	// only its UID is written
+	void SaveState( CSnapshot* pSnapshot );
+
+	// Replace the entities with those in a snapshot, keeping their UIDs and update order. Scenery
+	// is not recreated, the existing entities with the saved UIDs are kept - so a snapshot can only
+	// be restored into the scene it was taken from (or the same scene loaded again). Templates are
+	// found by name. Returns false and leaves the entities unchanged if the snapshot does not match
+	// the scene
+	bool LoadState( CSnapshot* pSnapshot );
+
+	// Add all entities to a hash in update order, to check that runs match. Each entity is hashed
+	// on its own and that hash added, so two runs can be compared entity by entity to find the
+	// first that differs - pass an array to receive them, indexed as for GetEntityAtIndex. Scenery
+	// never changes so only its UID is hashed. Entity hashes are kept between calls and only
+	// taken again for entities created, updated or moved in the list since the last call - all
+	// changes to the simulation are made in entity updates
+	void HashState( CStateHash* pHash, vector<TUInt64>* pEntityHashes = 0 );
 
 		
 /////////////////////////////////////
@@ -272,6 +323,27 @@ private:
 	typedef vector<CEntity*> TEntities;
 	typedef TEntities::iterator TEntityIter;
 
+	// Kept hash of the entity at the same index in the entity list, see HashState
+	struct SEntityHash
+	{
+		TUInt64 hash;      // Hash of the entity on its own
+		TUInt64 inTotal;   // Amount added to m_EntitiesHash for this index and hash, 0 if none
+		bool    changed;   // Entity must be hashed again, its index is in m_ChangedEntities
+	};
+
+
+	/////////////////////////////////////
+	// Support functions
+
+	// Create an entity of the given class for a snapshot being restored, its state is then read
+	// from the snapshot. Returns 0 if the template is not suitable
+	CEntity* CreateSnapshotEntity( EEntityKind kind, CEntityTemplate* entityTemplate, TEntityUID UID,
+	                               const string& name );
+
+	// Mark the entity at the given index to be hashed again by the next HashState. Call when an
+	// entity is added to the end of the list, updated or moved to another index
+	void EntityChanged( TUInt32 index );
+
 
 	/////////////////////////////////////
 	// Template Data
@@ -294,6 +366,15 @@ private:
 	// Entity IDs are provided using a single increasing integer
 	TEntityUID m_NextUID;
 
+	// Hash of each entity, by index as m_Entities, and the indexes of those to hash again. Kept
+	// hashes are not removed when entities are destroyed, so each index is listed at most once.
+	// The total of all entities is a sum of a hash of each index and entity hash, so it is kept up
+	// to date by taking out and adding in just the entities that change, yet still depends on the
+	// update order
+	vector<SEntityHash> m_EntityHashes;
+	vector<TUInt32>     m_ChangedEntities;
+	TUInt64             m_EntitiesHash;
+
 
 	/////////////////////////////////////
 	// Data for Entity Enumeration
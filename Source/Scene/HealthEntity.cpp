@@ -8,11 +8,13 @@
 #include "TankEntity.h"
 #include "EntityManager.h"
 #include "Messenger.h"
+#include "PickupIndex.h"
 
 namespace gen
 {
 	extern CEntityManager EntityManager;
 	extern CMessenger Messenger;
+	extern CPickupIndex Pickups;
 
 	/*-----------------------------------------------------------------------------------------
 		Health Entity Class
@@ -49,6 +51,9 @@ namespace gen
 				Position().y = 0.5f;
 				m_State = EHealthState::TimeOut;
 
+				// On the ground, so tanks can now find it
+				Pickups.AddPickup(Pickup_Health, GetUID(), Position());
+
 			} // End of if-else statment
 
 		}
@@ -81,6 +86,7 @@ namespace gen
 						m.from = GetUID();
 						Messenger.SendMessage(SystemUID, m);
 
+						Pickups.RemovePickup(Pickup_Health, GetUID());
 						return false;
 
 					} // End of if statment
@@ -99,6 +105,7 @@ namespace gen
 				m.from = GetUID();
 				Messenger.SendMessage(SystemUID, m);
 
+				Pickups.RemovePickup(Pickup_Health, GetUID());
 				return false;
 
 			} // End of if-else statment
@@ -109,4 +116,33 @@ namespace gen
 
 	} // End of Update class
 
+	// Write the health pack's state to a snapshot
+	void CHealthEntity::SaveState(CSnapshot* pSnapshot)
+	{
+		CEntity::SaveState(pSnapshot);
+		pSnapshot->Write(static_cast<TUInt32>(m_State));
+		pSnapshot->Write(m_LifeTime);
+		pSnapshot->Write(m_Amount);
+	}
+
+	// Read the health pack's state from a snapshot
+	void CHealthEntity::LoadState(CSnapshot* pSnapshot)
+	{
+		CEntity::LoadState(pSnapshot);
+		TUInt32 state;
+		pSnapshot->Read(&state);
+		pSnapshot->Read(&m_LifeTime);
+		pSnapshot->Read(&m_Amount);
+		m_State = (state == static_cast<TUInt32>(EHealthState::Dropping)) ? EHealthState::Dropping : EHealthState::TimeOut;
+	}
+
+	// Add the health pack's state to a hash
+	void CHealthEntity::HashState(CStateHash* pHash)
+	{
+		CEntity::HashState(pHash);
+		pHash->Add(static_cast<TUInt32>(m_State));
+		pHash->Add(m_LifeTime);
+		pHash->Add(m_Amount);
+	}
+
 } // namespace gen
\ No newline at end of file
@@ -63,6 +63,21 @@ namespace gen
 		// Virtual function
 		virtual bool Update( TFloat32 updateTime );
 
+		virtual EEntityKind GetKind()
+		{
+			return Entity_HealthPack;
+		}
+
+		/////////////////////////////////////
+		// Snapshots
+
+		// Write the health pack's state to a snapshot, or read it back
+		virtual void SaveState( CSnapshot* pSnapshot );
+		virtual void LoadState( CSnapshot* pSnapshot );
+
+		// Add the health pack's state to a hash
+		virtual void HashState( CStateHash* pHash );
+
 		// Returns true if the health box is not in Dropping state
 		const bool OnGround()
 		{
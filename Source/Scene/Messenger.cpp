@@ -5,6 +5,7 @@
 ********************************************/
 
 #include "Messenger.h"
+#include "MemoryTracker.h"
 
 namespace gen
 {
@@ -22,6 +23,8 @@ CMessenger Messenger;
 // Send the given message to a particular UID, does not check if the UID exists
 void CMessenger::SendMessage( TEntityUID to, const SMessage& msg )
 {
+	CMemoryScope memory( Mem_Messages );
+
 	// Simply insert the UID/message pair into the message map. It will be inserted next
 	// to any other pairs with the same UID
 	m_Messages.insert( UIDMsgPair( to, msg ) );
@@ -49,5 +52,53 @@ bool CMessenger::FetchMessage( TEntityUID to, SMessage* msg )
 }
 
 
+/////////////////////////////////////
+// Snapshots
+
+// Write all messages not yet fetched to a snapshot, in map order - by UID, then in the order sent
+void CMessenger::SaveState( CSnapshot* pSnapshot )
+{
+	pSnapshot->Write( static_cast<TUInt32>(m_Messages.size()) );
+	for (TMessageIter itMessage = m_Messages.begin(); itMessage != m_Messages.end(); ++itMessage)
+	{
+		pSnapshot->Write( itMessage->first );
+		pSnapshot->Write( itMessage->second );
+	}
+}
+
+// Replace the messages with those in a snapshot. Messages with the same UID are inserted after each
+// other, so are inserted again in the order they were sent
+void CMessenger::LoadState( CSnapshot* pSnapshot )
+{
+	CMemoryScope memory( Mem_Messages );
+
+	m_Messages.clear();
+	TUInt32 numMessages = 0;
+	pSnapshot->Read( &numMessages );
+	for (TUInt32 message = 0; message < numMessages && !pSnapshot->Failed(); ++message)
+	{
+		TEntityUID to;
+		SMessage msg;
+		pSnapshot->Read( &to );
+		pSnapshot->Read( &msg );
+		m_Messages.insert( m_Messages.end(), UIDMsgPair( to, msg ) );
+	}
+}
+
+// Add all messages not yet fetched to a hash. Each field is hashed separately so any padding added
+// to messages later is not
+void CMessenger::HashState( CStateHash* pHash )
+{
+	pHash->Add( static_cast<TUInt32>(m_Messages.size()) );
+	for (TMessageIter message = m_Messages.begin(); message != m_Messages.end(); ++message)
+	{
+		pHash->Add( message->first );
+		pHash->Add( static_cast<TUInt32>(message->second.type) );
+		pHash->Add( message->second.from );
+		pHash->Add( message->second.data );
+	}
+}
+
+
 
 } // namespace gen
@@ -11,6 +11,8 @@ using namespace std;
 
 #include "Defines.h"
 #include "Entity.h"
+#include "Snapshot.h"
+#include "StateHash.h"
 
 namespace gen
 {
@@ -91,6 +93,24 @@ public:
 	// pointer. Returns false if there are no messages for this UID
 	bool FetchMessage( TEntityUID to, SMessage* msg );
 
+	// Remove all messages not yet fetched
+	void Clear()
+	{
+		m_Messages.clear();
+	}
+
+
+	/////////////////////////////////////
+	// Snapshots
+
+	// Write all messages not yet fetched to a snapshot, or replace them with those read back.
+	// The messages for each UID are fetched in the same order after restoring
+	void SaveState( CSnapshot* pSnapshot );
+	void LoadState( CSnapshot* pSnapshot );
+
+	// Add all messages not yet fetched to a hash, in the order they will be fetched
+	void HashState( CStateHash* pHash );
+
 
 /////////////////////////////////////
 //	Private interface
@@ -0,0 +1,244 @@
+/*******************************************
+	NavGrid.cpp
+
+	Navigation grid and flow fields for
+	moving tanks around the scenery
+********************************************/
+
+#include <queue>
+#include <functional>
+#include "NavGrid.h"
+
+namespace gen
+{
+
+// Neighbour offsets - four straight steps then four diagonals
+const TInt32   kNeighbourX[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+const TInt32   kNeighbourZ[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+const TFloat32 kNeighbourCost[8] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.4142136f, 1.4142136f, 1.4142136f, 1.4142136f };
+
+
+// Constructor creates an empty grid
+CNavGrid::CNavGrid()
+{
+	m_CellSize = 1.0f;
+	m_Width = 0;
+	m_Height = 0;
+	m_UseCounter = 0;
+}
+
+
+/////////////////////////////////////
+// Creation
+
+// Bake the grid over the rectangle between minXZ and maxXZ with square cells of the given size
+void CNavGrid::Bake
+(
+	const CCollisionWorld& collisionWorld,
+	const CVector3&        minXZ,
+	const CVector3&        maxXZ,
+	TFloat32               cellSize,
+	TFloat32               clearance
+)
+{
+	Clear();
+
+	m_Origin = CVector3( minXZ.x, 0.0f, minXZ.z );
+	m_CellSize = cellSize;
+	m_Width = Max( static_cast<TUInt32>(Ceil( (maxXZ.x - minXZ.x) / cellSize )), 1u );
+	m_Height = Max( static_cast<TUInt32>(Ceil( (maxXZ.z - minXZ.z) / cellSize )), 1u );
+	m_Blocked.resize( m_Width * m_Height );
+
+	for (TUInt32 cell = 0; cell < m_Blocked.size(); ++cell)
+	{
+		m_Blocked[cell] = collisionWorld.SphereIntersect( CellCentre( cell, clearance ), clearance ) ? 1 : 0;
+	}
+}
+
+// Remove the grid and all flow fields
+void CNavGrid::Clear()
+{
+	m_Blocked.clear();
+	m_Width = 0;
+	m_Height = 0;
+	m_FlowFields.clear();
+}
+
+
+/////////////////////////////////////
+// Navigation
+
+// Return a point to steer towards to reach the goal from the given position
+CVector3 CNavGrid::SteerTarget( const CVector3& position, const CVector3& goal )
+{
+	TUInt32 startCell, goalCell;
+	if (!CellAt( position, &startCell ) || !CellAt( goal, &goalCell ) || m_Blocked[goalCell])
+	{
+		return goal;
+	}
+
+	// Follow the flow a few cells ahead, stopping at the goal
+	const SFlowField& field = GetFlowField( goalCell );
+	TUInt32 cell = startCell;
+	for (TUInt32 step = 0; step < kLookAheadCells; ++step)
+	{
+		TUInt8 direction = field.directions[cell];
+		if (direction == kAtGoal)
+		{
+			return goal;
+		}
+		if (direction == kNoPath)
+		{
+			// Start is blocked or cut off, head straight for the goal rather than stop
+			return (step == 0) ? goal : CellCentre( cell, position.y );
+		}
+		cell += kNeighbourZ[direction] * static_cast<TInt32>(m_Width) + kNeighbourX[direction];
+	}
+	return CellCentre( cell, position.y );
+}
+
+
+/////////////////////////////////////
+// Support functions
+
+// Get the cell containing a point, returns false if off the grid
+bool CNavGrid::CellAt( const CVector3& point, TUInt32* pCell ) const
+{
+	TFloat32 x = (point.x - m_Origin.x) / m_CellSize;
+	TFloat32 z = (point.z - m_Origin.z) / m_CellSize;
+	if (x < 0.0f || z < 0.0f || x >= m_Width || z >= m_Height)
+	{
+		return false;
+	}
+	*pCell = static_cast<TUInt32>(z) * m_Width + static_cast<TUInt32>(x);
+	return true;
+}
+
+// World position of a cell's centre at the given height
+CVector3 CNavGrid::CellCentre( TUInt32 cell, TFloat32 y ) const
+{
+	return CVector3( m_Origin.x + ((cell % m_Width) + 0.5f) * m_CellSize, y,
+	                 m_Origin.z + ((cell / m_Width) + 0.5f) * m_CellSize );
+}
+
+// Returns true if a step from a cell in the given neighbour direction is allowed
+bool CNavGrid::CanStep( TUInt32 x, TUInt32 z, TUInt32 direction ) const
+{
+	TInt32 nx = static_cast<TInt32>(x) + kNeighbourX[direction];
+	TInt32 nz = static_cast<TInt32>(z) + kNeighbourZ[direction];
+	if (nx < 0 || nz < 0 || nx >= static_cast<TInt32>(m_Width) || nz >= static_cast<TInt32>(m_Height))
+	{
+		return false;
+	}
+	if (m_Blocked[nz * m_Width + nx])
+	{
+		return false;
+	}
+
+	// Diagonal steps need both the straight cells they pass between to be open
+	if (direction >= 4)
+	{
+		return !m_Blocked[z * m_Width + nx] && !m_Blocked[nz * m_Width + x];
+	}
+	return true;
+}
+
+// Get the flow field for a goal cell, building it if necessary
+const CNavGrid::SFlowField& CNavGrid::GetFlowField( TUInt32 goalCell )
+{
+	++m_UseCounter;
+	map<TUInt32, SFlowField>::iterator found = m_FlowFields.find( goalCell );
+	if (found != m_FlowFields.end())
+	{
+		found->second.lastUsed = m_UseCounter;
+		return found->second;
+	}
+
+	// Make room by discarding the least recently used field
+	if (m_FlowFields.size() >= kMaxFlowFields)
+	{
+		map<TUInt32, SFlowField>::iterator oldest = m_FlowFields.begin();
+		for (map<TUInt32, SFlowField>::iterator field = m_FlowFields.begin(); field != m_FlowFields.end(); ++field)
+		{
+			if (field->second.lastUsed < oldest->second.lastUsed)
+			{
+				oldest = field;
+			}
+		}
+		m_FlowFields.erase( oldest );
+	}
+
+	SFlowField& field = m_FlowFields[goalCell];
+	BuildFlowField( goalCell, &field );
+	field.lastUsed = m_UseCounter;
+	return field;
+}
+
+// Build the flow field for a goal cell. The integration field (cost to reach the goal from
+// each cell) is found with Dijkstra's algorithm outward from the goal, then each cell points
+// at its cheapest neighbour
+void CNavGrid::BuildFlowField( TUInt32 goalCell, SFlowField* pField ) const
+{
+	TUInt32 numCells = m_Width * m_Height;
+	vector<TFloat32> costs( numCells, FLT_MAX );
+
+	typedef pair<TFloat32, TUInt32> TOpenCell; // Cost, cell
+	priority_queue< TOpenCell, vector<TOpenCell>, greater<TOpenCell> > open;
+	costs[goalCell] = 0.0f;
+	open.push( TOpenCell( 0.0f, goalCell ) );
+	while (!open.empty())
+	{
+		TOpenCell current = open.top();
+		open.pop();
+		if (current.first > costs[current.second]) continue; // Already reached more cheaply
+
+		TUInt32 x = current.second % m_Width;
+		TUInt32 z = current.second / m_Width;
+		for (TUInt32 direction = 0; direction < 8; ++direction)
+		{
+			// Steps are symmetric, so a cell reachable from here can step back here
+			if (!CanStep( x, z, direction )) continue;
+
+			TUInt32 neighbour = (z + kNeighbourZ[direction]) * m_Width + (x + kNeighbourX[direction]);
+			TFloat32 cost = current.first + kNeighbourCost[direction];
+			if (cost < costs[neighbour])
+			{
+				costs[neighbour] = cost;
+				open.push( TOpenCell( cost, neighbour ) );
+			}
+		}
+	}
+
+	// Point each cell at its cheapest neighbour
+	pField->directions.resize( numCells );
+	for (TUInt32 cell = 0; cell < numCells; ++cell)
+	{
+		if (cell == goalCell)
+		{
+			pField->directions[cell] = kAtGoal;
+			continue;
+		}
+		TUInt8 best = kNoPath;
+		TFloat32 bestCost = costs[cell];
+		if (bestCost < FLT_MAX)
+		{
+			TUInt32 x = cell % m_Width;
+			TUInt32 z = cell / m_Width;
+			for (TUInt32 direction = 0; direction < 8; ++direction)
+			{
+				if (!CanStep( x, z, direction )) continue;
+
+				TUInt32 neighbour = (z + kNeighbourZ[direction]) * m_Width + (x + kNeighbourX[direction]);
+				if (costs[neighbour] < bestCost)
+				{
+					bestCost = costs[neighbour];
+					best = static_cast<TUInt8>(direction);
+				}
+			}
+		}
+		pField->directions[cell] = best;
+	}
+}
+
+
+} // namespace gen
@@ -0,0 +1,168 @@
+/*******************************************
+	NavGrid.h
+
+	Navigation grid and flow fields for
+	moving tanks around the scenery
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <map>
+using namespace std;
+
+#include "Defines.h"
+#include "CVector3.h"
+#include "CollisionWorld.h"
+
+namespace gen
+{
+
+// A grid over the ground (x/z plane) marking which cells tanks can drive through, baked once
+// from the collision world after the scenery is in place. Paths are found with flow fields:
+// for a goal, the cost to reach it is found from every cell at once and each cell stores the
+// direction to the neighbour nearest the goal. A flow field is built the first time a goal is
+// used and then shared by every tank heading there, so pathing cost is per goal rather than
+// per tank. A limited number of recently used fields are kept
+class CNavGrid
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty grid
+	CNavGrid();
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CNavGrid( const CNavGrid& );
+	CNavGrid& operator=( const CNavGrid& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	/////////////////////////////////////
+	// Creation
+
+	// Bake the grid over the rectangle between minXZ and maxXZ (y ignored) with square cells
+	// of the given size. Cells are blocked where a sphere of radius clearance, just above the
+	// ground at the cell centre, touches the scenery
+	void Bake
+	(
+		const CCollisionWorld& collisionWorld,
+		const CVector3&        minXZ,
+		const CVector3&        maxXZ,
+		TFloat32               cellSize,
+		TFloat32               clearance
+	);
+
+	// Remove the grid and all flow fields
+	void Clear();
+
+
+	/////////////////////////////////////
+	// Navigation
+
+	// Return a point to steer towards to reach the goal from the given position, following the
+	// flow field for the goal. Returns the goal itself when it is close, when either point is
+	// off the grid or blocked, or when there is no path
+	CVector3 SteerTarget( const CVector3& position, const CVector3& goal );
+
+
+	/////////////////////////////////////
+	// Getters
+
+	bool IsEmpty() const
+	{
+		return m_Blocked.empty();
+	}
+
+	TUInt32 Width() const
+	{
+		return m_Width;
+	}
+
+	TUInt32 Height() const
+	{
+		return m_Height;
+	}
+
+	// Number of flow fields currently held
+	TUInt32 NumFlowFields() const
+	{
+		return static_cast<TUInt32>(m_FlowFields.size());
+	}
+
+	// Returns true if the cell containing the given point is blocked or off the grid
+	bool IsBlocked( const CVector3& point ) const
+	{
+		TUInt32 cell;
+		return !CellAt( point, &cell ) || m_Blocked[cell] != 0;
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	/////////////////////////////////////
+	// Types
+
+	// Flow field for a single goal cell - one direction per cell (an index into the neighbour
+	// offsets), kAtGoal for the goal cell itself, kNoPath where the goal cannot be reached
+	struct SFlowField
+	{
+		vector<TUInt8> directions;
+		TUInt32        lastUsed; // For discarding least recently used fields
+	};
+
+	static const TUInt8 kAtGoal = 8;
+	static const TUInt8 kNoPath = 0xff;
+
+	// Most flow fields kept at once
+	static const TUInt32 kMaxFlowFields = 32;
+
+	// Cells followed along the flow to choose the steering target
+	static const TUInt32 kLookAheadCells = 2;
+
+
+	/////////////////////////////////////
+	// Support functions
+
+	// Get the cell containing a point, returns false if off the grid
+	bool CellAt( const CVector3& point, TUInt32* pCell ) const;
+
+	// World position of a cell's centre at the given height
+	CVector3 CellCentre( TUInt32 cell, TFloat32 y ) const;
+
+	// Returns true if a step from a cell in the given neighbour direction is allowed - the
+	// neighbour must be on the grid and open, and diagonal steps may not cut blocked corners
+	bool CanStep( TUInt32 x, TUInt32 z, TUInt32 direction ) const;
+
+	// Get the flow field for a goal cell, building it if necessary
+	const SFlowField& GetFlowField( TUInt32 goalCell );
+
+	// Build the flow field for a goal cell
+	void BuildFlowField( TUInt32 goalCell, SFlowField* pField ) const;
+
+
+	/////////////////////////////////////
+	// Data
+
+	// Grid layout, cell (x, z) is at index z * m_Width + x
+	CVector3         m_Origin;   // Corner of cell (0, 0)
+	TFloat32         m_CellSize;
+	TUInt32          m_Width;
+	TUInt32          m_Height;
+	vector<TUInt8>   m_Blocked;  // Non-zero for blocked cells
+
+	// Flow fields by goal cell
+	map<TUInt32, SFlowField> m_FlowFields;
+	TUInt32                  m_UseCounter;
+};
+
+
+} // namespace gen
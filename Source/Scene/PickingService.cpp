@@ -0,0 +1,185 @@
+/*******************************************
+	PickingService.cpp
+
+	Finds the entity nearest to a point on
+	screen, e.g. under the mouse cursor
+********************************************/
+
+#include "PickingService.h"
+#include "CVector4.h"
+
+namespace gen
+{
+
+// Constructor creates an empty service with grid cells of the given size in pixels
+CPickingService::CPickingService( TUInt32 cellSize /*= kDefaultCellSize*/ )
+{
+	m_CellSize = cellSize;
+	Clear( 0, 0 );
+}
+
+
+/////////////////////////////////////
+// Adding entities
+
+// Remove all entities, ready to add those for a new frame with the given viewport size
+void CPickingService::Clear( TUInt32 viewportWidth, TUInt32 viewportHeight )
+{
+	m_ViewportWidth = static_cast<TFloat32>(viewportWidth);
+	m_ViewportHeight = static_cast<TFloat32>(viewportHeight);
+	m_NumCellsX = Max( (viewportWidth + m_CellSize - 1) / m_CellSize, 1u );
+	m_NumCellsY = Max( (viewportHeight + m_CellSize - 1) / m_CellSize, 1u );
+	m_Points.clear();
+	m_Binned = false;
+}
+
+// Add an entity at the given pixel position, ignored if off screen
+void CPickingService::Add( TEntityUID UID, const CVector2& pixel )
+{
+	if (pixel.x >= 0.0f && pixel.x < m_ViewportWidth && pixel.y >= 0.0f && pixel.y < m_ViewportHeight)
+	{
+		SPoint point = { UID, pixel.x, pixel.y };
+		m_Points.push_back( point );
+		m_Binned = false;
+	}
+}
+
+// Add an entity at the given world position, projected with the given view-projection matrix
+void CPickingService::Add( TEntityUID UID, const CVector3& position, const CMatrix4x4& viewProj )
+{
+	// Same projection as CCamera::PixelFromWorldPt
+	CVector4 projected = CVector4( position, 1.0f ) * viewProj;
+	if (projected.w <= 0.0f)
+	{
+		return;
+	}
+	TFloat32 invW = 1.0f / projected.w;
+	Add( UID, CVector2( (projected.x * invW + 1.0f) * m_ViewportWidth * 0.5f,
+	                    (1.0f - projected.y * invW) * m_ViewportHeight * 0.5f ) );
+}
+
+
+/////////////////////////////////////
+// Queries
+
+// Find the entity nearest to the given pixel position within maxDistance pixels
+bool CPickingService::Nearest( const CVector2& pixel, TFloat32 maxDistance, TEntityUID* pUID,
+                               TFloat32* pDistance /*= 0*/ )
+{
+	if (m_Points.empty())
+	{
+		return false;
+	}
+	if (!m_Binned)
+	{
+		Bin();
+	}
+
+	// Cells that the search circle can reach, the point itself may be off screen
+	TInt32 minX = static_cast<TInt32>(floorf( (pixel.x - maxDistance) / m_CellSize ));
+	TInt32 maxX = static_cast<TInt32>(floorf( (pixel.x + maxDistance) / m_CellSize ));
+	TInt32 minY = static_cast<TInt32>(floorf( (pixel.y - maxDistance) / m_CellSize ));
+	TInt32 maxY = static_cast<TInt32>(floorf( (pixel.y + maxDistance) / m_CellSize ));
+	minX = Max( minX, 0 );
+	minY = Max( minY, 0 );
+	maxX = Min( maxX, static_cast<TInt32>(m_NumCellsX) - 1 );
+	maxY = Min( maxY, static_cast<TInt32>(m_NumCellsY) - 1 );
+	if (minX > maxX || minY > maxY)
+	{
+		return false;
+	}
+
+	// Search rings of cells outwards from the cell under the point (clamped onto the grid). Any
+	// point in ring n is at least (n - 1) cells away, so stop once the nearest so far is closer
+	TInt32 centreX = Min( Max( static_cast<TInt32>(floorf( pixel.x / m_CellSize )), minX ), maxX );
+	TInt32 centreY = Min( Max( static_cast<TInt32>(floorf( pixel.y / m_CellSize )), minY ), maxY );
+	TInt32 maxRing = Max( Max( centreX - minX, maxX - centreX ), Max( centreY - minY, maxY - centreY ) );
+	TFloat32 nearestDistanceSquared = maxDistance * maxDistance;
+	const SPoint* pNearest = 0;
+	for (TInt32 ring = 0; ring <= maxRing; ++ring)
+	{
+		if (pNearest != 0)
+		{
+			TFloat32 ringDistance = static_cast<TFloat32>((ring - 1) * static_cast<TInt32>(m_CellSize));
+			if (ringDistance * ringDistance >= nearestDistanceSquared)
+			{
+				break;
+			}
+		}
+
+		for (TInt32 y = Max( centreY - ring, minY ); y <= Min( centreY + ring, maxY ); ++y)
+		{
+			// Whole rows at the top and bottom of the ring, only the two ends in between
+			bool edgeRow = (y == centreY - ring || y == centreY + ring);
+			TInt32 step = edgeRow ? 1 : 2 * ring;
+			for (TInt32 x = centreX - ring; x <= centreX + ring; x += Max( step, 1 ))
+			{
+				if (x < minX || x > maxX)
+				{
+					continue;
+				}
+				TUInt32 cell = y * m_NumCellsX + x;
+				for (TUInt32 point = m_CellStarts[cell]; point < m_CellStarts[cell + 1]; ++point)
+				{
+					const SPoint& candidate = m_SortedPoints[point];
+					TFloat32 dx = candidate.x - pixel.x;
+					TFloat32 dy = candidate.y - pixel.y;
+					TFloat32 distanceSquared = dx * dx + dy * dy;
+					if (distanceSquared < nearestDistanceSquared)
+					{
+						nearestDistanceSquared = distanceSquared;
+						pNearest = &candidate;
+					}
+				}
+			}
+		}
+	}
+
+	if (pNearest == 0)
+	{
+		return false;
+	}
+	*pUID = pNearest->UID;
+	if (pDistance != 0)
+	{
+		*pDistance = Sqrt( nearestDistanceSquared );
+	}
+	return true;
+}
+
+
+/////////////////////////////////////
+// Grid
+
+// Sort the points into grid cells, a counting sort so binning is linear in the number of points
+void CPickingService::Bin()
+{
+	TUInt32 numCells = m_NumCellsX * m_NumCellsY;
+	m_CellStarts.assign( numCells + 1, 0 );
+	for (TUInt32 point = 0; point < m_Points.size(); ++point)
+	{
+		++m_CellStarts[CellY( m_Points[point].y ) * m_NumCellsX + CellX( m_Points[point].x ) + 1];
+	}
+	for (TUInt32 cell = 0; cell < numCells; ++cell)
+	{
+		m_CellStarts[cell + 1] += m_CellStarts[cell];
+	}
+
+	// Fill each cell from its start, then restore the starts
+	m_SortedPoints.resize( m_Points.size() );
+	for (TUInt32 point = 0; point < m_Points.size(); ++point)
+	{
+		TUInt32 cell = CellY( m_Points[point].y ) * m_NumCellsX + CellX( m_Points[point].x );
+		m_SortedPoints[m_CellStarts[cell]++] = m_Points[point];
+	}
+	for (TUInt32 cell = numCells; cell > 0; --cell)
+	{
+		m_CellStarts[cell] = m_CellStarts[cell - 1];
+	}
+	m_CellStarts[0] = 0;
+
+	m_Binned = true;
+}
+
+
+} // namespace gen
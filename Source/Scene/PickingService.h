@@ -0,0 +1,129 @@
+/*******************************************
+	PickingService.h
+
+	Finds the entity nearest to a point on
+	screen, e.g. under the mouse cursor
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "CVector2.h"
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "Entity.h"
+
+namespace gen
+{
+
+// Holds the screen positions of the pickable entities for the current frame. Positions are added
+// each frame, usually already projected by other work on screen positions (e.g. text labels), and
+// are only binned into a grid of screen cells when the first query is made, so a frame without a
+// click costs just the adds. Queries search outwards from the cell under the point, stopping as
+// soon as no nearer entity can remain
+class CPickingService
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty service with grid cells of the given size in pixels
+	CPickingService( TUInt32 cellSize = kDefaultCellSize );
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CPickingService( const CPickingService& );
+	CPickingService& operator=( const CPickingService& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Default size of grid cells in pixels
+	static const TUInt32 kDefaultCellSize = 32;
+
+
+	/////////////////////////////////////
+	// Adding entities
+
+	// Remove all entities, ready to add those for a new frame with the given viewport size
+	void Clear( TUInt32 viewportWidth, TUInt32 viewportHeight );
+
+	// Add an entity at the given pixel position, ignored if off screen
+	void Add( TEntityUID UID, const CVector2& pixel );
+
+	// Add an entity at the given world position, projected with the given view-projection matrix
+	// (see CCamera::GetViewProjMatrix). Ignored if behind the camera or off screen
+	void Add( TEntityUID UID, const CVector3& position, const CMatrix4x4& viewProj );
+
+
+	/////////////////////////////////////
+	// Queries
+
+	// Find the entity nearest to the given pixel position within maxDistance pixels. Returns
+	// false if there is none, otherwise returns its UID and optionally the distance in pixels
+	bool Nearest( const CVector2& pixel, TFloat32 maxDistance, TEntityUID* pUID, TFloat32* pDistance = 0 );
+
+	// Number of entities added since the last Clear
+	TUInt32 NumEntities() const
+	{
+		return static_cast<TUInt32>(m_Points.size());
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	/////////////////////////////////////
+	// Types
+
+	struct SPoint
+	{
+		TEntityUID UID;
+		TFloat32   x;
+		TFloat32   y;
+	};
+
+
+	/////////////////////////////////////
+	// Grid
+
+	// Sort the points into grid cells
+	void Bin();
+
+	// Grid cell containing a pixel position, which must be on screen
+	TUInt32 CellX( TFloat32 x ) const
+	{
+		return Min( static_cast<TUInt32>(x) / m_CellSize, m_NumCellsX - 1 );
+	}
+	TUInt32 CellY( TFloat32 y ) const
+	{
+		return Min( static_cast<TUInt32>(y) / m_CellSize, m_NumCellsY - 1 );
+	}
+
+
+	/////////////////////////////////////
+	// Data
+
+	TUInt32  m_CellSize;
+	TFloat32 m_ViewportWidth;
+	TFloat32 m_ViewportHeight;
+	TUInt32  m_NumCellsX;
+	TUInt32  m_NumCellsY;
+
+	// Points as added, then the same points ordered by cell once binned. Cell c holds the sorted
+	// points from m_CellStarts[c] to m_CellStarts[c + 1]
+	vector<SPoint>  m_Points;
+	vector<SPoint>  m_SortedPoints;
+	vector<TUInt32> m_CellStarts;
+	bool            m_Binned;
+};
+
+
+} // namespace gen
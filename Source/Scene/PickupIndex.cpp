@@ -0,0 +1,164 @@
+/*******************************************
+	PickupIndex.cpp
+
+	Spatial index of the health and ammo packs
+	on the ground, with claims by tanks
+********************************************/
+
+#include "PickupIndex.h"
+
+namespace gen
+{
+
+/////////////////////////////////////
+// Pack registration
+
+// Add a pack that has landed at the given position
+void CPickupIndex::AddPickup( EPickupType type, TEntityUID UID, const CVector3& position )
+{
+	SPickupSet& set = m_Pickups[type];
+	if (set.packIndices.find( UID ) != set.packIndices.end())
+	{
+		return;
+	}
+
+	SPickup pack;
+	pack.UID = UID;
+	pack.position = position;
+	pack.claimant = kNoPickup;
+	set.packIndices[UID] = static_cast<TUInt32>(set.packs.size());
+	set.packs.push_back( pack );
+	set.treeDirty = true;
+}
+
+// Remove a pack (collected or expired), any claim on it is dropped
+void CPickupIndex::RemovePickup( EPickupType type, TEntityUID UID )
+{
+	SPickupSet& set = m_Pickups[type];
+	map<TEntityUID, TUInt32>::iterator found = set.packIndices.find( UID );
+	if (found == set.packIndices.end())
+	{
+		return;
+	}
+
+	// Move the last pack into the removed one's place
+	TUInt32 index = found->second;
+	set.packIndices.erase( found );
+	if (index != set.packs.size() - 1)
+	{
+		set.packs[index] = set.packs.back();
+		set.packIndices[set.packs[index].UID] = index;
+	}
+	set.packs.pop_back();
+	set.treeDirty = true;
+}
+
+// Remove all packs
+void CPickupIndex::Clear()
+{
+	for (TUInt32 type = 0; type < kNumPickupTypes; ++type)
+	{
+		m_Pickups[type].packs.clear();
+		m_Pickups[type].packIndices.clear();
+		m_Pickups[type].tree.Clear();
+		m_Pickups[type].treeDirty = false;
+	}
+}
+
+
+/////////////////////////////////////
+// Snapshots
+
+// Write the packs and their claims to a snapshot
+void CPickupIndex::SaveState( CSnapshot* pSnapshot )
+{
+	for (TUInt32 type = 0; type < kNumPickupTypes; ++type)
+	{
+		pSnapshot->WriteArray( m_Pickups[type].packs );
+	}
+}
+
+// Replace the packs with those in a snapshot, the trees are rebuilt when next queried
+void CPickupIndex::LoadState( CSnapshot* pSnapshot )
+{
+	for (TUInt32 type = 0; type < kNumPickupTypes; ++type)
+	{
+		SPickupSet& set = m_Pickups[type];
+		pSnapshot->ReadArray( &set.packs );
+		set.packIndices.clear();
+		for (TUInt32 pack = 0; pack < set.packs.size(); ++pack)
+		{
+			set.packIndices[set.packs[pack].UID] = pack;
+		}
+		set.tree.Clear();
+		set.treeDirty = true;
+	}
+}
+
+
+/////////////////////////////////////
+// Claims
+
+// Find and claim the nearest pack of the given type that is unclaimed or already claimed by
+// this tank. Any different pack previously claimed is released
+bool CPickupIndex::ClaimNearest
+(
+	EPickupType     type,
+	const CVector3& position,
+	TEntityUID      claimant,
+	TEntityUID*     pClaim,
+	CVector3*       pPickupPosition,
+	TFloat32        maxDistance /*= 1000.0f*/
+)
+{
+	SPickupSet& set = m_Pickups[type];
+
+	// Rebuild the tree if packs have changed since the last query
+	if (set.treeDirty)
+	{
+		vector<SAABB> boxes( set.packs.size() );
+		for (TUInt32 pack = 0; pack < set.packs.size(); ++pack)
+		{
+			boxes[pack].minBounds = set.packs[pack].position;
+			boxes[pack].maxBounds = set.packs[pack].position;
+		}
+		set.tree.Build( boxes.empty() ? 0 : &boxes[0], static_cast<TUInt32>(boxes.size()) );
+		set.treeDirty = false;
+	}
+
+	const vector<SPickup>& packs = set.packs;
+	auto available = [&]( TUInt32 pack ) -> bool
+	{
+		return packs[pack].claimant == kNoPickup || packs[pack].claimant == claimant;
+	};
+	TUInt32 nearest;
+	if (set.tree.NearestQuery( position, maxDistance, 1, available, &nearest ) == 0)
+	{
+		ReleaseClaim( type, claimant, pClaim );
+		return false;
+	}
+
+	if (set.packs[nearest].UID != *pClaim)
+	{
+		ReleaseClaim( type, claimant, pClaim );
+		set.packs[nearest].claimant = claimant;
+		*pClaim = set.packs[nearest].UID;
+	}
+	*pPickupPosition = set.packs[nearest].position;
+	return true;
+}
+
+// Release a claim, the claim is set to kNoPickup
+void CPickupIndex::ReleaseClaim( EPickupType type, TEntityUID claimant, TEntityUID* pClaim )
+{
+	SPickupSet& set = m_Pickups[type];
+	map<TEntityUID, TUInt32>::iterator found = set.packIndices.find( *pClaim );
+	if (found != set.packIndices.end() && set.packs[found->second].claimant == claimant)
+	{
+		set.packs[found->second].claimant = kNoPickup;
+	}
+	*pClaim = kNoPickup;
+}
+
+
+} // namespace gen
@@ -0,0 +1,149 @@
+/*******************************************
+	PickupIndex.h
+
+	Spatial index of the health and ammo packs
+	on the ground, with claims by tanks
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <map>
+using namespace std;
+
+#include "Defines.h"
+#include "CVector3.h"
+#include "AABBTree.h"
+#include "Entity.h"
+#include "Snapshot.h"
+
+namespace gen
+{
+
+// Kinds of pickup held in the index
+enum EPickupType
+{
+	Pickup_Health,
+	Pickup_Ammo,
+	kNumPickupTypes
+};
+
+
+// Packs are added to the index when they land and removed when collected or expired. Tanks
+// find the nearest pack of a given type and claim it, so other tanks look for a different one.
+// Packs are static once on the ground, so each type keeps an AABB tree that is only rebuilt
+// (on the next query) after packs have been added or removed
+class CPickupIndex
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty index
+	CPickupIndex() {}
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CPickupIndex( const CPickupIndex& );
+	CPickupIndex& operator=( const CPickupIndex& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Used for no pack / no claimant
+	static const TEntityUID kNoPickup = 0xffffffff;
+
+
+	/////////////////////////////////////
+	// Pack registration
+
+	// Add a pack that has landed at the given position
+	void AddPickup( EPickupType type, TEntityUID UID, const CVector3& position );
+
+	// Remove a pack (collected or expired), any claim on it is dropped
+	void RemovePickup( EPickupType type, TEntityUID UID );
+
+	// Remove all packs
+	void Clear();
+
+
+	/////////////////////////////////////
+	// Snapshots
+
+	// Write the packs and their claims to a snapshot, or replace them with those read back. Pack
+	// order is kept so the same pack is chosen between equally near ones after restoring
+	void SaveState( CSnapshot* pSnapshot );
+	void LoadState( CSnapshot* pSnapshot );
+
+
+	/////////////////////////////////////
+	// Claims
+
+	// Find the nearest pack of the given type that is unclaimed or already claimed by this tank,
+	// within maxDistance, and claim it. pClaim holds the tank's current claim (or kNoPickup) on
+	// entry, if a different pack is chosen the old claim is released. Returns false and releases
+	// the claim if there is no pack available
+	bool ClaimNearest
+	(
+		EPickupType     type,
+		const CVector3& position,
+		TEntityUID      claimant,
+		TEntityUID*     pClaim,
+		CVector3*       pPickupPosition,
+		TFloat32        maxDistance = 1000.0f
+	);
+
+	// Release a claim, e.g. the tank no longer needs the pack or has been destroyed. The claim
+	// is set to kNoPickup
+	void ReleaseClaim( EPickupType type, TEntityUID claimant, TEntityUID* pClaim );
+
+
+	/////////////////////////////////////
+	// Getters
+
+	TUInt32 NumPickups( EPickupType type ) const
+	{
+		return static_cast<TUInt32>(m_Pickups[type].packs.size());
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	/////////////////////////////////////
+	// Types
+
+	struct SPickup
+	{
+		TEntityUID UID;
+		CVector3   position;
+		TEntityUID claimant;
+	};
+
+	// All the packs of a single type, the tree indexes into the packs array
+	struct SPickupSet
+	{
+		vector<SPickup>          packs;
+		map<TEntityUID, TUInt32> packIndices; // UID to index in packs
+		CAABBTree                tree;
+		bool                     treeDirty;
+
+		SPickupSet()
+		{
+			treeDirty = false;
+		}
+	};
+
+
+	/////////////////////////////////////
+	// Data
+
+	SPickupSet m_Pickups[kNumPickupTypes];
+};
+
+
+} // namespace gen
@@ -0,0 +1,237 @@
+/*******************************************
+	RaycastService.cpp
+
+	Batched ray queries against the scenery
+	and the tanks
+********************************************/
+
+#include "RaycastService.h"
+#include "Profiler.h"
+
+namespace gen
+{
+
+// Frame profiler
+extern CProfiler Profiler;
+
+// Constructor creates an empty service using the given scenery
+CRaycastService::CRaycastService( const CCollisionWorld* collisionWorld )
+{
+	m_CollisionWorld = collisionWorld;
+	m_BatchNumber = 1;
+	m_ResultsBatch = 0;
+}
+
+
+/////////////////////////////////////
+// Queueing
+
+// Add a sphere (e.g. around a tank) that rays in the current batch may hit
+void CRaycastService::AddSphere( const CVector3& centre, TFloat32 radius, TEntityUID UID )
+{
+	SSphere sphere;
+	sphere.centre = centre;
+	sphere.radius = radius;
+	sphere.UID = UID;
+	m_Spheres.push_back( sphere );
+}
+
+// Queue a ray from start to end for the current batch, returns a ticket to read the result
+TUInt32 CRaycastService::QueueRay( const CVector3& start, const CVector3& end, TEntityUID ignoreUID )
+{
+	if (m_Rays.size() >= kMaxRaysPerBatch)
+	{
+		return kInvalidTicket;
+	}
+
+	SRay ray;
+	ray.start = start;
+	ray.end = end;
+	ray.ignoreUID = ignoreUID;
+	m_Rays.push_back( ray );
+
+	return (m_BatchNumber << kTicketIndexBits) | static_cast<TUInt32>(m_Rays.size() - 1);
+}
+
+
+/////////////////////////////////////
+// Resolution
+
+// Resolve all rays queued since the last call, results replace those of the last batch. This is
+// the update's collision phase, so it is timed as one zone rather than per query
+void CRaycastService::ResolveBatch()
+{
+	CProfileZone zone( Profiler, "Collision" );
+
+	// Build a tree over this batch's spheres - cheaper than testing every ray against every tank
+	vector<SAABB> boxes( m_Spheres.size() );
+	for (TUInt32 sphere = 0; sphere < m_Spheres.size(); ++sphere)
+	{
+		boxes[sphere].minBounds = m_Spheres[sphere].centre;
+		boxes[sphere].maxBounds = m_Spheres[sphere].centre;
+		boxes[sphere].Inflate( m_Spheres[sphere].radius );
+	}
+	m_SphereTree.Build( boxes.empty() ? 0 : &boxes[0], static_cast<TUInt32>(boxes.size()) );
+
+	// Each ray first against the scenery, then against the spheres nearer than any scenery hit
+	m_Results.resize( m_Rays.size() );
+	for (TUInt32 ray = 0; ray < m_Rays.size(); ++ray)
+	{
+		const SRay& data = m_Rays[ray];
+		SRayResult& result = m_Results[ray];
+
+		result.hit = m_CollisionWorld->SegmentIntersect( data.start, data.end, 0.0f, &result.hitFraction, &result.hitUID );
+		TFloat32 maxT = result.hit ? result.hitFraction : 1.0f;
+
+		TFloat32 sphereT;
+		TUInt32  hitSphere;
+		if (RaySpheres( data, data.end - data.start, maxT, &sphereT, &hitSphere ))
+		{
+			result.hit = true;
+			result.hitFraction = sphereT;
+			result.hitUID = m_Spheres[hitSphere].UID;
+		}
+	}
+
+	// Start the next batch. Batch numbers wrap within the bits available in a ticket, but
+	// never to 0 so an uninitialised ticket is never mistaken for a valid one
+	m_ResultsBatch = m_BatchNumber;
+	m_BatchNumber = (m_BatchNumber + 1) & ((1 << (32 - kTicketIndexBits)) - 1);
+	if (m_BatchNumber == 0) m_BatchNumber = 1;
+	m_Rays.clear();
+	m_Spheres.clear();
+}
+
+// Get the result for a ticket issued in the last resolved batch
+bool CRaycastService::GetResult( TUInt32 ticket, SRayResult* pResult ) const
+{
+	if (ticket == kInvalidTicket || (ticket >> kTicketIndexBits) != m_ResultsBatch)
+	{
+		return false;
+	}
+	TUInt32 index = ticket & (kMaxRaysPerBatch - 1);
+	if (index >= m_Results.size())
+	{
+		return false;
+	}
+	*pResult = m_Results[index];
+	return true;
+}
+
+// Remove all queued rays, spheres and results
+void CRaycastService::Clear()
+{
+	m_Rays.clear();
+	m_Spheres.clear();
+	m_Results.clear();
+	m_SphereTree.Clear();
+	m_ResultsBatch = 0;
+}
+
+
+/////////////////////////////////////
+// Snapshots
+
+// Write the queued rays and spheres, the results of the last batch and the batch numbers to a
+// snapshot. The sphere tree is only used while resolving so is not needed
+void CRaycastService::SaveState( CSnapshot* pSnapshot )
+{
+	// Rays and spheres are written as whole arrays, so must have no padding bytes (which would be
+	// uninitialised and make two snapshots of the same state differ)
+	static_assert( sizeof(SRay) == 2 * sizeof(CVector3) + sizeof(TEntityUID), "SRay has padding" );
+	static_assert( sizeof(SSphere) == sizeof(CVector3) + sizeof(TFloat32) + sizeof(TEntityUID),
+	               "SSphere has padding" );
+	pSnapshot->WriteArray( m_Rays );
+	pSnapshot->WriteArray( m_Spheres );
+	pSnapshot->Write( m_BatchNumber );
+
+	// Results are written a field at a time, the bool in each is followed by padding
+	pSnapshot->Write( static_cast<TUInt32>(m_Results.size()) );
+	for (TUInt32 ray = 0; ray < m_Results.size(); ++ray)
+	{
+		const SRayResult& result = m_Results[ray];
+		pSnapshot->Write( static_cast<TUInt8>(result.hit ? 1 : 0) );
+		pSnapshot->Write( result.hitFraction );
+		pSnapshot->Write( result.hitUID );
+	}
+	pSnapshot->Write( m_ResultsBatch );
+}
+
+// Replace the rays, spheres and results with those in a snapshot
+void CRaycastService::LoadState( CSnapshot* pSnapshot )
+{
+	pSnapshot->ReadArray( &m_Rays );
+	pSnapshot->ReadArray( &m_Spheres );
+	pSnapshot->Read( &m_BatchNumber );
+
+	m_Results.clear();
+	TUInt32 numResults = 0;
+	pSnapshot->Read( &numResults );
+	for (TUInt32 ray = 0; ray < numResults && !pSnapshot->Failed(); ++ray)
+	{
+		SRayResult result;
+		TUInt8 hit = 0;
+		pSnapshot->Read( &hit );
+		pSnapshot->Read( &result.hitFraction );
+		pSnapshot->Read( &result.hitUID );
+		result.hit = (hit != 0);
+		m_Results.push_back( result );
+	}
+	pSnapshot->Read( &m_ResultsBatch );
+	m_SphereTree.Clear();
+}
+
+
+/////////////////////////////////////
+// Support functions
+
+// Return the nearest sphere hit by a ray before maxT, false if none
+bool CRaycastService::RaySpheres
+(
+	const SRay&     ray,
+	const CVector3& direction,
+	TFloat32        maxT,
+	TFloat32*       pHitT,
+	TUInt32*        pHitSphere
+) const
+{
+	TFloat32 a = direction.Dot( direction );
+	if (a <= 0.0f)
+	{
+		return false;
+	}
+
+	const vector<SSphere>& spheres = m_Spheres;
+	auto visitor = [&]( TUInt32 sphere, TFloat32 nearestT ) -> TFloat32
+	{
+		const SSphere& data = spheres[sphere];
+		if (data.UID == ray.ignoreUID)
+		{
+			return nearestT;
+		}
+
+		// Ray starting inside the sphere hits it immediately
+		CVector3 offset = ray.start - data.centre;
+		TFloat32 c = offset.Dot( offset ) - data.radius * data.radius;
+		if (c <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		// Otherwise solve |start + t * direction - centre| = radius for the smaller t. No hit
+		// if the sphere is behind the start or the ray passes it by
+		TFloat32 b = offset.Dot( direction );
+		TFloat32 discriminant = b * b - a * c;
+		if (b >= 0.0f || discriminant < 0.0f)
+		{
+			return nearestT;
+		}
+		TFloat32 t = (-b - Sqrt( discriminant )) / a;
+		return (t < nearestT) ? t : nearestT;
+	};
+
+	return m_SphereTree.RayQuery( ray.start, direction, maxT, visitor, pHitT, pHitSphere );
+}
+
+
+} // namespace gen
@@ -0,0 +1,166 @@
+/*******************************************
+	RaycastService.h
+
+	Batched ray queries against the scenery
+	and the tanks
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "CVector3.h"
+#include "AABBTree.h"
+#include "Entity.h"
+#include "CollisionWorld.h"
+#include "Snapshot.h"
+
+namespace gen
+{
+
+// The result of a single ray - whether anything was hit and, if so, what and where
+struct SRayResult
+{
+	bool       hit;
+	TFloat32   hitFraction; // Fraction of the way along the ray of the hit
+	TEntityUID hitUID;      // Scenery or tank entity hit
+};
+
+
+// Entities queue rays during their update and the service resolves all of them in one pass
+// after the update, against the static scenery (the collision world) and spheres around the
+// tanks. Results are read back on the following update using the ticket returned when the
+// ray was queued. Tanks re-register their spheres each update, so the sphere tree is rebuilt
+// once per batch rather than being kept up to date as tanks move
+class CRaycastService
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty service using the given scenery
+	CRaycastService( const CCollisionWorld* collisionWorld );
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CRaycastService( const CRaycastService& );
+	CRaycastService& operator=( const CRaycastService& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Returned by QueueRay when the batch is full
+	static const TUInt32 kInvalidTicket = 0xffffffff;
+
+
+	/////////////////////////////////////
+	// Queueing
+
+	// Add a sphere (e.g. around a tank) that rays in the current batch may hit
+	void AddSphere( const CVector3& centre, TFloat32 radius, TEntityUID UID );
+
+	// Queue a ray from start to end for the current batch. Any sphere belonging to ignoreUID
+	// is not tested (use for the entity casting the ray). Returns a ticket to read the result
+	// after the batch is resolved
+	TUInt32 QueueRay( const CVector3& start, const CVector3& end, TEntityUID ignoreUID );
+
+
+	/////////////////////////////////////
+	// Resolution
+
+	// Resolve all rays queued since the last call, results replace those of the last batch
+	void ResolveBatch();
+
+	// Get the result for a ticket issued in the last resolved batch. Returns false if the
+	// ticket is not from that batch (e.g. the ray was queued before the one before)
+	bool GetResult( TUInt32 ticket, SRayResult* pResult ) const;
+
+	// Remove all queued rays, spheres and results
+	void Clear();
+
+
+	/////////////////////////////////////
+	// Snapshots
+
+	// Write the queued rays and spheres, the results of the last batch and the batch numbers to a
+	// snapshot, or replace them with those read back. Tickets issued before the snapshot was taken
+	// give the same results after restoring
+	void SaveState( CSnapshot* pSnapshot );
+	void LoadState( CSnapshot* pSnapshot );
+
+
+	/////////////////////////////////////
+	// Getters
+
+	// Number of rays resolved in the last batch
+	TUInt32 NumRaysResolved() const
+	{
+		return static_cast<TUInt32>(m_Results.size());
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	/////////////////////////////////////
+	// Types
+
+	struct SRay
+	{
+		CVector3   start;
+		CVector3   end;
+		TEntityUID ignoreUID;
+	};
+
+	struct SSphere
+	{
+		CVector3   centre;
+		TFloat32   radius;
+		TEntityUID UID;
+	};
+
+	// Tickets hold the batch number in the top bits and the ray index in the rest
+	static const TUInt32 kTicketIndexBits = 20;
+	static const TUInt32 kMaxRaysPerBatch = 1 << kTicketIndexBits;
+
+
+	/////////////////////////////////////
+	// Support functions
+
+	// Return the nearest sphere hit by a ray before maxT, false if none
+	bool RaySpheres
+	(
+		const SRay&     ray,
+		const CVector3& direction,
+		TFloat32        maxT,
+		TFloat32*       pHitT,
+		TUInt32*        pHitSphere
+	) const;
+
+
+	/////////////////////////////////////
+	// Data
+
+	const CCollisionWorld* m_CollisionWorld;
+
+	// Current batch
+	vector<SRay>       m_Rays;
+	vector<SSphere>    m_Spheres;
+	TUInt32            m_BatchNumber;
+
+	// Sphere tree built when resolving
+	CAABBTree          m_SphereTree;
+
+	// Results of the last resolved batch
+	vector<SRayResult> m_Results;
+	TUInt32            m_ResultsBatch;
+};
+
+
+} // namespace gen
@@ -0,0 +1,251 @@
+/*******************************************
+	Replay.cpp
+
+	Recording of a battle's inputs, played
+	back to reproduce the battle exactly
+********************************************/
+
+#include "Replay.h"
+
+namespace gen
+{
+
+// Simulation globals, defined by the program running the battle
+extern CMessenger Messenger;
+
+
+// Constructor creates an empty replay, neither recording nor playing
+CReplay::CReplay()
+{
+	m_Recording = false;
+	m_Playing = false;
+	m_NumUpdates = 0;
+	m_Time = 0.0;
+	m_PlayTime = 0.0f;
+	m_NumHashesChecked = 0;
+	m_DivergedUpdate = 0;
+}
+
+
+/////////////////////////////////////
+// Recording
+
+// Start a new recording from the current state of the battle, replacing any earlier one
+void CReplay::StartRecording( CBattle* pBattle )
+{
+	m_Data.Clear();
+	m_Data.Write( kReplayMagic );
+	m_Data.Write( kReplayVersion );
+	pBattle->SaveState( &m_Data );
+
+	m_Recording = true;
+	m_Playing = false;
+	m_Messages.clear();
+	m_NumUpdates = 0;
+	m_Time = 0.0;
+}
+
+// Send a message from outside the battle, recorded for the next update if recording
+void CReplay::SendMessage( TEntityUID to, const SMessage& msg )
+{
+	Messenger.SendMessage( to, msg );
+	if (m_Recording)
+	{
+		SRecordedMessage recorded = { to, msg };
+		m_Messages.push_back( recorded );
+	}
+}
+
+// Record then run one update of the battle. Also runs the update when not recording
+void CReplay::RecordUpdate( CBattle* pBattle, TFloat32 updateTime )
+{
+	if (!m_Recording)
+	{
+		pBattle->Update( updateTime );
+		return;
+	}
+
+	++m_NumUpdates;
+	m_Time += updateTime;
+	TUInt8 flags = 0;
+	if (!m_Messages.empty())
+	{
+		flags |= Update_Messages;
+	}
+	if (m_NumUpdates % kHashInterval == 0)
+	{
+		flags |= Update_Hash;
+	}
+
+	m_Data.Write( updateTime );
+	m_Data.Write( flags );
+	if (flags & Update_Messages)
+	{
+		m_Data.Write( static_cast<TUInt32>(m_Messages.size()) );
+		for (TUInt32 message = 0; message < m_Messages.size(); ++message)
+		{
+			const SRecordedMessage& recorded = m_Messages[message];
+			m_Data.Write( recorded.to );
+			m_Data.Write( static_cast<TUInt32>(recorded.msg.type) );
+			m_Data.Write( recorded.msg.from );
+			m_Data.Write( recorded.msg.data );
+		}
+		m_Messages.clear();
+	}
+
+	pBattle->Update( updateTime );
+
+	if (flags & Update_Hash)
+	{
+		CStateHash hash;
+		pBattle->HashState( &hash );
+		m_Data.Write( hash.Value() );
+	}
+}
+
+// Finish the recording, it can then be saved or played. Messages sent since the last update are
+// dropped, they have not affected the battle yet
+void CReplay::StopRecording()
+{
+	m_Recording = false;
+	m_Messages.clear();
+}
+
+
+/////////////////////////////////////
+// Playback
+
+// Start playing the recording, restoring the battle's state at its start
+bool CReplay::StartPlayback( CBattle* pBattle )
+{
+	StopRecording();
+
+	TUInt32 magic = 0;
+	TUInt32 version = 0;
+	m_Data.BeginRead();
+	m_Data.Read( &magic );
+	m_Data.Read( &version );
+	if (magic != kReplayMagic || version != kReplayVersion || !pBattle->LoadState( &m_Data ))
+	{
+		return false;
+	}
+
+	m_Playing = true;
+	m_NumUpdates = 0;
+	m_Time = 0.0;
+	m_PlayTime = 0.0f;
+	m_NumHashesChecked = 0;
+	m_DivergedUpdate = 0;
+	return true;
+}
+
+// Play the next recorded update, sending its messages first. Returns false when there are no
+// more updates
+bool CReplay::PlayUpdate( CBattle* pBattle )
+{
+	if (!m_Playing || m_Data.ReadAll())
+	{
+		m_Playing = false;
+		return false;
+	}
+
+	TFloat32 updateTime = 0.0f;
+	TUInt8 flags = 0;
+	m_Data.Read( &updateTime );
+	m_Data.Read( &flags );
+	if (flags & Update_Messages)
+	{
+		TUInt32 numMessages = 0;
+		m_Data.Read( &numMessages );
+		for (TUInt32 message = 0; message < numMessages && !m_Data.Failed(); ++message)
+		{
+			TEntityUID to = 0;
+			TUInt32 type = 0;
+			SMessage msg;
+			m_Data.Read( &to );
+			m_Data.Read( &type );
+			m_Data.Read( &msg.from );
+			m_Data.Read( &msg.data );
+			msg.type = static_cast<EMessageType>(type);
+			Messenger.SendMessage( to, msg );
+		}
+	}
+	if (m_Data.Failed())
+	{
+		m_Playing = false;
+		return false;
+	}
+
+	pBattle->Update( updateTime );
+	++m_NumUpdates;
+	m_Time += updateTime;
+	m_PlayTime -= updateTime;
+
+	if (flags & Update_Hash)
+	{
+		TUInt64 recordedHash = 0;
+		m_Data.Read( &recordedHash );
+		CStateHash hash;
+		pBattle->HashState( &hash );
+		++m_NumHashesChecked;
+		if (recordedHash != hash.Value() && m_DivergedUpdate == 0)
+		{
+			m_DivergedUpdate = m_NumUpdates;
+		}
+	}
+	return true;
+}
+
+// Play recorded updates to cover the given time
+TUInt32 CReplay::Play( CBattle* pBattle, TFloat32 time )
+{
+	TUInt32 numPlayed = 0;
+	m_PlayTime += time;
+	while (m_PlayTime > 0.0f && PlayUpdate( pBattle ))
+	{
+		++numPlayed;
+	}
+	return numPlayed;
+}
+
+// Stop playing, the battle continues from where the playback reached
+void CReplay::StopPlayback()
+{
+	m_Playing = false;
+}
+
+
+/////////////////////////////////////
+// Files
+
+// Save the recording to a file
+bool CReplay::Save( const string& fileName ) const
+{
+	return m_Data.Save( fileName );
+}
+
+// Load a recording from a file, stops any recording or playback
+bool CReplay::Load( const string& fileName )
+{
+	m_Recording = false;
+	m_Playing = false;
+	m_Messages.clear();
+	if (!m_Data.Load( fileName ))
+	{
+		return false;
+	}
+
+	TUInt32 magic = 0;
+	TUInt32 version = 0;
+	m_Data.Read( &magic );
+	m_Data.Read( &version );
+	if (magic != kReplayMagic || version != kReplayVersion)
+	{
+		m_Data.Clear();
+		return false;
+	}
+	return true;
+}
+
+
+} // namespace gen
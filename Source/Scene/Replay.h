@@ -0,0 +1,184 @@
+/*******************************************
+	Replay.h
+
+	Recording of a battle's inputs, played
+	back to reproduce the battle exactly
+********************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "Entity.h"
+#include "Messenger.h"
+#include "Snapshot.h"
+#include "Battle.h"
+
+namespace gen
+{
+
+// Identifies the replay data within its snapshot file, increase the version if the layout changes
+const TUInt32 kReplayMagic = 0x4c505254; // "TRPL"
+const TUInt32 kReplayVersion = 3;
+
+// A battle only depends on its state at the start, the time of each update and the messages sent
+// from outside (start/stop from keys, evade from mouse clicks), as random numbers come from the
+// saved random state. A recording holds the start state, then for each update its time and the
+// messages sent since the previous one. A hash of the battle (CBattle::HashState) is also kept at
+// intervals, so playback can report the first update where it no longer matches, e.g. after code
+// changes or from state that snapshots miss.
+//
+// Each recorded update is a float time and a byte of flags, followed by the messages and the hash
+// if present - about 5 bytes per update when nothing happens. Messages are written a field at a
+// time rather than as whole structures, so a recording holds no padding bytes and the same battle
+// always records the same data
+class CReplay
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty replay, neither recording nor playing
+	CReplay();
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CReplay( const CReplay& );
+	CReplay& operator=( const CReplay& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Updates between hashes of the battle, about once a second in game
+	static const TUInt32 kHashInterval = 60;
+
+
+	/////////////////////////////////////
+	// Recording
+
+	// Start a new recording from the current state of the battle, replacing any earlier one
+	void StartRecording( CBattle* pBattle );
+
+	// Send a message from outside the battle, recorded for the next update if recording
+	void SendMessage( TEntityUID to, const SMessage& msg );
+
+	// Record then run one update of the battle. Also runs the update when not recording
+	void RecordUpdate( CBattle* pBattle, TFloat32 updateTime );
+
+	// Finish the recording, it can then be saved or played
+	void StopRecording();
+
+
+	/////////////////////////////////////
+	// Playback
+
+	// Start playing the recording, restoring the battle's state at its start. Returns false if the
+	// recording was made in a different scene, when the battle is unchanged
+	bool StartPlayback( CBattle* pBattle );
+
+	// Play the next recorded update, sending its messages first. Returns false when there are no
+	// more updates, when playback stops
+	bool PlayUpdate( CBattle* pBattle );
+
+	// Play recorded updates to cover the given time, e.g. the frame time multiplied by the playback
+	// speed. The difference from the time of the updates played is carried to the next call, so
+	// playback keeps pace on average. Returns the number of updates played
+	TUInt32 Play( CBattle* pBattle, TFloat32 time );
+
+	// Stop playing, the battle continues from where the playback reached
+	void StopPlayback();
+
+
+	/////////////////////////////////////
+	// Files
+
+	// Save the recording to a file, returns false on failure
+	bool Save( const string& fileName ) const;
+
+	// Load a recording from a file, returns false if it cannot be read or is the wrong version
+	bool Load( const string& fileName );
+
+
+	/////////////////////////////////////
+	// Getters
+
+	bool IsRecording() const
+	{
+		return m_Recording;
+	}
+
+	bool IsPlaying() const
+	{
+		return m_Playing;
+	}
+
+	// Updates recorded or played so far
+	TUInt32 NumUpdates() const
+	{
+		return m_NumUpdates;
+	}
+
+	// Total time of the updates recorded or played so far
+	TFloat64 Time() const
+	{
+		return m_Time;
+	}
+
+	// Number of hashes checked during playback
+	TUInt32 NumHashesChecked() const
+	{
+		return m_NumHashesChecked;
+	}
+
+	// True if a hash did not match during playback, and the update it was taken after (counting
+	// from 1)
+	bool HasDiverged() const
+	{
+		return m_DivergedUpdate != 0;
+	}
+	TUInt32 DivergedUpdate() const
+	{
+		return m_DivergedUpdate;
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	// Flags following the time of each update
+	enum EUpdateFlags
+	{
+		Update_Messages = 1, // Messages follow: a count then (recipient, message) pairs
+		Update_Hash     = 2, // A hash of the battle after the update follows
+	};
+
+	// A message waiting for the next update
+	struct SRecordedMessage
+	{
+		TEntityUID to;
+		SMessage   msg;
+	};
+
+	CSnapshot m_Data; // Start state then the recorded updates
+
+	bool m_Recording;
+	bool m_Playing;
+
+	vector<SRecordedMessage> m_Messages; // Sent since the last update while recording
+
+	TUInt32  m_NumUpdates;
+	TFloat64 m_Time;
+	TFloat32 m_PlayTime;         // Time carried over between calls to Play
+	TUInt32  m_NumHashesChecked;
+	TUInt32  m_DivergedUpdate;   // First update after which the hash did not match, 0 if none
+};
+
+
+} // namespace gen
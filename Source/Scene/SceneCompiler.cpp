@@ -0,0 +1,461 @@
+/*******************************************
+	SceneCompiler.cpp
+
+	Compiles a scene XML file to a binary
+	scene image
+********************************************/
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "SceneCompiler.h"
+#include "BaseMath.h"
+#include "MemoryTracker.h"
+
+namespace gen
+{
+
+// Maximum number of strings remembered for sharing. Scenes usually repeat a few names many
+// times, but generated scenes may give every entity a unique name - limit the memory used
+const TUInt32 kMaxSharedStrings = 4096;
+
+// Random numbers for a Scatter element without a Seed attribute start from this seed
+const TUInt32 kDefaultScatterSeed = 1;
+
+
+// Read a vector attribute given as space separated numbers (e.g. Position="-20 0.5 40") into
+// the given array, leaving it unchanged if the attribute is missing
+static void ReadVector( const CXMLPullReader& reader, const char* name, TFloat32* pVector, TUInt32 size )
+{
+	const char* text = reader.Attribute( name );
+	if (text == 0)
+	{
+		return;
+	}
+	// strtod rather than sscanf, which is several times slower and dominates compiling large scenes
+	for (TUInt32 element = 0; element < size; ++element)
+	{
+		char* end;
+		TFloat32 value = static_cast<TFloat32>(strtod( text, &end ));
+		if (end == text)
+		{
+			return; // Fewer values than elements, leave the rest unchanged
+		}
+		pVector[element] = value;
+		text = end;
+	}
+}
+
+// Read a rotation attribute given in degrees, storing it in radians
+static void ReadRotation( const CXMLPullReader& reader, const char* name, TFloat32* pRotation )
+{
+	TFloat32 degrees[3] = { 0.0f, 0.0f, 0.0f };
+	ReadVector( reader, name, degrees, 3 );
+	for (TUInt32 axis = 0; axis < 3; ++axis)
+	{
+		pRotation[axis] = ToRadians( degrees[axis] );
+	}
+}
+
+// Set an array of three floats
+static void SetVector( TFloat32* pVector, TFloat32 x, TFloat32 y, TFloat32 z )
+{
+	pVector[0] = x;
+	pVector[1] = y;
+	pVector[2] = z;
+}
+
+
+// Compile the given scene file to the given image file, returns false on failure (after
+// showing an error message)
+bool CSceneCompiler::Compile( const string& sceneFileName, const string& imageFileName )
+{
+	CMemoryScope memory( Mem_XML );
+
+	m_SceneFileName = sceneFileName;
+	if (!m_Reader.Open( sceneFileName ))
+	{
+		string errorMsg = "Error reading scene file " + sceneFileName;
+		SystemMessageBox( errorMsg.c_str(), "Scene Error" );
+		return false;
+	}
+
+	m_StringsFileName = imageFileName + ".strings";
+	m_Image.open( imageFileName.c_str(), ios::binary | ios::trunc );
+	m_Strings.open( m_StringsFileName.c_str(), ios::binary | ios::trunc );
+	if (!m_Image || !m_Strings)
+	{
+		m_Reader.Close();
+		string errorMsg = "Error writing scene image " + imageFileName;
+		SystemMessageBox( errorMsg.c_str(), "Scene Error" );
+		return false;
+	}
+
+	bool success = ReadScene() && FinishImage();
+
+	m_Reader.Close();
+	m_Image.close();
+	m_Strings.close();
+	remove( m_StringsFileName.c_str() );
+	if (!success)
+	{
+		remove( imageFileName.c_str() ); // Don't leave a partial image behind
+	}
+
+	m_Templates.clear();
+	m_TemplateDefined.clear();
+	m_Tanks.clear();
+	m_Waypoints.clear();
+	m_Lights.clear();
+	m_TemplateIndices.clear();
+	m_StringOffsets.clear();
+	return success;
+}
+
+// Returns true if the image file exists, is newer than the scene file and is of the current
+// image version - i.e. it does not need compiling again
+bool CSceneCompiler::IsImageUpToDate( const string& sceneFileName, const string& imageFileName )
+{
+	WIN32_FILE_ATTRIBUTE_DATA sceneData, imageData;
+	if (!GetFileAttributesEx( sceneFileName.c_str(), GetFileExInfoStandard, &sceneData ) ||
+	    !GetFileAttributesEx( imageFileName.c_str(), GetFileExInfoStandard, &imageData ))
+	{
+		return false;
+	}
+	ULONGLONG sceneTime = (static_cast<ULONGLONG>(sceneData.ftLastWriteTime.dwHighDateTime) << 32) |
+	                      sceneData.ftLastWriteTime.dwLowDateTime;
+	ULONGLONG imageTime = (static_cast<ULONGLONG>(imageData.ftLastWriteTime.dwHighDateTime) << 32) |
+	                      imageData.ftLastWriteTime.dwLowDateTime;
+	if (imageTime < sceneTime)
+	{
+		return false;
+	}
+
+	CSceneImage image;
+	return image.Open( imageFileName );
+}
+
+
+// Read the scene elements, writing entities to the image file as they are read
+bool CSceneCompiler::ReadScene()
+{
+	// Defaults for anything not in the scene file
+	memset( &m_Header, 0, sizeof(m_Header) );
+	SetVector( m_Header.ambientColour, 0.5f, 0.5f, 0.5f );
+	m_Header.ambientColour[3] = 1.0f;
+	m_Header.cameraNearClip = 1.0f;
+	m_Header.cameraFarClip = 20000.0f;
+	m_Header.navCellSize = 2.0f;
+	m_Header.navClearance = 3.0f;
+	m_NumEntities = 0;
+	m_NumStringBytes = 0;
+	AddString( "" );
+
+	// Header is written at the end once the array positions are known, entities follow it
+	m_Image.write( reinterpret_cast<const char*>(&m_Header), sizeof(m_Header) );
+
+	CXMLPullReader::EEvent event = m_Reader.Next();
+	if (event != CXMLPullReader::Event_StartElement || m_Reader.Name() != "Scene")
+	{
+		return Error( event == CXMLPullReader::Event_Error ? m_Reader.ErrorText() : "No Scene element" );
+	}
+	while ((event = m_Reader.Next()) == CXMLPullReader::Event_StartElement)
+	{
+		if (!ReadSceneElement())
+		{
+			return false;
+		}
+	}
+	if (event == CXMLPullReader::Event_Error)
+	{
+		return Error( m_Reader.ErrorText() );
+	}
+	return true; // End of Scene element
+}
+
+// Read the current element, a child of the Scene element
+bool CSceneCompiler::ReadSceneElement()
+{
+	const string& tag = m_Reader.Name();
+	TUInt32 depth = m_Reader.Depth();
+	bool isTank = false;
+	SSceneTank tank;
+
+	if (tag == "Template" || tag == "TankTemplate")
+	{
+		if (!ReadTemplate( tag == "TankTemplate" ))
+		{
+			return false;
+		}
+	}
+	else if (tag == "Entity")
+	{
+		SSceneEntity entity;
+		entity.templateIndex = TemplateIndex( m_Reader.Attribute( "Template" ) );
+		entity.name = AddString( m_Reader.Attribute( "Name" ) );
+		SetVector( entity.position, 0.0f, 0.0f, 0.0f );
+		SetVector( entity.scale, 1.0f, 1.0f, 1.0f );
+		ReadVector( m_Reader, "Position", entity.position, 3 );
+		ReadRotation( m_Reader, "Rotation", entity.rotation );
+		ReadVector( m_Reader, "Scale", entity.scale, 3 );
+		entity.flags = m_Reader.BoolAttribute( "Static" ) ? kSceneEntityStatic : 0;
+		WriteEntity( entity );
+	}
+	else if (tag == "Scatter")
+	{
+		// A number of entities placed randomly in a box, each with a random yaw if required. The
+		// random numbers come from the element's seed so the same XML always compiles to the same
+		// image, the program's own random sequence is left as it was
+		SSceneEntity entity;
+		entity.templateIndex = TemplateIndex( m_Reader.Attribute( "Template" ) );
+		entity.name = AddString( m_Reader.Attribute( "Name" ) );
+		SetVector( entity.scale, 1.0f, 1.0f, 1.0f );
+		ReadVector( m_Reader, "Scale", entity.scale, 3 );
+		entity.flags = m_Reader.BoolAttribute( "Static" ) ? kSceneEntityStatic : 0;
+		TFloat32 minBounds[3] = { 0.0f, 0.0f, 0.0f };
+		TFloat32 maxBounds[3] = { 0.0f, 0.0f, 0.0f };
+		ReadVector( m_Reader, "Min", minBounds, 3 );
+		ReadVector( m_Reader, "Max", maxBounds, 3 );
+		bool randomYaw = m_Reader.BoolAttribute( "RandomYaw" );
+
+		TUInt32 randomState = GetRandomState();
+		SeedRandom( m_Reader.UnsignedAttribute( "Seed", kDefaultScatterSeed ) );
+		TUInt32 count = m_Reader.UnsignedAttribute( "Count" );
+		for (TUInt32 instance = 0; instance < count; ++instance)
+		{
+			for (TUInt32 axis = 0; axis < 3; ++axis)
+			{
+				entity.position[axis] = Random( minBounds[axis], maxBounds[axis] );
+			}
+			SetVector( entity.rotation, 0.0f, randomYaw ? Random( 0.0f, 2.0f * kfPi ) : 0.0f, 0.0f );
+			WriteEntity( entity );
+		}
+		SetRandomState( randomState );
+	}
+	else if (tag == "Tank")
+	{
+		// Waypoints are child elements, read below
+		isTank = true;
+		tank.templateIndex = TemplateIndex( m_Reader.Attribute( "Template" ) );
+		tank.name = AddString( m_Reader.Attribute( "Name" ) );
+		tank.team = m_Reader.UnsignedAttribute( "Team" );
+		SetVector( tank.position, 0.0f, 0.0f, 0.0f );
+		ReadVector( m_Reader, "Position", tank.position, 3 );
+		ReadRotation( m_Reader, "Rotation", tank.rotation );
+		tank.firstWaypoint = static_cast<TUInt32>(m_Waypoints.size() / 3);
+		tank.numWaypoints = 0;
+	}
+	else if (tag == "Light")
+	{
+		SSceneLight light;
+		SetVector( light.position, 0.0f, 0.0f, 0.0f );
+		SetVector( light.colour, 1.0f, 1.0f, 1.0f );
+		light.colour[3] = 0.0f;
+		ReadVector( m_Reader, "Position", light.position, 3 );
+		ReadVector( m_Reader, "Colour", light.colour, 4 );
+		light.brightness = m_Reader.FloatAttribute( "Brightness", 100.0f );
+		m_Lights.push_back( light );
+	}
+	else if (tag == "AmbientLight")
+	{
+		ReadVector( m_Reader, "Colour", m_Header.ambientColour, 4 );
+	}
+	else if (tag == "Camera")
+	{
+		ReadVector( m_Reader, "Position", m_Header.cameraPosition, 3 );
+		ReadRotation( m_Reader, "Rotation", m_Header.cameraRotation );
+		m_Header.cameraNearClip = m_Reader.FloatAttribute( "NearClip", m_Header.cameraNearClip );
+		m_Header.cameraFarClip = m_Reader.FloatAttribute( "FarClip", m_Header.cameraFarClip );
+	}
+	else if (tag == "NavGrid")
+	{
+		ReadVector( m_Reader, "Min", m_Header.navAreaMin, 3 );
+		ReadVector( m_Reader, "Max", m_Header.navAreaMax, 3 );
+		m_Header.navCellSize = m_Reader.FloatAttribute( "CellSize", m_Header.navCellSize );
+		m_Header.navClearance = m_Reader.FloatAttribute( "Clearance", m_Header.navClearance );
+	}
+
+	// Read to the end of the element, picking up tank waypoints and skipping anything else
+	while (true)
+	{
+		CXMLPullReader::EEvent event = m_Reader.Next();
+		if (event == CXMLPullReader::Event_Error)
+		{
+			return Error( m_Reader.ErrorText() );
+		}
+		if (event == CXMLPullReader::Event_EndElement && m_Reader.Depth() == depth)
+		{
+			break;
+		}
+		if (isTank && event == CXMLPullReader::Event_StartElement && m_Reader.Depth() == depth + 1 &&
+		    m_Reader.Name() == "Waypoint")
+		{
+			TFloat32 position[3] = { 0.0f, 0.0f, 0.0f };
+			ReadVector( m_Reader, "Position", position, 3 );
+			m_Waypoints.insert( m_Waypoints.end(), position, position + 3 );
+			++tank.numWaypoints;
+		}
+	}
+	if (isTank)
+	{
+		m_Tanks.push_back( tank );
+	}
+	return true;
+}
+
+// Read a template or tank template
+bool CSceneCompiler::ReadTemplate( bool isTank )
+{
+	TUInt32 index = TemplateIndex( m_Reader.Attribute( "Name" ) );
+	if (m_TemplateDefined[index])
+	{
+		return Error( "Template " + string( m_Reader.Attribute( "Name" ) ) + " defined twice" );
+	}
+	m_TemplateDefined[index] = true;
+
+	SSceneTemplate& entityTemplate = m_Templates[index];
+	entityTemplate.type = AddString( m_Reader.Attribute( "Type" ) );
+	entityTemplate.name = AddString( m_Reader.Attribute( "Name" ) );
+	entityTemplate.mesh = AddString( m_Reader.Attribute( "Mesh" ) );
+	entityTemplate.isTank = isTank ? 1 : 0;
+	if (isTank)
+	{
+		entityTemplate.maxSpeed = m_Reader.FloatAttribute( "TopSpeed" );
+		entityTemplate.acceleration = m_Reader.FloatAttribute( "Acceleration" );
+		entityTemplate.turnSpeed = m_Reader.FloatAttribute( "TankTurnSpeed" );
+		entityTemplate.turretTurnSpeed = m_Reader.FloatAttribute( "TurretTurnSpeed" );
+		entityTemplate.maxHP = m_Reader.IntAttribute( "MaxHP" );
+		entityTemplate.shellDamage = m_Reader.IntAttribute( "ShellDamage" );
+	}
+	return true;
+}
+
+// Get the index of the named template, adding a placeholder if it is not yet defined
+TUInt32 CSceneCompiler::TemplateIndex( const char* name )
+{
+	string templateName = name ? name : "";
+	map<string, TUInt32>::iterator found = m_TemplateIndices.find( templateName );
+	if (found != m_TemplateIndices.end())
+	{
+		return found->second;
+	}
+
+	TUInt32 index = static_cast<TUInt32>(m_Templates.size());
+	SSceneTemplate placeholder;
+	memset( &placeholder, 0, sizeof(placeholder) );
+	m_Templates.push_back( placeholder );
+	m_TemplateDefined.push_back( false );
+	m_TemplateIndices[templateName] = index;
+	return index;
+}
+
+// Add a string to the string table and return its offset. Recently used strings are shared,
+// the set of shared strings is reset when it gets too large
+TUInt32 CSceneCompiler::AddString( const char* text )
+{
+	string key = text ? text : "";
+	map<string, TUInt32>::iterator found = m_StringOffsets.find( key );
+	if (found != m_StringOffsets.end())
+	{
+		return found->second;
+	}
+
+	TUInt32 offset = m_NumStringBytes;
+	m_Strings.write( key.c_str(), key.length() + 1 );
+	m_NumStringBytes += static_cast<TUInt32>(key.length()) + 1;
+
+	if (m_StringOffsets.size() >= kMaxSharedStrings)
+	{
+		m_StringOffsets.clear();
+	}
+	m_StringOffsets[key] = offset;
+	return offset;
+}
+
+// Write an entity record to the image file
+void CSceneCompiler::WriteEntity( const SSceneEntity& entity )
+{
+	m_Image.write( reinterpret_cast<const char*>(&entity), sizeof(entity) );
+	++m_NumEntities;
+}
+
+
+// Check all references and write the remaining arrays and the header to the image file
+bool CSceneCompiler::FinishImage()
+{
+	for (map<string, TUInt32>::iterator entry = m_TemplateIndices.begin(); entry != m_TemplateIndices.end(); ++entry)
+	{
+		if (!m_TemplateDefined[entry->second])
+		{
+			return Error( "Unknown template \"" + entry->first + "\"" );
+		}
+	}
+	for (TUInt32 tank = 0; tank < m_Tanks.size(); ++tank)
+	{
+		if (!m_Templates[m_Tanks[tank].templateIndex].isTank)
+		{
+			return Error( "Tank uses non-tank template" );
+		}
+	}
+
+	// Pad the string table so the file size stays a multiple of 4 bytes
+	while (m_NumStringBytes % 4 != 0)
+	{
+		m_Strings.put( 0 );
+		++m_NumStringBytes;
+	}
+	m_Strings.close();
+
+	// Arrays follow the entities in this order, all records are a multiple of 4 bytes so each
+	// array stays aligned
+	TUInt32 offset = sizeof(SSceneImageHeader);
+	SSceneArray* arrays[] = { &m_Header.entities, &m_Header.templates, &m_Header.tanks, &m_Header.waypoints,
+	                          &m_Header.lights, &m_Header.strings };
+	TUInt32 counts[] = { m_NumEntities, static_cast<TUInt32>(m_Templates.size()),
+	                     static_cast<TUInt32>(m_Tanks.size()), static_cast<TUInt32>(m_Waypoints.size() / 3),
+	                     static_cast<TUInt32>(m_Lights.size()), m_NumStringBytes };
+	TUInt32 sizes[] = { sizeof(SSceneEntity), sizeof(SSceneTemplate), sizeof(SSceneTank), 3 * sizeof(TFloat32),
+	                    sizeof(SSceneLight), 1 };
+	for (TUInt32 array = 0; array < 6; ++array)
+	{
+		arrays[array]->offset = offset;
+		arrays[array]->count = counts[array];
+		offset += counts[array] * sizes[array];
+	}
+	m_Header.magic = kSceneImageMagic;
+	m_Header.version = kSceneImageVersion;
+	m_Header.fileSize = offset;
+
+	if (!m_Templates.empty()) m_Image.write( reinterpret_cast<const char*>(&m_Templates[0]), m_Templates.size() * sizeof(SSceneTemplate) );
+	if (!m_Tanks.empty())     m_Image.write( reinterpret_cast<const char*>(&m_Tanks[0]), m_Tanks.size() * sizeof(SSceneTank) );
+	if (!m_Waypoints.empty()) m_Image.write( reinterpret_cast<const char*>(&m_Waypoints[0]), m_Waypoints.size() * sizeof(TFloat32) );
+	if (!m_Lights.empty())    m_Image.write( reinterpret_cast<const char*>(&m_Lights[0]), m_Lights.size() * sizeof(SSceneLight) );
+
+	// Copy the string table across in chunks
+	ifstream strings( m_StringsFileName.c_str(), ios::binary );
+	vector<char> buffer( 64 * 1024 );
+	while (strings.read( &buffer[0], buffer.size() ) || strings.gcount() > 0)
+	{
+		m_Image.write( &buffer[0], strings.gcount() );
+	}
+
+	m_Image.seekp( 0 );
+	m_Image.write( reinterpret_cast<const char*>(&m_Header), sizeof(m_Header) );
+	m_Image.flush();
+	if (!m_Image)
+	{
+		return Error( "Error writing scene image" );
+	}
+	return true;
+}
+
+// Show an error message with the position in the scene file, returns false
+bool CSceneCompiler::Error( const string& text )
+{
+	string errorMsg = m_SceneFileName + " line " + to_string( m_Reader.LineNumber() ) + ": " + text;
+	SystemMessageBox( errorMsg.c_str(), "Scene Error" );
+	return false;
+}
+
+
+} // namespace gen
@@ -0,0 +1,109 @@
+/*******************************************
+	SceneCompiler.h
+
+	Compiles a scene XML file to a binary
+	scene image
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <fstream>
+using namespace std;
+
+#include "Defines.h"
+#include "XMLPullReader.h"
+#include "SceneImage.h"
+
+namespace gen
+{
+
+// Reads a scene XML file (templates, entities, tanks and their patrol routes, lights, camera)
+// and writes it as a scene image (see SceneImage.h). Scatter elements are expanded into
+// individual entities with random positions when compiled, from the element's Seed attribute (or
+// a fixed seed) so compiling the same file always gives the same image.
+// The XML file is streamed a chunk at a time and entity records and strings are written to
+// the image as they are read, so memory use does not grow with the number of entities. Very
+// large generated scenes can be compiled this way. Templates may be used before they are
+// defined, references are checked at the end
+class CSceneCompiler
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates a compiler with no scene
+	CSceneCompiler() {}
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CSceneCompiler( const CSceneCompiler& );
+	CSceneCompiler& operator=( const CSceneCompiler& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Compile the given scene file to the given image file, returns false on failure (after
+	// showing an error message)
+	bool Compile( const string& sceneFileName, const string& imageFileName );
+
+	// Returns true if the image file exists, is newer than the scene file and is of the current
+	// image version - i.e. it does not need compiling again
+	static bool IsImageUpToDate( const string& sceneFileName, const string& imageFileName );
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	// Read the scene elements, writing entities to the image file as they are read
+	bool ReadScene();
+
+	// Read the current element, a child of the Scene element
+	bool ReadSceneElement();
+
+	// Read a template or tank template
+	bool ReadTemplate( bool isTank );
+
+	// Get the index of the named template, adding a placeholder if it is not yet defined
+	TUInt32 TemplateIndex( const char* name );
+
+	// Add a string to the string table and return its offset. Recently used strings are shared
+	TUInt32 AddString( const char* text );
+
+	// Write an entity record to the image file
+	void WriteEntity( const SSceneEntity& entity );
+
+	// Check all references and write the remaining arrays and the header to the image file
+	bool FinishImage();
+
+	// Show an error message with the position in the scene file, returns false
+	bool Error( const string& text );
+
+
+	CXMLPullReader          m_Reader;
+	string                  m_SceneFileName;
+	ofstream                m_Image;
+	ofstream                m_Strings;         // Temporary file, appended to the image at the end
+	string                  m_StringsFileName;
+
+	SSceneImageHeader       m_Header;
+	TUInt32                 m_NumEntities;
+	TUInt32                 m_NumStringBytes;
+
+	// Small arrays kept in memory until the end
+	vector<SSceneTemplate>  m_Templates;
+	vector<bool>            m_TemplateDefined;
+	vector<SSceneTank>      m_Tanks;
+	vector<TFloat32>        m_Waypoints;       // x, y, z for each
+	vector<SSceneLight>     m_Lights;
+
+	map<string, TUInt32>    m_TemplateIndices;
+	map<string, TUInt32>    m_StringOffsets;   // Limited in size, see AddString
+};
+
+
+} // namespace gen
@@ -0,0 +1,115 @@
+/*******************************************
+	SceneImage.cpp
+
+	Compiled binary form of a scene file,
+	memory-mapped for loading
+********************************************/
+
+#include "SceneImage.h"
+
+namespace gen
+{
+
+// Constructor creates a closed image
+CSceneImage::CSceneImage()
+{
+	m_Header = 0;
+}
+
+// Destructor closes the image
+CSceneImage::~CSceneImage()
+{
+	Close();
+}
+
+
+// Map the given scene image file into memory. Returns false if the file cannot be opened or
+// is not a valid image of the current version
+bool CSceneImage::Open( const string& fileName )
+{
+	Close();
+	if (!m_File.Open( fileName ) || m_File.Size() < sizeof(SSceneImageHeader))
+	{
+		m_File.Close();
+		return false;
+	}
+	m_Header = reinterpret_cast<const SSceneImageHeader*>(m_File.Data());
+	if (!Validate( m_File.Size() ))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+// Unmap the file
+void CSceneImage::Close()
+{
+	m_Header = 0;
+	m_File.Close();
+}
+
+
+// Check an array lies within a file of the given size
+static bool ArrayInFile( const SSceneArray& array, TUInt32 elementSize, TUInt32 fileSize )
+{
+	return array.offset % 4 == 0 && array.offset <= fileSize &&
+	       array.count <= (fileSize - array.offset) / elementSize;
+}
+
+// Check the header and that all arrays and references lie within the file, so a damaged or
+// truncated image is rejected rather than read out of bounds
+bool CSceneImage::Validate( TUInt32 fileSize ) const
+{
+	const SSceneImageHeader& header = *m_Header;
+	if (header.magic != kSceneImageMagic || header.version != kSceneImageVersion ||
+	    header.fileSize != fileSize ||
+	    !ArrayInFile( header.templates, sizeof(SSceneTemplate), fileSize ) ||
+	    !ArrayInFile( header.entities, sizeof(SSceneEntity), fileSize ) ||
+	    !ArrayInFile( header.tanks, sizeof(SSceneTank), fileSize ) ||
+	    !ArrayInFile( header.waypoints, 3 * sizeof(TFloat32), fileSize ) ||
+	    !ArrayInFile( header.lights, sizeof(SSceneLight), fileSize ) ||
+	    !ArrayInFile( header.strings, 1, fileSize ))
+	{
+		return false;
+	}
+
+	// String table must end with a null so every string offset within it is terminated
+	const char* strings = String( 0 );
+	TUInt32 numChars = header.strings.count;
+	if (numChars == 0 || strings[numChars - 1] != 0)
+	{
+		return false;
+	}
+
+	for (TUInt32 entry = 0; entry < header.templates.count; ++entry)
+	{
+		const SSceneTemplate& data = Templates()[entry];
+		if (data.type >= numChars || data.name >= numChars || data.mesh >= numChars)
+		{
+			return false;
+		}
+	}
+	for (TUInt32 entry = 0; entry < header.entities.count; ++entry)
+	{
+		const SSceneEntity& data = Entities()[entry];
+		if (data.templateIndex >= header.templates.count || data.name >= numChars)
+		{
+			return false;
+		}
+	}
+	for (TUInt32 entry = 0; entry < header.tanks.count; ++entry)
+	{
+		const SSceneTank& data = Tanks()[entry];
+		if (data.templateIndex >= header.templates.count || !Templates()[data.templateIndex].isTank ||
+		    data.name >= numChars || data.firstWaypoint > header.waypoints.count ||
+		    data.numWaypoints > header.waypoints.count - data.firstWaypoint)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+} // namespace gen
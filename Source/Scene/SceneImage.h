@@ -0,0 +1,202 @@
+/*******************************************
+	SceneImage.h
+
+	Compiled binary form of a scene file,
+	memory-mapped for loading
+********************************************/
+
+#pragma once
+
+#include <string>
+using namespace std;
+
+#include "Defines.h"
+#include "MappedFile.h"
+
+namespace gen
+{
+
+/*-----------------------------------------------------------------------------------------
+	Scene image file format
+-----------------------------------------------------------------------------------------*/
+// A scene image is a header followed by flat arrays of fixed size records, then a table of
+// null-terminated strings. Records refer to strings by byte offset into the string table and
+// to other records by array index. Everything is 4-byte aligned so the file can be mapped
+// into memory and used in place. Vectors are stored as x, y, z and rotations in radians
+
+// Identifies a scene image, and the version of the layout below - increase the version if
+// any of the structures change so older images are recompiled
+const TUInt32 kSceneImageMagic = 0x4e435354; // "TSCN"
+const TUInt32 kSceneImageVersion = 1;
+
+// Position and number of elements of an array in the image
+struct SSceneArray
+{
+	TUInt32 offset; // Bytes from start of file
+	TUInt32 count;
+};
+
+// Entity template, tank templates have the tank stats set
+struct SSceneTemplate
+{
+	TUInt32  type;           // String offsets
+	TUInt32  name;
+	TUInt32  mesh;
+
+	TUInt32  isTank;
+	TFloat32 maxSpeed;
+	TFloat32 acceleration;
+	TFloat32 turnSpeed;
+	TFloat32 turretTurnSpeed;
+	TInt32   maxHP;
+	TInt32   shellDamage;
+};
+
+// Entity flags
+const TUInt32 kSceneEntityStatic = 1; // Added to the collision world
+
+// Non-tank entity
+struct SSceneEntity
+{
+	TUInt32  templateIndex;
+	TUInt32  name;           // String offset
+	TFloat32 position[3];
+	TFloat32 rotation[3];
+	TFloat32 scale[3];
+	TUInt32  flags;
+};
+
+// Tank entity and its patrol route
+struct SSceneTank
+{
+	TUInt32  templateIndex;
+	TUInt32  name;           // String offset
+	TUInt32  team;
+	TFloat32 position[3];
+	TFloat32 rotation[3];
+	TUInt32  firstWaypoint;  // Range in the waypoint array
+	TUInt32  numWaypoints;
+};
+
+// Point light
+struct SSceneLight
+{
+	TFloat32 position[3];
+	TFloat32 colour[4];
+	TFloat32 brightness;
+};
+
+// Scene image header, at the start of the file
+struct SSceneImageHeader
+{
+	TUInt32     magic;
+	TUInt32     version;
+	TUInt32     fileSize;
+
+	SSceneArray templates;   // SSceneTemplate
+	SSceneArray entities;    // SSceneEntity
+	SSceneArray tanks;       // SSceneTank
+	SSceneArray waypoints;   // TFloat32[3]
+	SSceneArray lights;      // SSceneLight
+	SSceneArray strings;     // Bytes
+
+	TFloat32    ambientColour[4];
+
+	TFloat32    cameraPosition[3];
+	TFloat32    cameraRotation[3];
+	TFloat32    cameraNearClip;
+	TFloat32    cameraFarClip;
+
+	// Navigation grid covers the scenery extended to include this area
+	TFloat32    navAreaMin[3];
+	TFloat32    navAreaMax[3];
+	TFloat32    navCellSize;
+	TFloat32    navClearance;
+};
+
+
+/*-----------------------------------------------------------------------------------------
+	Scene image reader
+-----------------------------------------------------------------------------------------*/
+// Maps a scene image file into memory and gives access to its arrays. The data is read only
+// and remains valid until the image is closed
+class CSceneImage
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates a closed image
+	CSceneImage();
+
+	// Destructor closes the image
+	~CSceneImage();
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CSceneImage( const CSceneImage& );
+	CSceneImage& operator=( const CSceneImage& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Map the given scene image file into memory. Returns false if the file cannot be opened or
+	// is not a valid image of the current version
+	bool Open( const string& fileName );
+
+	// Unmap the file
+	void Close();
+
+	bool IsOpen() const
+	{
+		return m_Header != 0;
+	}
+
+
+	/////////////////////////////////////
+	// Contents (image must be open)
+
+	const SSceneImageHeader& Header() const
+	{
+		return *m_Header;
+	}
+
+	TUInt32 NumTemplates() const { return m_Header->templates.count; }
+	TUInt32 NumEntities()  const { return m_Header->entities.count; }
+	TUInt32 NumTanks()     const { return m_Header->tanks.count; }
+	TUInt32 NumLights()    const { return m_Header->lights.count; }
+
+	const SSceneTemplate* Templates() const { return Array<SSceneTemplate>( m_Header->templates ); }
+	const SSceneEntity*   Entities()  const { return Array<SSceneEntity>( m_Header->entities ); }
+	const SSceneTank*     Tanks()     const { return Array<SSceneTank>( m_Header->tanks ); }
+	const TFloat32*       Waypoints() const { return Array<TFloat32>( m_Header->waypoints ); }
+	const SSceneLight*    Lights()    const { return Array<SSceneLight>( m_Header->lights ); }
+
+	// Get a string from the string table by offset
+	const char* String( TUInt32 offset ) const
+	{
+		return Array<char>( m_Header->strings ) + offset;
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	template <class T>
+	const T* Array( const SSceneArray& array ) const
+	{
+		return reinterpret_cast<const T*>(reinterpret_cast<const TUInt8*>(m_Header) + array.offset);
+	}
+
+	// Check the header and that all arrays and references lie within the file
+	bool Validate( TUInt32 fileSize ) const;
+
+
+	CMappedFile              m_File;
+	const SSceneImageHeader* m_Header;      // Start of mapped file, 0 if not open
+};
+
+
+} // namespace gen
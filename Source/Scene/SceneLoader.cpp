@@ -0,0 +1,347 @@
+/*******************************************
+	SceneLoader.cpp
+
+	Loads the templates and entities for a
+	scene, decoding assets on a thread pool
+********************************************/
+
+#include <algorithm>
+#include "SceneLoader.h"
+#include "TraceLog.h"
+#include "TextureCache.h"
+#include "MemoryTracker.h"
+
+namespace gen
+{
+
+// Get reference to global variables from another source file
+extern ID3D10Device* g_pd3dDevice;
+extern const string MediaFolder;
+
+// Start-up timeline
+extern CTraceLog TraceLog;
+
+// Textures shared between all meshes
+extern CTextureCache TextureCache;
+
+
+// Constructor creates a loader adding templates to the given entity manager
+CSceneLoader::CSceneLoader( CEntityManager* entityManager, TUInt32 numThreads, bool headless /*= false*/ )
+	: m_Pool( numThreads, "Loader" )
+{
+	m_EntityManager = entityManager;
+	m_Headless = headless;
+}
+
+// Destructor releases anything left over from a failed load
+CSceneLoader::~CSceneLoader()
+{
+	m_Pool.WaitForAll();
+	ReleaseResources();
+}
+
+
+// Load all the templates in the given scene image, returns false on failure
+bool CSceneLoader::LoadTemplates( const CSceneImage& image )
+{
+	m_CreatedTemplates.clear();
+	for (TUInt32 entry = 0; entry < image.NumTemplates(); ++entry)
+	{
+		const SSceneTemplate& data = image.Templates()[entry];
+		STemplate newTemplate;
+		newTemplate.type = image.String( data.type );
+		newTemplate.name = image.String( data.name );
+		newTemplate.meshFileName = image.String( data.mesh );
+		newTemplate.isTank = data.isTank != 0;
+		newTemplate.maxSpeed = data.maxSpeed;
+		newTemplate.acceleration = data.acceleration;
+		newTemplate.turnSpeed = data.turnSpeed;
+		newTemplate.turretTurnSpeed = data.turretTurnSpeed;
+		newTemplate.maxHP = data.maxHP;
+		newTemplate.shellDamage = data.shellDamage;
+		newTemplate.mesh = 0;
+		newTemplate.existing = 0;
+		m_Templates.push_back( newTemplate );
+	}
+
+	// Import all meshes in parallel, they will queue their own texture jobs
+	for (TUInt32 entry = 0; entry < m_Templates.size(); ++entry)
+	{
+		STemplate* pTemplate = &m_Templates[entry];
+		m_Pool.AddJob( [this, pTemplate] { ImportMesh( pTemplate ); } );
+	}
+	{
+		CTraceScope trace( TraceLog, "Wait for decoding", "Loading" );
+		m_Pool.WaitForAll();
+	}
+
+	bool success = CreateTemplates();
+	ReleaseResources();
+	return success;
+}
+
+
+// Create the entities and tanks in the given scene image, the templates must have been loaded
+// first. Static entities are added to the collision world and the UIDs of the tanks are returned
+// in the same order as in the image
+void CSceneLoader::CreateEntities( const CSceneImage& image, CCollisionWorld* collisionWorld,
+                                   vector<TEntityUID>* pTankUIDs )
+{
+	CTraceScope trace( TraceLog, "Create entities", "Loading" );
+
+	// Space for all entities up front, templates are looked up by index rather than by name
+	m_EntityManager->ReserveEntities( image.NumEntities() + image.NumTanks() );
+	const SSceneEntity* entities = image.Entities();
+	for (TUInt32 entity = 0; entity < image.NumEntities(); ++entity)
+	{
+		const SSceneEntity& data = entities[entity];
+		TEntityUID uid = m_EntityManager->CreateEntity( m_CreatedTemplates[data.templateIndex], image.String( data.name ),
+			CVector3( data.position ), CVector3( data.rotation ), CVector3( data.scale ) );
+		if (data.flags & kSceneEntityStatic)
+		{
+			collisionWorld->AddStaticEntity( m_EntityManager->GetEntity( uid ) );
+		}
+	}
+
+	const SSceneTank* tanks = image.Tanks();
+	for (TUInt32 tank = 0; tank < image.NumTanks(); ++tank)
+	{
+		const SSceneTank& data = tanks[tank];
+		const TFloat32* waypoints = image.Waypoints() + 3 * data.firstWaypoint;
+		vector<CVector3> patrolList;
+		for (TUInt32 waypoint = 0; waypoint < data.numWaypoints; ++waypoint)
+		{
+			patrolList.push_back( CVector3( waypoints + 3 * waypoint ) );
+		}
+		pTankUIDs->push_back( m_EntityManager->CreateTank( image.String( image.Templates()[data.templateIndex].name ),
+			data.team, patrolList, image.String( data.name ), CVector3( data.position ), CVector3( data.rotation ) ) );
+	}
+}
+
+
+// Apply an edited scene image to the templates already loaded, while the game is running.
+// Returns false if any mesh failed to load
+bool CSceneLoader::ReloadTemplates( const CSceneImage& image, const vector<string>& changedMeshFiles,
+                                    vector<CMesh*>* pOldMeshes )
+{
+	CTraceScope trace( TraceLog, "Reload templates", "Loading" );
+
+	m_CreatedTemplates.clear();
+	m_OldMeshes.clear();
+	for (TUInt32 entry = 0; entry < image.NumTemplates(); ++entry)
+	{
+		const SSceneTemplate& data = image.Templates()[entry];
+		STemplate newTemplate;
+		newTemplate.type = image.String( data.type );
+		newTemplate.name = image.String( data.name );
+		newTemplate.meshFileName = image.String( data.mesh );
+		newTemplate.isTank = data.isTank != 0;
+		newTemplate.maxSpeed = data.maxSpeed;
+		newTemplate.acceleration = data.acceleration;
+		newTemplate.turnSpeed = data.turnSpeed;
+		newTemplate.turretTurnSpeed = data.turretTurnSpeed;
+		newTemplate.maxHP = data.maxHP;
+		newTemplate.shellDamage = data.shellDamage;
+		newTemplate.mesh = 0;
+		newTemplate.existing = m_EntityManager->GetTemplate( newTemplate.name );
+
+		CEntityTemplate* existing = newTemplate.existing;
+		if (existing)
+		{
+			// Entities have already been created with this template, so it cannot become a
+			// different kind of template
+			CTankTemplate* tankTemplate = dynamic_cast<CTankTemplate*>(existing);
+			if (existing->GetType() != newTemplate.type || (tankTemplate != 0) != newTemplate.isTank)
+			{
+				string errorMsg = "Template " + newTemplate.name + " has changed type, restart to apply";
+				SystemMessageBox( errorMsg.c_str(), "Scene Error" );
+				continue;
+			}
+			if (tankTemplate)
+			{
+				tankTemplate->SetSpecifications( newTemplate.maxSpeed, newTemplate.acceleration, newTemplate.turnSpeed,
+					newTemplate.turretTurnSpeed, newTemplate.maxHP, newTemplate.shellDamage );
+			}
+
+			// Keep the current mesh unless it is a different file or the file has been edited
+			if (existing->Mesh()->FileName() == newTemplate.meshFileName &&
+			    find( changedMeshFiles.begin(), changedMeshFiles.end(), newTemplate.meshFileName ) == changedMeshFiles.end())
+			{
+				continue;
+			}
+		}
+		m_Templates.push_back( newTemplate );
+	}
+
+	// Load the meshes needed in the same way as at start-up, textures already in the cache are
+	// shared rather than loaded again
+	for (TUInt32 entry = 0; entry < m_Templates.size(); ++entry)
+	{
+		STemplate* pTemplate = &m_Templates[entry];
+		m_Pool.AddJob( [this, pTemplate] { ImportMesh( pTemplate ); } );
+	}
+	m_Pool.WaitForAll();
+
+	bool success = CreateTemplates();
+	ReleaseResources();
+	pOldMeshes->insert( pOldMeshes->end(), m_OldMeshes.begin(), m_OldMeshes.end() );
+	m_OldMeshes.clear();
+	return success;
+}
+
+
+// Job to import the mesh for a template, queues jobs for textures not already queued
+void CSceneLoader::ImportMesh( STemplate* pTemplate )
+{
+	CTraceScope trace( TraceLog, "Import " + pTemplate->meshFileName, "Loading" );
+
+	CMesh* mesh = new CMesh();
+	try
+	{
+		if (!mesh->Import( pTemplate->meshFileName, &m_Pool ))
+		{
+			delete mesh;
+			return;
+		}
+	}
+	catch (...)
+	{
+		delete mesh;
+		return;
+	}
+	pTemplate->mesh = mesh;
+	if (m_Headless)
+	{
+		return;
+	}
+
+	vector<string> textureFileNames;
+	mesh->GetTextureFileNames( &textureFileNames );
+	lock_guard<mutex> lock( m_Mutex );
+	for (TUInt32 texture = 0; texture < textureFileNames.size(); ++texture)
+	{
+		const string& fileName = textureFileNames[texture];
+		string path = CTextureCache::CanonicalPath( fileName );
+		if (m_Textures.find( path ) == m_Textures.end() && !TextureCache.Contains( fileName ))
+		{
+			STexture* pTexture = &m_Textures[path]; // Map entries don't move, safe to keep
+			pTexture->fileName = fileName;
+			pTexture->processor = 0;
+			m_Pool.AddJob( [this, pTexture] { DecodeTexture( pTexture ); } );
+		}
+	}
+}
+
+// Job to read and decode a texture file. Uses the D3DX asynchronous loader and processor, which
+// split loading into reading the file, decoding it and creating the device resource
+void CSceneLoader::DecodeTexture( STexture* pTexture )
+{
+	CTraceScope trace( TraceLog, "Decode " + pTexture->fileName, "Loading" );
+	CMemoryScope memory( Mem_Textures );
+
+	string fullFileName = MediaFolder + pTexture->fileName;
+	ID3DX10DataLoader* loader = 0;
+	ID3DX10DataProcessor* processor = 0;
+	if (FAILED( D3DX10CreateAsyncFileLoader( fullFileName.c_str(), &loader ) ) ||
+	    FAILED( D3DX10CreateAsyncShaderResourceViewProcessor( g_pd3dDevice, NULL, &processor ) ))
+	{
+		if (loader) loader->Destroy();
+		return;
+	}
+
+	void*  data;
+	SIZE_T dataSize;
+	if (SUCCEEDED( loader->Load() ) && SUCCEEDED( loader->Decompress( &data, &dataSize ) ) &&
+	    SUCCEEDED( processor->Process( data, dataSize ) ))
+	{
+		pTexture->processor = processor;
+	}
+	else
+	{
+		processor->Destroy();
+	}
+	loader->Destroy();
+}
+
+
+// Create the device resources for textures and meshes, then create the templates
+bool CSceneLoader::CreateTemplates()
+{
+	CTraceScope trace( TraceLog, "Upload", "Loading" );
+
+	// Create texture resources and put them in the texture cache for the meshes to find. Textures
+	// that failed to decode are left out, so the meshes will try to load them and report the error
+	vector<ID3D10ShaderResourceView*> textures;
+	for (map<string, STexture>::iterator texture = m_Textures.begin(); texture != m_Textures.end(); ++texture)
+	{
+		ID3DX10DataProcessor* processor = texture->second.processor;
+		ID3D10ShaderResourceView* resource = 0;
+		if (processor && SUCCEEDED( processor->CreateDeviceObject( reinterpret_cast<void**>(&resource) ) ))
+		{
+			textures.push_back( TextureCache.Insert( texture->second.fileName, resource ) );
+		}
+	}
+
+	// Create mesh resources and the templates that own the meshes
+	bool success = true;
+	for (TUInt32 entry = 0; entry < m_Templates.size(); ++entry)
+	{
+		STemplate& data = m_Templates[entry];
+		if (!data.mesh || (!m_Headless && !data.mesh->CreateDeviceResources()))
+		{
+			string errorMsg = "Error loading mesh " + data.meshFileName;
+			SystemMessageBox( errorMsg.c_str(), "Mesh Error" );
+			success = false;
+			break;
+		}
+
+		if (data.existing)
+		{
+			// Entities hold a matrix for each node of their template's mesh
+			if (data.mesh->GetNumNodes() != data.existing->Mesh()->GetNumNodes())
+			{
+				string errorMsg = "Mesh " + data.meshFileName + " has a different hierarchy, restart to apply";
+				SystemMessageBox( errorMsg.c_str(), "Mesh Error" );
+				continue; // Mesh is deleted below
+			}
+			m_OldMeshes.push_back( data.existing->ReplaceMesh( data.mesh ) );
+			m_CreatedTemplates.push_back( data.existing );
+		}
+		else if (data.isTank)
+		{
+			m_CreatedTemplates.push_back( m_EntityManager->CreateTankTemplate( data.type, data.name, data.mesh,
+				data.maxSpeed, data.acceleration, data.turnSpeed, data.turretTurnSpeed, data.maxHP, data.shellDamage ) );
+		}
+		else
+		{
+			m_CreatedTemplates.push_back( m_EntityManager->CreateTemplate( data.type, data.name, data.mesh ) );
+		}
+		data.mesh = 0; // Now owned by the template
+	}
+
+	// Meshes hold their own references to the textures they use
+	for (TUInt32 texture = 0; texture < textures.size(); ++texture)
+	{
+		TextureCache.Release( textures[texture] );
+	}
+	return success;
+}
+
+// Release any meshes and texture data still held
+void CSceneLoader::ReleaseResources()
+{
+	for (TUInt32 entry = 0; entry < m_Templates.size(); ++entry)
+	{
+		delete m_Templates[entry].mesh;
+	}
+	m_Templates.clear();
+
+	for (map<string, STexture>::iterator texture = m_Textures.begin(); texture != m_Textures.end(); ++texture)
+	{
+		if (texture->second.processor) texture->second.processor->Destroy();
+	}
+	m_Textures.clear();
+}
+
+
+} // namespace gen
@@ -0,0 +1,138 @@
+/*******************************************
+	SceneLoader.h
+
+	Loads the templates and entities for a
+	scene, decoding assets on a thread pool
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <mutex>
+using namespace std;
+
+#include <d3dx10.h>
+
+#include "Defines.h"
+#include "ThreadPool.h"
+#include "EntityManager.h"
+#include "CollisionWorld.h"
+#include "SceneImage.h"
+
+namespace gen
+{
+
+// Loads the templates and entities in a scene image. Meshes are imported and texture files read and decoded as jobs on a thread pool - each
+// texture file only once however many meshes use it, and not at all if it is already in the
+// texture cache. When all jobs are done the calling
+// (main) thread creates the device resources and the templates. Each stage is recorded in the
+// trace log so the overlap between threads can be seen
+class CSceneLoader
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates a loader adding templates to the given entity manager, using the
+	// given number of worker threads (0 to load everything on the calling thread). A headless
+	// loader only imports mesh geometry - no textures are loaded and no device resources are
+	// created, so there need not be a device, e.g. for benchmarks. Headless meshes cannot be rendered
+	CSceneLoader( CEntityManager* entityManager, TUInt32 numThreads, bool headless = false );
+
+	// Destructor releases anything left over from a failed load
+	~CSceneLoader();
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CSceneLoader( const CSceneLoader& );
+	CSceneLoader& operator=( const CSceneLoader& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	// Load all the templates in the given scene image, returns false on failure
+	bool LoadTemplates( const CSceneImage& image );
+
+	// Create the entities and tanks in the given scene image, the templates must have been
+	// loaded first. Static entities are added to the collision world and the UIDs of the tanks
+	// are returned in the same order as in the image
+	void CreateEntities( const CSceneImage& image, CCollisionWorld* collisionWorld,
+	                     vector<TEntityUID>* pTankUIDs );
+
+	// Apply an edited scene image to the templates already loaded, while the game is running.
+	// Tank specifications are updated in place, meshes are only loaded again if their file name
+	// has changed or they are in the given list of edited mesh files. Templates new to the image
+	// are created. Replaced meshes are added to the given list rather than deleted, since the
+	// collision world still refers to them - the caller deletes them after refreshing it.
+	// Returns false if any mesh failed to load
+	bool ReloadTemplates( const CSceneImage& image, const vector<string>& changedMeshFiles,
+	                      vector<CMesh*>* pOldMeshes );
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	/////////////////////////////////////
+	// Types
+
+	// A template read from the scene image and its mesh once imported
+	struct STemplate
+	{
+		string   type;
+		string   name;
+		string   meshFileName;
+
+		bool     isTank;
+		TFloat32 maxSpeed, acceleration, turnSpeed, turretTurnSpeed;
+		TInt32   maxHP, shellDamage;
+
+		CMesh*   mesh;     // 0 if import failed
+
+		CEntityTemplate* existing; // Template to replace the mesh of when reloading, 0 for a new template
+	};
+
+	// A texture file being read and decoded. The processor holds the decoded image ready to
+	// create the device resource
+	struct STexture
+	{
+		string                fileName;  // As given in the mesh file
+		ID3DX10DataProcessor* processor; // 0 if decoding failed
+	};
+
+
+	/////////////////////////////////////
+	// Support functions
+
+	// Job to import the mesh for a template, queues jobs for textures not already queued
+	void ImportMesh( STemplate* pTemplate );
+
+	// Job to read and decode a texture file
+	void DecodeTexture( STexture* pTexture );
+
+	// Create the device resources for textures and meshes, then create the templates
+	bool CreateTemplates();
+
+	// Release any meshes and texture data still held
+	void ReleaseResources();
+
+
+	/////////////////////////////////////
+	// Data
+
+	CEntityManager*          m_EntityManager;
+	CThreadPool              m_Pool;
+	bool                     m_Headless;
+
+	vector<STemplate>        m_Templates;
+	vector<CEntityTemplate*> m_CreatedTemplates; // By index in the scene image
+	vector<CMesh*>           m_OldMeshes;        // Meshes replaced when reloading
+	map<string, STexture>    m_Textures;         // By canonical path, see CTextureCache
+	mutex                    m_Mutex;            // Protects m_Textures while jobs are running
+};
+
+
+} // namespace gen
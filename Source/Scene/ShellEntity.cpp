@@ -7,6 +7,8 @@
 #include "ShellEntity.h"
 #include "TankEntity.h"
 #include "EntityManager.h"
+#include "CollisionWorld.h"
+#include "TankGrid.h"
 #include "Messenger.h"
 
 namespace gen
@@ -20,6 +22,12 @@ extern CEntityManager EntityManager;
 // Messenger class for sending messages to and between entities
 extern CMessenger Messenger;
 
+// Static scenery the shell can hit
+extern CCollisionWorld CollisionWorld;
+
+// The tanks near the shell, so it doesn't need to check every tank
+extern CTankGrid TankGrid;
+
 // Helper function made available from TankAssignment.cpp - gets UID of tank A (team 0) or B (team 1).
 // Will be needed to implement the required shell behaviour in the Update function below
 extern TEntityUID GetTankUID( int team );
@@ -63,45 +71,64 @@ bool CShellEntity::Update( TFloat32 updateTime )
 		// Reduce life time
 		m_ShellLifeTime = m_ShellLifeTime - updateTime;
 		// Move the shell (fire)
+		const CVector3 previousPosition = Position();
 		Matrix().MoveLocalZ(m_ShellSpeed * updateTime);
 
-		// Check to see if it has collided with the other tank
-
 		// Work out the radius of the shell
 		const TFloat32 shellRadius = Template()->Mesh()->BoundingRadius();
 
-		EntityManager.BeginEnumEntities("", "", "Tank");
-		CEntity* pTankEntity = EntityManager.EnumEntity();
-		while (pTankEntity != 0)
+		// Check to see if it has hit any scenery - test the whole distance moved this update
+		// so that fast shells can't pass through thin walls between frames
+		if (CollisionWorld.SegmentIntersect(previousPosition, Position(), shellRadius))
+		{
+			// Remove the shell (destroy it)
+			return false;
+
+		} // End of if statment
+
+		// Check to see if it has collided with a tank - only the tanks the grid finds near the
+		// shell are checked. If it touches more than one, the first created (lowest UID) is hit
+		TEntityUID hitTankUID = 0;
+		bool hitTank = false;
+		auto tankVisitor = [&](TEntityUID tankUID)
 		{
+			// The tank may have been destroyed earlier in this update
+			CEntity* pTankEntity = EntityManager.GetEntity(tankUID);
+			if (pTankEntity == 0 || (hitTank && tankUID > hitTankUID))
+			{
+				return;
+			}
+
 			// Work out the radius of the tank
 			const TFloat32 tankRadius = pTankEntity->Template()->Mesh()->BoundingRadius();
 
 			// Work out the distance between the shell and the tank
 			const TFloat32 distanceFromTank = Position().DistanceTo(pTankEntity->Position());
 
-			// Check to see if the shell has collided with the tank and if so, send a message 
+			// Check to see if the shell has collided with the tank
 			if (distanceFromTank < (shellRadius + tankRadius))
 			{
-				// Hit has occured
-				// Send a hit message to the tank
-				SMessage msg;
-				msg.type = Msg_Hit;
-				msg.from = GetUID();
-
-				Messenger.SendMessage(pTankEntity->GetUID(), msg);
+				hitTankUID = tankUID;
+				hitTank = true;
+			}
+		};
+		TankGrid.Query(Position(), shellRadius, tankVisitor);
 
-				// Remove the shell (destroy it)
-				return false;
-
-			} // End of if statment
+		if (hitTank)
+		{
+			// Hit has occured
+			// Send a hit message to the tank
+			SMessage msg;
+			msg.type = Msg_Hit;
+			msg.from = GetUID();
+			msg.data = m_TankUID; // Firing tank, for the help calls to target
 
-			// get the next tank info
-			pTankEntity = EntityManager.EnumEntity();
+			Messenger.SendMessage(hitTankUID, msg);
 
-		} // End of while loop
+			// Remove the shell (destroy it)
+			return false;
 
-		EntityManager.EndEnumEntities();
+		} // End of if statment
 
 	}
 	else // Destroy shell
@@ -116,4 +143,32 @@ bool CShellEntity::Update( TFloat32 updateTime )
 } // End of update class
 
 
+// Write the shell's state to a snapshot
+void CShellEntity::SaveState( CSnapshot* pSnapshot )
+{
+	CEntity::SaveState( pSnapshot );
+	pSnapshot->Write( m_ShellLifeTime );
+	pSnapshot->Write( m_ShellSpeed );
+	pSnapshot->Write( m_TankUID );
+}
+
+// Read the shell's state from a snapshot
+void CShellEntity::LoadState( CSnapshot* pSnapshot )
+{
+	CEntity::LoadState( pSnapshot );
+	pSnapshot->Read( &m_ShellLifeTime );
+	pSnapshot->Read( &m_ShellSpeed );
+	pSnapshot->Read( &m_TankUID );
+}
+
+// Add the shell's state to a hash
+void CShellEntity::HashState( CStateHash* pHash )
+{
+	CEntity::HashState( pHash );
+	pHash->Add( m_ShellLifeTime );
+	pHash->Add( m_ShellSpeed );
+	pHash->Add( m_TankUID );
+}
+
+
 } // namespace gen
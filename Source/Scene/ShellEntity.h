@@ -61,6 +61,22 @@ public:
 	// Return false if the entity is to be destroyed
 	// Keep as a virtual function in case of further derivation
 	virtual bool Update( TFloat32 updateTime );
+
+	virtual EEntityKind GetKind()
+	{
+		return Entity_Shell;
+	}
+
+
+	/////////////////////////////////////
+	// Snapshots
+
+	// Write the shell's state to a snapshot, or read it back
+	virtual void SaveState( CSnapshot* pSnapshot );
+	virtual void LoadState( CSnapshot* pSnapshot );
+
+	// Add the shell's state to a hash
+	virtual void HashState( CStateHash* pHash );
 	
 
 /////////////////////////////////////
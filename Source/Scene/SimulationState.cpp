@@ -0,0 +1,83 @@
+/*******************************************
+	SimulationState.cpp
+
+	Saving and restoring the state of the
+	whole simulation
+********************************************/
+
+#include <vector>
+using namespace std;
+
+#include "SimulationState.h"
+#include "BaseMath.h"
+#include "EntityManager.h"
+#include "Messenger.h"
+#include "PickupIndex.h"
+#include "RaycastService.h"
+#include "Profiler.h"
+
+namespace gen
+{
+
+// Simulation globals, defined by the program running the simulation
+extern CEntityManager EntityManager;
+extern CMessenger Messenger;
+extern CPickupIndex Pickups;
+extern CRaycastService Raycasts;
+extern vector<TEntityUID> TeamOne;
+extern vector<TEntityUID> TeamTwo;
+extern CProfiler Profiler;
+
+
+// Write the state shared by everything running the simulation to a snapshot
+void SaveSimulation( CSnapshot* pSnapshot )
+{
+	CProfileZone zone( Profiler, "Save simulation" );
+
+	pSnapshot->Write( GetRandomState() );
+	EntityManager.SaveState( pSnapshot );
+	Messenger.SaveState( pSnapshot );
+	pSnapshot->WriteArray( TeamOne );
+	pSnapshot->WriteArray( TeamTwo );
+	Pickups.SaveState( pSnapshot );
+	Raycasts.SaveState( pSnapshot );
+}
+
+// Restore the state written by SaveSimulation. The entities are restored first as only they
+// depend on the scene, and they are left unchanged if the scene does not match
+bool RestoreSimulation( CSnapshot* pSnapshot )
+{
+	CProfileZone zone( Profiler, "Restore simulation" );
+
+	TUInt32 randomState = 0;
+	if (!pSnapshot->Read( &randomState ) || !EntityManager.LoadState( pSnapshot ))
+	{
+		return false;
+	}
+	SetRandomState( randomState );
+	Messenger.LoadState( pSnapshot );
+	pSnapshot->ReadArray( &TeamOne );
+	pSnapshot->ReadArray( &TeamTwo );
+	Pickups.LoadState( pSnapshot );
+	Raycasts.LoadState( pSnapshot );
+	return !pSnapshot->Failed();
+}
+
+// Add the state of the simulation to a hash
+void HashSimulation( CStateHash* pHash, vector<TUInt64>* pEntityHashes /*= 0*/ )
+{
+	CProfileZone zone( Profiler, "Hash simulation" );
+
+	// The whole state is hashed again each time, rather than a hash being kept up to date as the
+	// state changes. Entity matrices and fields are written all over the update code, so keeping
+	// a hash up to date would mean catching every write, and one missed write would let the runs
+	// being checked diverge unseen. Most entities move every update so little would be saved, and
+	// hashing only runs when a check asks for it (replays every kHashInterval updates, Benchmark
+	// -hashes every tick) - about 5ms an update for 60k entities
+	pHash->Add( GetRandomState() );
+	EntityManager.HashState( pHash, pEntityHashes );
+	Messenger.HashState( pHash );
+}
+
+
+} // namespace gen
@@ -0,0 +1,41 @@
+/*******************************************
+	SimulationState.h
+
+	Saving and restoring the state of the
+	whole simulation
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "Snapshot.h"
+#include "StateHash.h"
+
+namespace gen
+{
+
+// Write the state shared by everything running the simulation to a snapshot: the random sequence,
+// the entities, messages not yet fetched, the teams, packs on the ground and line of sight
+// results. Programs running the simulation write their own state after this (e.g. the game's pack
+// timers). Take snapshots between updates
+void SaveSimulation( CSnapshot* pSnapshot );
+
+// Restore the state written by SaveSimulation, reading from the snapshot's current position.
+// Returns false if the snapshot does not match the loaded scene, in which case nothing has been
+// changed. Snapshots saved to file are checked when loaded, so other failures only come from
+// damaged data, and leave the simulation partly restored
+bool RestoreSimulation( CSnapshot* pSnapshot );
+
+// Add the state of the simulation to a hash, to check that two runs match: the random sequence,
+// each entity (positions, orientations, hit points, ammo, states...) and the messages not yet
+// fetched. Packs on the ground and line of sight results are left out as they are copies of
+// entity state or affect the entities on the next update. Fast enough to run every update -
+// nothing is copied and scenery is skipped. If an array is given it receives the hash of each
+// entity, indexed as for CEntityManager::GetEntityAtIndex, to find the first that differs
+void HashSimulation( CStateHash* pHash, vector<TUInt64>* pEntityHashes = 0 );
+
+
+} // namespace gen
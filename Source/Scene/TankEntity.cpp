@@ -27,8 +27,13 @@
 //   using their entity pointers. The return value from EntityManager.GetEntity will be NULL if the
 //   entity no longer exists. Use this to avoid trying to target a tank that no longer exists etc.
 
+#include <stdio.h>
 #include "TankEntity.h"
 #include "EntityManager.h"
+#include "RaycastService.h"
+#include "PickupIndex.h"
+#include "NavGrid.h"
+#include "TankGrid.h"
 #include "Messenger.h"
 
 namespace gen
@@ -42,6 +47,18 @@ extern CEntityManager EntityManager;
 // Messenger class for sending messages to and between entities
 extern CMessenger Messenger;
 
+// Batched rays, used for line-of-sight checks before firing
+extern CRaycastService Raycasts;
+
+// Health and ammo packs on the ground
+extern CPickupIndex Pickups;
+
+// Navigation grid, tanks steer along its flow fields to reach patrol points
+extern CNavGrid NavGrid;
+
+// Grid of the tanks' positions used by shells, told how far each tank moves
+extern CTankGrid TankGrid;
+
 // Helper function made available from TankAssignment.cpp - gets UID of tank A (team 0) or B (team 1).
 // Will be needed to implement the required tank behaviour in the Update function below
 extern const vector<TEntityUID>& GetEnemyTankUID( int team );
@@ -95,6 +112,54 @@ CTankEntity::CTankEntity
 
 	// Set the target enemy UID
 	m_TargetEnemyUID = 0;
+
+	// No packs claimed yet
+	m_HealthClaim = CPickupIndex::kNoPickup;
+	m_AmmoClaim = CPickupIndex::kNoPickup;
+
+	// No line of sight ray yet
+	m_SightTicket = CRaycastService::kInvalidTicket;
+	m_SightTarget = 0;
+
+	// No label yet
+	m_LabelLength = 0;
+	m_LabelExtraInfo = false;
+	m_LabelHP = 0;
+	m_LabelState = Inactive;
+	m_LabelShellsFired = 0;
+	m_LabelAmmo = 0;
+}
+
+
+// Get the text shown under the tank, only formatted again when something in it changes. The name
+// is set on creation so is not checked
+const char* CTankEntity::GetLabel(bool extraInfo, TUInt32* pLength)
+{
+	if (m_LabelLength == 0 || extraInfo != m_LabelExtraInfo || (extraInfo && (m_HP != m_LabelHP ||
+	    m_State != m_LabelState || m_numShellsFired != m_LabelShellsFired || m_Ammo != m_LabelAmmo)))
+	{
+		int length;
+		if (extraInfo)
+		{
+			length = snprintf(m_Label, kMaxLabelLength, "Name: %s\nHPs: %d\nState: %s\nShells Fired: %d\nShells Left: %d\n",
+			                  GetName().c_str(), m_HP, m_TankStateText.c_str(), static_cast<int>(m_numShellsFired), m_Ammo);
+		}
+		else
+		{
+			length = snprintf(m_Label, kMaxLabelLength, "Name: %s\n", GetName().c_str());
+		}
+
+		// Long names are cut short
+		m_LabelLength = (length < 0) ? 0 : min(static_cast<TUInt32>(length), kMaxLabelLength - 1);
+		m_LabelExtraInfo = extraInfo;
+		m_LabelHP = m_HP;
+		m_LabelState = m_State;
+		m_LabelShellsFired = m_numShellsFired;
+		m_LabelAmmo = m_Ammo;
+	}
+
+	*pLength = m_LabelLength;
+	return m_Label;
 }
 
 
@@ -102,6 +167,17 @@ CTankEntity::CTankEntity
 // is to be rewritten as one of the assignment requirements
 // Return false if the entity is to be destroyed
 bool CTankEntity::Update(TFloat32 updateTime)
+{
+	// Shells find tanks by where they were at the start of the update, so the grid must know how
+	// far the tank has moved since
+	const CVector3 startPosition = Position();
+	bool alive = UpdateBehaviour(updateTime);
+	TankGrid.Moved(startPosition.DistanceTo(Position()));
+	return alive;
+}
+
+// Message processing and behaviour for one update, see Update
+bool CTankEntity::UpdateBehaviour(TFloat32 updateTime)
 {
 	if (IsAlive() == false)
 	{
@@ -122,6 +198,9 @@ bool CTankEntity::Update(TFloat32 updateTime)
 
 	} // End of if statment
 
+	// Living tanks block line of sight rays
+	Raycasts.AddSphere(Position(), Template()->Mesh()->BoundingRadius(), GetUID());
+
 
 	// Fetch any messages sent to the tanks
 	SMessage msg;
@@ -157,13 +236,17 @@ bool CTankEntity::Update(TFloat32 updateTime)
 				{
 					m_State = Dead; // Tank is dead
 					m_TankStateText = "Dead";
+
+					// Let other tanks have any packs this one was heading for
+					Pickups.ReleaseClaim(Pickup_Health, GetUID(), &m_HealthClaim);
+					Pickups.ReleaseClaim(Pickup_Ammo, GetUID(), &m_AmmoClaim);
 				}
 				else // Call for help!
 				{
 					// Get enemy tank uid
 					TEntityUID enemyUID = msg.data;
 					// Get a list of UIDs for this team.
-					const vector<TEntityUID> teamUIDs = GetTeamTankUID(m_Team);
+					const vector<TEntityUID>& teamUIDs = GetTeamTankUID(m_Team);
 
 					// Ranged based for loop (had to look this up)
 					for (TEntityUID teamUID : teamUIDs)
@@ -240,6 +323,10 @@ bool CTankEntity::Update(TFloat32 updateTime)
 		if (m_HP <= 50.0f)
 		{
 			if (LookForHealth(updateTime)) return true;
+		}
+		else if (m_HealthClaim != CPickupIndex::kNoPickup) // No longer need a health pack
+		{
+			Pickups.ReleaseClaim(Pickup_Health, GetUID(), &m_HealthClaim);
 
 		} // End of if statment
 
@@ -247,6 +334,10 @@ bool CTankEntity::Update(TFloat32 updateTime)
 		if (m_Ammo <= 3)
 		{
 			if (LookForAmmo(updateTime)) return true;
+		}
+		else if (m_AmmoClaim != CPickupIndex::kNoPickup) // No longer need an ammo pack
+		{
+			Pickups.ReleaseClaim(Pickup_Ammo, GetUID(), &m_AmmoClaim);
 
 		} // End of if statment
 
@@ -275,6 +366,9 @@ bool CTankEntity::Update(TFloat32 updateTime)
 		}
 		else // Carry on moving
 		{
+			// Find the point to steer towards to get round any scenery on the way
+			CVector3 steerTarget = NavGrid.SteerTarget(Position(), m_patrolList[m_CurrentPatrolWP]);
+
 			// Get the facing Vector of the tank
 			CVector3 tankFacingVector = Matrix().ZAxis();
 			// Normalise this vector
@@ -283,8 +377,8 @@ bool CTankEntity::Update(TFloat32 updateTime)
 			CVector3 tankRightVector = Matrix().XAxis();
 			// Normalise this vector
 			tankRightVector.Normalise();
-			// Get the distance Vector to the next patrol point
-			CVector3 distanceVector = m_patrolList[m_CurrentPatrolWP] - Position();
+			// Get the distance Vector to the steering point
+			CVector3 distanceVector = steerTarget - Position();
 			// Normalise this vector
 			distanceVector.Normalise();
 			// Work out the forward dot product 
@@ -311,8 +405,8 @@ bool CTankEntity::Update(TFloat32 updateTime)
 			}
 			else
 			{
-				// Correct the facing of the tank to make it look directly at the waypoint
-				Matrix().FaceTarget(m_patrolList[m_CurrentPatrolWP]);
+				// Correct the facing of the tank to make it look directly at the steering point
+				Matrix().FaceTarget(steerTarget);
 
 				(m_Speed < tankMaxSpeed) ? m_Speed += tankAcceleration : m_Speed = tankMaxSpeed;
 
@@ -328,7 +422,11 @@ bool CTankEntity::Update(TFloat32 updateTime)
 			if (m_Ammo > 0)
 			{
 				// Get list of enemy tank ids
-				const vector<TEntityUID> enemyUIDs = GetEnemyTankUID(m_Team);
+				const vector<TEntityUID>& enemyUIDs = GetEnemyTankUID(m_Team);
+
+				// Best lined up enemy in the turret's sights
+				CEntity* pBestEnemy = 0;
+				TFloat32 bestDP = Cos(ToRadians(15.0f));
 
 				for (auto enemyUID : enemyUIDs)
 				{
@@ -352,20 +450,36 @@ bool CTankEntity::Update(TFloat32 updateTime)
 						TFloat32 forwardDP = Dot((distanceVector), Normalise(turretWorldMatrix.ZAxis()));
 
 						// Check to see if the angle of the turrent against the enemy tank is within range
-						if (forwardDP > Cos(ToRadians(15.0f)))
+						if (forwardDP > bestDP)
 						{
-							// Change to Aim State
-							m_State = Aim;
-							// Stop the tank from moving
-							m_Speed = 0.0f;
-							m_TargetEnemyUID = enemyUID;
-						
+							bestDP = forwardDP;
+							pBestEnemy = pEnemyTank;
+
 						} // End of if statment
 
 					} // End of if statment
 
 				} // End of for loop
 
+				if (pBestEnemy != 0)
+				{
+					// Only aim if last update's ray showed nothing in the way
+					if (HasClearShot(pBestEnemy->GetUID()))
+					{
+						// Change to Aim State
+						m_State = Aim;
+						m_TankStateText = "Aim";
+						// Stop the tank from moving
+						m_Speed = 0.0f;
+						m_TargetEnemyUID = pBestEnemy->GetUID();
+
+					} // End of if statment
+
+					// Keep checking line of sight while the enemy is lined up
+					QueueSightRay(pBestEnemy);
+
+				} // End of if statment
+
 			} // End of if statment
 
 		} // End of if statment
@@ -426,13 +540,22 @@ bool CTankEntity::Update(TFloat32 updateTime)
 
 				} // End of if statment
 
+				// Check line of sight every update so it is up to date when the timer runs out
+				QueueSightRay(pEnemyTankEntity);
 			}
 			else // Is the enemy dead?
 			{
 				m_State = Patrol;
+				m_TankStateText = "Patrol";
 				return true;
 			}
 		}
+		else if (!HasClearShot(m_TargetEnemyUID)) // Something in the way, don't waste the shell
+		{
+			m_BulletLifeTime = 2.0f;
+			m_State = Patrol;
+			m_TankStateText = "Patrol";
+		}
 		else // Fire the bullet
 		{
 			// Reduce the amount of ammout the tank has
@@ -466,6 +589,7 @@ bool CTankEntity::Update(TFloat32 updateTime)
 
 			// Change to Evade State
 			m_State = Evade;
+			m_TankStateText = "Evade";
 
 		} // End of if statment
 
@@ -489,6 +613,7 @@ bool CTankEntity::Update(TFloat32 updateTime)
 		if (Position().DistanceTo(m_EvadePoint) < 20.0f)
 		{
 			m_State = Patrol;
+			m_TankStateText = "Patrol";
 		}
 		else // otherwise move towards the evade point
 		{
@@ -573,55 +698,143 @@ bool CTankEntity::Update(TFloat32 updateTime)
 	return true; // Don't destroy the entity
 }
 
+
+// Write the tank's state to a snapshot. The patrol list is saved as tanks may be given new routes
+void CTankEntity::SaveState(CSnapshot* pSnapshot)
+{
+	CEntity::SaveState(pSnapshot);
+
+	pSnapshot->Write(m_Team);
+	pSnapshot->Write(m_Speed);
+	pSnapshot->Write(m_HP);
+	pSnapshot->Write(static_cast<TUInt32>(m_State));
+	pSnapshot->Write(m_Timer);
+	pSnapshot->WriteArray(m_patrolList);
+	pSnapshot->Write(m_EvadePoint);
+	pSnapshot->Write(m_CurrentPatrolWP);
+	pSnapshot->Write(m_BulletLifeTime);
+	pSnapshot->Write(m_TargetEnemyUID);
+	pSnapshot->WriteString(m_TankStateText);
+	pSnapshot->Write(m_numShellsFired);
+	pSnapshot->Write(m_kSinkingSpeed);
+	pSnapshot->Write(m_animationTime);
+	pSnapshot->Write(m_Ammo);
+	pSnapshot->Write(m_HealthClaim);
+	pSnapshot->Write(m_AmmoClaim);
+	pSnapshot->Write(m_SightTicket);
+	pSnapshot->Write(m_SightTarget);
+}
+
+// Read the tank's state from a snapshot, the label is formatted again when next needed
+void CTankEntity::LoadState(CSnapshot* pSnapshot)
+{
+	CEntity::LoadState(pSnapshot);
+
+	TUInt32 state;
+	pSnapshot->Read(&m_Team);
+	pSnapshot->Read(&m_Speed);
+	pSnapshot->Read(&m_HP);
+	pSnapshot->Read(&state);
+	pSnapshot->Read(&m_Timer);
+	pSnapshot->ReadArray(&m_patrolList);
+	pSnapshot->Read(&m_EvadePoint);
+	pSnapshot->Read(&m_CurrentPatrolWP);
+	pSnapshot->Read(&m_BulletLifeTime);
+	pSnapshot->Read(&m_TargetEnemyUID);
+	pSnapshot->ReadString(&m_TankStateText);
+	pSnapshot->Read(&m_numShellsFired);
+	pSnapshot->Read(&m_kSinkingSpeed);
+	pSnapshot->Read(&m_animationTime);
+	pSnapshot->Read(&m_Ammo);
+	pSnapshot->Read(&m_HealthClaim);
+	pSnapshot->Read(&m_AmmoClaim);
+	pSnapshot->Read(&m_SightTicket);
+	pSnapshot->Read(&m_SightTarget);
+
+	if (state > Dead)
+	{
+		pSnapshot->Fail();
+		state = Inactive;
+
+	} // End of if statment
+	m_State = static_cast<EState>(state);
+
+	m_LabelLength = 0;
+}
+
+// Add the tank's state to a hash, the same values written to a snapshot
+void CTankEntity::HashState(CStateHash* pHash)
+{
+	CEntity::HashState(pHash);
+
+	pHash->Add(m_Team);
+	pHash->Add(m_Speed);
+	pHash->Add(m_HP);
+	pHash->Add(static_cast<TUInt32>(m_State));
+	pHash->Add(m_Timer);
+	pHash->Add(static_cast<TUInt32>(m_patrolList.size()));
+	for (TUInt32 point = 0; point < m_patrolList.size(); ++point)
+	{
+		pHash->Add(&m_patrolList[point].x, 3);
+	}
+	pHash->Add(&m_EvadePoint.x, 3);
+	pHash->Add(static_cast<TInt32>(m_CurrentPatrolWP));
+	pHash->Add(m_BulletLifeTime);
+	pHash->Add(m_TargetEnemyUID);
+	pHash->Add(m_TankStateText);
+	pHash->Add(m_numShellsFired);
+	pHash->Add(m_kSinkingSpeed);
+	pHash->Add(m_animationTime);
+	pHash->Add(m_Ammo);
+	pHash->Add(m_HealthClaim);
+	pHash->Add(m_AmmoClaim);
+	pHash->Add(m_SightTicket);
+	pHash->Add(m_SightTarget);
+}
+
 	// Function to search for any health packs
 	bool CTankEntity::LookForHealth(float updateTime)
 	{
-		// Is there a health pack?
-		CEntity* pEntity = EntityManager.GetEntity("Health Pack 1", "", "");
-
-		if (pEntity != 0)
+		// Is there a health pack on the ground that no other tank is heading for?
+		CVector3 healthPackPosition;
+		if (Pickups.ClaimNearest(Pickup_Health, Position(), GetUID(), &m_HealthClaim, &healthPackPosition))
 		{
-			CHealthEntity* pHealthEntity = dynamic_cast<CHealthEntity*>(pEntity);
-			if (pHealthEntity != nullptr && pHealthEntity->OnGround())
-			{
-				// Get data for the tank
-				TFloat32 tankAcceleration = m_TankTemplate->GetAcceleration();
-				TFloat32 tankMaxSpeed = m_TankTemplate->GetMaxSpeed();
-				TFloat32 tankTurnSpeed = m_TankTemplate->GetTurnSpeed();
-				TFloat32 turrentRotateSpeed = m_TankTemplate->GetTurretTurnSpeed();
-
-				CVector3 distanceToHealthPack = pEntity->Position() - Position();
-				TFloat32 forwardDotProduct = Dot(Normalise(distanceToHealthPack), Normalise(Matrix().ZAxis()));
-				TFloat32 rightDotProduct = Dot(Normalise(distanceToHealthPack), Normalise(Matrix().XAxis()));
-
-				// Turn if not facing right direction
-				if (forwardDotProduct < Cos(tankTurnSpeed * updateTime))
-				{
-					// Check which way to rotate
-					if (rightDotProduct > 0.0f)
-					{
-						Matrix().RotateLocalY(tankTurnSpeed * updateTime);
-					}
-					else
-					{
-						Matrix().RotateLocalY(-tankTurnSpeed * updateTime);
+			// Get data for the tank
+			TFloat32 tankAcceleration = m_TankTemplate->GetAcceleration();
+			TFloat32 tankMaxSpeed = m_TankTemplate->GetMaxSpeed();
+			TFloat32 tankTurnSpeed = m_TankTemplate->GetTurnSpeed();
+			TFloat32 turrentRotateSpeed = m_TankTemplate->GetTurretTurnSpeed();
 
-					}  // End of if statment
+			CVector3 distanceToHealthPack = healthPackPosition - Position();
+			TFloat32 forwardDotProduct = Dot(Normalise(distanceToHealthPack), Normalise(Matrix().ZAxis()));
+			TFloat32 rightDotProduct = Dot(Normalise(distanceToHealthPack), Normalise(Matrix().XAxis()));
 
+			// Turn if not facing right direction
+			if (forwardDotProduct < Cos(tankTurnSpeed * updateTime))
+			{
+				// Check which way to rotate
+				if (rightDotProduct > 0.0f)
+				{
+					Matrix().RotateLocalY(tankTurnSpeed * updateTime);
 				}
 				else
 				{
-					Matrix().FaceTarget(pEntity->Position());
-					(m_Speed < tankMaxSpeed * 1.5f) ? m_Speed += tankAcceleration : m_Speed = tankMaxSpeed * 1.5f;
+					Matrix().RotateLocalY(-tankTurnSpeed * updateTime);
 
-				} // End of if-else statment
+				}  // End of if statment
 
-				Matrix().MoveLocalZ(m_Speed * updateTime);
-				Matrix(2).RotateLocalY(turrentRotateSpeed * updateTime);
+			}
+			else
+			{
+				Matrix().FaceTarget(healthPackPosition);
+				(m_Speed < tankMaxSpeed * 1.5f) ? m_Speed += tankAcceleration : m_Speed = tankMaxSpeed * 1.5f;
 
-				return true;
+			} // End of if-else statment
 
-			} // End of if statment
+			Matrix().MoveLocalZ(m_Speed * updateTime);
+			Matrix(2).RotateLocalY(turrentRotateSpeed * updateTime);
+
+			return true;
 
 		} // End of if statment
 
@@ -632,67 +845,88 @@ bool CTankEntity::Update(TFloat32 updateTime)
 	// function to search for any ammo packs
 	bool CTankEntity::LookForAmmo(float updateTime)
 	{
-		// Is there an ammo pack?
-		CEntity* pEntity = EntityManager.GetEntity("Ammo Pack 1", "", "");
-		if (pEntity != 0)
+		// Is there an ammo pack on the ground that no other tank is heading for?
+		CVector3 ammoPackPosition;
+		if (Pickups.ClaimNearest(Pickup_Ammo, Position(), GetUID(), &m_AmmoClaim, &ammoPackPosition))
 		{
-			CAmmoEntity* pAmmoEntity = dynamic_cast<CAmmoEntity*>(pEntity);
-			if (pAmmoEntity != nullptr && pAmmoEntity->OnGround())
-			{
-				// Get data for the tank
-				TFloat32 tankAcceleration   = m_TankTemplate->GetAcceleration();
-				TFloat32 tankMaxSpeed       = m_TankTemplate->GetMaxSpeed();
-				TFloat32 tankTurnSpeed      = m_TankTemplate->GetTurnSpeed();
-				TFloat32 turrentRotateSpeed = m_TankTemplate->GetTurretTurnSpeed();
-
-				CVector3 distanceToAmmoPack = pEntity->Position() - Position();
-				TFloat32 forwardDotProduct = Dot(Normalise(distanceToAmmoPack), Normalise(Matrix().ZAxis()));
-				TFloat32 rightDotProduct = Dot(Normalise(distanceToAmmoPack), Normalise(Matrix().XAxis()));
-
-				// Turn the tank if not facing the right direction
-				if (forwardDotProduct < Cos(tankTurnSpeed * updateTime))
-				{
-					// Check which way to rotate
-					if (rightDotProduct > 0.0f)
-					{
-						Matrix().RotateLocalY(tankTurnSpeed * updateTime);
-					}
-					else
-					{
-						Matrix().RotateLocalY(-tankTurnSpeed * updateTime);
+			// Get data for the tank
+			TFloat32 tankAcceleration   = m_TankTemplate->GetAcceleration();
+			TFloat32 tankMaxSpeed       = m_TankTemplate->GetMaxSpeed();
+			TFloat32 tankTurnSpeed      = m_TankTemplate->GetTurnSpeed();
+			TFloat32 turrentRotateSpeed = m_TankTemplate->GetTurretTurnSpeed();
 
-					} // End of if statment
+			CVector3 distanceToAmmoPack = ammoPackPosition - Position();
+			TFloat32 forwardDotProduct = Dot(Normalise(distanceToAmmoPack), Normalise(Matrix().ZAxis()));
+			TFloat32 rightDotProduct = Dot(Normalise(distanceToAmmoPack), Normalise(Matrix().XAxis()));
 
+			// Turn the tank if not facing the right direction
+			if (forwardDotProduct < Cos(tankTurnSpeed * updateTime))
+			{
+				// Check which way to rotate
+				if (rightDotProduct > 0.0f)
+				{
+					Matrix().RotateLocalY(tankTurnSpeed * updateTime);
 				}
 				else
 				{
-					// Face the pack
-					Matrix().FaceTarget(pEntity->Position());
-
-					// Check speed
-					if (m_Speed < tankMaxSpeed * 1.5f)
-					{
-						m_Speed += tankAcceleration;
-					}
-					else
-					{
-						m_Speed = tankMaxSpeed * 1.5f;
-					}
+					Matrix().RotateLocalY(-tankTurnSpeed * updateTime);
 
 				} // End of if statment
 
-				// move tank towards the pack
-				Matrix().MoveLocalZ(m_Speed * updateTime);
-				Matrix(2).RotateLocalY(turrentRotateSpeed * updateTime);
+			}
+			else
+			{
+				// Face the pack
+				Matrix().FaceTarget(ammoPackPosition);
 
-				return true;
+				// Check speed
+				if (m_Speed < tankMaxSpeed * 1.5f)
+				{
+					m_Speed += tankAcceleration;
+				}
+				else
+				{
+					m_Speed = tankMaxSpeed * 1.5f;
+				}
 
 			} // End of if statment
 
+			// move tank towards the pack
+			Matrix().MoveLocalZ(m_Speed * updateTime);
+			Matrix(2).RotateLocalY(turrentRotateSpeed * updateTime);
+
+			return true;
+
 		} // End of if statment
 
 		return false;
 
 	} // End of LookForAmmo function
 
+	// Queue a line of sight ray from this tank's turret to the target tank's turret
+	void CTankEntity::QueueSightRay(CEntity* pTarget)
+	{
+		CVector3 turretPosition = (Matrix(2) * Matrix()).Position();
+		CVector3 targetTurretPosition = (pTarget->Matrix(2) * pTarget->Matrix()).Position();
+
+		m_SightTicket = Raycasts.QueueRay(turretPosition, targetTurretPosition, GetUID());
+		m_SightTarget = pTarget->GetUID();
+
+	} // End of QueueSightRay function
+
+	// Check the result of the last sight ray
+	bool CTankEntity::HasClearShot(TEntityUID target)
+	{
+		SRayResult result;
+		if (m_SightTarget != target || !Raycasts.GetResult(m_SightTicket, &result))
+		{
+			return false;
+
+		} // End of if statment
+
+		// The ray ends at the target, so either nothing was hit or the target itself was
+		return !result.hit || result.hitUID == target;
+
+	} // End of HasClearShot function
+
 } // namespace gen
@@ -47,6 +47,23 @@ public:
 		m_ShellDamage = shellDamage;
 	}
 
+	// Alternative constructor for a mesh that has already been loaded, the template takes
+	// ownership of the mesh
+	CTankTemplate
+	(
+		const string& type, const string& name, CMesh* mesh,
+		TFloat32 maxSpeed, TFloat32 acceleration, TFloat32 turnSpeed,
+		TFloat32 turretTurnSpeed, TUInt32 maxHP, TUInt32 shellDamage
+	) : CEntityTemplate( type, name, mesh )
+	{
+		m_MaxSpeed = maxSpeed;
+		m_Acceleration = acceleration;
+		m_TurnSpeed = turnSpeed;
+		m_TurretTurnSpeed = turretTurnSpeed;
+		m_MaxHP = maxHP;
+		m_ShellDamage = shellDamage;
+	}
+
 	// No destructor needed (base class one will do)
 
 
@@ -88,6 +105,30 @@ public:
 	}
 
 
+	/////////////////////////////////////
+	//	Setters
+
+	// Change the tank specifications, e.g. when the scene file is edited while running. Tanks
+	// read their template each update so take the new values immediately. Returns true if any
+	// value was different
+	bool SetSpecifications
+	(
+		TFloat32 maxSpeed, TFloat32 acceleration, TFloat32 turnSpeed,
+		TFloat32 turretTurnSpeed, TUInt32 maxHP, TUInt32 shellDamage
+	)
+	{
+		bool changed = m_MaxSpeed != maxSpeed || m_Acceleration != acceleration || m_TurnSpeed != turnSpeed ||
+		               m_TurretTurnSpeed != turretTurnSpeed || m_MaxHP != maxHP || m_ShellDamage != shellDamage;
+		m_MaxSpeed = maxSpeed;
+		m_Acceleration = acceleration;
+		m_TurnSpeed = turnSpeed;
+		m_TurretTurnSpeed = turretTurnSpeed;
+		m_MaxHP = maxHP;
+		m_ShellDamage = shellDamage;
+		return changed;
+	}
+
+
 /////////////////////////////////////
 //	Private interface
 private:
@@ -158,7 +199,7 @@ public:
 	}
 
 	// Get tank state text
-	string GetTankStateText()
+	const string& GetTankStateText()
 	{
 		return m_TankStateText;
 	}
@@ -182,6 +223,15 @@ public:
 		return m_State != Dead;
 	}
 
+	virtual EEntityKind GetKind()
+	{
+		return Entity_Tank;
+	}
+
+	// Get the text shown under the tank, its name and also the hit points, state and shells if
+	// extraInfo is set. The text is kept and only formatted again when one of these changes
+	const char* GetLabel( bool extraInfo, TUInt32* pLength );
+
 
 	/////////////////////////////////////
 	// Update
@@ -190,6 +240,17 @@ public:
 	// Return false if the entity is to be destroyed
 	// Keep as a virtual function in case of further derivation
 	virtual bool Update( TFloat32 updateTime );
+
+
+	/////////////////////////////////////
+	// Snapshots
+
+	// Write the tank's state to a snapshot, or read it back
+	virtual void SaveState( CSnapshot* pSnapshot );
+	virtual void LoadState( CSnapshot* pSnapshot );
+
+	// Add the tank's state to a hash
+	virtual void HashState( CStateHash* pHash );
 	
 
 /////////////////////////////////////
@@ -243,6 +304,16 @@ private:
 	// Tank state text output
 	string m_TankStateText;
 
+	// Label text from GetLabel and the values it was formatted from
+	static const TUInt32 kMaxLabelLength = 160;
+	char     m_Label[kMaxLabelLength];
+	TUInt32  m_LabelLength;
+	bool     m_LabelExtraInfo;
+	TInt32   m_LabelHP;
+	EState   m_LabelState;
+	TFloat32 m_LabelShellsFired;
+	TInt32   m_LabelAmmo;
+
 	TFloat32 m_numShellsFired;
 
 	// Death animation variables
@@ -252,11 +323,31 @@ private:
 	// Amount of ammo each tank has
 	TInt32 m_Ammo = 10;
 
+	// Packs this tank has claimed and is heading for (CPickupIndex::kNoPickup if none)
+	TEntityUID m_HealthClaim;
+	TEntityUID m_AmmoClaim;
+
+	// Line of sight ray queued last update and the tank it was aimed at
+	TUInt32    m_SightTicket;
+	TEntityUID m_SightTarget;
+
 private:
+	// Message processing and behaviour for one update, Update also keeps the tank grid informed
+	// of the tank's movement. Return false if the entity is to be destroyed
+	bool UpdateBehaviour( TFloat32 updateTime );
+
 	// Helper functions used in ammo drop
 	bool LookForHealth( float upateTime );
 	bool LookForAmmo( float upateTime );
 
+	// Queue a line of sight ray from this tank's turret to the target tank's turret, the
+	// result is available on the next update
+	void QueueSightRay( CEntity* pTarget );
+
+	// Check the result of the last sight ray - true if it was aimed at the given target and
+	// reached it without hitting scenery or another tank first
+	bool HasClearShot( TEntityUID target );
+
 };
 
 
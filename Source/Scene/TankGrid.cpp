@@ -0,0 +1,116 @@
+/*******************************************
+	TankGrid.cpp
+
+	Grid of the tanks' positions, rebuilt each
+	update, for shells to find the tanks they
+	hit
+********************************************/
+
+#include "TankGrid.h"
+#include "EntityManager.h"
+
+namespace gen
+{
+
+// Constructor creates an empty grid
+CTankGrid::CTankGrid()
+{
+	Clear();
+}
+
+
+/////////////////////////////////////
+// Building
+
+// Bin the tanks held by the entity manager at their current positions, replacing the grid of the
+// last update
+void CTankGrid::Build( CEntityManager* pEntityManager )
+{
+	m_Tanks.clear();
+	m_MaxRadius = 0.0f;
+	m_MaxMoved = 0.0f;
+	TFloat32 maxX = 0.0f, maxZ = 0.0f;
+	for (TUInt32 entity = 0; entity < pEntityManager->NumEntities(); ++entity)
+	{
+		CEntity* pEntity = pEntityManager->GetEntityAtIndex( entity );
+		if (pEntity->GetKind() != Entity_Tank)
+		{
+			continue;
+		}
+
+		STank tank = { pEntity->GetUID(), pEntity->Position().x, pEntity->Position().z };
+		if (m_Tanks.empty())
+		{
+			m_MinX = maxX = tank.x;
+			m_MinZ = maxZ = tank.z;
+		}
+		m_MinX = Min( m_MinX, tank.x );
+		m_MinZ = Min( m_MinZ, tank.z );
+		maxX = Max( maxX, tank.x );
+		maxZ = Max( maxZ, tank.z );
+		m_MaxRadius = Max( m_MaxRadius, pEntity->Template()->Mesh()->BoundingRadius() );
+		m_Tanks.push_back( tank );
+	}
+	if (m_Tanks.empty())
+	{
+		Clear();
+		return;
+	}
+
+	// Cells are the width of a tank so a query usually covers a few, but grow while there would be
+	// too many cells for the number of tanks
+	TFloat32 width = maxX - m_MinX;
+	TFloat32 depth = maxZ - m_MinZ;
+	TFloat32 cellSize = Max( 2.0f * m_MaxRadius, 1.0f );
+	TUInt32 maxCells = kMaxCellsPerTank * static_cast<TUInt32>(m_Tanks.size());
+	while ((width / cellSize + 1.0f) * (depth / cellSize + 1.0f) > maxCells)
+	{
+		cellSize *= 2.0f;
+	}
+	m_InvCellSize = 1.0f / cellSize;
+	m_NumCellsX = static_cast<TUInt32>(width * m_InvCellSize) + 1;
+	m_NumCellsZ = static_cast<TUInt32>(depth * m_InvCellSize) + 1;
+
+	// Counting sort into cells so building is linear in the number of tanks
+	TUInt32 numCells = m_NumCellsX * m_NumCellsZ;
+	m_CellStarts.assign( numCells + 1, 0 );
+	for (TUInt32 tank = 0; tank < m_Tanks.size(); ++tank)
+	{
+		++m_CellStarts[CellZ( m_Tanks[tank].z ) * m_NumCellsX + CellX( m_Tanks[tank].x ) + 1];
+	}
+	for (TUInt32 cell = 0; cell < numCells; ++cell)
+	{
+		m_CellStarts[cell + 1] += m_CellStarts[cell];
+	}
+
+	// Fill each cell from its start, then restore the starts
+	m_SortedTanks.resize( m_Tanks.size() );
+	for (TUInt32 tank = 0; tank < m_Tanks.size(); ++tank)
+	{
+		TUInt32 cell = CellZ( m_Tanks[tank].z ) * m_NumCellsX + CellX( m_Tanks[tank].x );
+		m_SortedTanks[m_CellStarts[cell]++] = m_Tanks[tank];
+	}
+	for (TUInt32 cell = numCells; cell > 0; --cell)
+	{
+		m_CellStarts[cell] = m_CellStarts[cell - 1];
+	}
+	m_CellStarts[0] = 0;
+}
+
+// Remove all tanks
+void CTankGrid::Clear()
+{
+	m_MinX = 0.0f;
+	m_MinZ = 0.0f;
+	m_InvCellSize = 1.0f;
+	m_NumCellsX = 1;
+	m_NumCellsZ = 1;
+	m_MaxRadius = 0.0f;
+	m_MaxMoved = 0.0f;
+	m_Tanks.clear();
+	m_SortedTanks.clear();
+	m_CellStarts.assign( 2, 0 );
+}
+
+
+} // namespace gen
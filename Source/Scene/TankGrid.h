@@ -0,0 +1,171 @@
+/*******************************************
+	TankGrid.h
+
+	Grid of the tanks' positions, rebuilt each
+	update, for shells to find the tanks they
+	hit
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "BaseMath.h"
+#include "CVector3.h"
+#include "Entity.h"
+
+namespace gen
+{
+
+class CEntityManager;
+
+// The tanks are binned into a grid of cells over the ground (x and z) at the start of each update,
+// so a shell only tests the tanks in the cells around it rather than every tank. Tanks move during
+// the update after the grid is built, so each tank reports how far it has moved and queries reach
+// further by the furthest move so far - a tank is always found by a query that reaches its current
+// position. Tanks created during an update are not found until the next one
+class CTankGrid
+{
+/////////////////////////////////////
+//	Constructors/Destructors
+public:
+	// Constructor creates an empty grid
+	CTankGrid();
+
+	// No destructor needed
+
+private:
+	// Prevent use of copy constructor and assignment operator (private and not defined)
+	CTankGrid( const CTankGrid& );
+	CTankGrid& operator=( const CTankGrid& );
+
+
+/////////////////////////////////////
+//	Public interface
+public:
+
+	/////////////////////////////////////
+	// Building
+
+	// Bin the tanks held by the entity manager at their current positions, replacing the grid of
+	// the last update. Call at the start of each update
+	void Build( CEntityManager* pEntityManager );
+
+	// A tank reports the distance it has moved since the grid was built
+	void Moved( TFloat32 distance )
+	{
+		m_MaxMoved = Max( m_MaxMoved, distance );
+	}
+
+	// Remove all tanks
+	void Clear();
+
+
+	/////////////////////////////////////
+	// Queries
+
+	// Call the visitor with the UID of each tank that may be within the given distance of a point
+	// plus the tank's bounding radius, as a shell of that radius at the point would hit it. The
+	// visitor makes the exact test against the tank's current position, the tank may have been
+	// destroyed since the grid was built. Visitor signature: void operator()( TEntityUID tankUID )
+	template <class TVisitor>
+	void Query( const CVector3& point, TFloat32 radius, TVisitor& visitor ) const
+	{
+		if (m_SortedTanks.empty())
+		{
+			return;
+		}
+
+		TFloat32 reach = radius + m_MaxRadius + m_MaxMoved;
+		TFloat32 reachSquared = reach * reach;
+		TUInt32 minX = CellX( point.x - reach );
+		TUInt32 maxX = CellX( point.x + reach );
+		TUInt32 minZ = CellZ( point.z - reach );
+		TUInt32 maxZ = CellZ( point.z + reach );
+		for (TUInt32 z = minZ; z <= maxZ; ++z)
+		{
+			for (TUInt32 x = minX; x <= maxX; ++x)
+			{
+				TUInt32 cell = z * m_NumCellsX + x;
+				for (TUInt32 tank = m_CellStarts[cell]; tank < m_CellStarts[cell + 1]; ++tank)
+				{
+					const STank& candidate = m_SortedTanks[tank];
+					TFloat32 dx = candidate.x - point.x;
+					TFloat32 dz = candidate.z - point.z;
+					if (dx * dx + dz * dz < reachSquared)
+					{
+						visitor( candidate.UID );
+					}
+				}
+			}
+		}
+	}
+
+
+	/////////////////////////////////////
+	// Getters
+
+	TUInt32 NumTanks() const
+	{
+		return static_cast<TUInt32>(m_SortedTanks.size());
+	}
+
+
+/////////////////////////////////////
+//	Private interface
+private:
+
+	/////////////////////////////////////
+	// Types
+
+	struct STank
+	{
+		TEntityUID UID;
+		TFloat32   x;
+		TFloat32   z;
+	};
+
+	// The grid has no more than this many cells per tank, larger cells are used for tanks that
+	// are spread thinly over a large area
+	static const TUInt32 kMaxCellsPerTank = 4;
+
+
+	/////////////////////////////////////
+	// Grid
+
+	// Grid cell containing a position, positions outside the grid are clamped onto its edge cells
+	TUInt32 CellX( TFloat32 x ) const
+	{
+		TFloat32 cell = (x - m_MinX) * m_InvCellSize;
+		return !(cell > 0.0f) ? 0 : (cell >= m_NumCellsX) ? m_NumCellsX - 1 : static_cast<TUInt32>(cell);
+	}
+	TUInt32 CellZ( TFloat32 z ) const
+	{
+		TFloat32 cell = (z - m_MinZ) * m_InvCellSize;
+		return !(cell > 0.0f) ? 0 : (cell >= m_NumCellsZ) ? m_NumCellsZ - 1 : static_cast<TUInt32>(cell);
+	}
+
+
+	/////////////////////////////////////
+	// Data
+
+	TFloat32 m_MinX;
+	TFloat32 m_MinZ;
+	TFloat32 m_InvCellSize;
+	TUInt32  m_NumCellsX;
+	TUInt32  m_NumCellsZ;
+
+	TFloat32 m_MaxRadius; // Largest bounding radius of the tanks
+	TFloat32 m_MaxMoved;  // Furthest a tank has moved since the grid was built
+
+	// Tanks as found, then the same tanks ordered by cell. Cell c holds the sorted tanks from
+	// m_CellStarts[c] to m_CellStarts[c + 1]
+	vector<STank>   m_Tanks;
+	vector<STank>   m_SortedTanks;
+	vector<TUInt32> m_CellStarts;
+};
+
+
+} // namespace gen
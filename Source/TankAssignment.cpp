@@ -16,12 +16,30 @@ using namespace std;
 #include "Camera.h"
 #include "Light.h"
 #include "EntityManager.h"
+#include "CollisionWorld.h"
+#include "RaycastService.h"
+#include "TankGrid.h"
+#include "PickupIndex.h"
+#include "PickingService.h"
+#include "NavGrid.h"
+#include "SceneImage.h"
+#include "SceneCompiler.h"
+#include "SceneLoader.h"
+#include "ThreadPool.h"
+#include "TraceLog.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include "FrameArena.h"
+#include "FrameMetrics.h"
+#include "TextureCache.h"
+#include "TextBatcher.h"
+#include "FileWatcher.h"
 #include "Messenger.h"
+#include "Snapshot.h"
+#include "Battle.h"
+#include "Replay.h"
 #include "TankAssignment.h"
 
-// 3rd party libary for parsing the XML files
-#include "tinyxml2.h"
-
 
 namespace gen
 {
@@ -34,9 +52,6 @@ namespace gen
 const float CameraRotSpeed  = 2.0f;
 float       CameraMoveSpeed = 80.0f;
 
-// Amount of time to pass before calculating new average update time
-const float UpdateTimePeriod = 1.0f;
-
 // Total number of tanks in the game
 const TUInt32 TotalNumOfTanks = 6;
 
@@ -50,6 +65,7 @@ extern IDXGISwapChain*         SwapChain;
 extern ID3D10DepthStencilView* DepthStencilView;
 extern ID3D10RenderTargetView* BackBufferRenderTarget;
 extern ID3DX10Font*            OSDFont;
+extern ID3DX10Sprite*          OSDSprite;
 
 // Actual viewport dimensions (fullscreen or windowed)
 extern TUInt32 ViewportWidth;
@@ -62,17 +78,70 @@ extern TUInt32 MouseY;
 // Messenger class for sending messages to and between entities
 extern CMessenger Messenger;
 
-// Location of XML file in the project media folder
+// Folder containing the scene file and all meshes and textures
+extern const string MediaFolder;
+
+// Location of XML file in the project media folder, and the binary scene image compiled from it
 const string SCENE_XML_FILE_PATH = "Media\\Scene.xml";
+const string SCENE_IMAGE_FILE_PATH = "Media\\Scene.bin";
+
+// Name of the scene file within the media folder, watched for changes while the game runs
+const string SCENE_XML_FILE_NAME = "Scene.xml";
+
+// Worker threads used to load meshes and textures at start-up. Set to 0 to load everything on
+// the main thread, to compare start-up times in the trace
+const TUInt32 NumLoaderThreads = CThreadPool::DefaultNumThreads();
+
+// Timeline of start-up work on all threads, written to this file at the end of scene setup
+CTraceLog TraceLog;
+const string STARTUP_TRACE_FILE_PATH = "StartupTrace.json";
+
+// Times each frame's update and render work, the breakdown is shown on screen with P and the
+// most recent frames are written to this file with F5
+CProfiler Profiler;
+const string FRAME_TRACE_FILE_PATH = "FrameTrace.json";
+
+// Frame, update and render time histograms, percentiles of recent frames are shown on screen and
+// those of the whole run are written to these files on exit
+CFrameMetrics FrameMetrics;
+const string FRAME_METRICS_CSV_FILE_PATH = "FrameMetrics.csv";
+const string FRAME_METRICS_JSON_FILE_PATH = "FrameMetrics.json";
+
+// Memory for text and other data that only lasts one frame, reset at the end of each frame
+CFrameArena FrameArena;
+
+// On-screen text for the frame, drawn in one sprite batch, formatted into the frame arena
+CTextBatcher TextBatcher(FrameArena);
 
 
 //-----------------------------------------------------------------------------
 // Global game/scene variables
 //-----------------------------------------------------------------------------
 
+// Textures shared between all meshes, each texture file is only loaded once
+CTextureCache TextureCache;
+
 // Entity manager
 CEntityManager EntityManager;
 
+// Static scenery that shells and line-of-sight checks collide with
+CCollisionWorld CollisionWorld;
+
+// Batched line-of-sight rays, resolved once per update against the scenery and the tanks
+CRaycastService Raycasts( &CollisionWorld );
+
+// Positions of the tanks at the start of each update, for shells to find the tanks they hit
+CTankGrid TankGrid;
+
+// Navigation grid over the battle area, tanks follow its flow fields around the scenery
+CNavGrid NavGrid;
+
+// Screen positions of the tanks this frame, for picking with the mouse
+CPickingService Picking;
+
+// Watches the scene file and the meshes it uses so edits can be applied without a restart
+CFileWatcher SceneWatcher;
+
 // Tank UIDs
 TEntityUID TankA;
 TEntityUID TankB;
@@ -91,15 +160,16 @@ CLight*     Lights[NumLights];
 SColourRGBA AmbientLight;
 CCamera*    MainCamera;
 
-// Sum of recent update times and number of times in the sum - used to calculate
-// average over a given time period
-float SumUpdateTimes = 0.0f;
-int NumUpdateTimes = 0;
-float AverageUpdateTime = -1.0f; // Invalid value at first
 
 // Extra information displayed under tank
 bool mExtraInfoActive = false;
 
+// Profiler breakdown displayed on screen
+bool gProfilerInfoActive = false;
+
+// Memory used by each subsystem displayed on screen
+bool gMemoryInfoActive = false;
+
 // Current nearest entity to the mouse cursor
 CEntity* NearestEntity = 0;
 
@@ -109,86 +179,150 @@ bool chaseCamOn[TotalNumOfTanks] = { false, false, false, false, false, false };
 // Matrix of camera used to rotate it in chase cam mode
 CMatrix4x4 chaseCamTankMatrix;
 
-// Health pack variables
-TFloat32 gHealthPackTimer = 10.0f; // 10 seconds
-bool     gHealthPackDeployed = false;
+// The battle's rules - health and ammo packs are dropped at intervals while there are fewer than
+// the maximum number in the world
+CBattle Battle;
 
-// NEW: Ammo pack vars
-TFloat32 gAmmoPackTimer = 15.0f; // 15 seconds
-bool     gAmmoPackDeployed = false;
+// Packs on the ground, tanks query this for the nearest one
+CPickupIndex Pickups;
+
+// Checkpoint of the battle saved with F6 and restored with F7, also written to this file so later
+// runs can start from it
+CSnapshot Checkpoint;
+const string CHECKPOINT_FILE_PATH = "Checkpoint.bin";
+
+// Recording of the battle's inputs started and stopped with F8, played back with F9 at a speed
+// changed with the numpad + and - keys. Recordings are saved to this file when stopped
+CReplay Replay;
+const string REPLAY_FILE_PATH = "Replay.bin";
+TFloat32 gReplaySpeed = 1.0f;
+const TFloat32 kMinReplaySpeed = 0.25f;
+const TFloat32 kMaxReplaySpeed = 64.0f;
 
 //-----------------------------------------------------------------------------
 // Scene management
 //-----------------------------------------------------------------------------
 
-// Method to read from the XML file and create the templates
-bool LoadSceneTemplates( string filePath )
+// Method to load the scene image, compiling it from the XML file first if the XML file has
+// changed. Returns false on failure
+bool LoadSceneImage( CSceneImage* pImage )
 {
-	tinyxml2::XMLDocument xmlFile;
+	CTraceScope trace(TraceLog, "Load scene image", "Loading");
 
-	// Can the file be opened?
-	if (xmlFile.LoadFile(filePath.c_str()) != tinyxml2::XML_SUCCESS)
+	if (!CSceneCompiler::IsImageUpToDate(SCENE_XML_FILE_PATH, SCENE_IMAGE_FILE_PATH))
 	{
-		return false;  // Return false if failed
-	}
-	else  // Read in data from the file
+		CSceneCompiler compiler;
+		if (!compiler.Compile(SCENE_XML_FILE_PATH, SCENE_IMAGE_FILE_PATH))
+		{
+			return false;
+		}
+
+	} // End of if statment
+
+	return pImage->Open(SCENE_IMAGE_FILE_PATH);
+
+} // End of LoadSceneImage function
+
+
+// Method to watch the scene file and the meshes used by the templates in the scene image
+void WatchSceneFiles( const CSceneImage& sceneImage )
+{
+	SceneWatcher.AddFile(SCENE_XML_FILE_NAME);
+	for (TUInt32 entry = 0; entry < sceneImage.NumTemplates(); ++entry)
 	{
-		// Find the scene tag
-		tinyxml2::XMLElement* pScene = xmlFile.FirstChildElement("Scene");
+		SceneWatcher.AddFile(sceneImage.String(sceneImage.Templates()[entry].mesh));
 
-		// Find the first template tag
-		tinyxml2::XMLElement* pTemplate = pScene->FirstChildElement("Template");
+	} // End of for loop
 
-		// Loop through the template tags
-		while (pTemplate != nullptr)
-		{
-			// Build the template with the tag attribute values
-			EntityManager.CreateTemplate
-			(
-				pTemplate->Attribute("Type"),
-				pTemplate->Attribute("Name"),
-				pTemplate->Attribute("Mesh")
-			);
+} // End of WatchSceneFiles function
 
-			// Next template tag
-			pTemplate = pTemplate->NextSiblingElement("Template");
 
-		} // End of while loop
+// Bake the navigation grid over the collision world's scenery and the scene's patrol area
+void BakeNavGrid(const CSceneImage& sceneImage)
+{
+	const SSceneImageHeader& sceneHeader = sceneImage.Header();
+	SAABB navArea = CollisionWorld.Bounds();
+	navArea.Extend(CVector3(sceneHeader.navAreaMin));
+	navArea.Extend(CVector3(sceneHeader.navAreaMax));
+	NavGrid.Bake(CollisionWorld, navArea.minBounds, navArea.maxBounds, sceneHeader.navCellSize, sceneHeader.navClearance);
+
+} // End of BakeNavGrid function
+
 
-		// Find the first tank template tag
-		tinyxml2::XMLElement* pTankTemplate = pScene->FirstChildElement("TankTemplate");
+// Method to apply edits to the scene file or its meshes while the game runs. Tank specifications
+// are changed on the live templates and only edited meshes are loaded again. Entities, lights
+// and the camera are not changed, a restart is needed for those
+void HotReloadScene()
+{
+	CProfileZone zone(Profiler, "Hot reload");
+
+	vector<string> changedFiles;
+	if (SceneWatcher.Poll(&changedFiles) == false)
+	{
+		return;
+
+	} // End of if statment
+
+	// Recompiles the image if the scene file was edited, errors are shown and the next save will
+	// be tried again
+	CSceneImage sceneImage;
+	if (LoadSceneImage(&sceneImage) == false)
+	{
+		return;
+
+	} // End of if statment
+
+	CSceneLoader loader(&EntityManager, NumLoaderThreads);
+	vector<CMesh*> oldMeshes;
+	loader.ReloadTemplates(sceneImage, changedFiles, &oldMeshes);
+
+	// A larger shell mesh needs the collision tree built for a larger sweep radius
+	TFloat32 shellRadius = EntityManager.MaxBoundingRadius("Projectile");
+	if (shellRadius > CollisionWorld.MaxSweepRadius())
+	{
+		CollisionWorld.Build(shellRadius);
 
-		// Loop through the tank template tags
-		while ( pTankTemplate != nullptr )
+	} // End of if statment
+
+	// Scenery using a replaced mesh has a new shape, so point the collision world at the new
+	// meshes and bake the navigation grid again. Then nothing refers to the old meshes
+	if (!oldMeshes.empty())
+	{
+		CollisionWorld.RefreshEntities(&EntityManager);
+		BakeNavGrid(sceneImage);
+		for (TUInt32 mesh = 0; mesh < oldMeshes.size(); ++mesh)
 		{
-			// Build the tank template with tag attribute values
-			EntityManager.CreateTankTemplate
-			(
-				pTankTemplate->Attribute("Type"),
-				pTankTemplate->Attribute("Name"),
-				pTankTemplate->Attribute("Mesh"),
-				pTankTemplate->FloatAttribute("TopSpeed"),
-				pTankTemplate->FloatAttribute("Acceleration"),
-				pTankTemplate->FloatAttribute("TankTurnSpeed"),
-				pTankTemplate->FloatAttribute("TurretTurnSpeed"),
-				pTankTemplate->IntAttribute("MaxHP"),
-				pTankTemplate->IntAttribute("ShellDamage")
-			);
-
-			// Next tank template tag
-			pTankTemplate = pTankTemplate->NextSiblingElement("TankTemplate");
+			delete oldMeshes[mesh];
 
-		} // End of while loop
-	}
+		} // End of for loop
+
+	} // End of if statment
 
-	return true; // Return success
+	// Templates may now use other meshes
+	WatchSceneFiles(sceneImage);
 
-} // End of LoadSceneTemplates function
+} // End of HotReloadScene function
 
 
 // Creates the scene geometry
 bool SceneSetup()
 {
+	TraceLog.SetThreadName("Main");
+	Profiler.SetThreadName("Main");
+	TUInt64 setupStart = TraceLog.Now();
+
+	// Memory budgets for each subsystem, with room over what the scene uses today. Debug builds stop
+	// on the first frame over budget, release builds mark it in the memory display
+	const TUInt64 Megabyte = 1024 * 1024;
+	CMemoryTracker::SetBudget(Mem_Entities, 8 * Megabyte);
+	CMemoryTracker::SetBudget(Mem_Messages, 4 * Megabyte);
+	CMemoryTracker::SetBudget(Mem_Meshes, 64 * Megabyte);
+	CMemoryTracker::SetBudget(Mem_Textures, 64 * Megabyte);
+	CMemoryTracker::SetBudget(Mem_XML, 32 * Megabyte);
+#ifdef _DEBUG
+	CMemoryTracker::SetBudgetAssertions(true);
+#endif
+
 	//////////////////////////////////////////////
 	// Prepare render methods
 
@@ -197,124 +331,90 @@ bool SceneSetup()
 	//////////////////////////////////////////
 	// Create scenery templates and entities
 
-	// Load all of the templates for this scene
-	if ( LoadSceneTemplates(SCENE_XML_FILE_PATH) == false )
+	// All scene content comes from the scene image, the image is only valid until it is closed
+	// at the end of this function
+	CSceneImage sceneImage;
+	if ( LoadSceneImage(&sceneImage) == false )
 	{
-		SystemMessageBox("Failed to load XML file", "XML Error");
+		SystemMessageBox("Failed to load scene file", "Scene Error");
 		return false;  // Return error
 
 	} // End of if statment
-
-	// Creates the scenery entities
-	// Type (template name), entity name, position, rotation, scale
-	EntityManager.CreateEntity("Skybox", "Skybox", CVector3(0.0f, -10000.0f, 0.0f), CVector3::kZero, CVector3(10, 10, 10));
-	EntityManager.CreateEntity("Floor", "Floor");
-	EntityManager.CreateEntity("Building", "Building", CVector3(0.0f, 0.0f, 40.0f));
-	for (int tree = 0; tree < 100; ++tree)
-	{
-		// Load in random trees
-		EntityManager.CreateEntity("Tree", "Tree",
-			CVector3(Random(-200.0f, 30.0f), 0.0f, Random(40.0f, 150.0f)),
-			CVector3(0.0f, Random(0.0f, 2.0f * kfPi), 0.0f));
-
-	} // End of for loop
-
-
-	/////////////////////////////////
-	// Create tank patrol points
-
-	vector<CVector3> tankAPatrolList = // Tank A
-	{
-		{   0.0f, 0.5f, 0.0f },
-		{ -50.0f, 0.5f, 0.0f },
-		{ -50.0f, 0.5f, 40.0f },
-		{   0.0f, 0.5f, 40.0f },
-	};
-	vector<CVector3> tankBPatrolList = // Tank B
-	{
-		{ 10.0f, 0.5f, -50.0f },
-		{ 10.0f, 0.5f, -10.0f },
-		{ 50.0f, 0.5f, -30.0f },
-		{ 50.0f, 0.5f, -50.0f },
-	};
-	vector<CVector3> tankCPatrolList = // Tank C
-	{
-		{   0.0f, 0.5f, -50.0f },
-		{   0.0f, 0.5f, -10.0f },
-		{ -40.0f, 0.5f, -10.0f },
-		{ -50.0f, 0.5f, -50.0f },
-		
-	};
-	vector<CVector3> tankDPatrolList = // Tank D
+	if ( sceneImage.NumTanks() != TotalNumOfTanks || sceneImage.NumLights() != NumLights )
 	{
-		{  50.0f, 0.5f, 0.0f },
-		{  10.0f, 0.5f, 0.0f },
-		{  10.0f, 0.5f, 40.0f },
-		{  50.0f, 0.5f, 40.0f },
+		SystemMessageBox("Scene must contain 6 tanks and 2 lights", "Scene Error");
+		return false;  // Return error
 
-	};
-	vector<CVector3> tankEPatrolList = // Tank E
-	{
-		{ -30.0f, 0.5f, 30.0f },
-		{  30.0f, 0.5f, 30.0f },
-		{  30.0f, 0.5f, 10.0f },
-		{ -30.0f, 0.5f, 10.0f },
+	} // End of if statment
 
-	};
-	vector<CVector3> tankFPatrolList = // Tank F
+	// Load all of the templates for this scene, meshes and textures are loaded on worker threads
+	CSceneLoader loader(&EntityManager, NumLoaderThreads);
+	if ( loader.LoadTemplates(sceneImage) == false )
 	{
-		{ -40.0f, 0.5f, -20.0f },
-		{  20.0f, 0.5f, -20.0f },
-		{  20.0f, 0.5f, -40.0f },
-		{ -40.0f, 0.5f, -40.0f },
-
-	};
+		SystemMessageBox("Failed to load scene templates", "Scene Error");
+		return false;  // Return error
 
-	////////////////////////////////
-	// Create tank entities
+	} // End of if statment
 
-	// Type (template name), team number, tank name, position, rotation
+	// Create the scenery and tanks, static scenery goes in the collision world
+	vector<TEntityUID> tankUIDs;
+	loader.CreateEntities(sceneImage, &CollisionWorld, &tankUIDs);
 
-	// Team 1
-	TankA = EntityManager.CreateTank("Rogue Scout", 0, tankAPatrolList, "Red-1", CVector3(-20.0f, 0.5f, 40.0f),
-		CVector3(0.0f, ToRadians(0.0f), 0.0f));
-	TankC = EntityManager.CreateTank("Rogue Scout", 0, tankCPatrolList, "Red-2", CVector3(-50.0f, 0.5f, -50.0f),
-		CVector3(0.0f, ToRadians(0.0f), 0.0f));
-	TankE = EntityManager.CreateTank("Rogue Scout", 0, tankEPatrolList, "Red-3", CVector3(-30.0f, 0.5f,  10.0f),
-		CVector3(0.0f, ToRadians(0.0f), 0.0f));
+	// Scenery is now in place, build the collision tree over it. Shells are swept through it as
+	// spheres, so it must allow for the largest shell
+	CollisionWorld.Build(EntityManager.MaxBoundingRadius("Projectile"));
 
-	// Team 2
-	TankB = EntityManager.CreateTank("Oberon MkII", 1, tankBPatrolList, "Blue-1", CVector3(20.0f, 0.5f, -40.0f),
-		CVector3(0.0f, ToRadians(180.0f), 0.0f));
-	TankD = EntityManager.CreateTank("Oberon MkII", 1, tankDPatrolList, "Blue-2", CVector3(50.0f, 0.5f, 10.0f),
-		CVector3(0.0f, ToRadians(180.0f), 0.0f));
-	TankF = EntityManager.CreateTank("Oberon MkII", 1, tankFPatrolList, "Blue-3", CVector3(0.0f, 0.5f, 0.0f),
-		CVector3(0.0f, ToRadians(180.0f), 0.0f));
+	// Bake the navigation grid over the scenery and the area the tanks patrol
+	const SSceneImageHeader& sceneHeader = sceneImage.Header();
+	BakeNavGrid(sceneImage);
 
 
 	////////////////////////////////
 	// Populate Team Lists
 
-	TeamOne.push_back(TankA);
-	TeamTwo.push_back(TankB);
-	TeamOne.push_back(TankC);
-	TeamTwo.push_back(TankD);
-	TeamOne.push_back(TankE);
-	TeamTwo.push_back(TankF);
+	// Tanks are listed in the scene in chase camera order (A to F)
+	TEntityUID* chaseTanks[TotalNumOfTanks] = { &TankA, &TankB, &TankC, &TankD, &TankE, &TankF };
+	for (TUInt32 tank = 0; tank < TotalNumOfTanks; ++tank)
+	{
+		*chaseTanks[tank] = tankUIDs[tank];
+		if (sceneImage.Tanks()[tank].team == 0)
+		{
+			TeamOne.push_back(tankUIDs[tank]);
+		}
+		else
+		{
+			TeamTwo.push_back(tankUIDs[tank]);
+		}
+
+	} // End of for loop
 
 	/////////////////////////////
 	// Camera / light setup
 
 	// Set camera position and clip planes
-	MainCamera = new CCamera(CVector3(0.0f, 30.0f, -100.0f), CVector3(ToRadians(15.0f), 0, 0));
-	MainCamera->SetNearFarClip(1.0f, 20000.0f);
+	MainCamera = new CCamera(CVector3(sceneHeader.cameraPosition), CVector3(sceneHeader.cameraRotation));
+	MainCamera->SetNearFarClip(sceneHeader.cameraNearClip, sceneHeader.cameraFarClip);
 
 	// Sunlight and light in building
-	Lights[0] = new CLight(CVector3(-5000.0f, 4000.0f, -10000.0f), SColourRGBA(1.0f, 0.9f, 0.6f), 15000.0f);
-	Lights[1] = new CLight(CVector3(6.0f, 7.5f, 40.0f), SColourRGBA(1.0f, 0.0f, 0.0f), 1.0f);
+	for (int light = 0; light < NumLights; ++light)
+	{
+		const SSceneLight& lightData = sceneImage.Lights()[light];
+		Lights[light] = new CLight(CVector3(lightData.position), SColourRGBA(lightData.colour[0], lightData.colour[1],
+			lightData.colour[2], lightData.colour[3]), lightData.brightness);
+
+	} // End of for loop
 
 	// Ambient light level
-	AmbientLight = SColourRGBA(0.6f, 0.6f, 0.6f, 1.0f);
+	const TFloat32* ambient = sceneHeader.ambientColour;
+	AmbientLight = SColourRGBA(ambient[0], ambient[1], ambient[2], ambient[3]);
+
+	// Watch for edits to the scene while running
+	SceneWatcher.Start(MediaFolder);
+	WatchSceneFiles(sceneImage);
+
+	// Record the whole setup and write the start-up timeline
+	TraceLog.AddEvent("Scene setup", "Loading", setupStart, TraceLog.Now());
+	TraceLog.WriteChromeTrace(STARTUP_TRACE_FILE_PATH);
 
 	return true;
 
@@ -324,6 +424,10 @@ bool SceneSetup()
 // Release everything in the scene
 void SceneShutdown()
 {
+	// Write the frame time percentiles for the whole run
+	FrameMetrics.WriteCSV(FRAME_METRICS_CSV_FILE_PATH);
+	FrameMetrics.WriteJSON(FRAME_METRICS_JSON_FILE_PATH);
+
 	// Release render methods
 	ReleaseMethods();
 
@@ -337,12 +441,60 @@ void SceneShutdown()
 	delete MainCamera;
 
 	// Destroy all entities
+	Raycasts.Clear();
+	TankGrid.Clear();
+	Pickups.Clear();
+	NavGrid.Clear();
+	CollisionWorld.Clear();
 	EntityManager.DestroyAllEntities();
 	EntityManager.DestroyAllTemplates();
 
+	SceneWatcher.Stop();
+
 } // End of SceneShutdown function
 
 
+//-----------------------------------------------------------------------------
+// Snapshots
+//-----------------------------------------------------------------------------
+
+// Write the game to a snapshot, the battle then the game's own variables
+void SaveGame(CSnapshot* pSnapshot)
+{
+	pSnapshot->Clear();
+	Battle.SaveState(pSnapshot);
+
+	TEntityUID tanks[TotalNumOfTanks] = { TankA, TankB, TankC, TankD, TankE, TankF };
+	pSnapshot->Write(tanks);
+	pSnapshot->Write(chaseCamOn);
+
+} // End of SaveGame function
+
+// Restore the game from a snapshot, returns false if the snapshot was taken in a different scene
+bool RestoreGame(CSnapshot* pSnapshot)
+{
+	pSnapshot->BeginRead();
+	if (!Battle.LoadState(pSnapshot))
+	{
+		return false;
+
+	} // End of if statment
+
+	TEntityUID tanks[TotalNumOfTanks];
+	pSnapshot->Read(&tanks);
+	pSnapshot->Read(&chaseCamOn);
+	TankA = tanks[0];
+	TankB = tanks[1];
+	TankC = tanks[2];
+	TankD = tanks[3];
+	TankE = tanks[4];
+	TankF = tanks[5];
+
+	return pSnapshot->ReadAll();
+
+} // End of RestoreGame function
+
+
 //-----------------------------------------------------------------------------
 // Game Helper functions
 //-----------------------------------------------------------------------------
@@ -366,6 +518,8 @@ const vector<TEntityUID>& GetEnemyTankUID( int teamID )
 // Draw one frame of the scene
 void RenderScene( float updateTime )
 {
+	CProfileZone zone( Profiler, "Render scene" );
+
 	// Setup the viewport - defines which part of the back-buffer we will render to (usually all of it)
 	D3D10_VIEWPORT vp;
 	vp.Width  = ViewportWidth;
@@ -393,46 +547,22 @@ void RenderScene( float updateTime )
 	SetLights(&Lights[0]);
 
 	// Render entities and draw on-screen text
-	EntityManager.RenderAllEntities();
+	EntityManager.RenderAllEntities( MainCamera );
 	RenderSceneText( updateTime );
 
     // Present the backbuffer contents to the display
-	SwapChain->Present( 0, 0 );
-
-} // End of RenderScene function
-
-
-// Render a single text string at the given position in the given colour, may optionally centre it
-void RenderText(const string& text, int X, int Y, float r, float g, float b, bool centre = false)
-{
-	RECT rect;
-	if (!centre)
-	{
-		SetRect(&rect, X, Y, 0, 0);
-		OSDFont->DrawText(NULL, text.c_str(), -1, &rect, DT_NOCLIP, D3DXCOLOR(r, g, b, 1.0f));
-	}
-	else
 	{
-		SetRect(&rect, X - 100, Y, X + 100, 0);
-		OSDFont->DrawText(NULL, text.c_str(), -1, &rect, DT_CENTER | DT_NOCLIP, D3DXCOLOR(r, g, b, 1.0f));
+		CProfileZone presentZone( Profiler, "Present" );
+		SwapChain->Present( 0, 0 );
 	}
 
-} // End of RenderText function
+} // End of RenderScene function
+
 
-// Render on-screen text each frame
+// Render on-screen text each frame. Text is collected in the text batcher and drawn in one go
 void RenderSceneText(float updateTime)
 {
-	stringstream outText;
-
-	// Accumulate update times to calculate the average over a given period
-	SumUpdateTimes += updateTime;
-	++NumUpdateTimes;
-	if (SumUpdateTimes >= UpdateTimePeriod)
-	{
-		AverageUpdateTime = SumUpdateTimes / NumUpdateTimes;
-		SumUpdateTimes = 0.0f;
-		NumUpdateTimes = 0;
-	}
+	CProfileZone zone(Profiler, "Scene text");
 
 	/////////////////////////////////////
 	// Extra tank on screen information
@@ -452,40 +582,32 @@ void RenderSceneText(float updateTime)
 
 	} // End of if statment
 
-	// Output various data displayed underneath each tank
-
+	// Output various data displayed underneath each tank, labels keep their text between frames
+	// so are only formatted when they change. Labels of tanks off screen are skipped. The screen
+	// positions of living tanks are also kept for mouse picking
+	const SColourRGBA labelColour(1.0f, 1.0f, 0.0f);
+	const TFloat32 labelMargin = 100.0f;
+	Picking.Clear(ViewportWidth, ViewportHeight);
 	EntityManager.BeginEnumEntities("", "", "Tank");
 	CEntity* pEntity = EntityManager.EnumEntity();
 
 	while (pEntity != 0)
 	{
 		CVector2 PixelPoint;
+		CTankEntity* pTankEntity = dynamic_cast<CTankEntity*>(pEntity);
 
-		if (MainCamera->PixelFromWorldPt(&PixelPoint, pEntity->Position(), ViewportWidth, ViewportHeight))
+		if (pTankEntity != nullptr && pTankEntity->IsAlive() &&
+		    MainCamera->PixelFromWorldPt(&PixelPoint, pEntity->Position(), ViewportWidth, ViewportHeight))
 		{
-			CTankEntity* pTankEntity = dynamic_cast<CTankEntity*>(pEntity);
+			Picking.Add(pEntity->GetUID(), PixelPoint);
 
-			if (pTankEntity != nullptr && pTankEntity->IsAlive())
+			if (PixelPoint.x > -labelMargin && PixelPoint.x < ViewportWidth + labelMargin &&
+			    PixelPoint.y > -labelMargin && PixelPoint.y < ViewportHeight)
 			{
-				// Output tank name
-				outText << "Name: " << pEntity->GetName() << endl;
-
 				// Key "0" press is used to show and hide extra info data
-				if (mExtraInfoActive)
-				{
-					// Output number of hit points
-					outText << "HPs: " << pTankEntity->GetHPs() << endl;
-					// Output state of tank
-					outText << "State: " << pTankEntity->GetTankStateText() << endl;
-					// Output Shells fired
-					outText << "Shells Fired: " << pTankEntity->GetNumShellsFired() << endl;
-					// Output number of shells left
-					outText << "Shells Left: " <<  pTankEntity->GetNumShellsLeft() << endl;
-
-				} // End of if statment
-
-				RenderText(outText.str(), (int)PixelPoint.x, (int)PixelPoint.y, 1.0f, 1.0f, 0.0f, true);
-				outText.str("");
+				TUInt32 labelLength;
+				const char* label = pTankEntity->GetLabel(mExtraInfoActive, &labelLength);
+				TextBatcher.AddText(label, labelLength, (int)PixelPoint.x, (int)PixelPoint.y, labelColour, true);
 
 			} // End of if statment
 
@@ -500,49 +622,93 @@ void RenderSceneText(float updateTime)
 	/////////////////////////////
 	// On screen output text
 
-	// Write FPS text string
-	if (AverageUpdateTime >= 0.0f)
+	// Write FPS text string, with percentiles of recent frame, update and render times to show up
+	// hitches that the average hides
+	const CTimeHistogram& frameTimes = FrameMetrics.Window(Metric_Frame);
+	if (frameTimes.Count() > 0)
 	{
-		outText << "Frame Time: " << AverageUpdateTime * 1000.0f << "ms" << endl << "FPS:" << 1.0f / AverageUpdateTime;
-		RenderText(outText.str(), 2, 2, 0.0f, 0.0f, 0.0f);
-		RenderText(outText.str(), 0, 0, 1.0f, 1.0f, 0.0f);
-		outText.str("");
+		float averageFrameTime = frameTimes.Mean() * 0.000001f;
+		TextBatcher.BeginText();
+		TextBatcher.Append("Frame Time: ");
+		TextBatcher.AppendFloat(averageFrameTime * 1000.0f, 2);
+		TextBatcher.Append("ms\nFPS:");
+		TextBatcher.AppendFloat(1.0f / averageFrameTime, 1);
+		TextBatcher.Append("\n");
+		FrameMetrics.WindowSummary(TextBatcher.Text());
+		TextBatcher.EndText(0, 0, SColourRGBA(1.0f, 1.0f, 0.0f), false, true);
 
 	} // End of if statment
 
-	/////////////////////////////
-	// Mouse button actions
+	// Write the average time spent in each profiler zone, key "P" shows and hides it
+	if (gProfilerInfoActive)
+	{
+		TextBatcher.BeginText();
+		TextBatcher.Append("CPU Frame: ");
+		TextBatcher.AppendFloat(Profiler.AverageFrameTime(), 2);
+		TextBatcher.Append("ms\n");
+		Profiler.Breakdown(TextBatcher.Text());
+		TextBatcher.EndText(0, 80, SColourRGBA(1.0f, 1.0f, 1.0f), false, true);
+
+	} // End of if statment
 
-	if (!KeyHeld(Mouse_LButton))
+	// Write the memory used by each subsystem, key "M" shows and hides it
+	if (gMemoryInfoActive)
 	{
-		// Calculate the entity that is nearest to the cursor
-		CVector2 cursorPos = CVector2((TFloat32)MouseX, (TFloat32)MouseY);
-		TFloat32 closestDistance = 100.0f;
-		
-		// Find entity closest to cursor.
-		for (TUInt32 i = 0; i < EntityManager.NumEntities(); ++i)
+		int memoryX = static_cast<int>(ViewportWidth) - 360;
+		TextBatcher.BeginText();
+		CMemoryTracker::Summary(TextBatcher.Text());
+		TextBatcher.EndText(memoryX, 80, SColourRGBA(1.0f, 1.0f, 1.0f), false, true);
+
+	} // End of if statment
+
+	// Show recording or playback progress, and the update where playback first stopped matching
+	// the recording
+	if (Replay.IsRecording() || Replay.IsPlaying())
+	{
+		TextBatcher.BeginText();
+		if (Replay.IsRecording())
 		{
-			CEntity* pEntity = EntityManager.GetEntityAtIndex(i);
+			TextBatcher.Append("Recording: ");
+		}
+		else
+		{
+			TextBatcher.Append("Replay x");
+			TextBatcher.AppendFloat(gReplaySpeed, 2);
+			TextBatcher.Append(": ");
+		}
+		TextBatcher.AppendInt(static_cast<TInt32>(Replay.NumUpdates()));
+		TextBatcher.Append(" updates, ");
+		TextBatcher.AppendFloat(static_cast<TFloat32>(Replay.Time()), 1);
+		TextBatcher.Append("s");
+		if (Replay.HasDiverged())
+		{
+			TextBatcher.Append("\nDiverged after update ");
+			TextBatcher.AppendInt(static_cast<TInt32>(Replay.DivergedUpdate()));
+		}
+		TextBatcher.EndText(0, static_cast<int>(ViewportHeight) - 40, SColourRGBA(1.0f, 0.5f, 0.5f), false, true);
 
-			if (pEntity != nullptr)
-			{
-				// Get the next entity position in viewport space.
-				CVector2 entityPos2D;
-				MainCamera->PixelFromWorldPt(&entityPos2D, pEntity->Position(), ViewportWidth, ViewportHeight);
+	} // End of if statment
 
-				// Check if this entity position is closest to the cursor.
-				if (entityPos2D.DistanceTo(cursorPos) < closestDistance)
-				{
-					SMessage msg;
-					msg.type = Msg_Evade;
-					msg.from = SystemUID;
-					Messenger.SendMessage(pEntity->GetUID(), msg);
+	// Draw all the text in one sprite batch
+	TextBatcher.Draw(OSDFont, OSDSprite);
 
-				} // End of if statment
+	/////////////////////////////
+	// Mouse button actions
 
-			} // End of if statment
+	if (KeyHit(Mouse_LButton) && !Replay.IsPlaying())
+	{
+		// Send the tank nearest to the cursor, within 100 pixels, into its evade state. Sent
+		// through the replay so it is recorded
+		CVector2 cursorPos = CVector2((TFloat32)MouseX, (TFloat32)MouseY);
+		TEntityUID pickedUID;
+		if (Picking.Nearest(cursorPos, 100.0f, &pickedUID))
+		{
+			SMessage msg;
+			msg.type = Msg_Evade;
+			msg.from = SystemUID;
+			Replay.SendMessage(pickedUID, msg);
 
-		} // End of foor loop
+		} // End of if statment
 
 	} // End of if statment
 
@@ -552,81 +718,111 @@ void RenderSceneText(float updateTime)
 // Update the scene between rendering
 void UpdateScene(float updateTime)
 {
-	/////////////////////////////
-	// Health and ammo pack deployment
+	CProfileZone zone(Profiler, "Update scene");
 
-	SMessage msg;
-	if (Messenger.FetchMessage(SystemUID, &msg))
+	// Apply any edits to the scene file or meshes. Edits change the battle in ways a recording
+	// does not hold, so they wait until recording or playback has finished
+	if (!Replay.IsRecording() && !Replay.IsPlaying())
 	{
-		// Check if a new healthpack is needed to be dropped
-		if (msg.type == Msg_NewHealthPack)
-		{
-			gHealthPackTimer = 10.0f;
-			gHealthPackDeployed = false;
+		HotReloadScene();
 
-		} // End of if statment
-		
-		// Check if a new ammo pack is needed to be dropped
-		if (msg.type == Msg_NewAmmoPack)
-		{
-			gAmmoPackTimer = 15.0f;
-			gAmmoPackDeployed = false;
+	} // End of if statment
 
-		} // End of if statment
+	// Run the battle for this frame - recorded if recording is on, or played back from a recording
+	// at the chosen speed. When playback reaches the end the battle carries on live
+	if (Replay.IsPlaying())
+	{
+		Replay.Play(&Battle, updateTime * gReplaySpeed);
+	}
+	else
+	{
+		Replay.RecordUpdate(&Battle, updateTime);
 
 	} // End of if statment
 
-	// Check to update the health pack timer
-	if (!gHealthPackDeployed)
+	/////////////////////////////
+	// Camera controls
+
+	// Set camera speeds
+	// Key F1 used for full screen toggle
+	if (KeyHit(Key_F2)) CameraMoveSpeed = 5.0f;
+	if (KeyHit(Key_F3)) CameraMoveSpeed = 40.0f;
+
+	// Show or hide the profiler breakdown, or write the recent frames for viewing in
+	// chrome://tracing
+	if (KeyHit(Key_P)) gProfilerInfoActive = !gProfilerInfoActive;
+	if (KeyHit(Key_F5)) Profiler.WriteChromeTrace(FRAME_TRACE_FILE_PATH);
+
+	// Show or hide the memory used by each subsystem
+	if (KeyHit(Key_M)) gMemoryInfoActive = !gMemoryInfoActive;
+
+	// Save a checkpoint of the battle or go back to the last one. If none has been saved in this
+	// run, the one saved to file by an earlier run is used
+	if (KeyHit(Key_F6))
+	{
+		SaveGame(&Checkpoint);
+		Checkpoint.Save(CHECKPOINT_FILE_PATH);
+	}
+	if (KeyHit(Key_F7) && !Replay.IsPlaying() && (Checkpoint.Size() > 0 || Checkpoint.Load(CHECKPOINT_FILE_PATH)))
 	{
-		if (gHealthPackTimer > 0.0f)
+		if (!RestoreGame(&Checkpoint))
 		{
-			gHealthPackTimer -= updateTime;
+			SystemMessageBox("Checkpoint was saved in a different scene", "Checkpoint Error");
 		}
-		else  // Release the health pack
+		else if (Replay.IsRecording())
 		{
-			gHealthPackDeployed = true;
+			// A recording cannot jump back, so start it again from the checkpoint
+			Replay.StartRecording(&Battle);
+		}
 
-			EntityManager.CreateHealthPack
-			(
-				"HealthPack", "Health Pack 1", { Random(-50.0f, 0.0f), 25.0f, Random(-40.0f, 10.0f) }
-			);
+	} // End of if statment
 
-		} // End of if statment
+	// Start or stop recording the battle, the recording is saved when stopped
+	if (KeyHit(Key_F8))
+	{
+		if (Replay.IsRecording())
+		{
+			Replay.StopRecording();
+			Replay.Save(REPLAY_FILE_PATH);
+		}
+		else
+		{
+			Replay.StopPlayback();
+			Replay.StartRecording(&Battle);
+		}
 
 	} // End of if statment
 
-	// Check to update the ammo pack timer
-	if (!gAmmoPackDeployed)
+	// Play back the last recording, or stop playback. The battle carries on live from where
+	// playback stopped
+	if (KeyHit(Key_F9))
 	{
-		if (gAmmoPackTimer > 0.0f)
+		if (Replay.IsPlaying())
 		{
-			gAmmoPackTimer -= updateTime;
+			Replay.StopPlayback();
 		}
-		else  // Release the ammo pack
+		else
 		{
-			gAmmoPackDeployed = true;
+			if (Replay.IsRecording())
+			{
+				Replay.StopRecording();
+				Replay.Save(REPLAY_FILE_PATH);
+			}
+			if (!Replay.Load(REPLAY_FILE_PATH) || !Replay.StartPlayback(&Battle))
+			{
+				SystemMessageBox("Replay is missing or was recorded in a different scene", "Replay Error");
+			}
 
-			EntityManager.CreateAmmoPack
-			(
-				"AmmoPack", "Ammo Pack 1", { Random(0.0f, 50.0f), 25.0f, Random(-40.0f, 10.0f) }
-			);
 		} // End of if statment
 
 	} // End of if statment
 
-	// Call all entity update functions
-	EntityManager.UpdateAllEntities(updateTime);
-
-	/////////////////////////////
-	// Camera controls
-
-	// Set camera speeds
-	// Key F1 used for full screen toggle
-	if (KeyHit(Key_F2)) CameraMoveSpeed = 5.0f;
-	if (KeyHit(Key_F3)) CameraMoveSpeed = 40.0f;
+	// Playback speed
+	if (KeyHit(Key_Add)) gReplaySpeed = Min(gReplaySpeed * 2.0f, kMaxReplaySpeed);
+	if (KeyHit(Key_Subtract)) gReplaySpeed = Max(gReplaySpeed * 0.5f, kMinReplaySpeed);
 
-	if (KeyHit(Key_1))
+	// Tanks can only be told to start and stop in a live battle, playback sends the recorded messages
+	if (KeyHit(Key_1) && !Replay.IsPlaying())
 	{
 		// Create and send a start message to all tanks
 		EntityManager.BeginEnumEntities("", "", "Tank");
@@ -636,7 +832,7 @@ void UpdateScene(float updateTime)
 			SMessage msg;
 			msg.type = Msg_Start;
 			msg.from = SystemUID;
-			Messenger.SendMessage(entity->GetUID(), msg);
+			Replay.SendMessage(entity->GetUID(), msg);
 
 			// Next tank entity
 			entity = EntityManager.EnumEntity();
@@ -647,7 +843,7 @@ void UpdateScene(float updateTime)
 
 	} // End of if statment
 
-	if (KeyHit(Key_2))
+	if (KeyHit(Key_2) && !Replay.IsPlaying())
 	{
 		// Create and send a stop message to all tanks
 		EntityManager.BeginEnumEntities("", "", "Tank");
@@ -657,7 +853,7 @@ void UpdateScene(float updateTime)
 			SMessage msg;
 			msg.type = Msg_Stop;
 			msg.from = SystemUID;
-			Messenger.SendMessage(entity->GetUID(), msg);
+			Replay.SendMessage(entity->GetUID(), msg);
 
 			// Next tank entity
 			entity = EntityManager.EnumEntity();
@@ -0,0 +1,1386 @@
+/*******************************************
+	Benchmark.cpp
+
+	Command line tool running the tank
+	simulation headless in canned scenarios
+	and reporting its speed
+********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <d3d10.h>
+#include "Defines.h"
+#include "CFatalException.h"
+#include "CVector4.h"
+#include "CTimer.h"
+#include "TraceLog.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include "TextureCache.h"
+#include "CImportXFile.h"
+#include "MeshBVH.h"
+#include "EntityManager.h"
+#include "CollisionWorld.h"
+#include "RaycastService.h"
+#include "TankGrid.h"
+#include "PickupIndex.h"
+#include "PickingService.h"
+#include "NavGrid.h"
+#include "SceneImage.h"
+#include "SceneCompiler.h"
+#include "SceneLoader.h"
+#include "ThreadPool.h"
+#include "Messenger.h"
+#include "Snapshot.h"
+#include "SimulationState.h"
+#include "StateHash.h"
+#include "Battle.h"
+#include "Replay.h"
+
+
+namespace gen
+{
+
+// Globals used by the shared scene code. There is no device, meshes are only imported and
+// nothing is rendered
+ID3D10Device* g_pd3dDevice = 0;
+CTraceLog TraceLog;
+CProfiler Profiler;
+CTextureCache TextureCache;
+CEntityManager EntityManager;
+CCollisionWorld CollisionWorld;
+CRaycastService Raycasts( &CollisionWorld );
+CTankGrid TankGrid;
+CNavGrid NavGrid;
+CPickupIndex Pickups;
+vector<TEntityUID> TeamOne;
+vector<TEntityUID> TeamTwo;
+
+extern CMessenger Messenger;
+extern const string MediaFolder;
+
+// Returns a list of the tank UIDs of the team
+const vector<TEntityUID>& GetTeamTankUID( int teamID )
+{
+	return (teamID == 0) ? TeamOne : TeamTwo;
+}
+
+// Returns a list of the tank UIDs of the opposite team
+const vector<TEntityUID>& GetEnemyTankUID( int teamID )
+{
+	return (teamID == 0) ? TeamTwo : TeamOne;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Scenarios
+-----------------------------------------------------------------------------------------*/
+
+// Fixed update time, as at 60 frames per second
+const TFloat32 kUpdateTime = 1.0f / 60.0f;
+
+// Same random numbers every run so runs can be compared
+const unsigned int kRandomSeed = 1;
+
+// Worker threads, set with -threads. Loading the scene and the parallel import micro-benchmarks use
+// them, the simulation itself runs on the main thread
+TUInt32 NumThreads = CThreadPool::DefaultNumThreads();
+
+// Used for no tick
+const TUInt32 kNoTick = 0xffffffff;
+
+// A canned battle. The tanks in the scene file are always created, extra tanks copy them (template,
+// team and patrol route) at random positions. Shells and packs are kept at the given numbers
+struct SScenario
+{
+	const char* name;
+	const char* description;
+	TUInt32     numTanks;
+	TUInt32     numShells;
+	TUInt32     numHealthPacks;
+	TUInt32     numAmmoPacks;
+	bool        damageTanks;          // Start tanks on low health so they go for health packs
+	TUInt32     numTicks;
+	TUInt32     targetTicksPerSecond; // Speed the scenario must keep up with on one core, 0 if none
+};
+
+const SScenario kScenarios[] =
+{
+	{ "scene",     "6 tanks, today's scene",                 6,     0,     4,   4,   false, 3600, 0  },
+	{ "tanks1k",   "1,000 tanks",                            1000,  0,     4,   4,   false, 600,  0  },
+	{ "tanks10k",  "10,000 tanks and 50,000 shells",         10000, 50000, 4,   4,   false, 10,   0  },
+	{ "pickups",   "500 damaged tanks, 500 health and ammo", 500,   0,     500, 500, true,  600,  0  },
+	{ "shells10k", "10,000 shells among 100 tanks",          100,   10000, 4,   4,   false, 600,  60 },
+};
+const TUInt32 kNumScenarios = sizeof(kScenarios) / sizeof(kScenarios[0]);
+
+// Time and calls for one profiler zone over a run
+struct SZoneResult
+{
+	string   name;
+	TFloat32 time;  // Milliseconds
+	TUInt64  calls;
+};
+
+// Hash of one entity's state, from HashSimulation
+struct SEntityHash
+{
+	TEntityUID UID;
+	string     name;
+	TUInt64    hash;
+};
+
+// Results of running a scenario
+struct SScenarioResult
+{
+	const SScenario*    scenario;
+	TUInt32             numEntities; // After setup
+	TUInt32             numTicks;
+	TFloat64            setupTime;   // Milliseconds
+	TFloat64            tickTime;    // Milliseconds for all ticks
+	TUInt64             numAllocations;
+	TUInt64             allocatedBytes;
+	TUInt64             tagAllocations[NumMemoryTags]; // Allocations with each memory tag
+	TUInt64             tagPeakBytes[NumMemoryTags];   // Most live at once with each memory tag
+	TUInt64             numDroppedZones;
+	vector<SZoneResult> zones;
+	vector<TUInt64>     tickHashes;       // State hash after setup then after each tick, if asked for
+	TUInt32             entityHashTick;   // Tick that entity hashes were taken after, or kNoTick
+	vector<SEntityHash> entityHashes;
+};
+
+// Results of a micro-benchmark, one piece of code run a number of times
+struct SMicroResult
+{
+	string   name;
+	TUInt32  iterations;
+	TFloat64 time;       // Milliseconds for all iterations
+	TUInt64  numAllocations;
+	TUInt64  bytes;      // Size of the data produced by each iteration, 0 if not measured
+};
+
+
+// Milliseconds between two times from CTimer::Now
+TFloat64 Milliseconds( CTimer::TTicks start, CTimer::TTicks end )
+{
+	return static_cast<TFloat64>(end - start) * 1000.0 * CTimer::TClock::period::num / CTimer::TClock::period::den;
+}
+
+// Random point in the nav area that is not blocked, at the given height
+CVector3 RandomOpenPosition( const CVector3& minBounds, const CVector3& maxBounds, TFloat32 y )
+{
+	CVector3 position;
+	TUInt32 tries = 0;
+	do
+	{
+		position = CVector3( Random( minBounds.x, maxBounds.x ), y, Random( minBounds.z, maxBounds.z ) );
+	} while (NavGrid.IsBlocked( position ) && ++tries < 100);
+	return position;
+}
+
+
+// Scenery, tanks and packs of the current scenario
+class CScenarioScene
+{
+public:
+	CScenarioScene( const SScenario& scenario ) : m_Scenario( scenario ), m_PackSerial( 0 ) {}
+
+	// Load the scene headless and create the scenario's entities, returns false on failure
+	bool Setup()
+	{
+		// Compile the scene image first if the XML file has changed, as the game does
+		CSceneImage sceneImage;
+		string xmlFile = MediaFolder + "Scene.xml";
+		string imageFile = MediaFolder + "Scene.bin";
+		if (!CSceneCompiler::IsImageUpToDate( xmlFile, imageFile ))
+		{
+			CSceneCompiler compiler;
+			if (!compiler.Compile( xmlFile, imageFile ))
+			{
+				return false;
+			}
+		}
+		if (!sceneImage.Open( imageFile ))
+		{
+			return false;
+		}
+
+		CSceneLoader loader( &EntityManager, NumThreads, true );
+		if (!loader.LoadTemplates( sceneImage ))
+		{
+			return false;
+		}
+		vector<TEntityUID> tankUIDs;
+		loader.CreateEntities( sceneImage, &CollisionWorld, &tankUIDs );
+		CollisionWorld.Build( EntityManager.MaxBoundingRadius( "Projectile" ) );
+
+		const SSceneImageHeader& header = sceneImage.Header();
+		SAABB navArea = CollisionWorld.Bounds();
+		navArea.Extend( CVector3( header.navAreaMin ) );
+		navArea.Extend( CVector3( header.navAreaMax ) );
+		NavGrid.Bake( CollisionWorld, navArea.minBounds, navArea.maxBounds, header.navCellSize, header.navClearance );
+		m_MinBounds = CVector3( header.navAreaMin );
+		m_MaxBounds = CVector3( header.navAreaMax );
+
+		// Extra tanks copy the scene's tanks in turn
+		TUInt32 numSceneTanks = static_cast<TUInt32>(tankUIDs.size());
+		if (numSceneTanks == 0)
+		{
+			return false;
+		}
+		EntityManager.ReserveEntities( m_Scenario.numTanks + m_Scenario.numShells + m_Scenario.numHealthPacks +
+		                               m_Scenario.numAmmoPacks );
+		for (TUInt32 tank = numSceneTanks; tank < m_Scenario.numTanks; ++tank)
+		{
+			const SSceneTank& data = sceneImage.Tanks()[tank % numSceneTanks];
+			vector<CVector3> patrolList;
+			const TFloat32* waypoints = sceneImage.Waypoints() + 3 * data.firstWaypoint;
+			for (TUInt32 waypoint = 0; waypoint < data.numWaypoints; ++waypoint)
+			{
+				patrolList.push_back( CVector3( waypoints + 3 * waypoint ) );
+			}
+			tankUIDs.push_back( EntityManager.CreateTank( sceneImage.String( sceneImage.Templates()[data.templateIndex].name ),
+				data.team, patrolList, "Tank " + to_string( tank ), RandomOpenPosition( m_MinBounds, m_MaxBounds, data.position[1] ),
+				CVector3( data.rotation ) ) );
+		}
+
+		// Teams, then start every tank moving
+		vector<TUInt32> teams( tankUIDs.size() );
+		for (TUInt32 tank = 0; tank < tankUIDs.size(); ++tank)
+		{
+			teams[tank] = sceneImage.Tanks()[tank % numSceneTanks].team;
+			(teams[tank] == 0 ? TeamOne : TeamTwo).push_back( tankUIDs[tank] );
+		}
+		for (TUInt32 tank = 0; tank < tankUIDs.size(); ++tank)
+		{
+			SMessage msg;
+			msg.from = SystemUID;
+			const vector<TEntityUID>& enemies = GetEnemyTankUID( teams[tank] );
+			if (m_Scenario.damageTanks && !enemies.empty())
+			{
+				// Hit by a tank from the other team, the tank calls its team for help
+				msg.type = Msg_Hit;
+				msg.data = enemies[tank % enemies.size()];
+				for (TUInt32 hit = 0; hit < 3; ++hit)
+				{
+					Messenger.SendMessage( tankUIDs[tank], msg );
+				}
+			}
+			msg.type = Msg_Start;
+			Messenger.SendMessage( tankUIDs[tank], msg );
+		}
+		m_TankUIDs.swap( tankUIDs );
+
+		for (TUInt32 pack = 0; pack < m_Scenario.numHealthPacks; ++pack)
+		{
+			CreateHealthPack();
+		}
+		for (TUInt32 pack = 0; pack < m_Scenario.numAmmoPacks; ++pack)
+		{
+			CreateAmmoPack();
+		}
+		for (TUInt32 shell = 0; shell < m_Scenario.numShells; ++shell)
+		{
+			CreateShell();
+		}
+		return true;
+	}
+
+	// Run one update of the whole simulation
+	void Tick()
+	{
+		// Replace packs as they are collected or expire
+		SMessage msg;
+		while (Messenger.FetchMessage( SystemUID, &msg ))
+		{
+			if (msg.type == Msg_NewHealthPack)
+			{
+				CreateHealthPack();
+			}
+			else if (msg.type == Msg_NewAmmoPack)
+			{
+				CreateAmmoPack();
+			}
+		}
+
+		// Replace the shells that hit something or expired, so the scenario's number is always in
+		// flight. Tanks firing may add a few more
+		TUInt32 numShells = 0;
+		for (TUInt32 entity = 0; entity < EntityManager.NumEntities(); ++entity)
+		{
+			if (EntityManager.GetEntityAtIndex( entity )->GetKind() == Entity_Shell)
+			{
+				++numShells;
+			}
+		}
+		for (; numShells < m_Scenario.numShells; ++numShells)
+		{
+			CreateShell();
+		}
+
+		TankGrid.Build( &EntityManager );
+		EntityManager.UpdateAllEntities( kUpdateTime );
+		Raycasts.ResolveBatch();
+		Profiler.EndFrame();
+		CMemoryTracker::EndFrame();
+	}
+
+	// Release everything in the scene
+	void Shutdown()
+	{
+		Raycasts.Clear();
+		TankGrid.Clear();
+		Pickups.Clear();
+		NavGrid.Clear();
+		CollisionWorld.Clear();
+		EntityManager.DestroyAllEntities();
+		EntityManager.DestroyAllTemplates();
+		Messenger.Clear();
+		TeamOne.clear();
+		TeamTwo.clear();
+	}
+
+private:
+	void CreateHealthPack()
+	{
+		EntityManager.CreateHealthPack( "HealthPack", "Health Pack " + to_string( ++m_PackSerial ),
+		                                RandomOpenPosition( m_MinBounds, m_MaxBounds, 25.0f ) );
+	}
+
+	void CreateAmmoPack()
+	{
+		EntityManager.CreateAmmoPack( "AmmoPack", "Ammo Pack " + to_string( ++m_PackSerial ),
+		                              RandomOpenPosition( m_MinBounds, m_MaxBounds, 25.0f ) );
+	}
+
+	// A shell from a random tank, flying level in a random direction
+	void CreateShell()
+	{
+		TEntityUID owner = m_TankUIDs[Random( 0, static_cast<TInt32>(m_TankUIDs.size()) - 1 )];
+		EntityManager.CreateShell( "Shell Type 1", "Bullet", owner, RandomOpenPosition( m_MinBounds, m_MaxBounds, 2.0f ),
+		                           CVector3( 0.0f, Random( 0.0f, 2.0f * kfPi ), 0.0f ) );
+	}
+
+	const SScenario&   m_Scenario;
+	CVector3           m_MinBounds;
+	CVector3           m_MaxBounds;
+	vector<TEntityUID> m_TankUIDs;
+	TUInt32            m_PackSerial;
+};
+
+
+// Hash the state of the simulation after the given tick (0 for after setup), and each entity if it
+// is the tick asked for
+void HashTick( TUInt32 tick, SScenarioResult* pResult )
+{
+	CStateHash hash;
+	if (tick == pResult->entityHashTick)
+	{
+		vector<TUInt64> entityHashes;
+		HashSimulation( &hash, &entityHashes );
+		pResult->entityHashes.resize( entityHashes.size() );
+		for (TUInt32 entity = 0; entity < entityHashes.size(); ++entity)
+		{
+			CEntity* pEntity = EntityManager.GetEntityAtIndex( entity );
+			SEntityHash entityHash = { pEntity->GetUID(), pEntity->GetName(), entityHashes[entity] };
+			pResult->entityHashes[entity] = entityHash;
+		}
+	}
+	else
+	{
+		HashSimulation( &hash );
+	}
+	pResult->tickHashes.push_back( hash.Value() );
+}
+
+
+// Run a scenario for the given number of ticks (0 for the scenario's own), returns false if the
+// scene cannot be loaded. If hashing, the state is hashed after setup and after every tick, and
+// each entity after the given tick. Time spent hashing is not included in the tick time
+bool RunScenario( const SScenario& scenario, TUInt32 numTicks, bool hashTicks, TUInt32 entityHashTick,
+                  SScenarioResult* pResult )
+{
+	SeedRandom( kRandomSeed );
+	pResult->scenario = &scenario;
+	pResult->numTicks = (numTicks > 0) ? numTicks : scenario.numTicks;
+	pResult->entityHashTick = entityHashTick;
+
+	CScenarioScene scene( scenario );
+	CTimer::TTicks setupStart = CTimer::Now();
+	if (!scene.Setup())
+	{
+		scene.Shutdown();
+		return false;
+	}
+	pResult->setupTime = Milliseconds( setupStart, CTimer::Now() );
+	pResult->numEntities = EntityManager.NumEntities();
+
+	// Zones recorded during setup (e.g. baking the nav grid) are not part of the results
+	Profiler.EndFrame();
+	Profiler.ResetTotals();
+
+	CMemoryTracker::ResetPeaks();
+	TUInt64 allocationsStart = CMemoryTracker::TotalAllocations();
+	TUInt64 bytesStart = CMemoryTracker::TotalBytes();
+	TUInt64 tagAllocationsStart[NumMemoryTags];
+	for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+	{
+		SMemoryStats stats;
+		CMemoryTracker::GetStats( static_cast<EMemoryTag>(tag), &stats );
+		tagAllocationsStart[tag] = stats.totalAllocations;
+	}
+
+	if (hashTicks)
+	{
+		HashTick( 0, pResult );
+	}
+	TFloat64 hashTime = 0.0;
+	CTimer::TTicks tickStart = CTimer::Now();
+	for (TUInt32 tick = 0; tick < pResult->numTicks; ++tick)
+	{
+		scene.Tick();
+		if (hashTicks)
+		{
+			CTimer::TTicks hashStart = CTimer::Now();
+			HashTick( tick + 1, pResult );
+			hashTime += Milliseconds( hashStart, CTimer::Now() );
+		}
+	}
+	pResult->tickTime = Milliseconds( tickStart, CTimer::Now() ) - hashTime;
+	pResult->numAllocations = CMemoryTracker::TotalAllocations() - allocationsStart;
+	pResult->allocatedBytes = CMemoryTracker::TotalBytes() - bytesStart;
+	for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+	{
+		SMemoryStats stats;
+		CMemoryTracker::GetStats( static_cast<EMemoryTag>(tag), &stats );
+		pResult->tagAllocations[tag] = stats.totalAllocations - tagAllocationsStart[tag];
+		pResult->tagPeakBytes[tag] = stats.peakBytes;
+	}
+
+	pResult->numDroppedZones = Profiler.NumDroppedZones();
+	pResult->zones.clear();
+	for (TUInt32 zone = 0; zone < Profiler.NumZoneNames(); ++zone)
+	{
+		if (Profiler.ZoneTotalCalls( zone ) > 0)
+		{
+			SZoneResult zoneResult = { Profiler.ZoneName( zone ), Profiler.ZoneTotalTime( zone ),
+			                           Profiler.ZoneTotalCalls( zone ) };
+			pResult->zones.push_back( zoneResult );
+		}
+	}
+
+	scene.Shutdown();
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Micro-benchmarks
+-----------------------------------------------------------------------------------------*/
+
+// Time a function called the given number of times
+template <typename F>
+SMicroResult RunMicro( const string& name, TUInt32 iterations, F function )
+{
+	SMicroResult result;
+	result.name = name;
+	result.iterations = iterations;
+	TUInt64 allocationsStart = CMemoryTracker::TotalAllocations();
+	CTimer::TTicks start = CTimer::Now();
+	for (TUInt32 iteration = 0; iteration < iterations; ++iteration)
+	{
+		function();
+	}
+	result.time = Milliseconds( start, CTimer::Now() );
+	result.numAllocations = CMemoryTracker::TotalAllocations() - allocationsStart;
+	result.bytes = 0;
+	return result;
+}
+
+// Time parsing an X-file, building the triangle BVH over its geometry and ray queries against the
+// BVH. Returns false if the file cannot be imported
+bool RunMeshMicros( const string& fileName, vector<SMicroResult>* pResults )
+{
+	string fullFileName = MediaFolder + fileName;
+	bool imported = true;
+	pResults->push_back( RunMicro( "Parse " + fileName, 5, [&]()
+	{
+		CImportXFile importFile;
+		imported = imported && importFile.ImportFile( fullFileName ) == kSuccess;
+	} ) );
+	if (!imported)
+	{
+		return false;
+	}
+
+	// Geometry as the mesh holds it
+	CImportXFile importFile;
+	importFile.ImportFile( fullFileName );
+	vector<SMeshNode> nodes( importFile.GetNumNodes() );
+	for (TUInt32 node = 0; node < nodes.size(); ++node)
+	{
+		importFile.GetNode( node, &nodes[node] );
+	}
+	vector<SSubMesh> subMeshes( importFile.GetNumSubMeshes() );
+	for (TUInt32 subMesh = 0; subMesh < subMeshes.size(); ++subMesh)
+	{
+		importFile.GetSubMesh( subMesh, &subMeshes[subMesh] );
+	}
+
+	CMeshBVH bvh;
+	pResults->push_back( RunMicro( "BVH build " + fileName, 20, [&]()
+	{
+		bvh.Build( subMeshes.data(), static_cast<TUInt32>(subMeshes.size()), nodes.data(),
+		           static_cast<TUInt32>(nodes.size()) );
+	} ) );
+
+	// Rays from a sphere around the mesh towards random points inside its bounds
+	SAABB bounds;
+	bounds.SetEmpty();
+	for (TUInt32 triangle = 0; triangle < bvh.NumTriangles(); ++triangle)
+	{
+		CVector3 vertices[3];
+		bvh.GetTriangle( triangle, &vertices[0], &vertices[1], &vertices[2] );
+		bounds.Extend( vertices[0] );
+		bounds.Extend( vertices[1] );
+		bounds.Extend( vertices[2] );
+	}
+	CVector3 centre = (bounds.minBounds + bounds.maxBounds) * 0.5f;
+	TFloat32 radius = (bounds.maxBounds - bounds.minBounds).Length();
+	SeedRandom( kRandomSeed );
+	pResults->push_back( RunMicro( "BVH rays " + fileName, 100000, [&]()
+	{
+		CVector3 direction( Random( -1.0f, 1.0f ), Random( -1.0f, 1.0f ), Random( -1.0f, 1.0f ) );
+		CVector3 origin = centre + Normalise( direction ) * radius;
+		CVector3 target( Random( bounds.minBounds.x, bounds.maxBounds.x ), Random( bounds.minBounds.y, bounds.maxBounds.y ),
+		                 Random( bounds.minBounds.z, bounds.maxBounds.z ) );
+		bvh.RayIntersect( origin, target - origin, 1.0f );
+	} ) );
+
+	for (TUInt32 subMesh = 0; subMesh < subMeshes.size(); ++subMesh)
+	{
+		delete[] subMeshes[subMesh].vertices;
+		delete[] subMeshes[subMesh].faces;
+	}
+	return true;
+}
+
+// Import an X-file and get all of its sub-meshes with tangents, as a mesh is loaded. Mesh
+// splitting and the sub-meshes are spread across the pool if there is one. Returns false if the
+// file cannot be imported
+bool ImportSubMeshes( const string& fullFileName, CThreadPool* pPool, vector<SSubMesh>* pSubMeshes )
+{
+	CImportXFile importFile;
+	if (importFile.ImportFile( fullFileName, pPool ) != kSuccess)
+	{
+		return false;
+	}
+	pSubMeshes->resize( importFile.GetNumSubMeshes() );
+	auto getSubMesh = [&]( TUInt32 subMesh )
+	{
+		importFile.GetSubMesh( subMesh, &(*pSubMeshes)[subMesh], true );
+	};
+	if (pPool)
+	{
+		pPool->ParallelFor( importFile.GetNumSubMeshes(), getSubMesh );
+	}
+	else
+	{
+		for (TUInt32 subMesh = 0; subMesh < importFile.GetNumSubMeshes(); ++subMesh)
+		{
+			getSubMesh( subMesh );
+		}
+	}
+	return true;
+}
+
+// Free the data of sub-meshes from ImportSubMeshes
+void FreeSubMeshes( vector<SSubMesh>* pSubMeshes )
+{
+	for (TUInt32 subMesh = 0; subMesh < pSubMeshes->size(); ++subMesh)
+	{
+		delete[] (*pSubMeshes)[subMesh].vertices;
+		delete[] (*pSubMeshes)[subMesh].faces;
+	}
+	pSubMeshes->clear();
+}
+
+// Returns true if two lists of sub-meshes hold exactly the same data
+bool SameSubMeshes( const vector<SSubMesh>& a, const vector<SSubMesh>& b )
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (TUInt32 subMesh = 0; subMesh < a.size(); ++subMesh)
+	{
+		const SSubMesh& subA = a[subMesh];
+		const SSubMesh& subB = b[subMesh];
+		if (subA.node != subB.node || subA.material != subB.material ||
+		    subA.numVertices != subB.numVertices || subA.vertexSize != subB.vertexSize ||
+		    subA.hasSkinningData != subB.hasSkinningData || subA.hasNormals != subB.hasNormals ||
+		    subA.hasTangents != subB.hasTangents || subA.hasTextureCoords != subB.hasTextureCoords ||
+		    subA.hasVertexColours != subB.hasVertexColours || subA.numFaces != subB.numFaces ||
+		    memcmp( subA.vertices, subB.vertices, subA.numVertices * subA.vertexSize ) != 0 ||
+		    memcmp( subA.faces, subB.faces, subA.numFaces * sizeof(SMeshFace) ) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Time importing an X-file with tangents serially and on a thread pool - splitting the meshes by
+// material and building the sub-meshes. Returns false if the file cannot be imported or the two
+// imports give different sub-meshes
+bool RunImportMicros( const string& fileName, vector<SMicroResult>* pResults )
+{
+	string fullFileName = MediaFolder + fileName;
+	CThreadPool pool( Max( NumThreads, 1u ) );
+	vector<SSubMesh> serialSubMeshes;
+	vector<SSubMesh> parallelSubMeshes;
+	bool imported = true;
+	pResults->push_back( RunMicro( "Import serial " + fileName, 5, [&]()
+	{
+		FreeSubMeshes( &serialSubMeshes );
+		imported = imported && ImportSubMeshes( fullFileName, 0, &serialSubMeshes );
+	} ) );
+	pResults->push_back( RunMicro( "Import parallel " + fileName, 5, [&]()
+	{
+		FreeSubMeshes( &parallelSubMeshes );
+		imported = imported && ImportSubMeshes( fullFileName, &pool, &parallelSubMeshes );
+	} ) );
+
+	bool same = imported && SameSubMeshes( serialSubMeshes, parallelSubMeshes );
+	FreeSubMeshes( &serialSubMeshes );
+	FreeSubMeshes( &parallelSubMeshes );
+	return same;
+}
+
+// Time compiling a scene of 100,000 scattered trees to a scene image, then creating its entities
+// from the image - into the entity manager and collision world, including the collision tree
+// build. The scene is written to the working folder and deleted afterwards. Returns false if the
+// scene cannot be compiled or its templates loaded
+bool RunSceneMicros( vector<SMicroResult>* pResults )
+{
+	const string xmlFile = "BenchmarkScatter.xml";
+	const string imageFile = "BenchmarkScatter.bin";
+	{
+		ofstream file( xmlFile.c_str() );
+		file << "<Scene>\n"
+		        "  <Template Type=\"Scenery\" Name=\"Tree\" Mesh=\"Tree1.x\" />\n"
+		        "  <Scatter Template=\"Tree\" Name=\"Tree\" Count=\"100000\" Min=\"-1000 0 -1000\" Max=\"1000 0 1000\"\n"
+		        "           RandomYaw=\"true\" Static=\"true\" />\n"
+		        "</Scene>\n";
+	}
+
+	bool success = true;
+	pResults->push_back( RunMicro( "Scene 100k compile", 5, [&]()
+	{
+		CSceneCompiler compiler;
+		success = compiler.Compile( xmlFile, imageFile ) && success;
+	} ) );
+
+	CSceneImage sceneImage;
+	CSceneLoader loader( &EntityManager, NumThreads, true );
+	success = success && sceneImage.Open( imageFile ) && loader.LoadTemplates( sceneImage );
+	if (success)
+	{
+		// Timed by hand so that destroying the entities between iterations is not included
+		SMicroResult create = { "Scene 100k create entities", 5, 0.0, 0, 0 };
+		for (TUInt32 iteration = 0; iteration < create.iterations; ++iteration)
+		{
+			TUInt64 allocationsStart = CMemoryTracker::TotalAllocations();
+			CTimer::TTicks start = CTimer::Now();
+			vector<TEntityUID> tankUIDs;
+			loader.CreateEntities( sceneImage, &CollisionWorld, &tankUIDs );
+			CollisionWorld.Build( 0.0f );
+			create.time += Milliseconds( start, CTimer::Now() );
+			create.numAllocations += CMemoryTracker::TotalAllocations() - allocationsStart;
+
+			CollisionWorld.Clear();
+			EntityManager.DestroyAllEntities();
+		}
+		pResults->push_back( create );
+	}
+
+	sceneImage.Close();
+	EntityManager.DestroyAllTemplates();
+	remove( xmlFile.c_str() );
+	remove( imageFile.c_str() );
+	return success;
+}
+
+// Time 10,000 tanks steering towards 4 shared goals on the scene's nav grid. Returns false if the
+// scene cannot be loaded
+bool RunNavMicro( vector<SMicroResult>* pResults )
+{
+	const TUInt32 kNumAgents = 10000;
+	const TUInt32 kNumGoals = 4;
+
+	SeedRandom( kRandomSeed );
+	SScenario empty = { "nav", "", 0, 0, 0, 0, false, 0, 0 };
+	CScenarioScene scene( empty );
+	if (!scene.Setup())
+	{
+		scene.Shutdown();
+		return false;
+	}
+
+	CVector3 minBounds = CollisionWorld.Bounds().minBounds;
+	CVector3 maxBounds = CollisionWorld.Bounds().maxBounds;
+	vector<CVector3> agents( kNumAgents );
+	for (TUInt32 agent = 0; agent < kNumAgents; ++agent)
+	{
+		agents[agent] = RandomOpenPosition( minBounds, maxBounds, 0.5f );
+	}
+	CVector3 goals[kNumGoals];
+	for (TUInt32 goal = 0; goal < kNumGoals; ++goal)
+	{
+		goals[goal] = RandomOpenPosition( minBounds, maxBounds, 0.5f );
+	}
+
+	pResults->push_back( RunMicro( "Nav 10k agents 4 goals", 60, [&]()
+	{
+		for (TUInt32 agent = 0; agent < kNumAgents; ++agent)
+		{
+			CVector3 target = NavGrid.SteerTarget( agents[agent], goals[agent % kNumGoals] );
+			agents[agent] += Normalise( target - agents[agent] ) * 0.25f;
+		}
+	} ) );
+
+	scene.Shutdown();
+	return true;
+}
+
+// Time mouse picking among 100,000 entities on a 1280x720 screen: adding and binning their screen
+// positions, queries against the grid, and the old approach of checking every entity per query
+void RunPickingMicros( vector<SMicroResult>* pResults )
+{
+	const TUInt32 kNumEntities = 100000;
+	const TUInt32 kNumQueries = 1000;
+	const TUInt32 kWidth = 1280;
+	const TUInt32 kHeight = 720;
+	const TFloat32 kMaxDistance = 100.0f;
+
+	// Top down view of a 2000 x 2000 area as a view-projection matrix, entities slightly over
+	// the edges of the area are off screen
+	CMatrix4x4 viewProj( 0.001f, 0.0f,   0.0f, 0.0f,
+	                     0.0f,   0.0f,   0.0f, 0.0f,
+	                     0.0f,   0.001f, 0.0f, 0.0f,
+	                     0.0f,   0.0f,   0.0f, 1.0f );
+	SeedRandom( kRandomSeed );
+	vector<CVector3> positions( kNumEntities );
+	for (TUInt32 entity = 0; entity < kNumEntities; ++entity)
+	{
+		positions[entity] = CVector3( Random( -1050.0f, 1050.0f ), 0.0f, Random( -1050.0f, 1050.0f ) );
+	}
+	vector<CVector2> clicks( kNumQueries );
+	for (TUInt32 query = 0; query < kNumQueries; ++query)
+	{
+		clicks[query] = CVector2( Random( 0.0f, static_cast<TFloat32>(kWidth) ), Random( 0.0f, static_cast<TFloat32>(kHeight) ) );
+	}
+
+	CPickingService picking;
+	TEntityUID pickedUID;
+	pResults->push_back( RunMicro( "Pick 100k add and bin", 20, [&]()
+	{
+		picking.Clear( kWidth, kHeight );
+		for (TUInt32 entity = 0; entity < kNumEntities; ++entity)
+		{
+			picking.Add( entity, positions[entity], viewProj );
+		}
+		picking.Nearest( clicks[0], kMaxDistance, &pickedUID );
+	} ) );
+
+	TUInt32 query = 0;
+	pResults->push_back( RunMicro( "Pick 100k nearest", kNumQueries, [&]()
+	{
+		picking.Nearest( clicks[query++], kMaxDistance, &pickedUID );
+	} ) );
+
+	// Project every entity and keep the nearest, per query
+	query = 0;
+	pResults->push_back( RunMicro( "Pick 100k brute force", 20, [&]()
+	{
+		CVector2 click = clicks[query++];
+		TFloat32 nearestDistance = kMaxDistance;
+		for (TUInt32 entity = 0; entity < kNumEntities; ++entity)
+		{
+			CVector4 projected = CVector4( positions[entity], 1.0f ) * viewProj;
+			CVector2 pixel( (projected.x / projected.w + 1.0f) * kWidth * 0.5f, (1.0f - projected.y / projected.w) * kHeight * 0.5f );
+			TFloat32 distance = pixel.DistanceTo( click );
+			if (distance < nearestDistance)
+			{
+				nearestDistance = distance;
+				pickedUID = entity;
+			}
+		}
+	} ) );
+}
+
+
+// Time saving and restoring a snapshot of a battle of 100,000 entities - 20,000 tanks and 80,000
+// shells with some packs and the scenery - and report its size. The restored simulation is saved
+// again and must give the same snapshot. Returns false if the scene cannot be loaded or the
+// snapshot does not restore exactly
+bool RunSnapshotMicros( vector<SMicroResult>* pResults )
+{
+	SeedRandom( kRandomSeed );
+	SScenario battle = { "snapshot", "", 20000, 80000, 50, 50, false, 0, 0 };
+	CScenarioScene scene( battle );
+	if (!scene.Setup())
+	{
+		scene.Shutdown();
+		return false;
+	}
+
+	// Taken straight after setup - the arena is so crowded that most shells hit something in the
+	// first update. The size of the state does not depend on what the entities are doing
+	CSnapshot snapshot;
+	SMicroResult save = RunMicro( "Snapshot 100k save", 10, [&]()
+	{
+		snapshot.Clear();
+		SaveSimulation( &snapshot );
+	} );
+	save.bytes = snapshot.Size();
+	pResults->push_back( save );
+
+	bool restored = true;
+	pResults->push_back( RunMicro( "Snapshot 100k restore", 10, [&]()
+	{
+		snapshot.BeginRead();
+		restored = RestoreSimulation( &snapshot ) && snapshot.ReadAll() && restored;
+	} ) );
+
+	CSnapshot check;
+	SaveSimulation( &check );
+	restored = restored && check.Size() == snapshot.Size() && memcmp( check.Data(), snapshot.Data(), snapshot.Size() ) == 0;
+
+	scene.Shutdown();
+	return restored;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Large scenes
+-----------------------------------------------------------------------------------------*/
+
+// Generated scenes are at least this size in megabytes unless given with -scene-mb
+const TUInt32 kDefaultLargeSceneMB = 500;
+
+// Write a generated scene XML file of at least the given size: the templates of Scene.xml, then
+// scattered trees and buildings as Entity elements with a tank and its patrol route after every
+// thousand. Positions come from a fixed seed so the same file is generated each time. Returns the
+// number of entities written, 0 if the file cannot be written
+TUInt32 GenerateLargeScene( const string& fileName, TUInt64 size )
+{
+	FILE* file = fopen( fileName.c_str(), "w" );
+	if (!file)
+	{
+		return 0;
+	}
+
+	TUInt64 numBytes = fprintf( file, "<?xml version=\"1.0\"?>\n"
+	               "<!-- Generated by Benchmark largescene -->\n"
+	               "<Scene>\n"
+	               "  <Template Type=\"Scenery\" Name=\"Building\" Mesh=\"Building.x\" />\n"
+	               "  <Template Type=\"Scenery\" Name=\"Tree\" Mesh=\"Tree1.x\" />\n"
+	               "  <TankTemplate Type=\"Tank\" Name=\"Rogue Scout\" Mesh=\"HoverTank02.x\" TopSpeed=\"24.0\"\n"
+	               "                Acceleration=\"2.2\" TankTurnSpeed=\"2.0\" TurretTurnSpeed=\"1.03\" MaxHP=\"100\"\n"
+	               "                ShellDamage=\"20\" />\n" );
+
+	SeedRandom( kRandomSeed );
+	TUInt32 numEntities = 0;
+	while (numBytes < size && !ferror( file ))
+	{
+		++numEntities;
+		bool building = (numEntities % 50 == 0);
+		numBytes += fprintf( file, "  <Entity Template=\"%s\" Name=\"%s %u\" Position=\"%.2f 0 %.2f\" Rotation=\"0 %.1f 0\"%s Static=\"true\" />\n",
+		         building ? "Building" : "Tree", building ? "Building" : "Tree", numEntities, Random( -5000.0f, 5000.0f ),
+		         Random( -5000.0f, 5000.0f ), Random( 0.0f, 360.0f ), building ? "" : " Scale=\"1 1.2 1\"" );
+
+		if (numEntities % 1000 == 0)
+		{
+			TFloat32 x = Random( -5000.0f, 5000.0f );
+			TFloat32 z = Random( -5000.0f, 5000.0f );
+			numBytes += fprintf( file, "  <Tank Template=\"Rogue Scout\" Team=\"%u\" Name=\"Tank %u\" Position=\"%.2f 0.5 %.2f\">\n"
+			               "    <Waypoint Position=\"%.2f 0.5 %.2f\" />\n"
+			               "    <Waypoint Position=\"%.2f 0.5 %.2f\" />\n"
+			               "  </Tank>\n",
+			         (numEntities / 1000) % 2, numEntities / 1000, x, z, x + 50.0f, z, x + 50.0f, z + 50.0f );
+		}
+	}
+	fprintf( file, "</Scene>\n" );
+
+	bool written = !ferror( file );
+	fclose( file );
+	return written ? numEntities : 0;
+}
+
+// Generate a scene of the given size in megabytes, then time compiling it to a scene image with
+// the streaming compiler and report the most memory allocated at once while compiling. The files
+// are written to the working folder and deleted afterwards. Returns false if the scene cannot be
+// written or compiled
+bool RunLargeScene( TUInt32 megabytes )
+{
+	const string xmlFile = "BenchmarkLarge.xml";
+	const string imageFile = "BenchmarkLarge.bin";
+
+	CTimer::TTicks generateStart = CTimer::Now();
+	TUInt32 numEntities = GenerateLargeScene( xmlFile, static_cast<TUInt64>(megabytes) * 1024 * 1024 );
+	TFloat64 generateTime = Milliseconds( generateStart, CTimer::Now() );
+	if (numEntities == 0)
+	{
+		remove( xmlFile.c_str() );
+		return false;
+	}
+
+	// Peak of each tag over the compile, less what was live before it started
+	TUInt64 liveBefore[NumMemoryTags];
+	for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+	{
+		SMemoryStats stats;
+		CMemoryTracker::GetStats( static_cast<EMemoryTag>(tag), &stats );
+		liveBefore[tag] = stats.liveBytes;
+	}
+	CMemoryTracker::ResetPeaks();
+
+	CTimer::TTicks compileStart = CTimer::Now();
+	bool compiled;
+	{
+		CSceneCompiler compiler;
+		compiled = compiler.Compile( xmlFile, imageFile );
+	}
+	TFloat64 compileTime = Milliseconds( compileStart, CTimer::Now() );
+
+	TUInt64 peakBytes = 0;
+	SMemoryStats xmlStats;
+	for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+	{
+		SMemoryStats stats;
+		CMemoryTracker::GetStats( static_cast<EMemoryTag>(tag), &stats );
+		peakBytes += stats.peakBytes - liveBefore[tag];
+		if (tag == Mem_XML)
+		{
+			xmlStats = stats;
+		}
+	}
+
+	if (compiled)
+	{
+		printf( "largescene: %uMB generated scene, %u entities, generated in %.1fs\n", megabytes, numEntities, generateTime / 1000.0 );
+		printf( "  compiled in %.2fs (%.1fMB/s), peak memory %.2fMB (%.2fMB scene compiler)\n", compileTime / 1000.0,
+		        megabytes * 1000.0 / Max( compileTime, 0.001 ), peakBytes / (1024.0 * 1024.0),
+		        (xmlStats.peakBytes - liveBefore[Mem_XML]) / (1024.0 * 1024.0) );
+	}
+
+	remove( xmlFile.c_str() );
+	remove( imageFile.c_str() );
+	return compiled;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Replays
+-----------------------------------------------------------------------------------------*/
+
+// Play a recording made in the game (F8) as fast as possible and report whether the battle still
+// matches its hashes. The scene is loaded as for the "scene" scenario, then the recording's start
+// state replaces its tanks and packs. Returns false if the recording cannot be loaded or was made
+// in a different scene
+bool RunReplay( const string& fileName, bool* pDiverged )
+{
+	CScenarioScene scene( kScenarios[0] );
+	CBattle battle;
+	CReplay replay;
+	if (!scene.Setup() || !replay.Load( fileName ) || !replay.StartPlayback( &battle ))
+	{
+		scene.Shutdown();
+		return false;
+	}
+
+	CTimer::TTicks playStart = CTimer::Now();
+	while (replay.PlayUpdate( &battle ))
+	{
+		Profiler.EndFrame();
+		CMemoryTracker::EndFrame();
+	}
+	TFloat64 playTime = Milliseconds( playStart, CTimer::Now() );
+
+	printf( "%s: %u updates, %.1fs of battle played in %.1fms (%.0fx real time), %u hashes checked, ",
+	        fileName.c_str(), replay.NumUpdates(), replay.Time(), playTime,
+	        replay.Time() * 1000.0 / Max( playTime, 0.001 ), replay.NumHashesChecked() );
+	if (replay.HasDiverged())
+	{
+		printf( "diverged after update %u\n", replay.DivergedUpdate() );
+	}
+	else
+	{
+		printf( "all matched\n" );
+	}
+	*pDiverged = replay.HasDiverged();
+
+	scene.Shutdown();
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Output
+-----------------------------------------------------------------------------------------*/
+
+// Print the results as a table
+void PrintResults( const vector<SScenarioResult>& scenarios, const vector<SMicroResult>& micros )
+{
+	for (TUInt32 entry = 0; entry < scenarios.size(); ++entry)
+	{
+		const SScenarioResult& result = scenarios[entry];
+		printf( "%s: %s\n", result.scenario->name, result.scenario->description );
+		printf( "  %u entities, setup %.1fms, %u ticks at %.1f ticks/s (%.3fms/tick)\n", result.numEntities,
+		        result.setupTime, result.numTicks, result.numTicks * 1000.0 / result.tickTime, result.tickTime / result.numTicks );
+		if (result.scenario->targetTicksPerSecond > 0)
+		{
+			bool met = result.numTicks * 1000.0 / result.tickTime >= result.scenario->targetTicksPerSecond;
+			printf( "  target %u ticks/s %s\n", result.scenario->targetTicksPerSecond, met ? "met" : "MISSED" );
+		}
+		printf( "  %.1f allocations/tick, %.0f bytes/tick\n", static_cast<TFloat64>(result.numAllocations) / result.numTicks,
+		        static_cast<TFloat64>(result.allocatedBytes) / result.numTicks );
+		for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+		{
+			printf( "    %-20s %9.1f allocations/tick %8.2fMB peak\n", CMemoryTracker::TagName( static_cast<EMemoryTag>(tag) ),
+			        static_cast<TFloat64>(result.tagAllocations[tag]) / result.numTicks, result.tagPeakBytes[tag] / (1024.0 * 1024.0) );
+		}
+		for (TUInt32 zone = 0; zone < result.zones.size(); ++zone)
+		{
+			printf( "    %-20s %9.3fms/tick %10.1f calls/tick\n", result.zones[zone].name.c_str(), result.zones[zone].time / result.numTicks,
+			        static_cast<TFloat64>(result.zones[zone].calls) / result.numTicks );
+		}
+		if (result.numDroppedZones > 0)
+		{
+			printf( "    %llu zones dropped, zone times are low\n", static_cast<unsigned long long>(result.numDroppedZones) );
+		}
+	}
+
+	if (!micros.empty())
+	{
+		printf( "Micro-benchmarks\n" );
+	}
+	for (TUInt32 entry = 0; entry < micros.size(); ++entry)
+	{
+		const SMicroResult& result = micros[entry];
+		printf( "  %-28s %10.4fms x%-6u %8.1f allocations", result.name.c_str(), result.time / result.iterations, result.iterations,
+		        static_cast<TFloat64>(result.numAllocations) / result.iterations );
+		if (result.bytes > 0)
+		{
+			printf( " %8.2fMB", result.bytes / (1024.0 * 1024.0) );
+		}
+		printf( "\n" );
+	}
+}
+
+// Write a string as a JSON string literal
+void WriteJSONString( ofstream& file, const string& text )
+{
+	file << '"';
+	for (TUInt32 c = 0; c < text.length(); ++c)
+	{
+		if (text[c] == '"' || text[c] == '\\') file << '\\';
+		file << text[c];
+	}
+	file << '"';
+}
+
+// Write the results as JSON, returns false if the file cannot be written
+bool WriteJSON( const string& fileName, const vector<SScenarioResult>& scenarios, const vector<SMicroResult>& micros )
+{
+	ofstream file( fileName.c_str() );
+	if (!file)
+	{
+		return false;
+	}
+
+	file << fixed << setprecision( 4 );
+	file << "{\n\"scenarios\":[\n";
+	for (TUInt32 entry = 0; entry < scenarios.size(); ++entry)
+	{
+		const SScenarioResult& result = scenarios[entry];
+		file << "{\"name\":";
+		WriteJSONString( file, result.scenario->name );
+		file << ",\"entities\":" << result.numEntities << ",\"ticks\":" << result.numTicks
+		     << ",\"setup_ms\":" << result.setupTime << ",\"ticks_per_second\":" << result.numTicks * 1000.0 / result.tickTime
+		     << ",\"ms_per_tick\":" << result.tickTime / result.numTicks
+		     << ",\"target_ticks_per_second\":" << result.scenario->targetTicksPerSecond
+		     << ",\"allocations_per_tick\":" << static_cast<TFloat64>(result.numAllocations) / result.numTicks
+		     << ",\"bytes_per_tick\":" << static_cast<TFloat64>(result.allocatedBytes) / result.numTicks
+		     << ",\"dropped_zones\":" << result.numDroppedZones << ",\"memory\":[";
+		for (TUInt32 tag = 0; tag < NumMemoryTags; ++tag)
+		{
+			file << (tag > 0 ? "," : "") << "{\"tag\":";
+			WriteJSONString( file, CMemoryTracker::TagName( static_cast<EMemoryTag>(tag) ) );
+			file << ",\"allocations_per_tick\":" << static_cast<TFloat64>(result.tagAllocations[tag]) / result.numTicks
+			     << ",\"peak_bytes\":" << result.tagPeakBytes[tag] << "}";
+		}
+		file << "],\"zones\":[";
+		for (TUInt32 zone = 0; zone < result.zones.size(); ++zone)
+		{
+			file << (zone > 0 ? "," : "") << "{\"name\":";
+			WriteJSONString( file, result.zones[zone].name );
+			file << ",\"ms_per_tick\":" << result.zones[zone].time / result.numTicks
+			     << ",\"calls_per_tick\":" << static_cast<TFloat64>(result.zones[zone].calls) / result.numTicks << "}";
+		}
+		file << "]}" << ((entry + 1 < scenarios.size()) ? ",\n" : "\n");
+	}
+	file << "],\n\"micro\":[\n";
+	for (TUInt32 entry = 0; entry < micros.size(); ++entry)
+	{
+		const SMicroResult& result = micros[entry];
+		file << "{\"name\":";
+		WriteJSONString( file, result.name );
+		file << ",\"iterations\":" << result.iterations << ",\"ms_per_iteration\":" << result.time / result.iterations
+		     << ",\"allocations_per_iteration\":" << static_cast<TFloat64>(result.numAllocations) / result.iterations
+		     << ",\"bytes\":" << result.bytes << "}"
+		     << ((entry + 1 < micros.size()) ? ",\n" : "\n");
+	}
+	file << "]\n}\n";
+	return file.good();
+}
+
+// Write the state hashes of each scenario, one line per tick with the scenario name, tick and
+// hash. The entity hashes follow their tick's line, with the entity's index, UID, hash and name.
+// Runs can be compared with diff or CheckDeterminism.sh
+bool WriteHashes( const string& fileName, const vector<SScenarioResult>& scenarios )
+{
+	ofstream file( fileName.c_str() );
+	if (!file)
+	{
+		return false;
+	}
+
+	file << hex << setfill( '0' );
+	for (TUInt32 entry = 0; entry < scenarios.size(); ++entry)
+	{
+		const SScenarioResult& result = scenarios[entry];
+		for (TUInt32 tick = 0; tick < result.tickHashes.size(); ++tick)
+		{
+			file << result.scenario->name << " " << dec << tick << " " << hex << setw( 16 ) << result.tickHashes[tick] << "\n";
+			if (tick == result.entityHashTick)
+			{
+				for (TUInt32 entity = 0; entity < result.entityHashes.size(); ++entity)
+				{
+					const SEntityHash& entityHash = result.entityHashes[entity];
+					file << result.scenario->name << " " << dec << tick << " entity " << entity << " " << entityHash.UID
+					     << " " << hex << setw( 16 ) << entityHash.hash << " " << entityHash.name << "\n";
+				}
+			}
+		}
+	}
+	return file.good();
+}
+
+} // namespace gen
+
+
+// Usage: Benchmark [-ticks n] [-threads n] [-json file] [-hashes file [-hash-entities tick]] [-replay file]
+//                  [-scene-mb n] [scenario ...] [micro] [largescene]
+int main( int argc, char* argv[] )
+{
+	using namespace gen;
+
+	// Choose what to run, everything by default
+	TUInt32 numTicks = 0;
+	string jsonFile;
+	string hashFile;
+	TUInt32 entityHashTick = kNoTick;
+	string replayFile;
+	vector<const SScenario*> scenarios;
+	bool runMicros = false;
+	bool runLargeScene = false;
+	TUInt32 largeSceneMB = kDefaultLargeSceneMB;
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		if (strcmp( argv[arg], "-ticks" ) == 0 && arg + 1 < argc)
+		{
+			numTicks = static_cast<TUInt32>(atoi( argv[++arg] ));
+			continue;
+		}
+		if (strcmp( argv[arg], "-threads" ) == 0 && arg + 1 < argc)
+		{
+			NumThreads = static_cast<TUInt32>(atoi( argv[++arg] ));
+			continue;
+		}
+		if (strcmp( argv[arg], "-hashes" ) == 0 && arg + 1 < argc)
+		{
+			hashFile = argv[++arg];
+			continue;
+		}
+		if (strcmp( argv[arg], "-hash-entities" ) == 0 && arg + 1 < argc)
+		{
+			entityHashTick = static_cast<TUInt32>(atoi( argv[++arg] ));
+			continue;
+		}
+		if (strcmp( argv[arg], "-json" ) == 0 && arg + 1 < argc)
+		{
+			jsonFile = argv[++arg];
+			continue;
+		}
+		if (strcmp( argv[arg], "-replay" ) == 0 && arg + 1 < argc)
+		{
+			replayFile = argv[++arg];
+			continue;
+		}
+		if (strcmp( argv[arg], "-scene-mb" ) == 0 && arg + 1 < argc)
+		{
+			largeSceneMB = static_cast<TUInt32>(atoi( argv[++arg] ));
+			continue;
+		}
+		if (strcmp( argv[arg], "micro" ) == 0)
+		{
+			runMicros = true;
+			continue;
+		}
+		if (strcmp( argv[arg], "largescene" ) == 0)
+		{
+			runLargeScene = true;
+			continue;
+		}
+		TUInt32 scenario = 0;
+		while (scenario < kNumScenarios && strcmp( argv[arg], kScenarios[scenario].name ) != 0)
+		{
+			++scenario;
+		}
+		if (scenario == kNumScenarios)
+		{
+			printf( "Usage: Benchmark [-ticks n] [-threads n] [-json file] [-hashes file [-hash-entities tick]]\n"
+			        "                 [-replay file] [-scene-mb n] [scenario ...] [micro] [largescene]\n"
+			        "Runs the simulation headless and reports ticks per second, time in each profiler zone and\n"
+			        "allocations. Run from the game folder so Media is found. -hashes writes a hash of the state\n"
+			        "after every tick (and each entity after the -hash-entities tick) to compare runs. -replay\n"
+			        "plays a recording made in the game and checks the battle still matches it. Scenarios:\n" );
+			for (scenario = 0; scenario < kNumScenarios; ++scenario)
+			{
+				printf( "  %-10s %s, %u ticks\n", kScenarios[scenario].name, kScenarios[scenario].description,
+				        kScenarios[scenario].numTicks );
+			}
+			printf( "  %-10s X-file parsing, serial and parallel import with tangents, mesh BVH build and rays,\n"
+			        "  %-10s 100k scene compile and entity creation, nav grid steering, picking, snapshot save\n"
+			        "  %-10s and restore\n", "micro", "", "" );
+			printf( "  %-10s compile a generated scene of -scene-mb megabytes (default %u), reporting the time\n"
+			        "  %-10s and peak memory. Not run by default\n", "largescene", kDefaultLargeSceneMB, "" );
+			return 1;
+		}
+		scenarios.push_back( &kScenarios[scenario] );
+	}
+	if (scenarios.empty() && !runMicros && !runLargeScene && replayFile.empty())
+	{
+		for (TUInt32 scenario = 0; scenario < kNumScenarios; ++scenario)
+		{
+			scenarios.push_back( &kScenarios[scenario] );
+		}
+		runMicros = true;
+	}
+
+	Profiler.SetThreadName( "Main" );
+	int result = 0;
+	vector<SScenarioResult> scenarioResults;
+	vector<SMicroResult> microResults;
+	try
+	{
+		if (!replayFile.empty())
+		{
+			bool diverged = false;
+			if (!RunReplay( replayFile, &diverged ))
+			{
+				printf( "%s: cannot load scene or recording, or recorded in a different scene\n", replayFile.c_str() );
+				result = 1;
+			}
+			else if (diverged)
+			{
+				result = 1;
+			}
+		}
+
+		for (TUInt32 scenario = 0; scenario < scenarios.size(); ++scenario)
+		{
+			SScenarioResult scenarioResult;
+			if (RunScenario( *scenarios[scenario], numTicks, !hashFile.empty(), entityHashTick, &scenarioResult ))
+			{
+				scenarioResults.push_back( scenarioResult );
+			}
+			else
+			{
+				printf( "%s: cannot load scene\n", scenarios[scenario]->name );
+				result = 1;
+			}
+		}
+
+		if (runMicros)
+		{
+			const char* const kMeshFiles[] = { "Building.x", "tigerAusfH.x", "HoverTank02.x" };
+			for (TUInt32 mesh = 0; mesh < sizeof(kMeshFiles) / sizeof(kMeshFiles[0]); ++mesh)
+			{
+				if (!RunMeshMicros( kMeshFiles[mesh], &microResults ))
+				{
+					printf( "%s: cannot import mesh\n", kMeshFiles[mesh] );
+					result = 1;
+				}
+			}
+			const char* const kTangentMeshFiles[] = { "tigerAusfH.x", "Building.x" };
+			for (TUInt32 mesh = 0; mesh < sizeof(kTangentMeshFiles) / sizeof(kTangentMeshFiles[0]); ++mesh)
+			{
+				if (!RunImportMicros( kTangentMeshFiles[mesh], &microResults ))
+				{
+					printf( "%s: cannot import mesh, or parallel import differs from serial\n", kTangentMeshFiles[mesh] );
+					result = 1;
+				}
+			}
+			if (!RunSceneMicros( &microResults ))
+			{
+				printf( "scene: cannot compile or load scatter scene\n" );
+				result = 1;
+			}
+			if (!RunNavMicro( &microResults ))
+			{
+				printf( "nav: cannot load scene\n" );
+				result = 1;
+			}
+			RunPickingMicros( &microResults );
+			if (!RunSnapshotMicros( &microResults ))
+			{
+				printf( "snapshot: cannot load scene or restore snapshot\n" );
+				result = 1;
+			}
+		}
+
+		if (runLargeScene && !RunLargeScene( largeSceneMB ))
+		{
+			printf( "largescene: cannot write or compile generated scene\n" );
+			result = 1;
+		}
+	}
+	catch (CFatalException&)
+	{
+		printf( "Fatal error\n" );
+		return 1;
+	}
+
+	PrintResults( scenarioResults, microResults );
+	if (!jsonFile.empty() && !WriteJSON( jsonFile, scenarioResults, microResults ))
+	{
+		printf( "%s: cannot write file\n", jsonFile.c_str() );
+		result = 1;
+	}
+	if (!hashFile.empty() && !WriteHashes( hashFile, scenarioResults ))
+	{
+		printf( "%s: cannot write file\n", hashFile.c_str() );
+		result = 1;
+	}
+	return result;
+}
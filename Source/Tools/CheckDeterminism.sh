@@ -0,0 +1,109 @@
+#!/bin/bash
+#*******************************************
+#	CheckDeterminism.sh
+#
+#	Checks that builds of the Benchmark tool
+#	run the simulation identically
+#*******************************************
+#
+# Runs each build, writing a hash of the simulation state after every tick (Benchmark -hashes),
+# and compares every run with the first. For a run that differs, the first diverging tick is found,
+# both runs are repeated hashing each entity after that tick, and the first entity that differs is
+# reported. Builds are commands that run the Benchmark tool, e.g. a Release and a Debug build, or
+# builds with different optimisation or SIMD settings. Run from the game folder so Media is found.
+#
+# Each build is one argument holding a shell command, split into words as the shell would (with
+# eval), so it may include a launcher or arguments. Quote a path with spaces inside the argument:
+#     CheckDeterminism.sh ./BenchmarkRelease.exe '"./Debug build/Benchmark.exe"' 'wine ./Benchmark.exe'
+#
+# Runs are not compared across thread counts: the simulation runs on the main thread only, and
+# -threads just sets how many workers load the scene, so there is nothing for it to change.
+#
+# The tree only builds with MSVC (Benchmark.vcxproj), so this is a bash script for running Windows
+# builds: use it from Git Bash, MSYS2 or WSL, which can all run the .exe files directly. Every
+# configuration writes Benchmark.exe to the solution folder, so copy each build aside first, e.g.
+#     Source/Tools/CheckDeterminism.sh ./BenchmarkRelease.exe ./BenchmarkDebug.exe
+#
+# Usage: CheckDeterminism.sh [-t ticks] [-s "scenario ..."] build [build ...]
+# Exits with 0 if all runs match, 1 if any differ and 2 if a run fails
+
+ticks=300
+scenarios="scene pickups"
+while getopts "t:s:" option; do
+	case $option in
+		t) ticks=$OPTARG ;;
+		s) scenarios=$OPTARG ;;
+		*) sed -n 's/^# Usage: //p' "$0"; exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+if [ $# -eq 0 ]; then
+	sed -n 's/^# Usage: //p' "$0"
+	exit 2
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Run a build: run <build> <hash file> [-hash-entities tick] scenario...
+# The build command is split into an array of words with eval, see above
+run()
+{
+	local build=$1 hashFile=$2
+	local -a command
+	shift 2
+	if ! eval "command=($build)" || [ ${#command[@]} -eq 0 ]; then
+		echo "FAILED: cannot split build command: $build"
+		exit 2
+	fi
+	if ! "${command[@]}" -ticks "$ticks" -hashes "$hashFile" "$@" > "$hashFile.log" 2>&1; then
+		echo "FAILED: $build ($hashFile.log):"
+		tail -n 5 "$hashFile.log"
+		exit 2
+	fi
+}
+
+# First line where two hash files differ, ignoring entity lines
+first_difference()
+{
+	paste -d '|' <(grep -v ' entity ' "$1") <(grep -v ' entity ' "$2") |
+		awk -F '|' '$1 != $2 { print ($1 != "" ? $1 : $2); exit }'
+}
+
+result=0
+reference=""
+runNumber=0
+for build in "$@"; do
+	runNumber=$((runNumber + 1))
+	hashes="$work/run$runNumber.txt"
+	run "$build" "$hashes" $scenarios
+
+	if [ -z "$reference" ]; then
+		reference=$hashes
+		referenceBuild=$build
+		echo "reference: $build"
+		continue
+	fi
+
+	difference=$(first_difference "$reference" "$hashes")
+	if [ -z "$difference" ]; then
+		echo "match:     $build"
+		continue
+	fi
+
+	# Hash each entity after the first tick that differs, in that scenario only
+	result=1
+	read -r scenario tick _ <<< "$difference"
+	echo "DIFFERS:   $build - first at scenario $scenario tick $tick"
+	run "$referenceBuild" "$work/entities_a.txt" -hash-entities "$tick" "$scenario"
+	run "$build" "$work/entities_b.txt" -hash-entities "$tick" "$scenario"
+	entity=$(paste -d '|' <(grep ' entity ' "$work/entities_a.txt") <(grep ' entity ' "$work/entities_b.txt") |
+		awk -F '|' '$1 != $2 { print ($1 != "" ? $1 : $2); exit }')
+	if [ -n "$entity" ]; then
+		read -r _ _ _ index uid _ entityName <<< "$entity"
+		echo "           first entity that differs: index $index, UID $uid, $entityName"
+	else
+		echo "           all entities match, the random state or messages differ"
+	fi
+done
+exit $result
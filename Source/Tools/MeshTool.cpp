@@ -0,0 +1,106 @@
+/*******************************************
+	MeshTool.cpp
+
+	Command line tool reporting the vertex
+	cache efficiency of meshes before and
+	after optimisation
+********************************************/
+
+#include <stdio.h>
+#include <d3d10.h>
+#include "Defines.h"
+#include "CFatalException.h"
+#include "CImportXFile.h"
+#include "MeshOptimiser.h"
+#include "TraceLog.h"
+
+namespace gen
+{
+
+// Globals used by the shared mesh import code. There is no device, meshes are only imported
+ID3D10Device* g_pd3dDevice = 0;
+CTraceLog TraceLog;
+
+// Import an X-file and print the average cache miss ratio (ACMR) of each sub-mesh before
+// optimisation, after reordering faces for the vertex cache and after reordering them for
+// overdraw. Returns false if the file cannot be imported
+bool ReportMesh( const char* fileName )
+{
+	CImportXFile importFile;
+	if (!CImportXFile::IsXFile( fileName ) || importFile.ImportFile( fileName ) != kSuccess)
+	{
+		return false;
+	}
+
+	printf( "%s\n", fileName );
+	printf( "  Sub-mesh  Vertices     Faces    ACMR  -> Cache -> Overdraw\n" );
+	TUInt32 totalFaces = 0;
+	TFloat32 totalBefore = 0.0f, totalCache = 0.0f, totalOverdraw = 0.0f;
+	for (TUInt32 subMesh = 0; subMesh < importFile.GetNumSubMeshes(); ++subMesh)
+	{
+		SSubMesh data;
+		bool needTangents = RenderMethodUsesTangents( importFile.GetSubMeshRenderMethod( subMesh ) );
+		if (importFile.GetSubMesh( subMesh, &data, needTangents ) != kSuccess)
+		{
+			return false;
+		}
+
+		TFloat32 before = AverageCacheMissRatio( data );
+		OptimiseFaceOrder( &data );
+		TFloat32 cache = AverageCacheMissRatio( data );
+		OptimiseOverdraw( &data );
+		TFloat32 overdraw = AverageCacheMissRatio( data );
+		printf( "  %8u  %8u  %8u   %5.3f     %5.3f    %5.3f\n", subMesh, data.numVertices, data.numFaces,
+		        before, cache, overdraw );
+
+		// Totals weighted by face count, i.e. vertices transformed over the whole mesh
+		totalFaces += data.numFaces;
+		totalBefore += before * data.numFaces;
+		totalCache += cache * data.numFaces;
+		totalOverdraw += overdraw * data.numFaces;
+
+		delete[] data.vertices;
+		delete[] data.faces;
+	}
+	if (totalFaces > 0)
+	{
+		printf( "  Total               %8u   %5.3f     %5.3f    %5.3f\n", totalFaces,
+		        totalBefore / totalFaces, totalCache / totalFaces, totalOverdraw / totalFaces );
+	}
+	return true;
+}
+
+} // namespace gen
+
+
+// Usage: MeshTool file.x [file.x ...]
+int main( int argc, char* argv[] )
+{
+	if (argc < 2)
+	{
+		printf( "Usage: MeshTool file.x [file.x ...]\n"
+		        "Reports the vertex cache miss ratio (ACMR) of each sub-mesh before and after optimisation,\n"
+		        "simulating a %u entry FIFO cache\n", gen::kVertexCacheSize );
+		return 1;
+	}
+
+	int result = 0;
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		bool imported;
+		try
+		{
+			imported = gen::ReportMesh( argv[arg] );
+		}
+		catch (gen::CFatalException&)
+		{
+			imported = false;
+		}
+		if (!imported)
+		{
+			printf( "%s: cannot import mesh\n", argv[arg] );
+			result = 1;
+		}
+	}
+	return result;
+}
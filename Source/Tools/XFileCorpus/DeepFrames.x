@@ -0,0 +1,2 @@
+xof 0303txt 0032
+Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {Frame {}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}}
@@ -0,0 +1,46 @@
+xof 0303txt 0032
+Mesh {
+  4;
+  -1.0;0.0;-1.0;,
+  -1.0;0.0;1.0;,
+  1.0;0.0;-1.0;,
+  1.0;0.0;1.0;;
+  4000000000;
+  3;3;2;0;,
+  3;1;3;0;;
+
+  MeshNormals {
+    4;
+    0.0;1.0;0.0;,
+    0.0;1.0;0.0;,
+    0.0;1.0;0.0;,
+    0.0;1.0;0.0;;
+    2;
+    3;3;2;0;,
+    3;1;3;0;;
+  }
+
+  MeshTextureCoords {
+    4;
+    0.0;0.0;,
+    0.0;-1.0;,
+    1.0;0.0;,
+    1.0;-1.0;;
+  }
+
+  MeshMaterialList {
+    1;
+    2;
+    0,
+    0;
+    Material {
+      1.0;1.0;1.0;1.0;;
+      0.0;
+      0.0;0.0;0.0;;
+      0.0;0.0;0.0;;
+      TextureFilename {
+        "Sand.png";
+      }
+    }
+  }
+}
@@ -0,0 +1 @@
+xof 0303t
\ No newline at end of file
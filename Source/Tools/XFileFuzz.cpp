@@ -0,0 +1,260 @@
+/*******************************************
+	XFileFuzz.cpp
+
+	Command line tool importing a corpus of
+	damaged X-files, and random variants of
+	valid ones, to check that the importer
+	rejects them without crashing
+********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <d3d10.h>
+#include "Defines.h"
+#include "BaseMath.h"
+#include "CFatalException.h"
+#include "CImportXFile.h"
+#include "TraceLog.h"
+
+namespace gen
+{
+
+// Globals used by the shared mesh import code. There is no device, meshes are only imported
+ID3D10Device* g_pd3dDevice = 0;
+CTraceLog TraceLog;
+
+// Each variant of a file is written here then imported. It is left behind if the tool crashes,
+// so the failing file can be examined
+const char* const kVariantFile = "XFileFuzz.x";
+
+
+// Import an X-file and read back everything the mesh loader reads: each sub-mesh with tangents,
+// each node and each material. Returns the importer's result, or kSystemFailure if the importer
+// threw an exception
+EImportError ImportAll( const string& fileName )
+{
+	try
+	{
+		CImportXFile importFile;
+		EImportError error = importFile.ImportFile( fileName );
+		if (error != kSuccess)
+		{
+			return error;
+		}
+
+		for (TUInt32 subMesh = 0; subMesh < importFile.GetNumSubMeshes(); ++subMesh)
+		{
+			SSubMesh data;
+			error = importFile.GetSubMesh( subMesh, &data, true );
+			if (error != kSuccess)
+			{
+				return error;
+			}
+			delete[] data.vertices;
+			delete[] data.faces;
+		}
+		for (TUInt32 node = 0; node < importFile.GetNumNodes(); ++node)
+		{
+			SMeshNode data;
+			importFile.GetNode( node, &data );
+		}
+		for (TUInt32 material = 0; material < importFile.GetNumMaterials(); ++material)
+		{
+			SMeshMaterial data;
+			importFile.GetMaterial( material, &data );
+		}
+		return kSuccess;
+	}
+	catch (CFatalException&)
+	{
+		return kSystemFailure;
+	}
+}
+
+
+// Import each file listed in the corpus file of the given folder and check it is imported or
+// rejected as the list expects. Returns the number of files that were not, or that could not
+// be read
+TUInt32 RunCorpus( const string& folder )
+{
+	string listName = folder + "/Corpus.txt";
+	FILE* list = fopen( listName.c_str(), "r" );
+	if (!list)
+	{
+		printf( "%s: cannot open corpus list\n", listName.c_str() );
+		return 1;
+	}
+
+	TUInt32 numFiles = 0, numFailed = 0;
+	char line[256];
+	while (fgets( line, sizeof(line), list ))
+	{
+		char fileName[128], expected[16];
+		if (line[0] == '#' || sscanf( line, "%127s %15s", fileName, expected ) != 2)
+		{
+			continue;
+		}
+		bool shouldImport = (string( expected ) == "import");
+
+		EImportError error = ImportAll( folder + "/" + fileName );
+		const char* result = (error == kSuccess) ? "imported" :
+		                     (error == kSystemFailure) ? "exception" : "rejected";
+		bool passed = (error != kSystemFailure) && ((error == kSuccess) == shouldImport);
+		printf( "  %-32s %-9s %s\n", fileName, result, passed ? "" : "FAILED" );
+
+		++numFiles;
+		if (!passed)
+		{
+			++numFailed;
+		}
+	}
+	fclose( list );
+
+	printf( "%u corpus files, %u failed\n", numFiles, numFailed );
+	return numFailed;
+}
+
+
+// Change a copy of the given file data in one of three ways chosen at random: cut it short,
+// overwrite some bytes with random values, or write a large count somewhere in it (the value most
+// likely to cause an overflow or huge allocation if a count is trusted)
+vector<TUInt8> MakeVariant( const vector<TUInt8>& data )
+{
+	vector<TUInt8> variant = data;
+	TInt32 last = static_cast<TInt32>(data.size()) - 1;
+	switch (Random( 0, 2 ))
+	{
+		case 0:
+		{
+			variant.resize( Random( 0, last ) );
+			break;
+		}
+		case 1:
+		{
+			TInt32 numBytes = Random( 1, 8 );
+			for (TInt32 byte = 0; byte < numBytes; ++byte)
+			{
+				variant[Random( 0, last )] = static_cast<TUInt8>(RandomBits());
+			}
+			break;
+		}
+		case 2:
+		{
+			// In a text file the count is written as digits, in a binary file as a raw value
+			static const char* const kTextCounts[] = { "4000000000", "2147483647", "65536", "-1" };
+			TUInt32 pos = Random( 0, last );
+			if (data.size() > 12 && data[8] == 't')
+			{
+				string count = kTextCounts[Random( 0, 3 )];
+				variant.insert( variant.begin() + pos, count.begin(), count.end() );
+			}
+			else if (pos + 4 <= data.size())
+			{
+				TUInt32 count = 0x7fffffff >> Random( 0, 16 );
+				memcpy( &variant[pos], &count, 4 );
+			}
+			break;
+		}
+	}
+	return variant;
+}
+
+// Import the given number of random variants of an X-file, seeded so a run can be repeated.
+// The importer may import or reject each one but must not crash or throw. Returns the number of
+// variants that threw, or 1 if the file cannot be read
+TUInt32 RunVariants( const string& fileName, TUInt32 numVariants, TUInt32 seed )
+{
+	vector<TUInt8> data;
+	FILE* file = fopen( fileName.c_str(), "rb" );
+	if (file)
+	{
+		TUInt8 buffer[4096];
+		size_t numRead;
+		while ((numRead = fread( buffer, 1, sizeof(buffer), file )) > 0)
+		{
+			data.insert( data.end(), buffer, buffer + numRead );
+		}
+		fclose( file );
+	}
+	if (data.empty())
+	{
+		printf( "%s: cannot read file\n", fileName.c_str() );
+		return 1;
+	}
+
+	SeedRandom( seed );
+	TUInt32 numImported = 0, numFailed = 0;
+	for (TUInt32 variant = 0; variant < numVariants; ++variant)
+	{
+		vector<TUInt8> variantData = MakeVariant( data );
+		file = fopen( kVariantFile, "wb" );
+		if (!file)
+		{
+			printf( "%s: cannot write file\n", kVariantFile );
+			return 1;
+		}
+		if (!variantData.empty())
+		{
+			fwrite( &variantData[0], 1, variantData.size(), file );
+		}
+		fclose( file );
+
+		EImportError error = ImportAll( kVariantFile );
+		if (error == kSuccess)
+		{
+			++numImported;
+		}
+		else if (error == kSystemFailure)
+		{
+			printf( "  %s variant %u: exception\n", fileName.c_str(), variant );
+			++numFailed;
+		}
+	}
+	remove( kVariantFile );
+
+	printf( "%s: %u variants, %u imported, %u failed\n", fileName.c_str(), numVariants, numImported,
+	        numFailed );
+	return numFailed;
+}
+
+} // namespace gen
+
+
+// Usage: XFileFuzz corpusFolder [-variants count] [-seed seed] [file.x ...]
+int main( int argc, char* argv[] )
+{
+	if (argc < 2)
+	{
+		printf( "Usage: XFileFuzz corpusFolder [-variants count] [-seed seed] [file.x ...]\n"
+		        "Imports each file listed in corpusFolder/Corpus.txt and checks it is imported or rejected as\n"
+		        "listed, then imports random variants (truncated, overwritten, large counts) of each file.x\n"
+		        "given, which must not crash. Variants are written to %s, left behind on a crash\n",
+		        gen::kVariantFile );
+		return 1;
+	}
+
+	gen::TUInt32 numVariants = 1000;
+	gen::TUInt32 seed = 1;
+	gen::TUInt32 numFailed = gen::RunCorpus( argv[1] );
+	for (int arg = 2; arg < argc; ++arg)
+	{
+		if (string( argv[arg] ) == "-variants" && arg + 1 < argc)
+		{
+			numVariants = atoi( argv[++arg] );
+		}
+		else if (string( argv[arg] ) == "-seed" && arg + 1 < argc)
+		{
+			seed = atoi( argv[++arg] );
+		}
+		else
+		{
+			numFailed += gen::RunVariants( argv[arg], numVariants, seed );
+		}
+	}
+	return (numFailed > 0) ? 1 : 0;
+}